@@ -0,0 +1,963 @@
+/***************************************************************************
+*                    Huffman Library Benchmark Program
+*
+*   File    : bench.c
+*   Purpose : Measure how fast and how well each of the Huffman library's
+*             coders encodes and decodes a set of synthetic and real files.
+*   Author  : Michael Dipperstein
+*   Date    : October 14, 2026
+*
+****************************************************************************
+*
+* Huffman: An ANSI C Huffman Encoding/Decoding Routine
+* Copyright (C) 2026 by
+* Michael Dipperstein (mdipperstein@gmail.com)
+*
+* This file is part of the Huffman library.
+*
+* The Huffman library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The Huffman library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L     /* clock_gettime */
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "huffman.h"
+#include "optlist/optlist.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define DEFAULT_RUNS        5           /* timed runs of each coder */
+#define DEFAULT_SIZE        (4UL << 20) /* bytes in each synthetic input */
+#define TINY_SIZE           64          /* bytes in a tiny message */
+#define MIN_RUN_TIME        0.02        /* seconds; short runs are repeated */
+#define TRAIN_SIZE          (64UL << 10)    /* most bytes to train a table on */
+#define TABLE_ID            1
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* an input and everything needed to code it */
+typedef struct bench_t
+{
+    const char *name;           /* name printed for the input */
+    unsigned char *in;          /* data to encode */
+    size_t inLen;               /* number of bytes in in */
+    unsigned char *enc;         /* encoded data */
+    size_t encCap;              /* size of enc */
+    size_t encLen;              /* number of bytes in enc */
+    unsigned char *dec;         /* decoded data */
+    size_t decLen;              /* number of bytes in dec */
+    FILE *inFile;               /* in, for coders that use files */
+    FILE *encFile;              /* encoded data, for coders that use files */
+    FILE *decFile;              /* decoded data, for coders that use files */
+    int numThreads;             /* threads for parallel coders */
+    canonical_table_t *table;   /* table trained on the start of in */
+    canonical_cache_t *cache;   /* cache holding table */
+    huffman_encoder_t *encoder; /* context reused by each encode */
+    huffman_decoder_t *decoder; /* context reused by each decode */
+} bench_t;
+
+/* a coder being measured */
+typedef struct coder_t
+{
+    const char *name;                   /* name printed for the coder */
+    int usesFiles;                      /* 1 if the coder uses the files */
+    int (*encode)(bench_t *bench);      /* encodes in to enc */
+    int (*decode)(bench_t *bench);      /* decodes enc to dec */
+} coder_t;
+
+/* the results of timing a coder on an input */
+typedef struct result_t
+{
+    double encMin, encMedian;           /* seconds per encode */
+    double decMin, decMedian;           /* seconds per decode */
+} result_t;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* coders */
+static int EncodeTraditional(bench_t *bench);
+static int EncodeCompact(bench_t *bench);
+static int DecodeTraditional(bench_t *bench);
+static int EncodeCanonical(bench_t *bench);
+static int DecodeCanonical(bench_t *bench);
+static int EncodeBuffer(bench_t *bench);
+static int DecodeBuffer(bench_t *bench);
+static int EncodeContext(bench_t *bench);
+static int DecodeContext(bench_t *bench);
+static int EncodeStream(bench_t *bench);
+static int DecodeStream(bench_t *bench);
+static int EncodeParallel(bench_t *bench);
+static int DecodeParallel(bench_t *bench);
+static int EncodeOrder1(bench_t *bench);
+static int EncodeTrained(bench_t *bench);
+static int DecodeTrained(bench_t *bench);
+static int CodeFiles(FILE *inFile, FILE *outFile, size_t *outLen,
+    int (*code)(FILE *inFile, FILE *outFile));
+
+/* measuring */
+static int RunInput(bench_t *bench, const int runs);
+static int TimeCoder(bench_t *bench, const coder_t *coder, const int runs,
+    result_t *result);
+static double TimeCalls(bench_t *bench, int (*call)(bench_t *bench));
+static int Verify(bench_t *bench, const coder_t *coder);
+static double Median(double *times, const int count);
+static int CompareTimes(const void *item1, const void *item2);
+static double Now(void);
+
+/* inputs */
+static int Prepare(bench_t *bench);
+static void Release(bench_t *bench);
+static unsigned char *MakeSynthetic(const char *kind, const size_t size);
+static unsigned char *ReadInput(const char *name, size_t *size);
+static unsigned long Random(void);
+
+static void ShowUsage(FILE *stream, char *progPath);
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+/* every coder in the library; new coders get a line here */
+static const coder_t coders[] =
+{
+    {"traditional", 1, EncodeTraditional, DecodeTraditional},
+    {"compact", 1, EncodeCompact, DecodeTraditional},
+    {"canonical", 1, EncodeCanonical, DecodeCanonical},
+    {"buffer", 0, EncodeBuffer, DecodeBuffer},
+    {"context", 0, EncodeContext, DecodeContext},
+    {"stream", 1, EncodeStream, DecodeStream},
+    {"parallel", 1, EncodeParallel, DecodeParallel},
+    {"order1", 1, EncodeOrder1, DecodeParallel},
+    {"trained", 0, EncodeTrained, DecodeTrained}
+};
+
+#define NUM_CODERS  ((int)(sizeof(coders) / sizeof(coders[0])))
+
+/* synthetic inputs, generated with a fixed seed */
+static const char *synthetics[] =
+{
+    "uniform",      /* every byte equally likely */
+    "skewed",       /* geometric distribution, mostly small values */
+    "text",         /* Zipf distribution over 64 symbols */
+    "single",       /* one symbol repeated */
+    "tiny"          /* TINY_SIZE byte message */
+};
+
+#define NUM_SYNTHETICS  ((int)(sizeof(synthetics) / sizeof(synthetics[0])))
+
+static unsigned long seed;          /* state of Random */
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It times
+*                every coder on each synthetic input and each file named
+*                on the command line, and prints the minimum and median
+*                speeds along with the ratio of encoded to original size.
+*   Parameters : argc - number of parameters
+*                argv - parameter list
+*   Effects    : Inputs are coded and results are written to stdout.
+*   Returned   : 0 for success, otherwise errno.
+****************************************************************************/
+int main(int argc, char *argv[])
+{
+    option_t *optList, *thisOpt;
+    bench_t bench;
+    int i, runs, synthetic, status;
+    unsigned long size;
+
+    runs = DEFAULT_RUNS;
+    size = DEFAULT_SIZE;
+    synthetic = 1;
+    bench.numThreads = 4;
+
+    /* parse the options first, files are read after the synthetic data */
+    optList = GetOptList(argc, argv, "n:s:j:xi:h?");
+
+    for (thisOpt = optList; NULL != thisOpt; thisOpt = thisOpt->next)
+    {
+        switch (thisOpt->option)
+        {
+            case 'n':       /* number of timed runs */
+                runs = atoi(thisOpt->argument);
+                break;
+
+            case 's':       /* size of synthetic inputs */
+                size = strtoul(thisOpt->argument, NULL, 0);
+                break;
+
+            case 'j':       /* threads for the parallel coders */
+                bench.numThreads = atoi(thisOpt->argument);
+                break;
+
+            case 'x':       /* skip synthetic inputs */
+                synthetic = 0;
+                break;
+
+            case 'h':
+            case '?':
+                ShowUsage(stdout, argv[0]);
+                FreeOptList(optList);
+                return 0;
+        }
+    }
+
+    if ((runs < 1) || (0 == size) || (bench.numThreads < 1))
+    {
+        fprintf(stderr, "Invalid option value.\n\n");
+        ShowUsage(stderr, argv[0]);
+        FreeOptList(optList);
+        return EINVAL;
+    }
+
+    printf("%-12s %-11s %9s %7s %9s %9s %9s %9s\n", "input", "coder",
+        "bytes", "ratio", "enc min", "enc med", "dec min", "dec med");
+    printf("%-12s %-11s %9s %7s %9s %9s %9s %9s\n", "", "", "", "",
+        "MB/s", "MB/s", "MB/s", "MB/s");
+    status = 0;
+
+    for (i = 0; synthetic && (i < NUM_SYNTHETICS) && (0 == status); i++)
+    {
+        bench.name = synthetics[i];
+        bench.inLen = (0 == strcmp(synthetics[i], "tiny")) ?
+            TINY_SIZE : size;
+        bench.in = MakeSynthetic(synthetics[i], bench.inLen);
+        status = (0 == RunInput(&bench, runs)) ? 0 : -1;
+    }
+
+    for (thisOpt = optList; (NULL != thisOpt) && (0 == status);
+        thisOpt = thisOpt->next)
+    {
+        if ('i' != thisOpt->option)
+        {
+            continue;
+        }
+
+        bench.name = FindFileName(thisOpt->argument);
+        bench.in = ReadInput(thisOpt->argument, &bench.inLen);
+        status = (0 == RunInput(&bench, runs)) ? 0 : -1;
+    }
+
+    FreeOptList(optList);
+
+    /* failures have already been reported */
+    if (0 != status)
+    {
+        return (0 != errno) ? errno : EILSEQ;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : RunInput
+*   Description: This function times every coder on one input and prints
+*                the results.  The input is released when it's done.
+*   Parameters : bench - pointer to the input (bench->in may be NULL if it
+*                        couldn't be made)
+*                runs - number of timed runs of each coder
+*   Effects    : The input is coded and a line is printed for each coder.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int RunInput(bench_t *bench, const int runs)
+{
+    int i;
+    double start, build, mb;
+    result_t result;
+
+    if (NULL == bench->in)
+    {
+        return -1;
+    }
+
+    if (0 != Prepare(bench))
+    {
+        Release(bench);
+        return -1;
+    }
+
+    /* building a code is a histogram and a tree, the same as any encoder */
+    start = Now();
+    bench->table = CanonicalTrainTable(bench->in,
+        (bench->inLen < TRAIN_SIZE) ? bench->inLen : TRAIN_SIZE, TABLE_ID);
+    build = Now() - start;
+
+    if ((NULL == bench->table) ||
+        (0 != CanonicalCacheAdd(bench->cache, bench->table)))
+    {
+        CanonicalFreeTable(bench->table);
+        bench->table = NULL;
+        Release(bench);
+        return -1;
+    }
+
+    mb = (double)bench->inLen / (1024.0 * 1024.0);
+
+    for (i = 0; i < NUM_CODERS; i++)
+    {
+        if (0 != TimeCoder(bench, &coders[i], runs, &result))
+        {
+            perror(coders[i].name);
+            Release(bench);
+            return -1;
+        }
+
+        printf("%-12.12s %-11s %9lu %6.2f%% %9.1f %9.1f %9.1f %9.1f\n",
+            bench->name, coders[i].name, (unsigned long)bench->encLen,
+            (0 == bench->inLen) ? 0.0 :
+            (100.0 * bench->encLen) / bench->inLen,
+            mb / result.encMin, mb / result.encMedian,
+            mb / result.decMin, mb / result.decMedian);
+    }
+
+    printf("%-12.12s table build (%lu bytes) %.3f ms\n\n", bench->name,
+        (unsigned long)((bench->inLen < TRAIN_SIZE) ?
+        bench->inLen : TRAIN_SIZE), build * 1000.0);
+    fflush(stdout);
+
+    Release(bench);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : TimeCoder
+*   Description: This function times a number of encodes and decodes of an
+*                input with one coder, then checks that the last decode
+*                matches the input.
+*   Parameters : bench - pointer to the input
+*                coder - pointer to the coder to time
+*                runs - number of timed runs
+*                result - pointer to the times measured
+*   Effects    : The input is coded and row results are stored.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int TimeCoder(bench_t *bench, const coder_t *coder, const int runs,
+    result_t *result)
+{
+    int i;
+    double *encTimes, *decTimes;
+
+    encTimes = (double *)malloc(2 * runs * sizeof(double));
+
+    if (NULL == encTimes)
+    {
+        return -1;
+    }
+
+    decTimes = encTimes + runs;
+
+    /* an untimed round trip warms up caches and catches failures */
+    if ((0 != coder->encode(bench)) || (0 != coder->decode(bench)) ||
+        (0 != Verify(bench, coder)))
+    {
+        free(encTimes);
+        return -1;
+    }
+
+    for (i = 0; i < runs; i++)
+    {
+        encTimes[i] = TimeCalls(bench, coder->encode);
+        decTimes[i] = TimeCalls(bench, coder->decode);
+
+        if ((encTimes[i] < 0) || (decTimes[i] < 0))
+        {
+            free(encTimes);
+            return -1;
+        }
+    }
+
+    result->encMedian = Median(encTimes, runs);
+    result->decMedian = Median(decTimes, runs);
+
+    /* Median sorted the times */
+    result->encMin = encTimes[0];
+    result->decMin = decTimes[0];
+
+    free(encTimes);
+    return Verify(bench, coder);
+}
+
+/****************************************************************************
+*   Function   : TimeCalls
+*   Description: This function times a coding function.  Calls that take
+*                less than MIN_RUN_TIME are repeated until MIN_RUN_TIME has
+*                passed, so the time of short calls can be measured.
+*   Parameters : bench - pointer to the input
+*                call - the coding function to time
+*   Effects    : The coding function is called at least once.
+*   Returned   : The average number of seconds per call, or -1 if a call
+*                failed.
+****************************************************************************/
+static double TimeCalls(bench_t *bench, int (*call)(bench_t *bench))
+{
+    double start, elapsed;
+    unsigned long calls;
+
+    start = Now();
+    calls = 0;
+
+    do
+    {
+        if (0 != call(bench))
+        {
+            return -1;
+        }
+
+        calls++;
+        elapsed = Now() - start;
+    } while (elapsed < MIN_RUN_TIME);
+
+    return elapsed / calls;
+}
+
+/****************************************************************************
+*   Function   : Verify
+*   Description: This function checks that the last decode produced the
+*                original input.
+*   Parameters : bench - pointer to the input
+*                coder - pointer to the coder that decoded the input
+*   Effects    : Decoded files are read back into bench->dec.
+*   Returned   : 0 if the decoded data matches the input, otherwise -1.
+****************************************************************************/
+static int Verify(bench_t *bench, const coder_t *coder)
+{
+    if (coder->usesFiles)
+    {
+        rewind(bench->decFile);
+
+        if ((bench->decLen != bench->inLen) ||
+            (fread(bench->dec, 1, bench->decLen, bench->decFile) !=
+            bench->decLen))
+        {
+            errno = EILSEQ;
+            return -1;
+        }
+    }
+
+    if ((bench->decLen != bench->inLen) ||
+        (0 != memcmp(bench->in, bench->dec, bench->inLen)))
+    {
+        fprintf(stderr, "error: %s decoded %s incorrectly.\n",
+            coder->name, bench->name);
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : Median
+*   Description: This function finds the median of a list of times.
+*   Parameters : times - pointer to the times
+*                count - number of times
+*   Effects    : times is sorted.
+*   Returned   : The median time.
+****************************************************************************/
+static double Median(double *times, const int count)
+{
+    qsort(times, count, sizeof(double), CompareTimes);
+
+    if (count % 2)
+    {
+        return times[count / 2];
+    }
+
+    return (times[count / 2 - 1] + times[count / 2]) / 2.0;
+}
+
+/****************************************************************************
+*   Function   : CompareTimes
+*   Description: Compare function to be used by qsort for sorting times.
+*   Parameters : item1 - pointer to a time
+*                item2 - pointer to a time
+*   Effects    : None
+*   Returned   : 1 if item1 > item2
+*                -1 if item1 < item 2
+*                0 if item1 == item2
+****************************************************************************/
+static int CompareTimes(const void *item1, const void *item2)
+{
+    double t1, t2;
+
+    t1 = *(const double *)item1;
+    t2 = *(const double *)item2;
+
+    return (t1 > t2) - (t1 < t2);
+}
+
+/****************************************************************************
+*   Function   : Now
+*   Description: This function returns the current time for measuring
+*                intervals.  A monotonic wall clock is used where POSIX
+*                timers are available, so threads aren't counted twice.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : The current time in seconds.
+****************************************************************************/
+static double Now(void)
+{
+#if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/****************************************************************************
+*   Function   : CodeFiles
+*   Description: This function rewinds a pair of files and codes one into
+*                the other.  Each run writes the same number of bytes, so
+*                the output file doesn't need to be truncated.
+*   Parameters : inFile - file to code
+*                outFile - file receiving coded data
+*                outLen - pointer to the number of bytes written
+*                code - library function that codes inFile to outFile
+*   Effects    : inFile is coded into outFile.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int CodeFiles(FILE *inFile, FILE *outFile, size_t *outLen,
+    int (*code)(FILE *inFile, FILE *outFile))
+{
+    long len;
+
+    rewind(inFile);
+    rewind(outFile);
+
+    if ((0 != code(inFile, outFile)) || (0 != fflush(outFile)) ||
+        ((len = ftell(outFile)) < 0))
+    {
+        return -1;
+    }
+
+    *outLen = (size_t)len;
+    return 0;
+}
+
+/***************************************************************************
+* Coders.  Each one encodes bench->in to bench->enc (or bench->encFile) and
+* decodes back to bench->dec (or bench->decFile).
+***************************************************************************/
+static int EncodeTraditional(bench_t *bench)
+{
+    return CodeFiles(bench->inFile, bench->encFile, &bench->encLen,
+        HuffmanEncodeFile);
+}
+
+static int EncodeCompact(bench_t *bench)
+{
+    return CodeFiles(bench->inFile, bench->encFile, &bench->encLen,
+        HuffmanEncodeFileCompact);
+}
+
+static int DecodeTraditional(bench_t *bench)
+{
+    return CodeFiles(bench->encFile, bench->decFile, &bench->decLen,
+        HuffmanDecodeFile);
+}
+
+static int EncodeCanonical(bench_t *bench)
+{
+    return CodeFiles(bench->inFile, bench->encFile, &bench->encLen,
+        CanonicalEncodeFile);
+}
+
+static int DecodeCanonical(bench_t *bench)
+{
+    return CodeFiles(bench->encFile, bench->decFile, &bench->decLen,
+        CanonicalDecodeFile);
+}
+
+static int EncodeBuffer(bench_t *bench)
+{
+    return CanonicalEncodeBuffer(bench->in, bench->inLen, bench->enc,
+        bench->encCap, &bench->encLen);
+}
+
+static int DecodeBuffer(bench_t *bench)
+{
+    return CanonicalDecodeBuffer(bench->enc, bench->encLen, bench->dec,
+        bench->inLen, &bench->decLen);
+}
+
+static int EncodeContext(bench_t *bench)
+{
+    return HuffmanEncodeMessage(bench->encoder, bench->in, bench->inLen,
+        bench->enc, bench->encCap, &bench->encLen);
+}
+
+static int DecodeContext(bench_t *bench)
+{
+    return HuffmanDecodeMessage(bench->decoder, bench->enc, bench->encLen,
+        bench->dec, bench->inLen, &bench->decLen);
+}
+
+static int EncodeStream(bench_t *bench)
+{
+    return CodeFiles(bench->inFile, bench->encFile, &bench->encLen,
+        CanonicalEncodeStream);
+}
+
+static int DecodeStream(bench_t *bench)
+{
+    return CodeFiles(bench->encFile, bench->decFile, &bench->decLen,
+        CanonicalDecodeStream);
+}
+
+static int EncodeParallel(bench_t *bench)
+{
+    long len;
+
+    rewind(bench->inFile);
+    rewind(bench->encFile);
+
+    if ((0 != CanonicalEncodeStreamParallel(bench->inFile, bench->encFile,
+        bench->numThreads)) || (0 != fflush(bench->encFile)) ||
+        ((len = ftell(bench->encFile)) < 0))
+    {
+        return -1;
+    }
+
+    bench->encLen = (size_t)len;
+    return 0;
+}
+
+static int DecodeParallel(bench_t *bench)
+{
+    long len;
+
+    rewind(bench->encFile);
+    rewind(bench->decFile);
+
+    if ((0 != CanonicalDecodeStreamParallel(bench->encFile, bench->decFile,
+        bench->numThreads)) || (0 != fflush(bench->decFile)) ||
+        ((len = ftell(bench->decFile)) < 0))
+    {
+        return -1;
+    }
+
+    bench->decLen = (size_t)len;
+    return 0;
+}
+
+static int EncodeOrder1(bench_t *bench)
+{
+    long len;
+
+    rewind(bench->inFile);
+    rewind(bench->encFile);
+
+    if ((0 != CanonicalEncodeStreamOrder1(bench->inFile, bench->encFile,
+        bench->numThreads)) || (0 != fflush(bench->encFile)) ||
+        ((len = ftell(bench->encFile)) < 0))
+    {
+        return -1;
+    }
+
+    bench->encLen = (size_t)len;
+    return 0;
+}
+
+static int EncodeTrained(bench_t *bench)
+{
+    return CanonicalEncodeWithTable(bench->table, bench->in, bench->inLen,
+        bench->enc, bench->encCap, &bench->encLen);
+}
+
+static int DecodeTrained(bench_t *bench)
+{
+    return CanonicalDecodeWithCache(bench->cache, bench->enc, bench->encLen,
+        bench->dec, bench->inLen, &bench->decLen);
+}
+
+/****************************************************************************
+*   Function   : Prepare
+*   Description: This function allocates the buffers and temporary files
+*                used to code an input.
+*   Parameters : bench - pointer to the input
+*   Effects    : Buffers and files are created, and the input is written
+*                to bench->inFile.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int Prepare(bench_t *bench)
+{
+    bench->encCap = CanonicalEncodeBound(bench->inLen);
+    bench->enc = (unsigned char *)malloc(bench->encCap);
+    bench->dec = (unsigned char *)malloc(bench->inLen + 1);
+    bench->encLen = 0;
+    bench->decLen = 0;
+    bench->inFile = tmpfile();
+    bench->encFile = tmpfile();
+    bench->decFile = tmpfile();
+    bench->table = NULL;
+    bench->cache = CanonicalCreateCache();
+    bench->encoder = HuffmanCreateEncoder();
+    bench->decoder = HuffmanCreateDecoder();
+
+    if ((0 == bench->encCap) || (NULL == bench->enc) ||
+        (NULL == bench->dec) || (NULL == bench->inFile) ||
+        (NULL == bench->encFile) || (NULL == bench->decFile) ||
+        (NULL == bench->cache) || (NULL == bench->encoder) ||
+        (NULL == bench->decoder))
+    {
+        perror("Preparing Input");
+        return -1;
+    }
+
+    if ((fwrite(bench->in, 1, bench->inLen, bench->inFile) != bench->inLen)
+        || (0 != fflush(bench->inFile)))
+    {
+        perror("Writing Input");
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : Release
+*   Description: This function frees everything allocated for an input.
+*   Parameters : bench - pointer to the input
+*   Effects    : Buffers are freed and temporary files are closed.
+*   Returned   : None
+****************************************************************************/
+static void Release(bench_t *bench)
+{
+    free(bench->in);
+    free(bench->enc);
+    free(bench->dec);
+    bench->in = NULL;
+    bench->enc = NULL;
+    bench->dec = NULL;
+
+    if (NULL != bench->inFile)
+    {
+        fclose(bench->inFile);
+    }
+
+    if (NULL != bench->encFile)
+    {
+        fclose(bench->encFile);
+    }
+
+    if (NULL != bench->decFile)
+    {
+        fclose(bench->decFile);
+    }
+
+    bench->inFile = NULL;
+    bench->encFile = NULL;
+    bench->decFile = NULL;
+
+    /* the cache owns the table */
+    CanonicalFreeCache(bench->cache);
+    bench->cache = NULL;
+    bench->table = NULL;
+
+    HuffmanFreeEncoder(bench->encoder);
+    HuffmanFreeDecoder(bench->decoder);
+    bench->encoder = NULL;
+    bench->decoder = NULL;
+}
+
+/****************************************************************************
+*   Function   : MakeSynthetic
+*   Description: This function generates a synthetic input.  The same seed
+*                is used every time, so results may be compared between
+*                runs.
+*   Parameters : kind - the kind of input (one of synthetics)
+*                size - number of bytes to generate
+*   Effects    : Memory is allocated for the input.
+*   Returned   : Pointer to the input, or NULL for failure.
+****************************************************************************/
+static unsigned char *MakeSynthetic(const char *kind, const size_t size)
+{
+    unsigned char *data;
+    size_t i;
+    unsigned long r, total;
+    int c, bits;
+    unsigned long zipf[64];     /* cumulative odds of each text symbol */
+
+    /* symbol n (counting from 1) is chosen with odds 1/n */
+    total = 0;
+
+    for (c = 0; c < 64; c++)
+    {
+        total += 65536UL / (c + 1);
+        zipf[c] = total;
+    }
+
+    data = (unsigned char *)malloc(size + 1);
+
+    if (NULL == data)
+    {
+        perror("Allocating Input");
+        return NULL;
+    }
+
+    seed = 1;
+
+    for (i = 0; i < size; i++)
+    {
+        r = Random();
+
+        if (0 == strcmp(kind, "uniform"))
+        {
+            c = (int)(r & 0xFF);
+        }
+        else if (0 == strcmp(kind, "single"))
+        {
+            c = 'a';
+        }
+        else if (0 == strcmp(kind, "text"))
+        {
+            r %= total;
+
+            for (c = 0; zipf[c] <= r; c++)
+            {
+                /* find the symbol whose odds r falls in */
+            }
+
+            c += ' ';
+        }
+        else
+        {
+            /* skewed and tiny: each value is half as likely as the last */
+            bits = 24;
+
+            for (c = 0; (c < 255) && (r & 1); c++)
+            {
+                r >>= 1;
+
+                if (0 == --bits)
+                {
+                    r = Random();
+                    bits = 24;
+                }
+            }
+        }
+
+        data[i] = (unsigned char)c;
+    }
+
+    return data;
+}
+
+/****************************************************************************
+*   Function   : ReadInput
+*   Description: This function reads a whole file into memory.
+*   Parameters : name - name of the file
+*                size - pointer to the number of bytes read
+*   Effects    : Memory is allocated for the file.
+*   Returned   : Pointer to the file's contents, or NULL for failure.
+****************************************************************************/
+static unsigned char *ReadInput(const char *name, size_t *size)
+{
+    FILE *fp;
+    unsigned char *data;
+    long len;
+
+    *size = 0;
+
+    if (NULL == (fp = fopen(name, "rb")))
+    {
+        perror(name);
+        return NULL;
+    }
+
+    data = NULL;
+
+    if ((0 == fseek(fp, 0, SEEK_END)) && ((len = ftell(fp)) >= 0) &&
+        (0 == fseek(fp, 0, SEEK_SET)))
+    {
+        data = (unsigned char *)malloc((size_t)len + 1);
+
+        if ((NULL != data) && (fread(data, 1, (size_t)len, fp) != (size_t)len))
+        {
+            free(data);
+            data = NULL;
+        }
+
+        *size = (size_t)len;
+    }
+
+    if (NULL == data)
+    {
+        perror(name);
+    }
+
+    fclose(fp);
+    return data;
+}
+
+/****************************************************************************
+*   Function   : Random
+*   Description: This function generates pseudo random numbers with a
+*                linear congruential generator, so synthetic inputs are
+*                the same on every system.
+*   Parameters : None
+*   Effects    : seed is advanced.
+*   Returned   : A pseudo random number of at least 16 bits.
+****************************************************************************/
+static unsigned long Random(void)
+{
+    seed = (seed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+    return (seed >> 8) & 0xFFFFFFUL;
+}
+
+/****************************************************************************
+*   Function   : ShowUsage
+*   Description: This function sends instructions for using this program to
+*                a stream.
+*   Parameters : stream - output stream receiving instructions.
+*                progPath - the name + path to the executable version of this
+*                           program.
+*   Effects    : Usage instructions are sent to stream.
+*   Returned   : None
+****************************************************************************/
+static void ShowUsage(FILE *stream, char *progPath)
+{
+    fprintf(stream, "Usage: %s <options>\n\n", FindFileName(progPath));
+    fprintf(stream, "options:\n");
+    fprintf(stream,
+        "  -i<filename> : Add a file to the inputs (may be repeated).\n");
+    fprintf(stream, "  -n<runs> : Number of timed runs (default %d).\n",
+        DEFAULT_RUNS);
+    fprintf(stream,
+        "  -s<bytes> : Size of synthetic inputs (default %lu).\n",
+        DEFAULT_SIZE);
+    fprintf(stream,
+        "  -j<threads> : Threads for the parallel coder (default 4).\n");
+    fprintf(stream, "  -x : Skip the synthetic inputs.\n");
+    fprintf(stream, "  -h|?  : Print out command line options.\n\n");
+}
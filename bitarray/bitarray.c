@@ -78,6 +78,10 @@
 /* most significant bit in a character */
 #define MS_BIT                (1 << (CHAR_BIT - 1))
 
+/* characters and bits in the words that shifts and carries work on */
+#define WORD_CHARS            (sizeof(unsigned long))
+#define WORD_BIT              (WORD_CHARS * CHAR_BIT)
+
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
@@ -597,6 +601,82 @@ int BitArrayNot(const bit_array_t *const dest,
     return 0;
 }
 
+/***************************************************************************
+*   Function   : GetWord
+*   Description: This function reads WORD_CHARS unsigned chars of a bit
+*                array as a single unsigned long.  The first char is the
+*                most significant, so the bits stay in the same order.
+*   Parameters : chars - pointer to the first char to read
+*   Effects    : None
+*   Returned   : The chars as an unsigned long.
+***************************************************************************/
+static unsigned long GetWord(const unsigned char *chars)
+{
+#if (8 == CHAR_BIT) && (ULONG_MAX == 0xFFFFFFFFUL)
+    return ((unsigned long)chars[0] << 24) | ((unsigned long)chars[1] << 16) |
+        ((unsigned long)chars[2] << 8) | (unsigned long)chars[3];
+#elif (8 == CHAR_BIT) && ((ULONG_MAX >> 31 >> 31) == 3)
+    /* written out so that compilers can make it a single load */
+    return ((unsigned long)chars[0] << 56) | ((unsigned long)chars[1] << 48) |
+        ((unsigned long)chars[2] << 40) | ((unsigned long)chars[3] << 32) |
+        ((unsigned long)chars[4] << 24) | ((unsigned long)chars[5] << 16) |
+        ((unsigned long)chars[6] << 8) | (unsigned long)chars[7];
+#else
+    unsigned i;
+    unsigned long word;
+
+    word = 0;
+
+    for (i = 0; i < WORD_CHARS; i++)
+    {
+        word = (word << CHAR_BIT) | chars[i];
+    }
+
+    return word;
+#endif
+}
+
+/***************************************************************************
+*   Function   : PutWord
+*   Description: This function writes an unsigned long to WORD_CHARS
+*                unsigned chars of a bit array in the order read by
+*                GetWord.
+*   Parameters : chars - pointer to the first char to write
+*                word - value to write
+*   Effects    : WORD_CHARS chars starting at chars are written.
+*   Returned   : None
+***************************************************************************/
+static void PutWord(unsigned char *chars, const unsigned long word)
+{
+#if (8 == CHAR_BIT) && (ULONG_MAX == 0xFFFFFFFFUL)
+    chars[0] = (unsigned char)(word >> 24);
+    chars[1] = (unsigned char)(word >> 16);
+    chars[2] = (unsigned char)(word >> 8);
+    chars[3] = (unsigned char)word;
+#elif (8 == CHAR_BIT) && ((ULONG_MAX >> 31 >> 31) == 3)
+    /* written out so that compilers can make it a single store */
+    chars[0] = (unsigned char)(word >> 56);
+    chars[1] = (unsigned char)(word >> 48);
+    chars[2] = (unsigned char)(word >> 40);
+    chars[3] = (unsigned char)(word >> 32);
+    chars[4] = (unsigned char)(word >> 24);
+    chars[5] = (unsigned char)(word >> 16);
+    chars[6] = (unsigned char)(word >> 8);
+    chars[7] = (unsigned char)word;
+#else
+    unsigned i;
+    unsigned long value;
+
+    value = word;
+
+    for (i = WORD_CHARS; i > 0; i--)
+    {
+        chars[i - 1] = (unsigned char)value;
+        value >>= CHAR_BIT;
+    }
+#endif
+}
+
 /***************************************************************************
 *   Function   : BitArrayShiftLeft
 *   Description: This function shifts the bits in a bit array to the left
@@ -612,8 +692,8 @@ int BitArrayNot(const bit_array_t *const dest,
 int BitArrayShiftLeft(const bit_array_t *const ba, unsigned int shifts)
 {
     unsigned i;
-    unsigned j;
     unsigned chars;
+    unsigned last;
 
     if (NULL == ba)
     {
@@ -621,9 +701,6 @@ int BitArrayShiftLeft(const bit_array_t *const ba, unsigned int shifts)
         return -1;      /* not permitted on NULL array */
     }
 
-    chars = shifts / CHAR_BIT;      /* number of whole byte shifts */
-    shifts = shifts % CHAR_BIT;     /* number of bit shifts remaining */
-
     if (shifts >= ba->numBits)
     {
         /* all bits have been shifted off */
@@ -631,38 +708,42 @@ int BitArrayShiftLeft(const bit_array_t *const ba, unsigned int shifts)
         return 0;
     }
 
-    /* first handle big jumps of bytes */
+    chars = shifts / CHAR_BIT;      /* number of whole byte shifts */
+    shifts = shifts % CHAR_BIT;     /* number of bit shifts remaining */
+    last = BIT_CHAR(ba->numBits - 1);
+
+    /* first handle big jumps of bytes, then zero the new bytes on the right */
     if (chars != 0)
     {
-        for (i = 0; (i + chars) <  BITS_TO_CHARS(ba->numBits); i++)
-        {
-            ba->array[i] = ba->array[i + chars];
-        }
-
-        /* now zero out new bytes on the right */
-        for (i = BITS_TO_CHARS(ba->numBits); chars != 0; chars--)
-        {
-            ba->array[i - chars] = 0;
-        }
+        memmove(ba->array, ba->array + chars, last + 1 - chars);
+        memset(ba->array + last + 1 - chars, 0, chars);
     }
 
-    /* now we have at most CHAR_BIT - 1 bit shifts across the whole array */
-    for (i = 0; i < shifts; i++)
+    if (0 == shifts)
     {
-        for (j = 0; j < BIT_CHAR(ba->numBits - 1); j++)
-        {
-            ba->array[j] <<= 1;
+        return 0;
+    }
 
-            /* handle shifts across byte bounds */
-            if (ba->array[j + 1] & MS_BIT)
-            {
-                ba->array[j] |= 0x01;
-            }
-        }
+    /***********************************************************************
+    * Now shift every byte by the remaining bits in one pass, a word at a
+    * time while there's a whole word and the byte after it.  Each byte
+    * takes its low bits from the byte after it, which hasn't been shifted
+    * yet.
+    ***********************************************************************/
+    for (i = 0; i + WORD_CHARS <= last; i += WORD_CHARS)
+    {
+        PutWord(ba->array + i, (GetWord(ba->array + i) << shifts) |
+            (ba->array[i + WORD_CHARS] >> (CHAR_BIT - shifts)));
+    }
 
-        ba->array[BIT_CHAR(ba->numBits - 1)] <<= 1;
+    for (; i < last; i++)
+    {
+        ba->array[i] = (unsigned char)((ba->array[i] << shifts) |
+            (ba->array[i + 1] >> (CHAR_BIT - shifts)));
     }
 
+    ba->array[last] = (unsigned char)(ba->array[last] << shifts);
+
     return 0;
 }
 
@@ -681,9 +762,9 @@ int BitArrayShiftLeft(const bit_array_t *const ba, unsigned int shifts)
 int BitArrayShiftRight(const bit_array_t *const ba, unsigned int shifts)
 {
     unsigned i;
-    unsigned j;
     unsigned char mask;
     unsigned chars;
+    unsigned last;
 
     if (NULL == ba)
     {
@@ -691,9 +772,6 @@ int BitArrayShiftRight(const bit_array_t *const ba, unsigned int shifts)
         return -1;      /* not permitted on NULL array */
     }
 
-    chars = shifts / CHAR_BIT;      /* number of whole byte shifts */
-    shifts = shifts % CHAR_BIT;     /* number of bit shifts remaining */
-
     if (shifts >= ba->numBits)
     {
         /* all bits have been shifted off */
@@ -701,36 +779,40 @@ int BitArrayShiftRight(const bit_array_t *const ba, unsigned int shifts)
         return 0;
     }
 
-    /* first handle big jumps of bytes */
+    chars = shifts / CHAR_BIT;      /* number of whole byte shifts */
+    shifts = shifts % CHAR_BIT;     /* number of bit shifts remaining */
+    last = BIT_CHAR(ba->numBits - 1);
+
+    /* first handle big jumps of bytes, then zero the new bytes on the left */
     if (chars > 0)
     {
-        for (i = BIT_CHAR(ba->numBits - 1); i >= chars; i--)
-        {
-            ba->array[i] = ba->array[i - chars];
-        }
-
-        /* now zero out new bytes on the right */
-        for (; chars > 0; chars--)
-        {
-            ba->array[chars - 1] = 0;
-        }
+        memmove(ba->array + chars, ba->array, last + 1 - chars);
+        memset(ba->array, 0, chars);
     }
 
-    /* now we have at most CHAR_BIT - 1 bit shifts across the whole array */
-    for (i = 0; i < shifts; i++)
+    if (shifts != 0)
     {
-        for (j = BIT_CHAR(ba->numBits - 1); j > 0; j--)
+        /*******************************************************************
+        * Now shift every byte by the remaining bits in one pass from the
+        * right, a word at a time while there's a whole word and the byte
+        * before it.  Each byte takes its high bits from the byte before
+        * it, which hasn't been shifted yet.
+        *******************************************************************/
+        for (i = last + 1; i > WORD_CHARS; i -= WORD_CHARS)
         {
-            ba->array[j] >>= 1;
+            PutWord(ba->array + i - WORD_CHARS,
+                (GetWord(ba->array + i - WORD_CHARS) >> shifts) |
+                ((unsigned long)ba->array[i - WORD_CHARS - 1] <<
+                (WORD_BIT - shifts)));
+        }
 
-            /* handle shifts across byte bounds */
-            if (ba->array[j - 1] & 0x01)
-            {
-                ba->array[j] |= MS_BIT;
-            }
+        for (i--; i > 0; i--)
+        {
+            ba->array[i] = (unsigned char)((ba->array[i] >> shifts) |
+                (ba->array[i - 1] << (CHAR_BIT - shifts)));
         }
 
-        ba->array[0] >>= 1;
+        ba->array[0] >>= shifts;
     }
 
     /***********************************************************************
@@ -741,7 +823,7 @@ int BitArrayShiftRight(const bit_array_t *const ba, unsigned int shifts)
     if (i != 0)
     {
         mask = UCHAR_MAX << (CHAR_BIT - i);
-        ba->array[BIT_CHAR(ba->numBits - 1)] &= mask;
+        ba->array[last] &= mask;
     }
 
     return 0;
@@ -760,9 +842,9 @@ int BitArrayShiftRight(const bit_array_t *const ba, unsigned int shifts)
 ***************************************************************************/
 int BitArrayIncrement(const bit_array_t *const ba)
 {
-    int i;
-    unsigned char maxValue;     /* maximum value for current char */
-    unsigned char one;          /* least significant bit in current char */
+    unsigned i;
+    unsigned char maxValue;     /* maximum value for last char */
+    unsigned char one;          /* least significant bit in last char */
 
     if (NULL == ba)
     {
@@ -783,22 +865,39 @@ int BitArrayIncrement(const bit_array_t *const ba)
         one = 1;
     }
 
-    for (i = BIT_CHAR(ba->numBits - 1); i >= 0; i--)
+    i = BIT_CHAR(ba->numBits - 1);
+
+    if (ba->array[i] != maxValue)
     {
-        if (ba->array[i] != maxValue)
+        ba->array[i] = ba->array[i] + one;
+        return 0;
+    }
+
+    /* need to carry, the remaining characters use all bits */
+    ba->array[i] = 0;
+
+    /* carry through whole words while they're all ones */
+    for (; i >= WORD_CHARS; i -= WORD_CHARS)
+    {
+        if (ULONG_MAX != GetWord(ba->array + i - WORD_CHARS))
         {
-            ba->array[i] = ba->array[i] + one;
+            PutWord(ba->array + i - WORD_CHARS,
+                GetWord(ba->array + i - WORD_CHARS) + 1);
             return 0;
         }
-        else
-        {
-            /* need to carry to next byte */
-            ba->array[i] = 0;
 
-            /* remaining characters must use all bits */
-            maxValue = UCHAR_MAX;
-            one = 1;
+        memset(ba->array + i - WORD_CHARS, 0, WORD_CHARS);
+    }
+
+    for (; i > 0; i--)
+    {
+        if (ba->array[i - 1] != UCHAR_MAX)
+        {
+            ba->array[i - 1]++;
+            return 0;
         }
+
+        ba->array[i - 1] = 0;
     }
 
     return 0;
@@ -817,9 +916,9 @@ int BitArrayIncrement(const bit_array_t *const ba)
 ***************************************************************************/
 int BitArrayDecrement(const bit_array_t *const ba)
 {
-    int i;
-    unsigned char maxValue;     /* maximum value for current char */
-    unsigned char one;          /* least significant bit in current char */
+    unsigned i;
+    unsigned char maxValue;     /* maximum value for last char */
+    unsigned char one;          /* least significant bit in last char */
 
     if (NULL == ba)
     {
@@ -840,22 +939,39 @@ int BitArrayDecrement(const bit_array_t *const ba)
         one = 1;
     }
 
-    for (i = BIT_CHAR(ba->numBits - 1); i >= 0; i--)
+    i = BIT_CHAR(ba->numBits - 1);
+
+    if (ba->array[i] >= one)
+    {
+        ba->array[i] = ba->array[i] - one;
+        return 0;
+    }
+
+    /* need to borrow, the remaining characters use all bits */
+    ba->array[i] = maxValue;
+
+    /* borrow through whole words while they're all zeros */
+    for (; i >= WORD_CHARS; i -= WORD_CHARS)
     {
-        if (ba->array[i] >= one)
+        if (0 != GetWord(ba->array + i - WORD_CHARS))
         {
-            ba->array[i] = ba->array[i] - one;
+            PutWord(ba->array + i - WORD_CHARS,
+                GetWord(ba->array + i - WORD_CHARS) - 1);
             return 0;
         }
-        else
-        {
-            /* need to borrow from the next byte */
-            ba->array[i] = maxValue;
 
-            /* remaining characters must use all bits */
-            maxValue = UCHAR_MAX;
-            one = 1;
+        memset(ba->array + i - WORD_CHARS, UCHAR_MAX, WORD_CHARS);
+    }
+
+    for (; i > 0; i--)
+    {
+        if (ba->array[i - 1] != 0)
+        {
+            ba->array[i - 1]--;
+            return 0;
         }
+
+        ba->array[i - 1] = UCHAR_MAX;
     }
 
     return 0;
@@ -873,8 +989,6 @@ int BitArrayDecrement(const bit_array_t *const ba)
 ***************************************************************************/
 int BitArrayCompare(const bit_array_t *ba1, const bit_array_t *ba2)
 {
-    unsigned i;
-
     if (ba1 == NULL)
     {
         if (ba2 == NULL)
@@ -898,14 +1012,6 @@ int BitArrayCompare(const bit_array_t *ba1, const bit_array_t *ba2)
         return (ba1->numBits - ba2->numBits);
     }
 
-    for(i = 0; i <= BIT_CHAR(ba1->numBits - 1); i++)
-    {
-        if (ba1->array[i] != ba2->array[i])
-        {
-            /* found a non-matching unsigned char */
-            return(ba1->array[i] - ba2->array[i]);
-        }
-    }
-
-    return 0;
+    /* the first char that differs decides, like comparing char by char */
+    return memcmp(ba1->array, ba2->array, BITS_TO_CHARS(ba1->numBits));
 }
@@ -76,6 +76,14 @@ struct bit_file_t
     num_func_t PutBitsNumFunc;  /*!< endian specific BitFilePutBitsNum */
     num_func_t GetBitsNumFunc;  /*!< endian specific BitFileGetBitsNum */
     BF_MODES mode;              /*!< open for read, write, or append */
+
+    unsigned char *buffer;      /*!< byte buffer (NULL if unbuffered) */
+    size_t bufferSize;          /*!< number of bytes allocated for buffer */
+    size_t bufferPos;           /*!< next byte to read/write in buffer */
+    size_t bufferLen;           /*!< number of bytes read into buffer */
+    unsigned long accum;        /*!< bits waiting to be read/written when
+                                     buffered */
+    unsigned int accumCount;    /*!< number of bits in accum */
 };
 
 /**
@@ -101,11 +109,31 @@ typedef union
                                                         unsigned long */
 } endian_test_t;
 
+/***************************************************************************
+*                                 MACROS
+***************************************************************************/
+
+/** The number of bits in the buffered bit accumulator */
+#define ACCUM_BITS      ((unsigned int)(sizeof(unsigned long) * CHAR_BIT))
+
+/** A mask for the n least significant bits (n < ACCUM_BITS) */
+#define LOW_BITS(n)     ((1UL << (n)) - 1)
+
+/** True for bit files that are written to */
+#define IS_WRITER(bf)   (((bf)->mode == BF_WRITE) || ((bf)->mode == BF_APPEND))
+
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
 static endian_t DetermineEndianess(void);
 
+static void BitFileInitBuffer(bit_file_t *stream);
+static unsigned int BitFileFillAccum(bit_file_t *stream);
+static int BitFileDrainAccum(bit_file_t *stream);
+static int BitFileAlignAccum(bit_file_t *stream, const unsigned char fill);
+static int BitFileWriteBuffer(bit_file_t *stream);
+static int BitFileReleaseBuffer(bit_file_t *stream);
+
 static int BitFilePutBitsLE(bit_file_t *stream, void *bits,
     const unsigned int count, const size_t size);
 static int BitFilePutBitsBE(bit_file_t *stream, void *bits,
@@ -172,6 +200,7 @@ static int BitFileNotSupported(bit_file_t *stream, void *bits,
             bf->bitBuffer = 0;
             bf->bitCount = 0;
             bf->mode = mode;
+            BitFileInitBuffer(bf);
 
             switch (DetermineEndianess())
             {
@@ -252,6 +281,7 @@ bit_file_t *MakeBitFile(FILE *stream, const BF_MODES mode)
             bf->bitBuffer = 0;
             bf->bitCount = 0;
             bf->mode = mode;
+            BitFileInitBuffer(bf);
 
             switch (DetermineEndianess())
             {
@@ -331,7 +361,8 @@ bit_file_t *MakeBitFile(FILE *stream, const BF_MODES mode)
  * The specified file will be closed and the file structure will
  * be freed.
  *
- * \returns 0 for success or \c EOF for failure.
+ * \returns 0 for success or \c EOF for failure.  Failing to write out
+ * buffered bits is a failure, even if the file closes.
  */
 int BitFileClose(bit_file_t *stream)
 {
@@ -348,7 +379,10 @@ int BitFileClose(bit_file_t *stream)
         if (stream->bitCount != 0)
         {
             (stream->bitBuffer) <<= 8 - (stream->bitCount);
-            fputc(stream->bitBuffer, stream->fp);   /* handle error? */
+            if (EOF == fputc(stream->bitBuffer, stream->fp))
+            {
+                returnValue = EOF;
+            }
         }
     }
 
@@ -357,8 +391,17 @@ int BitFileClose(bit_file_t *stream)
     *  valid bits (bitCount) in the previous byte.
     ***********************************************************************/
 
+    /* write out any buffered data */
+    if (EOF == BitFileReleaseBuffer(stream))
+    {
+        returnValue = EOF;
+    }
+
     /* close file */
-    returnValue = fclose(stream->fp);
+    if (EOF == fclose(stream->fp))
+    {
+        returnValue = EOF;
+    }
 
     /* free memory allocated for bit file */
     free(stream);
@@ -403,6 +446,9 @@ FILE *BitFileToFILE(bit_file_t *stream)
     *  valid bits (bitCount) in the previous byte.
     ***********************************************************************/
 
+    /* errors are lost here; BitFileFlushOutput first to catch them */
+    (void)BitFileReleaseBuffer(stream);     /* write out or give back data */
+
     /* close file */
     fp = stream->fp;
 
@@ -439,6 +485,26 @@ int BitFileByteAlign(bit_file_t *stream)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        /* drop or pad the bits after the last whole byte */
+        returnValue = (int)(stream->accum & LOW_BITS(stream->accumCount % 8));
+
+        if (IS_WRITER(stream))
+        {
+            if (BitFileAlignAccum(stream, 0) == EOF)
+            {
+                returnValue = EOF;
+            }
+        }
+        else
+        {
+            stream->accumCount -= stream->accumCount % 8;
+        }
+
+        return returnValue;
+    }
+
     returnValue = stream->bitBuffer;
 
     if ((stream->mode == BF_WRITE) || (stream->mode == BF_APPEND))
@@ -486,6 +552,29 @@ int BitFileFlushOutput(bit_file_t *stream, const unsigned char onesFill)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        if (!IS_WRITER(stream))
+        {
+            return(EOF);
+        }
+
+        returnValue = -1;
+
+        if ((stream->accumCount % 8) != 0)
+        {
+            returnValue = BitFileAlignAccum(stream, onesFill);
+        }
+
+        /* write everything that's been buffered */
+        if (BitFileWriteBuffer(stream) == EOF)
+        {
+            returnValue = EOF;
+        }
+
+        return (returnValue);
+    }
+
     returnValue = -1;
 
     /* write out any unwritten bits */
@@ -532,6 +621,22 @@ int BitFileGetChar(bit_file_t *stream)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        if (stream->accumCount < 8)
+        {
+            BitFileFillAccum(stream);
+
+            if (stream->accumCount < 8)
+            {
+                return EOF;     /* there isn't a whole byte left */
+            }
+        }
+
+        stream->accumCount -= 8;
+        return (int)((stream->accum >> stream->accumCount) & 0xFF);
+    }
+
     returnValue = fgetc(stream->fp);
 
     if (stream->bitCount == 0)
@@ -582,6 +687,16 @@ int BitFilePutChar(const int c, bit_file_t *stream)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        if (BitFilePutCode(stream, (unsigned char)c, 8) == EOF)
+        {
+            return EOF;
+        }
+
+        return (unsigned char)c;
+    }
+
     if (stream->bitCount == 0)
     {
         /* we can just put byte from file */
@@ -631,6 +746,17 @@ int BitFileGetBit(bit_file_t *stream)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        if ((stream->accumCount == 0) && (BitFileFillAccum(stream) == 0))
+        {
+            return EOF;
+        }
+
+        stream->accumCount--;
+        return (int)((stream->accum >> stream->accumCount) & 0x01);
+    }
+
     if (stream->bitCount == 0)
     {
         /* buffer is empty, read another character */
@@ -678,6 +804,16 @@ int BitFilePutBit(const int c, bit_file_t *stream)
         return(EOF);
     }
 
+    if (stream->buffer != NULL)
+    {
+        if (BitFilePutCode(stream, (c != 0), 1) == EOF)
+        {
+            returnValue = EOF;
+        }
+
+        return returnValue;
+    }
+
     stream->bitCount++;
     stream->bitBuffer <<= 1;
 
@@ -731,6 +867,7 @@ int BitFileGetBits(bit_file_t *stream, void *bits, const unsigned int count)
 {
     unsigned char *bytes, shifts;
     int offset, remaining, returnValue;
+    unsigned long bitsLeft;
 
     bytes = (unsigned char *)bits;
 
@@ -757,6 +894,19 @@ int BitFileGetBits(bit_file_t *stream, void *bits, const unsigned int count)
         offset++;
     }
 
+    if ((remaining != 0) && (stream->buffer != NULL))
+    {
+        /* read remaining bits from the accumulator all at once */
+        if (BitFilePeekBits(stream, &bitsLeft, remaining) < remaining)
+        {
+            return EOF;
+        }
+
+        BitFileConsumeBits(stream, remaining);
+        bytes[offset] = (unsigned char)(bitsLeft << (8 - remaining));
+        remaining = 0;
+    }
+
     if (remaining != 0)
     {
         /* read remaining bits */
@@ -838,6 +988,19 @@ int BitFilePutBits(bit_file_t *stream, void *bits, const unsigned int count)
         offset++;
     }
 
+    if ((remaining != 0) && (stream->buffer != NULL))
+    {
+        /* write remaining bits to the accumulator all at once */
+        tmp = bytes[offset] >> (8 - remaining);
+
+        if (BitFilePutCode(stream, tmp, remaining) == EOF)
+        {
+            return EOF;
+        }
+
+        remaining = 0;
+    }
+
     if (remaining != 0)
     {
         /* write remaining bits */
@@ -1282,4 +1445,433 @@ static int BitFileNotSupported(bit_file_t *stream, void *bits,
     return -ENOTSUP;
 }
 
+/**
+ * \fn int BitFileSetBuffer(bit_file_t *stream, const size_t size)
+ *
+ * \brief This function makes a bit file read or write through a byte
+ * buffer of the specified size.
+ *
+ * \param stream A pointer to the bit file stream to buffer
+ *
+ * \param size The number of bytes to buffer (BF_BUFFER_SIZE is a good
+ * choice)
+ *
+ * \effects
+ * A byte buffer is allocated for the bit file.  Any bits already in the
+ * bit buffer are moved to the bit accumulator.
+ *
+ * \returns 0 for success, \c EOF for failure.  \c errno will be set for
+ * all failure cases.
+ *
+ * This function makes a bit file read or write through a byte buffer of
+ * the specified size.  Reads fill the buffer with \c fread and writes empty
+ * it with \c fwrite, instead of calling \c fgetc or \c fputc for every byte.
+ * Bits are read and written a word at a time through an unsigned long
+ * accumulator.  Calling this function on a bit file that is already
+ * buffered has no effect.
+ */
+int BitFileSetBuffer(bit_file_t *stream, const size_t size)
+{
+    if ((stream == NULL) || (size == 0))
+    {
+        errno = EINVAL;
+        return EOF;
+    }
+
+    if (stream->buffer != NULL)
+    {
+        return 0;       /* already buffered */
+    }
+
+    stream->buffer = (unsigned char *)malloc(size);
+
+    if (stream->buffer == NULL)
+    {
+        errno = ENOMEM;
+        return EOF;
+    }
+
+    stream->bufferSize = size;
+    stream->bufferPos = 0;
+    stream->bufferLen = 0;
+
+    /* unread or unwritten bits are the low bits of the bit buffer */
+    stream->accum = stream->bitBuffer & LOW_BITS(stream->bitCount);
+    stream->accumCount = stream->bitCount;
+    stream->bitBuffer = 0;
+    stream->bitCount = 0;
+
+    return 0;
+}
+
+/**
+ * \fn int BitFilePeekBits(bit_file_t *stream, unsigned long *bits,
+ * const unsigned int count)
+ *
+ * \brief This function gets the next bits from a buffered bit file without
+ * removing them from the file.
+ *
+ * \param stream A pointer to the bit file stream to read from
+ *
+ * \param bits The address to store the bits read
+ *
+ * \param count The number of bits to look at (at most BF_MAX_PEEK_BITS)
+ *
+ * \effects
+ * The bit accumulator is refilled if it doesn't have \c count bits.
+ *
+ * \returns \c EOF for failure, otherwise the number of bits in \c bits
+ * that were actually read from the file.
+ *
+ * This function gets the next \c count bits from a buffered bit file
+ * without removing them from the file.  The bits are right justified in
+ * \c bits, with the first bit in the most significant position.  If the
+ * end of the file is reached before \c count bits are found, the missing
+ * bits will be zero and the returned value will be less than \c count.
+ */
+int BitFilePeekBits(bit_file_t *stream, unsigned long *bits,
+    const unsigned int count)
+{
+    if ((stream == NULL) || (bits == NULL) || (stream->buffer == NULL) ||
+        (count > BF_MAX_PEEK_BITS))
+    {
+        return EOF;
+    }
+
+    if (stream->accumCount < count)
+    {
+        BitFileFillAccum(stream);
+
+        if (stream->accumCount < count)
+        {
+            /* pad the bits with zeros */
+            *bits = (stream->accum << (count - stream->accumCount)) &
+                LOW_BITS(count);
+            return (int)stream->accumCount;
+        }
+    }
+
+    *bits = (stream->accum >> (stream->accumCount - count)) & LOW_BITS(count);
+    return (int)count;
+}
+
+/**
+ * \fn int BitFileConsumeBits(bit_file_t *stream, const unsigned int count)
+ *
+ * \brief This function removes bits from a buffered bit file.
+ *
+ * \param stream A pointer to the bit file stream to read from
+ *
+ * \param count The number of bits to remove (at most BF_MAX_PEEK_BITS)
+ *
+ * \effects
+ * The bits are skipped over.
+ *
+ * \returns \c EOF if there aren't \c count bits left in the file,
+ * otherwise \c count.
+ *
+ * This function removes bits from a buffered bit file.  It is intended to
+ * be called with the number of bits that were used after a call to
+ * BitFilePeekBits.  If the file doesn't have \c count bits remaining, all
+ * of the remaining bits will be removed.
+ */
+int BitFileConsumeBits(bit_file_t *stream, const unsigned int count)
+{
+    if ((stream == NULL) || (stream->buffer == NULL) ||
+        (count > BF_MAX_PEEK_BITS))
+    {
+        return EOF;
+    }
+
+    if (stream->accumCount < count)
+    {
+        BitFileFillAccum(stream);
+
+        if (stream->accumCount < count)
+        {
+            stream->accumCount = 0;
+            return EOF;
+        }
+    }
+
+    stream->accumCount -= count;
+    return (int)count;
+}
+
+/**
+ * \fn int BitFilePutCode(bit_file_t *stream, const unsigned long code,
+ * const unsigned int count)
+ *
+ * \brief This function writes the least significant bits of an unsigned
+ * long to a buffered bit file.
+ *
+ * \param stream A pointer to the bit file stream to write to
+ *
+ * \param code The right justified bits to write
+ *
+ * \param count The number of bits to write (at most the number of bits in
+ * an unsigned long)
+ *
+ * \effects
+ * The bits are added to the bit accumulator.  Whole bytes are moved to
+ * the byte buffer, which is written to the file when it's full.
+ *
+ * \returns \c EOF for failure, otherwise \c count.
+ *
+ * This function writes the \c count least significant bits of \c code to
+ * a buffered bit file, most significant bit first.
+ */
+int BitFilePutCode(bit_file_t *stream, const unsigned long code,
+    const unsigned int count)
+{
+    unsigned int bits, remaining;
+
+    if ((stream == NULL) || (stream->buffer == NULL) ||
+        (count > ACCUM_BITS))
+    {
+        return EOF;
+    }
+
+    remaining = count;
+
+    while (remaining > 0)
+    {
+        /* after draining, the accumulator can hold all but 7 bits */
+        bits = ACCUM_BITS - 7;
+
+        if (bits > remaining)
+        {
+            bits = remaining;
+        }
+
+        remaining -= bits;
+        stream->accum = (stream->accum << bits) |
+            ((code >> remaining) & LOW_BITS(bits));
+        stream->accumCount += bits;
+
+        if (BitFileDrainAccum(stream) == EOF)
+        {
+            return EOF;
+        }
+    }
+
+    return (int)count;
+}
+
+/**
+ * \fn static void BitFileInitBuffer(bit_file_t *stream)
+ *
+ * \brief This function initializes the buffer related fields of a newly
+ * created bit file.
+ *
+ * \param stream A pointer to the bit file stream being initialized
+ *
+ * \effects
+ * The bit file is marked as unbuffered.
+ *
+ * \returns None
+ */
+static void BitFileInitBuffer(bit_file_t *stream)
+{
+    stream->buffer = NULL;
+    stream->bufferSize = 0;
+    stream->bufferPos = 0;
+    stream->bufferLen = 0;
+    stream->accum = 0;
+    stream->accumCount = 0;
+}
+
+/**
+ * \fn static unsigned int BitFileFillAccum(bit_file_t *stream)
+ *
+ * \brief This function adds as many bytes to the bit accumulator of a
+ * buffered bit file as it can hold.
+ *
+ * \param stream A pointer to the bit file stream to read from
+ *
+ * \effects
+ * Bytes are moved from the byte buffer to the bit accumulator.  The byte
+ * buffer is refilled from the file when it runs out.
+ *
+ * \returns The number of bits in the accumulator.
+ */
+static unsigned int BitFileFillAccum(bit_file_t *stream)
+{
+    while (stream->accumCount <= (ACCUM_BITS - 8))
+    {
+        if (stream->bufferPos == stream->bufferLen)
+        {
+            /* buffer is empty, read another block */
+            stream->bufferLen = fread(stream->buffer, 1, stream->bufferSize,
+                stream->fp);
+            stream->bufferPos = 0;
+
+            if (stream->bufferLen == 0)
+            {
+                break;
+            }
+        }
+
+        stream->accum = (stream->accum << 8) |
+            stream->buffer[stream->bufferPos];
+        stream->bufferPos++;
+        stream->accumCount += 8;
+    }
+
+    return stream->accumCount;
+}
+
+/**
+ * \fn static int BitFileDrainAccum(bit_file_t *stream)
+ *
+ * \brief This function moves all of the whole bytes in the bit accumulator
+ * of a buffered bit file to its byte buffer.
+ *
+ * \param stream A pointer to the bit file stream to write to
+ *
+ * \effects
+ * Bytes are moved from the bit accumulator to the byte buffer.  The byte
+ * buffer is written to the file when it fills up.
+ *
+ * \returns 0 for success, \c EOF for failure.
+ */
+static int BitFileDrainAccum(bit_file_t *stream)
+{
+    while (stream->accumCount >= 8)
+    {
+        if (stream->bufferPos == stream->bufferSize)
+        {
+            if (BitFileWriteBuffer(stream) == EOF)
+            {
+                return EOF;
+            }
+        }
+
+        stream->accumCount -= 8;
+        stream->buffer[stream->bufferPos] =
+            (unsigned char)(stream->accum >> stream->accumCount);
+        stream->bufferPos++;
+    }
+
+    return 0;
+}
+
+/**
+ * \fn static int BitFileAlignAccum(bit_file_t *stream,
+ * const unsigned char fill)
+ *
+ * \brief This function pads the bits in the accumulator of a buffered bit
+ * file out to a whole byte.
+ *
+ * \param stream A pointer to the bit file stream to write to
+ *
+ * \param fill set to non-zero if spare bits are to be filled with ones
+ *
+ * \effects
+ * The padded byte is moved to the byte buffer.
+ *
+ * \returns \c EOF for failure, otherwise the padded byte.
+ */
+static int BitFileAlignAccum(bit_file_t *stream, const unsigned char fill)
+{
+    unsigned int spare;
+    int returnValue;
+
+    spare = (8 - (stream->accumCount % 8)) % 8;
+    stream->accum <<= spare;
+
+    if (fill)
+    {
+        stream->accum |= LOW_BITS(spare);
+    }
+
+    stream->accumCount += spare;
+    returnValue = (int)(stream->accum & 0xFF);
+
+    if (BitFileDrainAccum(stream) == EOF)
+    {
+        return EOF;
+    }
+
+    return returnValue;
+}
+
+/**
+ * \fn static int BitFileWriteBuffer(bit_file_t *stream)
+ *
+ * \brief This function writes the contents of the byte buffer of a
+ * buffered bit file to the file.
+ *
+ * \param stream A pointer to the bit file stream to write to
+ *
+ * \effects
+ * The byte buffer is written with \c fwrite and emptied.
+ *
+ * \returns 0 for success, \c EOF for failure.
+ */
+static int BitFileWriteBuffer(bit_file_t *stream)
+{
+    size_t written;
+
+    written = fwrite(stream->buffer, 1, stream->bufferPos, stream->fp);
+
+    if (written != stream->bufferPos)
+    {
+        return EOF;
+    }
+
+    stream->bufferPos = 0;
+    return 0;
+}
+
+/**
+ * \fn static int BitFileReleaseBuffer(bit_file_t *stream)
+ *
+ * \brief This function frees the byte buffer of a buffered bit file.
+ *
+ * \param stream A pointer to the bit file stream being closed or converted
+ *
+ * \effects
+ * Files being written have all of their buffered bits written out (padded
+ * with zeros).  Files being read are moved back to the first byte that
+ * hasn't been used, if the file is seekable.  The byte buffer is freed,
+ * even if the buffered bits couldn't be written.
+ *
+ * \returns 0 for success or \c EOF if buffered bits couldn't be written.
+ */
+static int BitFileReleaseBuffer(bit_file_t *stream)
+{
+    long unread;
+    int returnValue = 0;
+
+    if (stream->buffer == NULL)
+    {
+        return 0;   /* not buffered */
+    }
+
+    if (IS_WRITER(stream))
+    {
+        if ((EOF == BitFileAlignAccum(stream, 0)) ||
+            (EOF == BitFileWriteBuffer(stream)))
+        {
+            returnValue = EOF;
+        }
+    }
+    else
+    {
+        /* whole bytes in accumulator + unused bytes in buffer */
+        unread = (long)(stream->accumCount / 8) +
+            (long)(stream->bufferLen - stream->bufferPos);
+
+        if (unread != 0)
+        {
+            fseek(stream->fp, -unread, SEEK_CUR);   /* may not be seekable */
+        }
+    }
+
+    free(stream->buffer);
+    BitFileInitBuffer(stream);
+    return returnValue;
+}
+
 /**@}*/
@@ -68,6 +68,21 @@
 *                             INCLUDED FILES
 ***************************************************************************/
 #include <stdio.h>
+#include <limits.h>
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+
+/** The default size of the byte buffer used by buffered bit files. */
+#define BF_BUFFER_SIZE      65536
+
+/**
+ * The maximum number of bits that may be peeked at or consumed at once by
+ * the buffered bit access functions.
+ */
+#define BF_MAX_PEEK_BITS    \
+    ((unsigned int)(sizeof(unsigned long) * CHAR_BIT) - 7)
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
@@ -123,6 +138,26 @@ int BitFilePutBit(const int c, bit_file_t *stream);
 int BitFileGetBits(bit_file_t *stream, void *bits, const unsigned int count);
 int BitFilePutBits(bit_file_t *stream, void *bits, const unsigned int count);
 
+/***************************************************************************
+* buffered bit access
+*
+* BitFileSetBuffer makes a bit file read and write through a large byte
+* buffer and a word sized bit accumulator instead of a byte at a time.
+* All of the other functions keep working on a buffered bit file.  Reads
+* may go past the data that has been consumed, so reading from the FILE
+* returned by BitFileToFILE only continues where the bit file left off if
+* the FILE is seekable.
+*
+* The peek and consume functions operate on up to BF_MAX_PEEK_BITS bits.
+* Codes are right justified and read/written most significant bit first.
+***************************************************************************/
+int BitFileSetBuffer(bit_file_t *stream, const size_t size);
+int BitFilePeekBits(bit_file_t *stream, unsigned long *bits,
+    const unsigned int count);
+int BitFileConsumeBits(bit_file_t *stream, const unsigned int count);
+int BitFilePutCode(bit_file_t *stream, const unsigned long code,
+    const unsigned int count);
+
 /***************************************************************************
 * get/put a number of bits from numerical types (short, int, long, ...)
 *
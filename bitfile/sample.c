@@ -75,6 +75,8 @@ int main(int argc, char *argv[])
     bit_file_t *bfp;
     FILE *fp;
     int i, numCalls, value;
+    unsigned int codeLen;
+    unsigned long code;
 
     if (argc < 2)
     {
@@ -402,6 +404,86 @@ int main(int argc, char *argv[])
          return (EXIT_FAILURE);
     }
 
+    /* now write and read codes through a buffered bit file */
+    bfp = BitFileOpen("testfile", BF_WRITE);
+
+    if (bfp == NULL)
+    {
+         perror("opening file");
+         return (EXIT_FAILURE);
+    }
+
+    if (BitFileSetBuffer(bfp, BF_BUFFER_SIZE) == EOF)
+    {
+        perror("buffering bitfile");
+        BitFileClose(bfp);
+        return (EXIT_FAILURE);
+    }
+
+    /* write codes of increasing length, starting over at the longest */
+    for (i = 0; i < numCalls; i++)
+    {
+        codeLen = ((i % (BF_MAX_PEEK_BITS / 3)) + 1) * 3;
+        printf("writing %u bit code %X\n", codeLen, (unsigned int)i);
+        if(BitFilePutCode(bfp, (unsigned long)i, codeLen) == EOF)
+        {
+            perror("writing code");
+            if (0 != BitFileClose(bfp))
+            {
+                perror("closing bitfile");
+            }
+            return (EXIT_FAILURE);
+        }
+    }
+
+    if (BitFileClose(bfp) != 0)
+    {
+         perror("closing file");
+         return (EXIT_FAILURE);
+    }
+
+    bfp = BitFileOpen("testfile", BF_READ);
+
+    if (bfp == NULL)
+    {
+         perror("reopening file");
+         return (EXIT_FAILURE);
+    }
+
+    if (BitFileSetBuffer(bfp, BF_BUFFER_SIZE) == EOF)
+    {
+        perror("buffering bitfile");
+        BitFileClose(bfp);
+        return (EXIT_FAILURE);
+    }
+
+    /* peek at each code, then consume it */
+    for (i = 0; i < numCalls; i++)
+    {
+        codeLen = ((i % (BF_MAX_PEEK_BITS / 3)) + 1) * 3;
+
+        if ((BitFilePeekBits(bfp, &code, codeLen) != (int)codeLen) ||
+            (BitFileConsumeBits(bfp, codeLen) == EOF))
+        {
+            perror("reading code");
+            if (0 != BitFileClose(bfp))
+            {
+                perror("closing bitfile");
+            }
+            return (EXIT_FAILURE);
+        }
+        else
+        {
+            printf("read %u bit code %lX\n", codeLen, code);
+        }
+    }
+
+    if (BitFileClose(bfp) != 0)
+    {
+         perror("closing file");
+         return (EXIT_FAILURE);
+    }
+
     return (EXIT_SUCCESS);
 }
 
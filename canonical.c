@@ -34,12 +34,147 @@
 ***************************************************************************/
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "huflocal.h"
 #include "huffman.h"
-#include "bitarray/bitarray.h"
 #include "bitfile/bitfile.h"
 
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/***************************************************************************
+* Longest code that the encoder will generate.  257 symbols require at
+* least 9 bits.  The decoder will accept codes of any length (up to 255
+* bits), so changing this value doesn't effect compatibility.
+***************************************************************************/
+#ifndef MAX_CODE_LEN
+#define MAX_CODE_LEN        15
+#endif
+
+#if (MAX_CODE_LEN < 9) || (MAX_CODE_LEN > 32)
+#error MAX_CODE_LEN must be between 9 and 32
+#endif
+
+/* number of bits resolved by a single decode table look up */
+#define DECODE_LOOKUP_BITS  11
+#define DECODE_TABLE_SIZE   (1 << DECODE_LOOKUP_BITS)
+
+/* number of bits in an unsigned long code */
+#define ULONG_BITS          ((int)(sizeof(unsigned long) * CHAR_BIT))
+#define ULONG_BYTES         ((int)sizeof(unsigned long))
+
+/***************************************************************************
+* The encoder adds CODES_PER_STORE codes to an unsigned long accumulator,
+* then stores the whole accumulator and keeps the bits that don't make a
+* whole byte.  Stores may write past the last whole byte, so they're only
+* done when at least STORE_SLACK more symbols (1 bit each, at least) will
+* be written after them.
+***************************************************************************/
+#define CODES_PER_STORE     ((ULONG_BITS - 7) / MAX_CODE_LEN)
+#define STORE_SLACK         (8 * ULONG_BYTES)
+
+/* number of input bytes encoded at a time by CanonicalEncodeFile */
+#define ENCODE_BUFFER_SIZE  16384
+#define ENCODED_BUFFER_SIZE ((ENCODE_BUFFER_SIZE * MAX_CODE_LEN + 7) / 8)
+
+/* number of decoded bytes written at a time by CanonicalDecodeFile */
+#define DECODE_BUFFER_SIZE  4096
+
+/* values returned by DecodeSymbol that aren't symbols */
+#define DECODE_END_OF_DATA  -1      /* data ran out before a whole code */
+#define DECODE_BAD_CODE     -2      /* bits don't match any code */
+
+/***************************************************************************
+* Interleaved buffers split their data into NUM_STREAMS equal segments
+* (the last may be shorter), and code each segment as a separate bit
+* stream, so the decoder can work on all of them at once.  The code
+* lengths are followed by a jump table holding the sizes of all but the
+* last stream (4 bytes each, MSB first).
+***************************************************************************/
+#define NUM_STREAMS         4
+#define JUMP_TABLE_SIZE     (4 * (NUM_STREAMS - 1))
+
+/* table look ups that always fit in a full accumulator */
+#define LOOKUPS_PER_FILL    ((ULONG_BITS - 7) / DECODE_LOOKUP_BITS)
+
+/***************************************************************************
+* Order-1 buffers code each symbol with one of up to ORDER1_MAX_CODES
+* codes, chosen by the symbol before it (the first symbol uses the code
+* chosen by 0).  They start with the number of codes (1 byte).  If there's
+* more than one, it's followed by the code used after each byte value
+* (ORDER1_MAP_SIZE bytes, 4 bits per value, high bits first).  The compact
+* code lengths of each code follow, each padded to a whole byte, then the
+* encoded symbols.  The encoder clusters the byte values into groups whose
+* following symbols have similar counts, trying each number of groups in
+* order1Groups.
+***************************************************************************/
+#define ORDER1_MAX_CODES    16
+#define ORDER1_MAP_SIZE     128
+#define ORDER1_PASSES       4       /* passes refining the groups */
+
+/***************************************************************************
+* Compact headers code the length of each symbol's code, in order of
+* symbol value, relative to the length before it:
+*   0                   - same length as the last symbol that occurs
+*   10 + 5 bits         - 1 to 32 symbols that don't occur
+*   110 + sign          - 1 longer (sign 0) or shorter (sign 1)
+*   1110 + sign + 1 bit - 2 or 3 longer or shorter
+*   1111 + 6 bits       - the length itself
+* The lengths are padded to a whole number of bytes.
+***************************************************************************/
+#define COMPACT_FIRST_LENGTH    8       /* length before the first symbol */
+#define ZERO_RUN_BITS           5
+#define LITERAL_LENGTH_BITS     6
+
+/* most bytes that a compact header can take (10 bits per symbol) */
+#define COMPACT_HEADER_BOUND    ((NUM_CHARS * 10 + 7) / 8)
+
+/***************************************************************************
+* Data encoded with a trained table starts with the table's id (4 bytes,
+* MSB first) instead of a header.  Saved tables are the id followed by a
+* compact header.
+***************************************************************************/
+#define TABLE_ID_SIZE       4
+#define MAX_TABLE_CODE_LEN  32      /* longest code a loaded table may use */
+
+#if (TABLE_ID_SIZE + COMPACT_HEADER_BOUND) > CANONICAL_TABLE_BOUND
+#error CANONICAL_TABLE_BOUND is too small for a saved table
+#endif
+
+#define CACHE_GROWTH        16      /* table pointers added when cache fills */
+
+/***************************************************************************
+* Files and buffers encoded by CanonicalEncodeFile and CanonicalEncodeBuffer
+* start with a container header:
+*   magic (4 bytes)             - 0x89 'H' 'U' 'F'
+*   version (1 byte)            - CONTAINER_VERSION
+*   flags (1 byte)              - CONTAINER_CRC if there's a checksum,
+*                                 CONTAINER_STORED or CONTAINER_RUN if the
+*                                 data isn't coded
+*   decoded size (8 bytes)      - number of symbols encoded, MSB first
+*   lengths size (2 bytes)      - bytes of compact code lengths, MSB first
+* The compact code lengths and the encoded symbols follow (EOF doesn't get a
+* code), then a CRC-32C of the decoded data (4 bytes, MSB first).  Data that
+* isn't coded has no code lengths (the lengths size is 0).  The decoded
+* bytes follow a CONTAINER_STORED header, and the one byte that they all
+* are follows a CONTAINER_RUN header.  Older files start with NUM_CHARS code
+* lengths, and none are as long as 0x89.
+***************************************************************************/
+#define CONTAINER_VERSION       1
+#define CONTAINER_CRC           0x01
+#define CONTAINER_STORED        0x02    /* decoded bytes without a code */
+#define CONTAINER_RUN           0x04    /* 1 byte repeated without a code */
+#define CONTAINER_HEADER_SIZE   16      /* bytes before the code lengths */
+#define CONTAINER_CRC_SIZE      4
+
+/* shorter data is stored, because its code lengths outweigh any savings */
+#define TINY_CONTAINER_SIZE     32
+
+/* most bytes that a container adds to the encoded symbols */
+#define CONTAINER_BOUND \
+    (CONTAINER_HEADER_SIZE + COMPACT_HEADER_BOUND + CONTAINER_CRC_SIZE)
+
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
@@ -47,32 +182,220 @@ typedef struct canonical_list_t
 {
     short value;        /* characacter represented */
     byte_t codeLen;     /* number of bits used in code (1 - 255) */
-    bit_array_t *code;  /* code used for symbol (left justified) */
+    unsigned long code; /* code used for symbol (right justified) */
 } canonical_list_t;
 
-/***************************************************************************
-*                                CONSTANTS
-***************************************************************************/
+typedef struct decode_entry_t
+{
+    short value;        /* character represented */
+    byte_t codeLen;     /* code length (0 -> longer than lookup bits) */
+} decode_entry_t;
+
+/* everything needed to decode a code, derived from the code lengths */
+typedef struct canonical_decoder_t
+{
+    canonical_list_t list[NUM_CHARS];   /* codes sorted by length */
+    int lenIndex[NUM_CHARS];            /* index of first code of a length */
+    int lenCount[NUM_CHARS];            /* number of codes of each length */
+    unsigned long lenBase[NUM_CHARS];   /* smallest code of each length */
+    int maxLength;                      /* length of longest code */
+    decode_entry_t table[DECODE_TABLE_SIZE];    /* short code look up */
+} canonical_decoder_t;
+
+/* bits written to a memory buffer (MSB first) */
+typedef struct bit_writer_t
+{
+    byte_t *data;               /* buffer being written */
+    size_t pos;                 /* index of next byte to write */
+    unsigned long accum;        /* bits not yet written (right justified) */
+    unsigned int accumCount;    /* number of bits in accum */
+} bit_writer_t;
+
+/* bits read from a memory buffer (MSB first) */
+typedef struct bit_reader_t
+{
+    const byte_t *data;         /* buffer being read */
+    size_t size;                /* number of bytes in buffer */
+    size_t pos;                 /* index of next byte to read */
+    unsigned long accum;        /* bits read but not used (right justified) */
+    unsigned int accumCount;    /* number of bits in accum */
+#ifdef HUFFMAN_STATS
+    unsigned long refills;      /* number of times accum was refilled */
+#endif
+} bit_reader_t;
+
+/* information from a container header */
+typedef struct container_t
+{
+    unsigned long size;         /* number of symbols encoded */
+    int flags;                  /* CONTAINER_CRC, CONTAINER_STORED, ... */
+    size_t lengthsLen;          /* bytes of compact code lengths */
+} container_t;
+
+/* a code trained on sample data, ready for encoding and decoding */
+struct canonical_table_t
+{
+    unsigned long id;                   /* written in place of a header */
+    int maxLength;                      /* length of longest code */
+    canonical_list_t codes[NUM_CHARS];  /* codes sorted by value */
+    canonical_decoder_t decoder;        /* decoder built from the codes */
+};
+
+/* tables available to the decoder, sorted by id */
+struct canonical_cache_t
+{
+    canonical_table_t **tables;         /* tables owned by the cache */
+    int numTables;                      /* number of tables in the cache */
+    int capacity;                       /* number of table pointers */
+};
+
+/* working memory for choosing the codes of an order-1 buffer */
+typedef struct order1_work_t
+{
+    count_t counts[256][NUM_CHARS];     /* symbols following each byte */
+    byte_t next[256][256];              /* symbols that follow each byte */
+    int numNext[256];                   /* number of symbols in next */
+    byte_t map[256];                    /* group of each byte */
+    count_t groupCounts[ORDER1_MAX_CODES][NUM_CHARS];   /* group symbols */
+    canonical_list_t codes[ORDER1_MAX_CODES][NUM_CHARS];    /* group codes */
+} order1_work_t;
+
+/* the code built for the last message, kept for the next one */
+struct huffman_encoder_t
+{
+    int valid;                          /* 1 if the code below is built */
+    byte_t lengths[NUM_CHARS];          /* lengths the code was built from */
+    canonical_list_t list[NUM_CHARS];   /* codes sorted by value */
+    byte_t header[CONTAINER_HEADER_SIZE + COMPACT_HEADER_BOUND];
+    size_t headerLen;                   /* bytes of container header */
+    count_t counts[NUM_CHARS];          /* symbols in the current message */
+};
+
+/* the decoder built for the last message, kept for the next one */
+struct huffman_decoder_t
+{
+    int valid;                          /* 1 if the tables below are built */
+    byte_t lengths[COMPACT_HEADER_BOUND];   /* compact code lengths */
+    size_t lengthsLen;                  /* bytes of compact code lengths */
+    canonical_decoder_t tables;         /* code and look up tables */
+};
 
 /***************************************************************************
 *                                 MACROS
 ***************************************************************************/
+/* count bit reader refills only when statistics are being collected */
+#ifdef HUFFMAN_STATS
+#define CLEAR_REFILLS(reader)   ((reader)->refills = 0)
+#define COUNT_REFILL(reader)    ((reader)->refills++)
+#else
+#define CLEAR_REFILLS(reader)   ((void)0)
+#define COUNT_REFILL(reader)    ((void)0)
+#endif
+
+/* add the coded size of a code's symbols to the statistics */
+#ifdef HUFFMAN_STATS
+#define COUNT_CODE(counts, cl)  AddCodeStats((counts), (cl))
+#else
+#define COUNT_CODE(counts, cl)  ((void)0)
+#endif
 
 /***************************************************************************
 *                            GLOBAL VARIABLES
 ***************************************************************************/
+static const byte_t containerMagic[4] = {0x89, 'H', 'U', 'F'};
+
+/* numbers of groups tried by the order-1 encoder */
+static const int order1Groups[] = {1, 2, 4, 8, ORDER1_MAX_CODES};
 
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
 /* creating canonical codes */
-static int BuildCanonicalCode(huffman_node_t *ht, canonical_list_t *cl);
-static int AssignCanonicalCodes(canonical_list_t *cl);
-static int CompareByCodeLen(const void *item1, const void *item2);
+static void BuildCanonicalCode(const count_t *counts, const int eof,
+    canonical_list_t *cl);
+static void BuildCodeFromLengths(const byte_t *lengths, canonical_list_t *cl);
+static void LimitCodeLengths(canonical_list_t *cl);
+static void AssignCanonicalCodes(canonical_list_t *cl);
+static void SortByCodeLength(const canonical_list_t *cl, int *lenCount,
+    int *order);
 
 /* reading/writing code to file */
-static void WriteHeader(canonical_list_t *cl, bit_file_t *bfp);
 static int ReadHeader(canonical_list_t *cl,  bit_file_t *bfp);
+static size_t PutContainerHeader(byte_t *dst, unsigned long size,
+    const canonical_list_t *cl);
+static void PutUncodedHeader(byte_t *dst, unsigned long size,
+    const int flags);
+static void PutContainerSize(byte_t *dst, unsigned long size);
+static int EncodeUncoded(const byte_t *in, const size_t srcLen,
+    const int flags, byte_t *dst, const size_t dstCap, size_t *outLen);
+static int DecodeUncoded(const byte_t *in, const size_t srcLen,
+    const container_t *container, byte_t *out, const size_t dstCap,
+    size_t *outLen);
+static int DecodeUncodedFile(FILE *inFile, FILE *outFile,
+    const container_t *container);
+static int CheckBufferCrc(const byte_t *src, const size_t srcLen,
+    const byte_t *data, const size_t len);
+static int GetContainerHeader(const byte_t *src, container_t *container);
+static int GetBufferContainer(const byte_t *src, const size_t srcLen,
+    container_t *container);
+static int GetContainerLengths(const byte_t *src, const size_t len,
+    canonical_list_t *cl);
+static int ReadContainer(FILE *fp, container_t *container,
+    canonical_list_t *cl);
+static int WriteDecoded(FILE *fp, const byte_t *data, const size_t len,
+    unsigned long *crc);
+
+/* table driven decoding */
+static int BuildDecoder(canonical_decoder_t *decoder);
+static void BuildDecodeTable(canonical_list_t *cl, decode_entry_t *table);
+static int FindSymbol(const canonical_decoder_t *decoder,
+    const unsigned long code, const int length);
+static int DecodeSymbol(const canonical_decoder_t *decoder,
+    bit_reader_t *reader);
+static int DecodeLongSymbol(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, unsigned long code, const unsigned int bits);
+
+/* coding whole buffers */
+static void EncodeToBuffer(bit_writer_t *writer, const canonical_list_t *cl,
+    const byte_t *in, const size_t len, const int maxLen);
+static int DecodeToBuffer(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, byte_t *out, const size_t outCap, size_t *outLen);
+static int DecodeSymbols(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, byte_t *out, const size_t count);
+
+/* trained tables */
+static canonical_table_t *MakeTable(const unsigned long id,
+    const canonical_list_t *cl);
+static int FindTable(const canonical_cache_t *cache, const unsigned long id);
+
+/* reading/writing bits in memory */
+static size_t SymbolsSize(const count_t *counts, const canonical_list_t *cl,
+    unsigned long bits);
+static void BufferPutCode(bit_writer_t *writer, const unsigned long code,
+    const unsigned int count);
+static void BufferPutSymbols(bit_writer_t *writer, const canonical_list_t *cl,
+    const byte_t *in, const size_t len, const int maxLen);
+static void BufferFlush(bit_writer_t *writer);
+static unsigned int BufferPeekBits(bit_reader_t *reader, unsigned long *bits,
+    const unsigned int count);
+static int BufferGetBit(bit_reader_t *reader);
+static int BufferGetBits(bit_reader_t *reader, const unsigned int count);
+
+/* compact code length headers */
+static size_t PutCompactLengths(const canonical_list_t *cl, byte_t *dst);
+static int GetCompactLengths(bit_reader_t *reader, canonical_list_t *cl);
+
+/* order-1 buffers */
+static int GroupContexts(order1_work_t *work, int numGroups);
+static void CountGroups(order1_work_t *work, const int numGroups);
+static size_t Order1Size(order1_work_t *work, const int numGroups);
+static void BufferPutOrder1Symbols(bit_writer_t *writer,
+    const canonical_list_t **contexts, const byte_t *in, const size_t len);
+
+#ifdef HUFFMAN_STATS
+/* statistics */
+static void AddCodeStats(const count_t *counts, const canonical_list_t *cl);
+#endif
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -81,7 +404,10 @@ static int ReadHeader(canonical_list_t *cl,  bit_file_t *bfp);
 /****************************************************************************
 *   Function   : CanonicalEncodeFile
 *   Description: This routine genrates a huffman tree optimized for a file
-*                and writes out an encoded version of that file.
+*                and writes out an encoded version of that file.  Files of
+*                one repeated byte, files shorter than TINY_CONTAINER_SIZE
+*                and files that coding doesn't make smaller are written
+*                without a code.
 *   Parameters : inFile - Open file pointer for file to encode (must be
 *                         rewindable).
 *                outFile - Open file pointer for file receiving encoded data
@@ -92,11 +418,17 @@ static int ReadHeader(canonical_list_t *cl,  bit_file_t *bfp);
 ****************************************************************************/
 int CanonicalEncodeFile(FILE *inFile, FILE *outFile)
 {
-    bit_file_t *bOutFile;
-    huffman_node_t *huffmanTree;        /* root of huffman tree */
-    int c;
+    int c, i, flags;
+    size_t len, codesLen;
+    unsigned long size, crc;
+    bit_writer_t writer;
+    byte_t in[ENCODE_BUFFER_SIZE];              /* symbols to encode */
+    byte_t out[ENCODED_BUFFER_SIZE];            /* encoded symbols */
+    count_t counts[NUM_CHARS];          /* number of each symbol */
     canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
-
+#ifdef HUFFMAN_STATS
+    long outPos;
+#endif
 
     /* validate input and output files */
     if ((NULL == inFile) || (NULL == outFile))
@@ -105,76 +437,188 @@ int CanonicalEncodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
-    bOutFile = MakeBitFile(outFile, BF_WRITE);
+    STATS_TELL(outPos, outFile);
 
-    if (NULL == bOutFile)
+    /* count symbols and use the counts to generate a canonical code */
+    if (0 != CountFileSymbols(inFile, counts))
     {
-        perror("Making Output File a BitFile");
         return -1;
     }
 
-    /* build tree */
-    if ((huffmanTree = GenerateTreeFromFile(inFile)) == NULL)
+    size = 0;
+    flags = 0;
+
+    for (c = 0; c < EOF_CHAR; c++)
     {
-        outFile = BitFileToFILE(bOutFile);
-        return -1;
+        if (counts[c] > ULONG_MAX - size)
+        {
+            errno = ERANGE;
+            return -1;
+        }
+
+        size += counts[c];
     }
 
-    /* use tree to generate a canonical code */
-    if (-1 == BuildCanonicalCode(huffmanTree, canonicalList))
+    /* runs and tiny files aren't worth building a code for */
+    for (c = 0; c < EOF_CHAR; c++)
     {
-        outFile = BitFileToFILE(bOutFile);
-        FreeHuffmanTree(huffmanTree);     /* free allocated memory */
-        return -1;
+        if ((0 != size) && (counts[c] == size))
+        {
+            break;
+        }
     }
 
-    /* write out encoded file */
+    if (c < EOF_CHAR)
+    {
+        flags = CONTAINER_RUN;
+        out[CONTAINER_HEADER_SIZE] = (byte_t)c;
+        len = CONTAINER_HEADER_SIZE + 1;
+    }
+    else if (size < TINY_CONTAINER_SIZE)
+    {
+        flags = CONTAINER_STORED;
+    }
+    else
+    {
+        BuildCanonicalCode(counts, 0, canonicalList);
 
-    /* write header for rebuilding of code */
-    WriteHeader(canonicalList, bOutFile);
+        /* write container header for rebuilding of code */
+        len = PutContainerHeader(out, size, canonicalList);
+        codesLen = SymbolsSize(counts, canonicalList, 0);
+
+        /* store files that coding doesn't make smaller */
+        if ((codesLen >= size) ||
+            (len - CONTAINER_HEADER_SIZE >= size - codesLen))
+        {
+            flags = CONTAINER_STORED;
+        }
+    }
+
+    if (0 != flags)
+    {
+        PutUncodedHeader(out, size, flags);
+
+        if (CONTAINER_STORED == flags)
+        {
+            len = CONTAINER_HEADER_SIZE;
+        }
+    }
+
+    /* write out encoded file */
+    if (fwrite(out, 1, len, outFile) != len)
+    {
+        return -1;
+    }
 
     /* read characters from file and write them to encoded file */
     rewind(inFile);               /* start another pass on the input file */
 
-    while((c = fgetc(inFile)) != EOF)
+    writer.data = out;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+    crc = 0;
+
+    while ((len = fread(in, 1, ENCODE_BUFFER_SIZE, inFile)) != 0)
+    {
+        crc = Crc32c(crc, in, len);
+
+        if (CONTAINER_STORED == flags)
+        {
+            if (fwrite(in, 1, len, outFile) != len)
+            {
+                return -1;
+            }
+        }
+        else if (0 == flags)
+        {
+            /* bits that don't make a whole byte stay in the accumulator */
+            BufferPutSymbols(&writer, canonicalList, in, len, MAX_CODE_LEN);
+
+            if (fwrite(out, 1, writer.pos, outFile) != writer.pos)
+            {
+                return -1;
+            }
+
+            writer.pos = 0;
+        }
+    }
+
+    if (ferror(inFile))
     {
-        /* write encoded symbols */
-        BitFilePutBits(bOutFile,
-            BitArrayGetBits(canonicalList[c].code),
-            canonicalList[c].codeLen);
+        return -1;
     }
 
-    /* now write EOF */
-    BitFilePutBits(bOutFile,
-        BitArrayGetBits(canonicalList[EOF_CHAR].code),
-        canonicalList[EOF_CHAR].codeLen);
+    /* pad the last byte and write the checksum (no EOF is needed) */
+    BufferFlush(&writer);
 
-    /* clean up */
-    outFile = BitFileToFILE(bOutFile);          /* make file normal again */
+    for (i = 24; i >= 0; i -= 8)
+    {
+        writer.data[writer.pos++] = (byte_t)((crc >> i) & 0xFF);
+    }
+
+    if (fwrite(out, 1, writer.pos, outFile) != writer.pos)
+    {
+        return -1;
+    }
 
+    STATS_ADD(STAT_BYTES_IN, size);
+    STATS_ADD_FILE(STAT_BYTES_OUT, outPos, outFile);
     return 0;
 }
 
 /****************************************************************************
 *   Function   : CanonicalDecodeFile
 *   Description: This routine reads a Huffman coded file and writes out a
-*                decoded version of that file.
+*                decoded version of that file.  Files written before there
+*                was a container header are decoded until their EOF.
 *   Parameters : inFile - Open file pointer for file to decode
 *                outFile - Open file pointer for file receiving decoded data
 *   Effects    : Huffman encoded file is decoded
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.  Either way, inFile and outFile will
-*                be left open.
+*                event of a failure (EILSEQ if the file is truncated or
+*                its checksum doesn't match).  Either way, inFile and
+*                outFile will be left open.
 ****************************************************************************/
 int CanonicalDecodeFile(FILE *inFile, FILE *outFile)
+{
+    return CanonicalDecodeFileLimit(inFile, outFile, ULONG_MAX);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeFileLimit
+*   Description: This routine decodes a file like CanonicalDecodeFile, but
+*                fails instead of writing more than a given number of
+*                bytes, so files from untrusted sources can't fill the
+*                disk.  Files with a container header are rejected before
+*                anything is written if their decoded size is too large.
+*                Older files are decoded until they reach the limit.
+*   Parameters : inFile - Open file pointer for file to decode
+*                outFile - Open file pointer for file receiving decoded data
+*                maxSize - most bytes that may be decoded
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (EILSEQ if the file is malformed,
+*                truncated or its checksum doesn't match, ERANGE if it
+*                decodes to more than maxSize bytes).  Either way, inFile
+*                and outFile will be left open.
+****************************************************************************/
+int CanonicalDecodeFileLimit(FILE *inFile, FILE *outFile,
+    unsigned long maxSize)
 {
     bit_file_t *bInFile;
-    bit_array_t *code;
-    byte_t length;
-    char decodedEOF;
-    int i, newBit;
-    int lenIndex[NUM_CHARS];
-    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+    decode_entry_t *entry;
+    unsigned long code, remaining, crc, storedCrc;
+    int length, bits;
+    int i, c, symbol, status, inContainer, done;
+    size_t pos;
+    container_t container;
+    byte_t out[DECODE_BUFFER_SIZE];     /* decoded symbols */
+    canonical_decoder_t decoder;        /* code and look up tables */
+#ifdef HUFFMAN_STATS
+    double timer;
+    long inPos, outPos;
+#endif
 
     /* validate input and output files */
     if ((NULL == inFile) || (NULL == outFile))
@@ -183,6 +627,59 @@ int CanonicalDecodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
+    STATS_TELL(inPos, inFile);
+    STATS_TELL(outPos, outFile);
+
+    /* initialize canonical list */
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        decoder.list[i].value = i;
+        decoder.list[i].codeLen = 0;
+        decoder.list[i].code = 0;
+    }
+
+    /* no code is as long as the first magic byte */
+    c = getc(inFile);
+    inContainer = (containerMagic[0] == c);
+
+    if (inContainer)
+    {
+        ungetc(c, inFile);
+
+        if (0 != ReadContainer(inFile, &container, decoder.list))
+        {
+            return -1;
+        }
+
+        if (container.size > maxSize)
+        {
+            fprintf(stderr, "error: decoded data is larger than %lu bytes.\n",
+                maxSize);
+            errno = ERANGE;
+            return -1;
+        }
+
+        if (container.flags & (CONTAINER_STORED | CONTAINER_RUN))
+        {
+            status = DecodeUncodedFile(inFile, outFile, &container);
+            STATS_ADD_FILE(STAT_BYTES_IN, inPos, inFile);
+            STATS_ADD_FILE(STAT_BYTES_OUT, outPos, outFile);
+            return status;
+        }
+
+        remaining = container.size;
+    }
+    else
+    {
+        if (EOF != c)
+        {
+            ungetc(c, inFile);
+        }
+
+        container.flags = 0;
+        remaining = maxSize;        /* decode until EOF */
+    }
+
     bInFile = MakeBitFile(inFile, BF_READ);
 
     if (NULL == bInFile)
@@ -191,460 +688,4131 @@ int CanonicalDecodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
-    /* allocate canonical code list */
-    code = BitArrayCreate(EOF_CHAR);
-    if (code == NULL)
+    if (EOF == BitFileSetBuffer(bInFile, BF_BUFFER_SIZE))
     {
-        perror("Bit array allocation");
+        perror("Buffering Input File");
         inFile = BitFileToFILE(bInFile);
         return -1;
     }
 
-    /* initialize canonical list */
-    for (i = 0; i < NUM_CHARS; i++)
+    /* populate list with code length from file header */
+    STATS_START(timer);
+
+    if ((!inContainer) && (0 != ReadHeader(decoder.list, bInFile)))
     {
-        canonicalList[i].codeLen = 0;
-        canonicalList[i].code = NULL;
+        inFile = BitFileToFILE(bInFile);
+        return -1;
     }
 
-    /* populate list with code length from file header */
-    if (0 != ReadHeader(canonicalList, bInFile))
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    /* rebuild the code used on the encode */
+    if (0 != BuildDecoder(&decoder))
     {
-        BitArrayDestroy(code);
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
         inFile = BitFileToFILE(bInFile);
         return -1;
     }
 
-    /* sort the header by code length */
-    qsort(canonicalList, NUM_CHARS, sizeof(canonical_list_t),
-        CompareByCodeLen);
+    /* decode input file */
+    status = 0;
+    done = 0;
+    pos = 0;
+    crc = 0;
+    STATS_START(timer);
 
-    /* assign the codes using same rule as encode */
-    if (AssignCanonicalCodes(canonicalList) != 0)
+    while ((remaining > 0) || (!inContainer))
     {
-        /* failed to assign codes */
-        inFile = BitFileToFILE(bInFile);
+        bits = BitFilePeekBits(bInFile, &code, DECODE_LOOKUP_BITS);
+        entry = &decoder.table[code];
 
-        for (i = 0; i < NUM_CHARS; i++)
+        if (entry->codeLen != 0)
         {
-            if(canonicalList[i].code != NULL)
+            if (entry->codeLen > bits)
             {
-                BitArrayDestroy(canonicalList[i].code);
+                /* we ran out of data */
+                break;
             }
+
+            BitFileConsumeBits(bInFile, entry->codeLen);
+            symbol = entry->value;
         }
+        else
+        {
+            /***************************************************************
+            * The code is longer than DECODE_LOOKUP_BITS (or invalid).
+            * Extend the bits we've already looked at one bit at a time
+            * until they form a code.
+            ***************************************************************/
+            if (DECODE_LOOKUP_BITS > bits)
+            {
+                break;
+            }
 
-        return -1;
-    }
+            BitFileConsumeBits(bInFile, DECODE_LOOKUP_BITS);
+            length = DECODE_LOOKUP_BITS;
 
-    /* now we have a huffman code that matches the code used on the encode */
+            while ((code < decoder.lenBase[length]) &&
+                (length < decoder.maxLength))
+            {
+                if ((bits = BitFileGetBit(bInFile)) == EOF)
+                {
+                    /* we ran out of data */
+                    break;
+                }
 
-    /* create an index of first code at each possible length */
-    for (i = 0; i < NUM_CHARS; i++)
-    {
-        lenIndex[i] = NUM_CHARS;
-    }
+                code = (code << 1) | bits;
+                length++;
+            }
 
-    for (i = 0; i < NUM_CHARS; i++)
-    {
-        if (lenIndex[canonicalList[i].codeLen] > i)
-        {
-            /* first occurance of this code length */
-            lenIndex[canonicalList[i].codeLen] = i;
+            if (code < decoder.lenBase[length])
+            {
+                break;      /* out of data */
+            }
+
+            if ((i = FindSymbol(&decoder, code, length)) < 0)
+            {
+                /* no code matches the bits read */
+                fprintf(stderr, "error: invalid code in input file.\n");
+                errno = EILSEQ;
+                status = -1;
+                break;
+            }
+
+            symbol = decoder.list[i].value;
         }
-    }
 
-    /* decode input file */
-    length = 0;
-    BitArrayClearAll(code);
-    decodedEOF = 0;
+        if (symbol == EOF_CHAR)
+        {
+            done = 1;
+            break;
+        }
 
-    while(((newBit = BitFileGetBit(bInFile)) != EOF) && (!decodedEOF))
-    {
-        if (newBit != 0)
+        if (0 == remaining)
         {
-            BitArraySetBit(code, length);
+            /* an old file without a size has reached the limit */
+            fprintf(stderr, "error: decoded data is larger than %lu bytes.\n",
+                maxSize);
+            errno = ERANGE;
+            status = -1;
+            break;
         }
 
-        length++;
+        out[pos++] = (byte_t)symbol;
+        remaining--;
 
-        if (lenIndex[length] != NUM_CHARS)
+        if (DECODE_BUFFER_SIZE == pos)
         {
-            /* there are code of this length */
-            for(i = lenIndex[length];
-                (i < NUM_CHARS) && (canonicalList[i].codeLen == length);
-                i++)
+            if (0 != WriteDecoded(outFile, out, pos,
+                (container.flags & CONTAINER_CRC) ? &crc : NULL))
             {
-                if (BitArrayCompare(canonicalList[i].code, code) == 0)
-                {
-                    /* we just read a symbol output decoded value */
-                    if (canonicalList[i].value != EOF_CHAR)
-                    {
-                        fputc(canonicalList[i].value, outFile);
-                    }
-                    else
-                    {
-                        decodedEOF = 1;
-                    }
-
-                    BitArrayClearAll(code);
-                    length = 0;
+                status = -1;
+                break;
+            }
 
-                    break;
-                }
+            pos = 0;
+        }
+    }
+
+    if ((0 == status) && (0 != WriteDecoded(outFile, out, pos,
+        (container.flags & CONTAINER_CRC) ? &crc : NULL)))
+    {
+        status = -1;
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+
+    if ((0 == status) && inContainer)
+    {
+        storedCrc = 0;
+        BitFileByteAlign(bInFile);
+
+        for (i = 0; (i < CONTAINER_CRC_SIZE) &&
+            (container.flags & CONTAINER_CRC); i++)
+        {
+            if (EOF == (c = BitFileGetChar(bInFile)))
+            {
+                remaining = 1;      /* treat it like missing symbols */
+                break;
             }
+
+            storedCrc = (storedCrc << 8) | (unsigned long)c;
+        }
+
+        if (0 != remaining)
+        {
+            fprintf(stderr, "error: truncated input file.\n");
+            errno = EILSEQ;
+            status = -1;
+        }
+        else if ((container.flags & CONTAINER_CRC) && (storedCrc != crc))
+        {
+            fprintf(stderr, "error: checksum doesn't match.\n");
+            errno = EILSEQ;
+            status = -1;
         }
     }
 
+    if ((0 == status) && !inContainer && !done)
+    {
+        /* the data ran out before the EOF symbol */
+        fprintf(stderr, "error: truncated input file.\n");
+        errno = EILSEQ;
+        status = -1;
+    }
+
     /* clean up */
     inFile = BitFileToFILE(bInFile);            /* make file normal again */
 
-    return 0;
+    STATS_ADD_FILE(STAT_BYTES_IN, inPos, inFile);
+    STATS_ADD_FILE(STAT_BYTES_OUT, outPos, outFile);
+    return status;
 }
 
 /****************************************************************************
-*   Function   : CanonicalShowTree
-*   Description: This routine genrates a huffman tree optimized for a file
-*                and writes out an ASCII representation of the code
-*                represented by the tree.
-*   Parameters : inFile - Open file pointer for file to create the tree for
-*                outFile - Open file pointer for file to write the tree to
-*   Effects    : Huffman tree is written out to a file
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.  Either way, inFile and outFile will
-*                be left open.
+*   Function   : CanonicalEncodeBound
+*   Description: This routine returns the largest number of bytes that
+*                CanonicalEncodeBuffer can produce for an input of a given
+*                size.
+*   Parameters : size - number of bytes to be encoded
+*   Effects    : None
+*   Returned   : The worst case encoded size, or 0 if it's too large to be
+*                represented by a size_t.
 ****************************************************************************/
-int CanonicalShowTree(FILE *inFile, FILE *outFile)
+size_t CanonicalEncodeBound(size_t size)
 {
-    huffman_node_t *huffmanTree;                /* root of huffman tree */
-    int i, length;
-    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+    size_t bound;
 
-    /* validate input and output files */
-    if ((NULL == inFile) || (NULL == outFile))
+    /* every symbol takes at most MAX_CODE_LEN bits */
+    if ((size / 8) > ((((size_t)-1) - CONTAINER_BOUND - MAX_CODE_LEN) /
+        MAX_CODE_LEN))
+    {
+        return 0;
+    }
+
+    bound = CONTAINER_BOUND + (size / 8) * MAX_CODE_LEN;
+    bound += ((size % 8) * MAX_CODE_LEN + 7) / 8;
+    return bound;
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeBuffer
+*   Description: This routine generates a canonical code optimized for a
+*                buffer and writes an encoded version of the buffer to
+*                another buffer.  The output is the same as the output of
+*                CanonicalEncodeFile.
+*   Parameters : src - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the encoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : src is encoded into dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+int CanonicalEncodeBuffer(const void *src, size_t srcLen, void *dst,
+    size_t dstCap, size_t *outLen)
+{
+    huffman_encoder_t encoder;      /* nothing to reuse from another call */
+
+    encoder.valid = 0;
+    return HuffmanEncodeMessage(&encoder, src, srcLen, dst, dstCap, outLen);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodedSize
+*   Description: This routine returns the number of bytes that a buffer
+*                encoded by CanonicalEncodeBuffer (or a file encoded by
+*                CanonicalEncodeFile) decodes to, so a decoding buffer can
+*                be allocated before decoding.
+*   Parameters : src - pointer to the encoded data
+*                srcLen - number of bytes in src
+*                size - pointer to the number of bytes src decodes to
+*   Effects    : None
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (EILSEQ if src doesn't start with a
+*                container header, which is the case for data encoded by
+*                older versions of this library).
+****************************************************************************/
+int CanonicalDecodedSize(const void *src, size_t srcLen, size_t *size)
+{
+    container_t container;
+
+    /* validate parameters */
+    if ((NULL == src) || (NULL == size))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (0 != GetBufferContainer((const byte_t *)src, srcLen, &container))
+    {
+        return -1;
+    }
+
+    *size = container.size;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeBuffer
+*   Description: This routine decodes a buffer encoded by
+*                CanonicalEncodeBuffer (or a file encoded by
+*                CanonicalEncodeFile) that has been read into memory.
+*                Data written before there was a container header is
+*                decoded until its EOF.
+*   Parameters : src - pointer to the encoded data
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the decoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : src is decoded into dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small, EILSEQ if
+*                src is malformed or its checksum doesn't match).
+****************************************************************************/
+int CanonicalDecodeBuffer(const void *src, size_t srcLen, void *dst,
+    size_t dstCap, size_t *outLen)
+{
+    const byte_t *in;
+    int i;
+    bit_reader_t reader;
+    huffman_decoder_t decoder;      /* nothing to reuse from another call */
+
+    /* validate parameters */
+    if ((NULL == src) || ((NULL == dst) && (0 != dstCap)) ||
+        (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    in = (const byte_t *)src;
+    *outLen = 0;
+    decoder.valid = 0;
+
+    if ((0 != srcLen) && (containerMagic[0] == in[0]))
+    {
+        return HuffmanDecodeMessage(&decoder, src, srcLen, dst, dstCap,
+            outLen);
+    }
+
+    /* no code is as long as the first magic byte, so it's old data */
+    if (srcLen < NUM_CHARS)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* populate list with code length from header */
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        decoder.tables.list[i].value = i;
+        decoder.tables.list[i].codeLen = in[i];
+        decoder.tables.list[i].code = 0;
+    }
+
+    reader.data = in;
+    reader.size = srcLen;
+    reader.pos = NUM_CHARS;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+
+    /* rebuild the code used on the encode */
+    if (0 != BuildDecoder(&decoder.tables))
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* decode input buffer */
+    if (0 != DecodeToBuffer(&decoder.tables, &reader, (byte_t *)dst, dstCap,
+        outLen))
+    {
+        return -1;
+    }
+
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, *outLen);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : HuffmanCreateEncoder
+*   Description: This routine creates an encoder context for
+*                HuffmanEncodeMessage.  The context holds everything needed
+*                to encode a message, so encoding doesn't allocate memory,
+*                and the code built for one message is kept for the next.
+*   Parameters : None
+*   Effects    : An encoder is allocated.  It must be freed with
+*                HuffmanFreeEncoder.
+*   Returned   : Pointer to the new encoder, or NULL for failure.  errno
+*                will be set in the event of a failure.
+****************************************************************************/
+huffman_encoder_t *HuffmanCreateEncoder(void)
+{
+    huffman_encoder_t *encoder;
+
+    encoder = (huffman_encoder_t *)malloc(sizeof(huffman_encoder_t));
+
+    if (NULL == encoder)
+    {
+        perror("Allocating Encoder");
+        return NULL;
+    }
+
+    encoder->valid = 0;
+    return encoder;
+}
+
+/****************************************************************************
+*   Function   : HuffmanFreeEncoder
+*   Description: This routine frees an encoder context.
+*   Parameters : encoder - pointer to the encoder to free (may be NULL)
+*   Effects    : The encoder is freed.
+*   Returned   : None
+****************************************************************************/
+void HuffmanFreeEncoder(huffman_encoder_t *encoder)
+{
+    free(encoder);
+}
+
+/****************************************************************************
+*   Function   : HuffmanEncodeMessage
+*   Description: This routine does the same thing as CanonicalEncodeBuffer,
+*                using an encoder context.  A canonical code is built from
+*                the code lengths of the message.  If they're the same as
+*                the lengths of the last message encoded with the context,
+*                that message's code and container header are used instead
+*                of building new ones.  Like CanonicalEncodeFile, runs and
+*                tiny messages are written without building a code, and
+*                messages that coding doesn't make smaller are stored.
+*   Parameters : encoder - pointer to an encoder from HuffmanCreateEncoder
+*                src - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the encoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : src is encoded into dst, and the code is kept in encoder.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+int HuffmanEncodeMessage(huffman_encoder_t *encoder, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen)
+{
+    const byte_t *in;
+    int i, rebuild;
+    size_t codesLen;
+    unsigned long crc;
+    bit_writer_t writer;
+    byte_t lengths[NUM_CHARS];      /* code length of each symbol */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    /* validate parameters */
+    if ((NULL == encoder) || ((NULL == src) && (0 != srcLen)) ||
+        (NULL == dst) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    in = (const byte_t *)src;
+    *outLen = 0;
+
+    /* runs and tiny messages aren't worth building a code for */
+    if (IsRun(in, srcLen))
+    {
+        return EncodeUncoded(in, srcLen, CONTAINER_RUN, (byte_t *)dst, dstCap,
+            outLen);
+    }
+
+    if (srcLen < TINY_CONTAINER_SIZE)
+    {
+        return EncodeUncoded(in, srcLen, CONTAINER_STORED, (byte_t *)dst,
+            dstCap, outLen);
+    }
+
+    /* count symbols and use the counts to generate a canonical code */
+    if (0 != CountSymbols(in, srcLen, encoder->counts))
+    {
+        return -1;
+    }
+
+    STATS_START(timer);
+    BuildCodeLengths(encoder->counts, 0, lengths);
+
+    /* the same lengths always make the same code and header */
+    rebuild = (!encoder->valid) ||
+        (0 != memcmp(lengths, encoder->lengths, NUM_CHARS));
+
+    if (rebuild)
+    {
+        memcpy(encoder->lengths, lengths, NUM_CHARS);
+        BuildCodeFromLengths(lengths, encoder->list);
+        STATS_ADD(STAT_TABLE_BUILDS, 1);
+    }
+
+    STATS_STOP(STAT_TREE_NS, timer);
+    COUNT_CODE(encoder->counts, encoder->list);
+
+    if (rebuild)
+    {
+        encoder->headerLen = PutContainerHeader(encoder->header, 0,
+            encoder->list);
+        encoder->valid = 1;
+    }
+
+    codesLen = SymbolsSize(encoder->counts, encoder->list, 0);
+
+    /* store messages that coding doesn't make smaller */
+    if ((codesLen >= srcLen) ||
+        (encoder->headerLen - CONTAINER_HEADER_SIZE >= srcLen - codesLen))
+    {
+        return EncodeUncoded(in, srcLen, CONTAINER_STORED, (byte_t *)dst,
+            dstCap, outLen);
+    }
+
+    /* make sure everything fits, so the coding loop doesn't have to check */
+    if ((codesLen > ((size_t)-1) - encoder->headerLen - CONTAINER_CRC_SIZE) ||
+        (encoder->headerLen + codesLen + CONTAINER_CRC_SIZE > dstCap))
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    writer.data = (byte_t *)dst;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+
+    /* write container header for rebuilding of code */
+    memcpy(writer.data, encoder->header, encoder->headerLen);
+    PutContainerSize(writer.data, srcLen);
+    writer.pos = encoder->headerLen;
+
+    /* write encoded symbols (no EOF is needed), then the checksum */
+    BufferPutSymbols(&writer, encoder->list, in, srcLen, MAX_CODE_LEN);
+    BufferFlush(&writer);
+    crc = Crc32c(0, in, srcLen);
+
+    for (i = 24; i >= 0; i -= 8)
+    {
+        writer.data[writer.pos++] = (byte_t)((crc >> i) & 0xFF);
+    }
+
+    *outLen = writer.pos;
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, writer.pos);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : HuffmanCreateDecoder
+*   Description: This routine creates a decoder context for
+*                HuffmanDecodeMessage.  The context holds everything needed
+*                to decode a message, so decoding doesn't allocate memory,
+*                and the decoder built for one message is kept for the next.
+*   Parameters : None
+*   Effects    : A decoder is allocated.  It must be freed with
+*                HuffmanFreeDecoder.
+*   Returned   : Pointer to the new decoder, or NULL for failure.  errno
+*                will be set in the event of a failure.
+****************************************************************************/
+huffman_decoder_t *HuffmanCreateDecoder(void)
+{
+    huffman_decoder_t *decoder;
+
+    decoder = (huffman_decoder_t *)malloc(sizeof(huffman_decoder_t));
+
+    if (NULL == decoder)
+    {
+        perror("Allocating Decoder");
+        return NULL;
+    }
+
+    decoder->valid = 0;
+    return decoder;
+}
+
+/****************************************************************************
+*   Function   : HuffmanFreeDecoder
+*   Description: This routine frees a decoder context.
+*   Parameters : decoder - pointer to the decoder to free (may be NULL)
+*   Effects    : The decoder is freed.
+*   Returned   : None
+****************************************************************************/
+void HuffmanFreeDecoder(huffman_decoder_t *decoder)
+{
+    free(decoder);
+}
+
+/****************************************************************************
+*   Function   : HuffmanDecodeMessage
+*   Description: This routine does the same thing as CanonicalDecodeBuffer,
+*                using a decoder context.  If the code lengths in the
+*                container header are the same as the ones in the last
+*                message decoded with the context, that message's decoder
+*                is used instead of building a new one.
+*   Parameters : decoder - pointer to a decoder from HuffmanCreateDecoder
+*                src - pointer to the encoded data
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the decoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : src is decoded into dst, and the code is kept in decoder.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small, EILSEQ if
+*                src is malformed or its checksum doesn't match).
+****************************************************************************/
+int HuffmanDecodeMessage(huffman_decoder_t *decoder, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen)
+{
+    const byte_t *in, *lengths;
+    byte_t *out;
+    int i;
+    bit_reader_t reader;
+    container_t container;
+
+    /* validate parameters */
+    if ((NULL == decoder) || (NULL == src) ||
+        ((NULL == dst) && (0 != dstCap)) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    in = (const byte_t *)src;
+    out = (byte_t *)dst;
+    *outLen = 0;
+
+    if ((0 == srcLen) || (containerMagic[0] != in[0]))
+    {
+        /* old data has its code lengths in a different kind of header */
+        return CanonicalDecodeBuffer(src, srcLen, dst, dstCap, outLen);
+    }
+
+    if (0 != GetBufferContainer(in, srcLen, &container))
+    {
+        return -1;
+    }
+
+    if (container.flags & (CONTAINER_STORED | CONTAINER_RUN))
+    {
+        /* there's no code, so the decoder is kept for the next message */
+        return DecodeUncoded(in, srcLen, &container, out, dstCap, outLen);
+    }
+
+    /* the same compact code lengths always make the same decoder */
+    lengths = in + CONTAINER_HEADER_SIZE;
+
+    if ((!decoder->valid) || (container.lengthsLen != decoder->lengthsLen) ||
+        (0 != memcmp(lengths, decoder->lengths, container.lengthsLen)))
+    {
+        decoder->valid = 0;
+
+        for (i = 0; i < NUM_CHARS; i++)
+        {
+            decoder->tables.list[i].value = i;
+            decoder->tables.list[i].codeLen = 0;
+            decoder->tables.list[i].code = 0;
+        }
+
+        if (0 != GetContainerLengths(lengths, container.lengthsLen,
+            decoder->tables.list))
+        {
+            return -1;
+        }
+
+        /* rebuild the code used on the encode */
+        if (0 != BuildDecoder(&decoder->tables))
+        {
+            fprintf(stderr, "error: malformed file header.\n");
+            errno = EILSEQ;
+            return -1;
+        }
+
+        memcpy(decoder->lengths, lengths, container.lengthsLen);
+        decoder->lengthsLen = container.lengthsLen;
+        decoder->valid = 1;
+    }
+
+    /* fail before decoding anything if it won't fit */
+    if (container.size > dstCap)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    /* the encoded symbols are between the code lengths and the checksum */
+    reader.data = in;
+    reader.size = srcLen;
+    reader.pos = CONTAINER_HEADER_SIZE + container.lengthsLen;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+
+    if (container.flags & CONTAINER_CRC)
+    {
+        reader.size -= CONTAINER_CRC_SIZE;
+    }
+
+    if (0 != DecodeSymbols(&decoder->tables, &reader, out, container.size))
+    {
+        return -1;
+    }
+
+    if ((container.flags & CONTAINER_CRC) &&
+        (0 != CheckBufferCrc(in, srcLen, out, container.size)))
+    {
+        return -1;
+    }
+
+    *outLen = container.size;
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, container.size);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalInterleavedBound
+*   Description: This routine returns the largest number of bytes that
+*                CanonicalEncodeInterleaved may produce when encoding a
+*                buffer of a given size, with either kind of header.
+*   Parameters : size - number of bytes to be encoded
+*   Effects    : None
+*   Returned   : The worst case size of the encoded buffer, or 0 if that
+*                size can't be represented by a size_t.
+****************************************************************************/
+size_t CanonicalInterleavedBound(size_t size)
+{
+    size_t bound;
+
+    /* every symbol takes at most MAX_CODE_LEN bits, and each stream pads */
+    if ((size / 8) > ((((size_t)-1) - COMPACT_HEADER_BOUND -
+        JUMP_TABLE_SIZE - NUM_STREAMS - MAX_CODE_LEN) / MAX_CODE_LEN))
+    {
+        return 0;
+    }
+
+    bound = COMPACT_HEADER_BOUND + JUMP_TABLE_SIZE +
+        (size / 8) * MAX_CODE_LEN;
+    bound += ((size % 8) * MAX_CODE_LEN + 7) / 8 + (NUM_STREAMS - 1);
+    return bound;
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeInterleaved
+*   Description: This routine encodes a buffer the same way that
+*                CanonicalEncodeBuffer does, except that the data is split
+*                into NUM_STREAMS segments that are written as separate bit
+*                streams, and no EOF is written.  The decoder needs to know
+*                the size of the original data.
+*   Parameters : src - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the encoded data
+*                dstCap - size of dst in bytes.  CanonicalInterleavedBound
+*                         returns a size that is always large enough.
+*                outLen - pointer to the number of encoded bytes
+*                compact - 1 to write the code lengths as a compact header,
+*                          0 to write NUM_CHARS bytes of code lengths
+*   Effects    : src is Huffman encoded into dst, and the number of bytes
+*                written to dst is stored in outLen.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+int CanonicalEncodeInterleaved(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstCap, size_t *outLen, const int compact)
+{
+    int c, s, shift;
+    size_t segLen, total, headerLen;
+    byte_t header[COMPACT_HEADER_BOUND];    /* code lengths */
+    size_t start[NUM_STREAMS + 1];      /* first byte of each segment */
+    size_t streamLen[NUM_STREAMS];      /* encoded size of each segment */
+    bit_writer_t writer;
+    count_t counts[NUM_CHARS];          /* number of each symbol */
+    count_t segCounts[NUM_STREAMS][NUM_CHARS];  /* symbols in each segment */
+    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    /* validate parameters */
+    if (((NULL == src) && (0 != srcLen)) || (NULL == dst) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *outLen = 0;
+    segLen = srcLen / NUM_STREAMS + ((srcLen % NUM_STREAMS) ? 1 : 0);
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        start[s] = (s * segLen < srcLen) ? s * segLen : srcLen;
+    }
+
+    start[NUM_STREAMS] = srcLen;
+
+    /* count the symbols in each segment, and in the whole buffer */
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        counts[c] = 0;
+    }
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        if (0 != CountSymbols(src + start[s], start[s + 1] - start[s],
+            segCounts[s]))
+        {
+            return -1;
+        }
+
+        for (c = 0; c < NUM_CHARS; c++)
+        {
+            if (counts[c] > COUNT_T_MAX - segCounts[s][c])
+            {
+                fprintf(stderr, "Input contains too many 0x%02X to count.\n",
+                    c);
+                errno = ERANGE;
+                return -1;
+            }
+
+            counts[c] += segCounts[s][c];
+        }
+    }
+
+    BuildCanonicalCode(counts, 0, canonicalList);
+    STATS_START(timer);
+
+    if (compact)
+    {
+        headerLen = PutCompactLengths(canonicalList, header);
+    }
+    else
+    {
+        for (c = 0; c < NUM_CHARS; c++)
+        {
+            header[c] = canonicalList[c].codeLen;
+        }
+
+        headerLen = NUM_CHARS;
+    }
+
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    /* make sure everything fits, so the coding loop doesn't have to check */
+    total = headerLen + JUMP_TABLE_SIZE;
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        streamLen[s] = SymbolsSize(segCounts[s], canonicalList, 0);
+
+        if ((streamLen[s] > 0xFFFFFFFFUL) ||
+            (streamLen[s] > ((size_t)-1) - total))
+        {
+            errno = ERANGE;
+            return -1;
+        }
+
+        total += streamLen[s];
+    }
+
+    if (total > dstCap)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    writer.data = dst;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+
+    /* write header for rebuilding of code */
+    memcpy(writer.data, header, headerLen);
+    writer.pos = headerLen;
+
+    /* write the jump table */
+    for (s = 0; s < NUM_STREAMS - 1; s++)
+    {
+        for (shift = 24; shift >= 0; shift -= 8)
+        {
+            writer.data[writer.pos++] =
+                (byte_t)((streamLen[s] >> shift) & 0xFF);
+        }
+    }
+
+    /* write each segment as its own stream of encoded symbols */
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        BufferPutSymbols(&writer, canonicalList, src + start[s],
+            start[s + 1] - start[s], MAX_CODE_LEN);
+        BufferFlush(&writer);
+    }
+
+    *outLen = writer.pos;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeInterleaved
+*   Description: This routine decodes a buffer encoded by
+*                CanonicalEncodeInterleaved.  One symbol is decoded from
+*                each stream in turn, so the decoding of one stream can
+*                overlap the decoding of the others.
+*   Parameters : src - pointer to the data to decode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the decoded data
+*                dstLen - number of bytes that src decodes to
+*                compact - 1 if src has a compact header, otherwise 0
+*   Effects    : src is decoded into dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+int CanonicalDecodeInterleaved(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstLen, const int compact)
+{
+    int c, s, shift, symbol;
+    size_t i, k, pos, segLen, shortest, streamLen;
+    size_t start[NUM_STREAMS + 1];      /* first byte of each segment */
+    const byte_t *jumpTable;
+    const decode_entry_t *entry;
+    bit_reader_t *r;
+    bit_reader_t reader[NUM_STREAMS];   /* one reader for each stream */
+    canonical_decoder_t decoder;        /* code and look up tables */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    /* validate parameters */
+    if ((NULL == src) || ((NULL == dst) && (0 != dstLen)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* populate list with code length from header */
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        decoder.list[c].value = c;
+        decoder.list[c].codeLen = 0;
+        decoder.list[c].code = 0;
+    }
+
+    STATS_START(timer);
+
+    if (compact)
+    {
+        reader[0].data = src;
+        reader[0].size = srcLen;
+        reader[0].pos = 0;
+        reader[0].accum = 0;
+        reader[0].accumCount = 0;
+        CLEAR_REFILLS(&reader[0]);
+
+        if (0 != GetCompactLengths(&reader[0], decoder.list))
+        {
+            pos = srcLen + 1;   /* malformed */
+        }
+        else
+        {
+            /* don't count bytes read past the padding */
+            pos = reader[0].pos - (reader[0].accumCount / 8);
+        }
+    }
+    else
+    {
+        for (c = 0; (c < NUM_CHARS) && ((size_t)c < srcLen); c++)
+        {
+            decoder.list[c].codeLen = src[c];
+        }
+
+        pos = NUM_CHARS;
+    }
+
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    /* rebuild the code used on the encode */
+    if ((pos > srcLen) || (srcLen - pos < JUMP_TABLE_SIZE) ||
+        (0 != BuildDecoder(&decoder)))
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* use the jump table to find the start of each stream */
+    jumpTable = src + pos;
+    pos += JUMP_TABLE_SIZE;
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        if (s < NUM_STREAMS - 1)
+        {
+            streamLen = 0;
+
+            for (shift = 0; shift < 4; shift++)
+            {
+                streamLen = (streamLen << 8) | jumpTable[(4 * s) + shift];
+            }
+
+            if (streamLen > srcLen - pos)
+            {
+                fprintf(stderr, "error: malformed jump table.\n");
+                errno = EILSEQ;
+                return -1;
+            }
+        }
+        else
+        {
+            streamLen = srcLen - pos;
+        }
+
+        reader[s].data = src + pos;
+        reader[s].size = streamLen;
+        reader[s].pos = 0;
+        reader[s].accum = 0;
+        reader[s].accumCount = 0;
+        CLEAR_REFILLS(&reader[s]);
+        pos += streamLen;
+    }
+
+    segLen = dstLen / NUM_STREAMS + ((dstLen % NUM_STREAMS) ? 1 : 0);
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        start[s] = (s * segLen < dstLen) ? s * segLen : dstLen;
+    }
+
+    start[NUM_STREAMS] = dstLen;
+
+    /* the last segment is the shortest; decode that much from every one */
+    shortest = start[NUM_STREAMS] - start[NUM_STREAMS - 1];
+    symbol = 0;
+    STATS_START(timer);
+
+    /***********************************************************************
+    * While every stream has at least an accumulator's worth of bytes left,
+    * fill all of the accumulators at once, then decode LOOKUPS_PER_FILL
+    * symbols from each stream without checking for the end of the data.
+    * Codes that aren't in the table are left to DecodeSymbol.
+    ***********************************************************************/
+    for (i = 0; (i + LOOKUPS_PER_FILL <= shortest) && (symbol >= 0);
+        i += LOOKUPS_PER_FILL)
+    {
+        for (s = 0; s < NUM_STREAMS; s++)
+        {
+            if (reader[s].size - reader[s].pos < sizeof(unsigned long))
+            {
+                break;
+            }
+        }
+
+        if (s < NUM_STREAMS)
+        {
+            break;      /* finish up with the checked loop below */
+        }
+
+        for (s = 0; s < NUM_STREAMS; s++)
+        {
+            r = &reader[s];
+            COUNT_REFILL(r);
+
+            while (r->accumCount <= (ULONG_BITS - 8))
+            {
+                r->accum = (r->accum << 8) | r->data[r->pos];
+                r->pos++;
+                r->accumCount += 8;
+            }
+        }
+
+        for (k = 0; (k < LOOKUPS_PER_FILL) && (symbol >= 0); k++)
+        {
+            for (s = 0; s < NUM_STREAMS; s++)
+            {
+                r = &reader[s];
+                entry = NULL;
+
+                if (r->accumCount >= DECODE_LOOKUP_BITS)
+                {
+                    entry = &decoder.table[(r->accum >>
+                        (r->accumCount - DECODE_LOOKUP_BITS)) &
+                        (DECODE_TABLE_SIZE - 1)];
+                }
+
+                if ((NULL != entry) && (0 != entry->codeLen))
+                {
+                    r->accumCount -= entry->codeLen;
+                    symbol = entry->value;
+                }
+                else
+                {
+                    /* long code, or a long code emptied the accumulator */
+                    symbol = DecodeSymbol(&decoder, r);
+                }
+
+                if ((symbol < 0) || (EOF_CHAR == symbol))
+                {
+                    symbol = DECODE_BAD_CODE;
+                    break;
+                }
+
+                dst[start[s] + i + k] = (byte_t)symbol;
+            }
+        }
+    }
+
+    for (; (i < shortest) && (symbol >= 0); i++)
+    {
+        for (s = 0; s < NUM_STREAMS; s++)
+        {
+            symbol = DecodeSymbol(&decoder, &reader[s]);
+
+            if ((symbol < 0) || (EOF_CHAR == symbol))
+            {
+                symbol = DECODE_BAD_CODE;
+                break;
+            }
+
+            dst[start[s] + i] = (byte_t)symbol;
+        }
+    }
+
+    /* finish the longer segments one at a time */
+    for (s = 0; (s < NUM_STREAMS) && (symbol >= 0); s++)
+    {
+        for (pos = start[s] + shortest; pos < start[s + 1]; pos++)
+        {
+            symbol = DecodeSymbol(&decoder, &reader[s]);
+
+            if ((symbol < 0) || (EOF_CHAR == symbol))
+            {
+                symbol = DECODE_BAD_CODE;
+                break;
+            }
+
+            dst[pos] = (byte_t)symbol;
+        }
+    }
+
+#ifdef HUFFMAN_STATS
+    STATS_STOP(STAT_CODING_NS, timer);
+
+    for (s = 0; s < NUM_STREAMS; s++)
+    {
+        STATS_ADD(STAT_REFILLS, reader[s].refills);
+    }
+#endif
+
+    if (symbol < 0)
+    {
+        fprintf(stderr, "error: invalid code in input buffer.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeOrder1
+*   Description: This routine encodes a buffer with a set of canonical
+*                codes, coding each symbol with the code chosen by the
+*                symbol before it.  The byte values are grouped by how
+*                similar the counts of the symbols that follow them are,
+*                and each group gets a code.  Every number of groups in
+*                order1Groups is tried, and the one with the smallest
+*                result is written.  The decoder needs to know the size of
+*                the original data.
+*   Parameters : src - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the encoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of encoded bytes
+*   Effects    : src is Huffman encoded into dst, and the number of bytes
+*                written to dst is stored in outLen.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small, in which
+*                case nothing is written to dst).
+****************************************************************************/
+int CanonicalEncodeOrder1(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstCap, size_t *outLen)
+{
+    int c, g, numGroups, bestGroups;
+    size_t i, size, bestSize;
+    byte_t prev;
+    byte_t bestMap[256];                /* group of each byte */
+    bit_writer_t writer;
+    order1_work_t *work;
+    const canonical_list_t *contexts[256];  /* code used after each byte */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    /* validate parameters */
+    if (((NULL == src) && (0 != srcLen)) || (NULL == dst) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *outLen = 0;
+
+    if (srcLen > COUNT_T_MAX)
+    {
+        fprintf(stderr, "Input contains too many symbols to count.\n");
+        errno = ERANGE;
+        return -1;
+    }
+
+    work = (order1_work_t *)malloc(sizeof(order1_work_t));
+
+    if (NULL == work)
+    {
+        perror("Allocating Order-1 Work");
+        return -1;
+    }
+
+    /* count the symbols following each byte value */
+    STATS_START(timer);
+    memset(work->counts, 0, sizeof(work->counts));
+    prev = 0;
+
+    for (i = 0; i < srcLen; i++)
+    {
+        work->counts[prev][src[i]]++;
+        prev = src[i];
+    }
+
+    for (c = 0; c < 256; c++)
+    {
+        work->numNext[c] = 0;
+
+        for (g = 0; g < 256; g++)
+        {
+            if (0 != work->counts[c][g])
+            {
+                work->next[c][work->numNext[c]++] = (byte_t)g;
+            }
+        }
+    }
+
+    STATS_STOP(STAT_HISTOGRAM_NS, timer);
+
+    /* keep the grouping that codes to the fewest bytes */
+    STATS_START(timer);
+    bestSize = (size_t)-1;
+    bestGroups = 1;
+    memset(bestMap, 0, sizeof(bestMap));
+
+    for (g = 0; g < (int)(sizeof(order1Groups) / sizeof(order1Groups[0]));
+        g++)
+    {
+        numGroups = GroupContexts(work, order1Groups[g]);
+        size = Order1Size(work, numGroups);
+
+        if (size < bestSize)
+        {
+            bestSize = size;
+            bestGroups = numGroups;
+            memcpy(bestMap, work->map, sizeof(bestMap));
+        }
+
+        if (numGroups < order1Groups[g])
+        {
+            /* there aren't enough byte values for more groups */
+            break;
+        }
+    }
+
+    STATS_STOP(STAT_TREE_NS, timer);
+
+    if (bestSize > dstCap)
+    {
+        free(work);
+        errno = ERANGE;
+        return -1;
+    }
+
+    /* build the codes that will be used */
+    memcpy(work->map, bestMap, sizeof(bestMap));
+    CountGroups(work, bestGroups);
+
+    for (g = 0; g < bestGroups; g++)
+    {
+        BuildCanonicalCode(work->groupCounts[g], 0, work->codes[g]);
+    }
+
+    for (c = 0; c < 256; c++)
+    {
+        contexts[c] = work->codes[bestMap[c]];
+    }
+
+    writer.data = dst;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+    writer.data[writer.pos++] = (byte_t)bestGroups;
+
+    if (bestGroups > 1)
+    {
+        for (c = 0; c < 256; c += 2)
+        {
+            writer.data[writer.pos++] = (byte_t)((bestMap[c] << 4) |
+                bestMap[c + 1]);
+        }
+    }
+
+    for (g = 0; g < bestGroups; g++)
+    {
+        writer.pos += PutCompactLengths(work->codes[g],
+            writer.data + writer.pos);
+    }
+
+    BufferPutOrder1Symbols(&writer, contexts, src, srcLen);
+    BufferFlush(&writer);
+
+    free(work);
+    *outLen = writer.pos;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeOrder1
+*   Description: This routine decodes a buffer encoded by
+*                CanonicalEncodeOrder1.
+*   Parameters : src - pointer to the data to decode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the decoded data
+*                dstLen - number of bytes that src decodes to
+*   Effects    : src is decoded into dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+int CanonicalDecodeOrder1(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstLen)
+{
+    int c, g, numGroups, symbol;
+    size_t pos;
+    bit_reader_t reader;
+    canonical_decoder_t *decoders;      /* one decoder for each group */
+    const canonical_decoder_t *contexts[256];   /* decoder after each byte */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    /* validate parameters */
+    if ((NULL == src) || ((NULL == dst) && (0 != dstLen)))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    numGroups = (srcLen > 0) ? src[0] : 0;
+
+    if ((numGroups < 1) || (numGroups > ORDER1_MAX_CODES) ||
+        ((numGroups > 1) && (srcLen < 1 + ORDER1_MAP_SIZE)))
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    decoders = (canonical_decoder_t *)malloc(numGroups *
+        sizeof(canonical_decoder_t));
+
+    if (NULL == decoders)
+    {
+        perror("Allocating Decoders");
+        return -1;
+    }
+
+    STATS_START(timer);
+    symbol = 0;
+
+    for (c = 0; c < 256; c++)
+    {
+        g = 0;
+
+        if (numGroups > 1)
+        {
+            g = (src[1 + c / 2] >> ((c & 1) ? 0 : 4)) & 0x0F;
+        }
+
+        if (g >= numGroups)
+        {
+            symbol = DECODE_BAD_CODE;
+            g = 0;          /* don't point past the decoders */
+        }
+
+        contexts[c] = &decoders[g];
+    }
+
+    reader.data = src;
+    reader.size = srcLen;
+    reader.pos = (numGroups > 1) ? 1 + ORDER1_MAP_SIZE : 1;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+
+    for (g = 0; (g < numGroups) && (symbol >= 0); g++)
+    {
+        for (c = 0; c < NUM_CHARS; c++)
+        {
+            decoders[g].list[c].value = c;
+            decoders[g].list[c].codeLen = 0;
+            decoders[g].list[c].code = 0;
+        }
+
+        if (0 != GetCompactLengths(&reader, decoders[g].list))
+        {
+            symbol = DECODE_BAD_CODE;
+            break;
+        }
+
+        /* the next code lengths (or the symbols) start on a whole byte */
+        reader.accumCount -= reader.accumCount % 8;
+
+        if (0 != BuildDecoder(&decoders[g]))
+        {
+            symbol = DECODE_BAD_CODE;
+            break;
+        }
+    }
+
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    if (symbol < 0)
+    {
+        free(decoders);
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    STATS_START(timer);
+
+    for (pos = 0; pos < dstLen; pos++)
+    {
+        symbol = DecodeSymbol(contexts[symbol], &reader);
+
+        if ((symbol < 0) || (EOF_CHAR == symbol))
+        {
+            break;
+        }
+
+        dst[pos] = (byte_t)symbol;
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+    STATS_ADD(STAT_REFILLS, reader.refills);
+    free(decoders);
+
+    if ((symbol < 0) || (EOF_CHAR == symbol))
+    {
+        fprintf(stderr, "error: invalid code in input buffer.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalTrainTable
+*   Description: This routine builds a canonical code from sample data, so
+*                that data like the sample may be encoded without a header.
+*                Every symbol gets a code, even if it isn't in the sample.
+*   Parameters : sample - pointer to the sample data
+*                sampleLen - number of bytes in sample
+*                id - number identifying the table (0 - 0xFFFFFFFF).  It's
+*                     written in place of a header.
+*   Effects    : A table is allocated.  It must be freed with
+*                CanonicalFreeTable, unless it's added to a cache.
+*   Returned   : Pointer to the new table, or NULL for failure.  errno will
+*                be set in the event of a failure.
+****************************************************************************/
+canonical_table_t *CanonicalTrainTable(const void *sample, size_t sampleLen,
+    unsigned long id)
+{
+    int c;
+    count_t counts[NUM_CHARS];          /* number of each symbol */
+    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+
+    if (((NULL == sample) && (0 != sampleLen)) || (id > 0xFFFFFFFFUL))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (0 != CountSymbols((const byte_t *)sample, sampleLen, counts))
+    {
+        return NULL;
+    }
+
+    /* give symbols that aren't in the sample a code too */
+    for (c = 0; c < EOF_CHAR; c++)
+    {
+        if (counts[c] < COUNT_T_MAX)
+        {
+            counts[c]++;
+        }
+    }
+
+    BuildCanonicalCode(counts, 1, canonicalList);
+    return MakeTable(id, canonicalList);
+}
+
+/****************************************************************************
+*   Function   : CanonicalLoadTable
+*   Description: This routine rebuilds a table saved by CanonicalSaveTable.
+*   Parameters : src - pointer to the saved table
+*                srcLen - number of bytes in src
+*   Effects    : A table is allocated.  It must be freed with
+*                CanonicalFreeTable, unless it's added to a cache.
+*   Returned   : Pointer to the new table, or NULL for failure.  errno will
+*                be set in the event of a failure.
+****************************************************************************/
+canonical_table_t *CanonicalLoadTable(const void *src, size_t srcLen)
+{
+    int c, length, available;
+    unsigned long id;
+    bit_reader_t reader;
+    int lenCount[MAX_TABLE_CODE_LEN + 1];   /* number of codes of a length */
+    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+
+    if (NULL == src)
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    reader.data = (const byte_t *)src;
+    reader.size = srcLen;
+    reader.pos = 0;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+    id = 0;
+
+    for (c = 0; c < TABLE_ID_SIZE; c++)
+    {
+        if ((length = BufferGetBits(&reader, 8)) == EOF)
+        {
+            break;
+        }
+
+        id = (id << 8) | (unsigned long)length;
+    }
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        canonicalList[c].value = c;
+        canonicalList[c].codeLen = 0;
+        canonicalList[c].code = 0;
+    }
+
+    for (length = 0; length <= MAX_TABLE_CODE_LEN; length++)
+    {
+        lenCount[length] = 0;
+    }
+
+    available = -1;     /* in case the table is cut short */
+
+    if ((EOF != length) && (0 == GetCompactLengths(&reader, canonicalList)))
+    {
+        /* every symbol needs a code of a length the encoder can write */
+        for (c = 0; c < NUM_CHARS; c++)
+        {
+            if ((0 == canonicalList[c].codeLen) ||
+                (canonicalList[c].codeLen > MAX_TABLE_CODE_LEN))
+            {
+                break;
+            }
+
+            lenCount[canonicalList[c].codeLen]++;
+        }
+
+        /*******************************************************************
+        * Canonical codes are only prefix free if the lengths use up every
+        * code, so count the unused codes of each length.  More unused
+        * codes than symbols can never be used up.
+        *******************************************************************/
+        available = (NUM_CHARS == c) ? 1 : -1;
+
+        for (length = 1; (length <= MAX_TABLE_CODE_LEN) &&
+            (available >= 0) && (available <= NUM_CHARS); length++)
+        {
+            available = (2 * available) - lenCount[length];
+        }
+    }
+
+    if (0 != available)
+    {
+        fprintf(stderr, "error: malformed code table.\n");
+        errno = EILSEQ;
+        return NULL;
+    }
+
+    AssignCanonicalCodes(canonicalList);
+    return MakeTable(id, canonicalList);
+}
+
+/****************************************************************************
+*   Function   : CanonicalSaveTable
+*   Description: This routine writes a table to a buffer, so that it may
+*                be loaded by CanonicalLoadTable.
+*   Parameters : table - pointer to the table to save
+*                dst - pointer to the buffer receiving the table
+*                dstCap - size of dst in bytes.  CANONICAL_TABLE_BOUND
+*                         bytes are always enough.
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : The table is written to dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+int CanonicalSaveTable(const canonical_table_t *table, void *dst,
+    size_t dstCap, size_t *outLen)
+{
+    int shift;
+    size_t pos, headerLen;
+    byte_t header[COMPACT_HEADER_BOUND];    /* code lengths */
+
+    if ((NULL == table) || (NULL == dst) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *outLen = 0;
+    headerLen = PutCompactLengths(table->codes, header);
+
+    if (TABLE_ID_SIZE + headerLen > dstCap)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    pos = 0;
+
+    for (shift = 8 * (TABLE_ID_SIZE - 1); shift >= 0; shift -= 8)
+    {
+        ((byte_t *)dst)[pos++] = (byte_t)((table->id >> shift) & 0xFF);
+    }
+
+    memcpy((byte_t *)dst + pos, header, headerLen);
+    *outLen = pos + headerLen;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalFreeTable
+*   Description: This routine frees a table that isn't in a cache.
+*   Parameters : table - pointer to the table to free (may be NULL)
+*   Effects    : The table is freed.
+*   Returned   : None
+****************************************************************************/
+void CanonicalFreeTable(canonical_table_t *table)
+{
+    free(table);
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeWithTable
+*   Description: This routine encodes a buffer with a trained table.  The
+*                encoded data starts with the table's id instead of a
+*                header.
+*   Parameters : table - pointer to the table to encode with
+*                src - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the encoded data
+*                dstCap - size of dst in bytes.  CanonicalEncodeBound
+*                         returns a size that is always large enough.
+*                outLen - pointer to the number of encoded bytes
+*   Effects    : src is Huffman encoded into dst, and the number of bytes
+*                written to dst is stored in outLen.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+int CanonicalEncodeWithTable(const canonical_table_t *table, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen)
+{
+    const byte_t *in;
+    int shift;
+    size_t i, worst;
+    unsigned long bits;
+    bit_writer_t writer;
+
+    /* validate parameters */
+    if ((NULL == table) || ((NULL == src) && (0 != srcLen)) ||
+        (NULL == dst) || (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    in = (const byte_t *)src;
+    *outLen = 0;
+
+    /* make sure everything fits, so the coding loop doesn't have to check */
+    worst = (size_t)-1;
+
+    if ((srcLen / 8) < (((size_t)-1) - TABLE_ID_SIZE - table->maxLength) /
+        table->maxLength)
+    {
+        worst = TABLE_ID_SIZE + (srcLen / 8) * table->maxLength +
+            ((srcLen % 8 + 1) * table->maxLength + 7) / 8;
+    }
+
+    if (worst > dstCap)
+    {
+        /* it might still fit; add up the real code lengths */
+        worst = TABLE_ID_SIZE;
+        bits = table->codes[EOF_CHAR].codeLen;
+
+        for (i = 0; (i < srcLen) && (worst <= dstCap); i++)
+        {
+            bits += table->codes[in[i]].codeLen;
+            worst += bits / 8;
+            bits %= 8;
+        }
+
+        if (worst + ((bits + 7) / 8) > dstCap)
+        {
+            errno = ERANGE;
+            return -1;
+        }
+    }
+
+    writer.data = (byte_t *)dst;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+
+    /* write table id in place of a header */
+    for (shift = 8 * (TABLE_ID_SIZE - 1); shift >= 0; shift -= 8)
+    {
+        writer.data[writer.pos++] = (byte_t)((table->id >> shift) & 0xFF);
+    }
+
+    /* write encoded symbols and EOF */
+    EncodeToBuffer(&writer, table->codes, in, srcLen, table->maxLength);
+
+    *outLen = writer.pos;
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, writer.pos);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalCreateCache
+*   Description: This routine creates an empty cache of trained tables for
+*                CanonicalDecodeWithCache to choose from.
+*   Parameters : None
+*   Effects    : A cache is allocated.  It must be freed with
+*                CanonicalFreeCache.
+*   Returned   : Pointer to the new cache, or NULL for failure.  errno will
+*                be set in the event of a failure.
+****************************************************************************/
+canonical_cache_t *CanonicalCreateCache(void)
+{
+    canonical_cache_t *cache;
+
+    cache = (canonical_cache_t *)malloc(sizeof(canonical_cache_t));
+
+    if (NULL == cache)
+    {
+        perror("Allocating Table Cache");
+        return NULL;
+    }
+
+    cache->tables = NULL;
+    cache->numTables = 0;
+    cache->capacity = 0;
+    return cache;
+}
+
+/****************************************************************************
+*   Function   : CanonicalCacheAdd
+*   Description: This routine adds a trained table to a cache.  The cache
+*                owns the table from then on; it may still be used for
+*                encoding until the cache is freed.
+*   Parameters : cache - pointer to the cache
+*                table - pointer to the table to add.  No other table in
+*                        the cache may have the same id.
+*   Effects    : The table is added to the cache.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  The table isn't added if the call
+*                fails.
+****************************************************************************/
+int CanonicalCacheAdd(canonical_cache_t *cache, canonical_table_t *table)
+{
+    canonical_table_t **tables;
+    int i, index;
+
+    if ((NULL == cache) || (NULL == table))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    index = FindTable(cache, table->id);
+
+    if ((index < cache->numTables) &&
+        (cache->tables[index]->id == table->id))
+    {
+        /* there's already a table with this id */
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (cache->numTables == cache->capacity)
+    {
+        tables = (canonical_table_t **)realloc(cache->tables,
+            (cache->capacity + CACHE_GROWTH) * sizeof(canonical_table_t *));
+
+        if (NULL == tables)
+        {
+            perror("Allocating Table Cache");
+            return -1;
+        }
+
+        cache->tables = tables;
+        cache->capacity += CACHE_GROWTH;
+    }
+
+    /* keep the tables sorted so they can be found with a binary search */
+    for (i = cache->numTables; i > index; i--)
+    {
+        cache->tables[i] = cache->tables[i - 1];
+    }
+
+    cache->tables[index] = table;
+    cache->numTables++;
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalFreeCache
+*   Description: This routine frees a cache and all of the tables in it.
+*   Parameters : cache - pointer to the cache to free (may be NULL)
+*   Effects    : The cache and its tables are freed.
+*   Returned   : None
+****************************************************************************/
+void CanonicalFreeCache(canonical_cache_t *cache)
+{
+    int i;
+
+    if (NULL == cache)
+    {
+        return;
+    }
+
+    for (i = 0; i < cache->numTables; i++)
+    {
+        free(cache->tables[i]);
+    }
+
+    free(cache->tables);
+    free(cache);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeWithCache
+*   Description: This routine decodes a buffer encoded by
+*                CanonicalEncodeWithTable, using the table in the cache
+*                with the id at the start of the buffer.  The table's
+*                decoder was built when the table was made, so nothing
+*                needs to be rebuilt.
+*   Parameters : cache - pointer to the cache holding the table
+*                src - pointer to the data to decode
+*                srcLen - number of bytes in src
+*                dst - pointer to the buffer receiving the decoded data
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of decoded bytes
+*   Effects    : src is decoded into dst, and the number of bytes written to
+*                dst is stored in outLen.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small, ENOENT if
+*                the table isn't in the cache).
+****************************************************************************/
+int CanonicalDecodeWithCache(const canonical_cache_t *cache, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen)
+{
+    unsigned long id;
+    int i;
+    bit_reader_t reader;
+
+    /* validate parameters */
+    if ((NULL == cache) || (NULL == src) || ((NULL == dst) && (0 != dstCap)) ||
+        (NULL == outLen))
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    *outLen = 0;
+
+    if (srcLen < TABLE_ID_SIZE)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    reader.data = (const byte_t *)src;
+    reader.size = srcLen;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+    id = 0;
+
+    for (i = 0; i < TABLE_ID_SIZE; i++)
+    {
+        id = (id << 8) | reader.data[i];
+    }
+
+    reader.pos = TABLE_ID_SIZE;
+    i = FindTable(cache, id);
+
+    if ((i == cache->numTables) || (cache->tables[i]->id != id))
+    {
+        fprintf(stderr, "error: unknown code table %lu.\n", id);
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != DecodeToBuffer(&cache->tables[i]->decoder, &reader,
+        (byte_t *)dst, dstCap, outLen))
+    {
+        return -1;
+    }
+
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, *outLen);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CanonicalShowTree
+*   Description: This routine genrates a huffman tree optimized for a file
+*                and writes out an ASCII representation of the code
+*                represented by the tree.
+*   Parameters : inFile - Open file pointer for file to create the tree for
+*                outFile - Open file pointer for file to write the tree to
+*   Effects    : Huffman tree is written out to a file
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalShowTree(FILE *inFile, FILE *outFile)
+{
+    int i, length;
+    count_t counts[NUM_CHARS];                  /* number of each symbol */
+    canonical_list_t canonicalList[NUM_CHARS];  /* list of canonical codes */
+
+    /* validate input and output files */
+    if ((NULL == inFile) || (NULL == outFile))
     {
         errno = ENOENT;
         return -1;
     }
 
-    /* build tree */
-    if ((huffmanTree = GenerateTreeFromFile(inFile)) == NULL)
+    /* count symbols and use the counts to generate a canonical code */
+    if (0 != CountFileSymbols(inFile, counts))
+    {
+        return -1;
+    }
+
+    BuildCanonicalCode(counts, 0, canonicalList);
+
+    /* write out canonical code */
+    /* print heading to make things look pretty (int is 10 char max) */
+    fprintf(outFile, "Char  CodeLen  Encoding\n");
+    fprintf(outFile, "----- -------- ----------------\n");
+
+    for(i = 0; i < NUM_CHARS; i++)
+    {
+        if(canonicalList[i].codeLen > 0)
+        {
+            if (canonicalList[i].value != EOF_CHAR)
+            {
+                fprintf(outFile,
+                        "0x%02X  %02d       ",
+                        canonicalList[i].value, canonicalList[i].codeLen);
+            }
+            else
+            {
+                fprintf(outFile,
+                        "EOF   %02d       ", canonicalList[i].codeLen);
+            }
+
+            /* now write out the code bits */
+            for(length = canonicalList[i].codeLen - 1; length >= 0; length--)
+            {
+                if ((canonicalList[i].code >> length) & 1)
+                {
+                    fputc('1', outFile);
+                }
+                else
+                {
+                    fputc('0', outFile);
+                }
+            }
+
+            fputc('\n', outFile);
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : BuildCanonicalCode
+*   Description: This function builds a canonical Huffman code from the
+*                number of occurrences of each symbol.
+*   Parameters : counts - number of occurrences of each symbol
+*                eof - 1 if EOF needs a code, 0 if it doesn't
+*                cl - pointer to canonical list
+*   Effects    : cl is filled with the canonical codes sorted by the value
+*                of the charcter to be encode.
+*   Returned   : None
+****************************************************************************/
+static void BuildCanonicalCode(const count_t *counts, const int eof,
+    canonical_list_t *cl)
+{
+    byte_t lengths[NUM_CHARS];      /* code length of each symbol */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+
+    /* code lengths are the depths in a Huffman tree for the counts */
+    BuildCodeLengths(counts, eof, lengths);
+    BuildCodeFromLengths(lengths, cl);
+
+    STATS_STOP(STAT_TREE_NS, timer);
+    STATS_ADD(STAT_TABLE_BUILDS, 1);
+    COUNT_CODE(counts, cl);
+}
+
+/****************************************************************************
+*   Function   : BuildCodeFromLengths
+*   Description: This function builds a canonical Huffman code from the
+*                code length of each symbol.  Codes longer than MAX_CODE_LEN
+*                are shortened.
+*   Parameters : lengths - code length of each symbol (0 if it has no code)
+*                cl - pointer to canonical list
+*   Effects    : cl is filled with the canonical codes sorted by the value
+*                of the charcter to be encode.
+*   Returned   : None
+****************************************************************************/
+static void BuildCodeFromLengths(const byte_t *lengths, canonical_list_t *cl)
+{
+    int i, maxLength;
+
+    /* initialize list */
+    maxLength = 0;
+
+    for(i = 0; i < NUM_CHARS; i++)
+    {
+        cl[i].value = i;
+        cl[i].codeLen = lengths[i];
+        cl[i].code = 0;
+
+        if (lengths[i] > maxLength)
+        {
+            maxLength = lengths[i];
+        }
+    }
+
+    if (maxLength > MAX_CODE_LEN)
+    {
+        /* shorten the longest codes */
+        LimitCodeLengths(cl);
+    }
+
+    AssignCanonicalCodes(cl);
+}
+
+/****************************************************************************
+*   Function   : LimitCodeLengths
+*   Description: This function shortens the codes in a list of symbols, so
+*                that no code is longer than MAX_CODE_LEN bits.  Codes that
+*                are too long are cut down to MAX_CODE_LEN bits, then codes
+*                are moved to longer lengths until the lengths satisfy the
+*                Kraft inequality again.  The symbols keep their order by
+*                (length, value), so more frequent symbols never end up
+*                with longer codes than less frequent ones.
+*   Parameters : cl - list of symbols sorted by value
+*   Effects    : The code lengths in cl are replaced with lengths of at
+*                most MAX_CODE_LEN.
+*   Returned   : None
+****************************************************************************/
+static void LimitCodeLengths(canonical_list_t *cl)
+{
+    int i, length;
+    int lenCount[NUM_CHARS];            /* number of codes of each length */
+    int order[NUM_CHARS];               /* symbols by (length, value) */
+    unsigned long excess;
+
+    SortByCodeLength(cl, lenCount, order);
+
+    /* every code that's too long becomes a MAX_CODE_LEN bit code */
+    for (length = MAX_CODE_LEN + 1; length < NUM_CHARS; length++)
+    {
+        lenCount[MAX_CODE_LEN] += lenCount[length];
+    }
+
+    /***********************************************************************
+    * Compute how far the Kraft sum now exceeds 1 in units of
+    * 2^-MAX_CODE_LEN.  The sum may not fit in an unsigned long, but the
+    * amount it exceeds 1 by always does, and unsigned arithmetic wraps.
+    ***********************************************************************/
+    excess = 0;
+
+    for (length = 1; length <= MAX_CODE_LEN; length++)
+    {
+        excess += (unsigned long)lenCount[length] << (MAX_CODE_LEN - length);
+    }
+
+    excess -= (1UL << (MAX_CODE_LEN - 1)) << 1;
+
+    while (excess > 0)
+    {
+        /* remove one code from the longest length ... */
+        lenCount[MAX_CODE_LEN]--;
+
+        /* ... and make room for it by splitting the longest shorter code */
+        for (length = MAX_CODE_LEN - 1; length > 0; length--)
+        {
+            if (lenCount[length] != 0)
+            {
+                lenCount[length]--;
+                lenCount[length + 1] += 2;
+                break;
+            }
+        }
+
+        excess--;
+    }
+
+    /* hand the new lengths out in the order of the old lengths */
+    length = 1;
+
+    for (i = lenCount[0]; i < NUM_CHARS; i++)
+    {
+        while (0 == lenCount[length])
+        {
+            length++;
+        }
+
+        cl[order[i]].codeLen = length;
+        lenCount[length]--;
+    }
+}
+
+/****************************************************************************
+*   Function   : AssignCanonicalCodes
+*   Description: This function assigns a canonical Huffman code to each
+*                symbol in a list from the symbols' code lengths.
+*                The longest codes are assigned the smallest values, so the
+*                value of every code is less than twice the number of
+*                symbols, even when the code itself is longer than an
+*                unsigned long.  Within a length, symbols with higher
+*                values are assigned smaller codes.  The first code of each
+*                length is computed from the number of codes of each
+*                length, so the list never needs to be sorted.
+*   Parameters : cl - list of symbols sorted by value
+*   Effects    : The code of every symbol with a code length is stored in
+*                cl.
+*   Returned   : None
+****************************************************************************/
+static void AssignCanonicalCodes(canonical_list_t *cl)
+{
+    int i, length;
+    int lenCount[NUM_CHARS];            /* number of codes of each length */
+    unsigned long nextCode[NUM_CHARS];  /* next code of each length */
+
+    for (length = 0; length < NUM_CHARS; length++)
+    {
+        lenCount[length] = 0;
+    }
+
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        lenCount[cl[i].codeLen]++;
+    }
+
+    /***********************************************************************
+    * The codes of a length follow the codes of the next longer length,
+    * shifted right by one bit.  Shifting one length at a time never shifts
+    * by ULONG_BITS or more, however far apart the lengths are.
+    ***********************************************************************/
+    nextCode[NUM_CHARS - 1] = 0;
+
+    for (length = NUM_CHARS - 2; length > 0; length--)
+    {
+        nextCode[length] =
+            (nextCode[length + 1] + lenCount[length + 1]) >> 1;
+    }
+
+    /* assign right justified codes in reverse symbol order */
+    for (i = NUM_CHARS - 1; i >= 0; i--)
+    {
+        if (cl[i].codeLen != 0)
+        {
+            cl[i].code = nextCode[cl[i].codeLen]++;
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : SortByCodeLength
+*   Description: This function counting sorts a list of symbols by code
+*                length.  Symbols with the same code length stay in order
+*                of value.
+*   Parameters : cl - list of symbols sorted by value
+*                lenCount - array of NUM_CHARS receiving the number of
+*                           symbols with each code length
+*                order - array of NUM_CHARS receiving the index in cl of
+*                        each symbol, sorted by (length, value)
+*   Effects    : lenCount and order are filled in.
+*   Returned   : None
+****************************************************************************/
+static void SortByCodeLength(const canonical_list_t *cl, int *lenCount,
+    int *order)
+{
+    int i, length;
+    int next[NUM_CHARS];                /* next index for each length */
+
+    for (length = 0; length < NUM_CHARS; length++)
+    {
+        lenCount[length] = 0;
+    }
+
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        lenCount[cl[i].codeLen]++;
+    }
+
+    next[0] = 0;
+
+    for (length = 1; length < NUM_CHARS; length++)
+    {
+        next[length] = next[length - 1] + lenCount[length - 1];
+    }
+
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        order[next[cl[i].codeLen]++] = i;
+    }
+}
+
+/****************************************************************************
+*   Function   : ReadHeader
+*   Description: This function reads the NUM_CHARS code lengths that
+*                start files written before there was a container header.
+*                If the same algorithm that produced the original code is
+*                used with these lengths, an exact copy of the code will be
+*                produced.
+*   Parameters : cl - pointer to list of canonical Huffman codes
+*                bfp - file to read from
+*   Effects    : Code lengths and symbols are read into the canonical list.
+*                Total number of symbols encoded is store in totalCount
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ReadHeader(canonical_list_t *cl, bit_file_t *bfp)
+{
+    int c;
+    int i;
+
+    /* read the code length */
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        c = BitFileGetChar(bfp);
+
+        if (c != EOF)
+        {
+            cl[i].value = i;
+            cl[i].codeLen = (byte_t)c;
+        }
+        else
+        {
+            fprintf(stderr, "error: malformed file header.\n");
+            errno = EILSEQ;     /* Illegal byte sequence seems reasonable */
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : PutContainerHeader
+*   Description: This function builds the container header that starts
+*                encoded files and buffers.
+*   Parameters : dst - pointer to the buffer receiving the header (it must
+*                      hold CONTAINER_HEADER_SIZE + COMPACT_HEADER_BOUND
+*                      bytes)
+*                size - number of bytes that will be encoded
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : The container header and code lengths are written to dst.
+*   Returned   : The number of bytes written to dst.
+****************************************************************************/
+static size_t PutContainerHeader(byte_t *dst, unsigned long size,
+    const canonical_list_t *cl)
+{
+    size_t lengthsLen;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    memcpy(dst, containerMagic, sizeof(containerMagic));
+    dst[4] = CONTAINER_VERSION;
+    dst[5] = CONTAINER_CRC;
+    PutContainerSize(dst, size);
+
+    lengthsLen = PutCompactLengths(cl, dst + CONTAINER_HEADER_SIZE);
+    dst[14] = (byte_t)(lengthsLen >> 8);
+    dst[15] = (byte_t)(lengthsLen & 0xFF);
+
+    STATS_STOP(STAT_HEADER_NS, timer);
+    return CONTAINER_HEADER_SIZE + lengthsLen;
+}
+
+/****************************************************************************
+*   Function   : PutUncodedHeader
+*   Description: This function writes the container header for data that
+*                isn't coded, which has no code lengths.
+*   Parameters : dst - pointer to the buffer receiving the header (it must
+*                      hold CONTAINER_HEADER_SIZE bytes)
+*                size - number of bytes in the data
+*                flags - CONTAINER_STORED or CONTAINER_RUN
+*   Effects    : The container header is written to dst.
+*   Returned   : None
+****************************************************************************/
+static void PutUncodedHeader(byte_t *dst, unsigned long size,
+    const int flags)
+{
+    memcpy(dst, containerMagic, sizeof(containerMagic));
+    dst[4] = CONTAINER_VERSION;
+    dst[5] = (byte_t)(CONTAINER_CRC | flags);
+    PutContainerSize(dst, size);
+    dst[14] = 0;
+    dst[15] = 0;
+}
+
+/****************************************************************************
+*   Function   : PutContainerSize
+*   Description: This function writes the decoded size into a container
+*                header, so a header may be reused for data of another
+*                size.
+*   Parameters : dst - pointer to the container header
+*                size - number of bytes that will be encoded
+*   Effects    : The size is written to the header.
+*   Returned   : None
+****************************************************************************/
+static void PutContainerSize(byte_t *dst, unsigned long size)
+{
+    int i;
+
+    /* size is 8 bytes no matter how big an unsigned long is */
+    for (i = 13; i >= 6; i--)
+    {
+        dst[i] = (byte_t)(size & 0xFF);
+        size >>= 8;
+    }
+}
+
+/****************************************************************************
+*   Function   : EncodeUncoded
+*   Description: This function writes a buffer to another buffer in a
+*                container that doesn't need a code.  A CONTAINER_STORED
+*                container holds the whole buffer, and a CONTAINER_RUN
+*                container holds its first byte.
+*   Parameters : in - pointer to the data to encode
+*                srcLen - number of bytes in src
+*                flags - CONTAINER_STORED or CONTAINER_RUN (in must be a
+*                        run)
+*                dst - pointer to the buffer receiving the container
+*                dstCap - size of dst in bytes
+*                outLen - pointer to the number of bytes written to dst
+*   Effects    : The container is written to dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if dst is too small).
+****************************************************************************/
+static int EncodeUncoded(const byte_t *in, const size_t srcLen,
+    const int flags, byte_t *dst, const size_t dstCap, size_t *outLen)
+{
+    int i;
+    size_t len;
+    unsigned long crc;
+
+    len = (CONTAINER_STORED == flags) ? srcLen : 1;
+
+    if ((dstCap < CONTAINER_HEADER_SIZE + CONTAINER_CRC_SIZE) ||
+        (len > dstCap - CONTAINER_HEADER_SIZE - CONTAINER_CRC_SIZE))
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    PutUncodedHeader(dst, srcLen, flags);
+
+    if (0 != len)
+    {
+        memcpy(dst + CONTAINER_HEADER_SIZE, in, len);
+    }
+
+    len += CONTAINER_HEADER_SIZE;
+    crc = Crc32c(0, in, srcLen);
+
+    for (i = 24; i >= 0; i -= 8)
+    {
+        dst[len++] = (byte_t)((crc >> i) & 0xFF);
+    }
+
+    *outLen = len;
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, len);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : GetContainerHeader
+*   Description: This function reads the part of a container header
+*                before the code lengths.
+*   Parameters : src - pointer to CONTAINER_HEADER_SIZE bytes of header
+*                container - pointer to the container information read
+*   Effects    : The header is read into container.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int GetContainerHeader(const byte_t *src, container_t *container)
+{
+    int i, uncoded;
+
+    container->flags = src[5];
+    container->size = 0;
+    container->lengthsLen = ((size_t)src[14] << 8) | src[15];
+    uncoded = container->flags & (CONTAINER_STORED | CONTAINER_RUN);
+
+    /* data with code lengths is coded, data without them is stored or a run */
+    if ((0 != memcmp(src, containerMagic, sizeof(containerMagic))) ||
+        (CONTAINER_VERSION != src[4]) ||
+        (container->flags &
+            ~(CONTAINER_CRC | CONTAINER_STORED | CONTAINER_RUN)) ||
+        ((CONTAINER_STORED | CONTAINER_RUN) == uncoded) ||
+        ((0 == container->lengthsLen) != (0 != uncoded)) ||
+        (container->lengthsLen > COMPACT_HEADER_BOUND))
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    for (i = 6; i < 14; i++)
+    {
+        if (container->size > (ULONG_MAX >> 8))
+        {
+            errno = ERANGE;
+            return -1;
+        }
+
+        container->size = (container->size << 8) | src[i];
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : GetBufferContainer
+*   Description: This function reads the container header at the start of
+*                a memory buffer, and makes sure the buffer is big enough
+*                to hold everything the header describes.
+*   Parameters : src - pointer to the buffer
+*                srcLen - number of bytes in src
+*                container - pointer to the container information read
+*   Effects    : The header is read into container.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int GetBufferContainer(const byte_t *src, const size_t srcLen,
+    container_t *container)
+{
+    size_t len;         /* bytes the header says follow it */
+
+    if (srcLen < CONTAINER_HEADER_SIZE)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if (0 != GetContainerHeader(src, container))
+    {
+        return -1;
+    }
+
+    if ((size_t)container->size != container->size)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    len = container->lengthsLen +
+        ((container->flags & CONTAINER_CRC) ? CONTAINER_CRC_SIZE : 0);
+
+    if ((len > srcLen - CONTAINER_HEADER_SIZE) ||
+        ((container->flags & CONTAINER_STORED) &&
+        (container->size > srcLen - CONTAINER_HEADER_SIZE - len)) ||
+        ((container->flags & CONTAINER_RUN) &&
+        (srcLen - CONTAINER_HEADER_SIZE - len < 1)))
+    {
+        fprintf(stderr, "error: truncated input buffer.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : GetContainerLengths
+*   Description: This function reads the compact code lengths that follow
+*                the fixed part of a container header.
+*   Parameters : src - pointer to the code lengths
+*                len - number of bytes of code lengths
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : The code lengths are read into cl.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int GetContainerLengths(const byte_t *src, const size_t len,
+    canonical_list_t *cl)
+{
+    int status;
+    bit_reader_t reader;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    reader.data = src;
+    reader.size = len;
+    reader.pos = 0;
+    reader.accum = 0;
+    reader.accumCount = 0;
+    CLEAR_REFILLS(&reader);
+    status = GetCompactLengths(&reader, cl);
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    if (0 != status)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ReadContainer
+*   Description: This function reads the container header at the start of
+*                an encoded file.
+*   Parameters : fp - pointer to open file to read from
+*                container - pointer to the container information read
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : The header is read from fp into container, and the code
+*                lengths are read into cl.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ReadContainer(FILE *fp, container_t *container,
+    canonical_list_t *cl)
+{
+    byte_t header[CONTAINER_HEADER_SIZE + COMPACT_HEADER_BOUND];
+
+    if (fread(header, 1, CONTAINER_HEADER_SIZE, fp) != CONTAINER_HEADER_SIZE)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if (0 != GetContainerHeader(header, container))
+    {
+        return -1;
+    }
+
+    if (0 == container->lengthsLen)
+    {
+        return 0;       /* the data isn't coded */
+    }
+
+    if (fread(header + CONTAINER_HEADER_SIZE, 1, container->lengthsLen, fp) !=
+        container->lengthsLen)
+    {
+        fprintf(stderr, "error: malformed file header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return GetContainerLengths(header + CONTAINER_HEADER_SIZE,
+        container->lengthsLen, cl);
+}
+
+/****************************************************************************
+*   Function   : WriteDecoded
+*   Description: This function writes a buffer of decoded symbols to a
+*                file, and adds them to a running checksum.
+*   Parameters : fp - pointer to open file to write to
+*                data - pointer to the decoded symbols
+*                len - number of symbols in data
+*                crc - pointer to the running CRC-32C (NULL if there's no
+*                      checksum)
+*   Effects    : data is written to fp and crc is updated.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int WriteDecoded(FILE *fp, const byte_t *data, const size_t len,
+    unsigned long *crc)
+{
+    if (NULL != crc)
+    {
+        *crc = Crc32c(*crc, data, len);
+    }
+
+    if (fwrite(data, 1, len, fp) != len)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : DecodeUncoded
+*   Description: This function decodes a buffer holding a CONTAINER_STORED
+*                or CONTAINER_RUN container.
+*   Parameters : in - pointer to the encoded data
+*                srcLen - number of bytes in src
+*                container - pointer to the container information read
+*                            by GetBufferContainer
+*                out - pointer to the buffer receiving the decoded data
+*                dstCap - size of out in bytes
+*                outLen - pointer to the number of bytes written to out
+*   Effects    : The data is decoded into out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if out is too small, EILSEQ if
+*                the checksum doesn't match).
+****************************************************************************/
+static int DecodeUncoded(const byte_t *in, const size_t srcLen,
+    const container_t *container, byte_t *out, const size_t dstCap,
+    size_t *outLen)
+{
+    if (container->size > dstCap)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    /* out may be NULL if there's nothing to decode */
+    if (0 != container->size)
+    {
+        if (container->flags & CONTAINER_STORED)
+        {
+            memcpy(out, in + CONTAINER_HEADER_SIZE, container->size);
+        }
+        else
+        {
+            memset(out, in[CONTAINER_HEADER_SIZE], container->size);
+        }
+    }
+
+    if ((container->flags & CONTAINER_CRC) &&
+        (0 != CheckBufferCrc(in, srcLen, out, container->size)))
+    {
+        return -1;
+    }
+
+    *outLen = container->size;
+    STATS_ADD(STAT_BYTES_IN, srcLen);
+    STATS_ADD(STAT_BYTES_OUT, container->size);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : DecodeUncodedFile
+*   Description: This function decodes the rest of a file holding a
+*                CONTAINER_STORED or CONTAINER_RUN container.
+*   Parameters : inFile - pointer to the open file being decoded, just
+*                         past its container header
+*                outFile - pointer to the open file receiving the data
+*                container - pointer to the container information read
+*                            by ReadContainer
+*   Effects    : The data is decoded from inFile to outFile.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (EILSEQ if the file is truncated or
+*                its checksum doesn't match).
+****************************************************************************/
+static int DecodeUncodedFile(FILE *inFile, FILE *outFile,
+    const container_t *container)
+{
+    int c, i, truncated;
+    size_t len;
+    unsigned long remaining, crc, storedCrc;
+    byte_t out[DECODE_BUFFER_SIZE];     /* decoded symbols */
+
+    remaining = container->size;
+    crc = 0;
+    truncated = 0;
+
+    /* the byte of a run fills a buffer that's written until it's done */
+    if (container->flags & CONTAINER_RUN)
+    {
+        if (EOF == (c = getc(inFile)))
+        {
+            truncated = 1;
+        }
+        else
+        {
+            memset(out, c, DECODE_BUFFER_SIZE);
+        }
+    }
+
+    while ((!truncated) && (remaining > 0))
+    {
+        len = (remaining < DECODE_BUFFER_SIZE) ?
+            (size_t)remaining : DECODE_BUFFER_SIZE;
+
+        if (container->flags & CONTAINER_STORED)
+        {
+            len = fread(out, 1, len, inFile);
+            truncated = (0 == len);
+        }
+
+        if (0 != WriteDecoded(outFile, out, len,
+            (container->flags & CONTAINER_CRC) ? &crc : NULL))
+        {
+            return -1;
+        }
+
+        remaining -= len;
+    }
+
+    storedCrc = 0;
+
+    for (i = 0; (i < CONTAINER_CRC_SIZE) && (!truncated) &&
+        (container->flags & CONTAINER_CRC); i++)
+    {
+        if (EOF == (c = getc(inFile)))
+        {
+            truncated = 1;
+        }
+
+        storedCrc = (storedCrc << 8) | (unsigned long)c;
+    }
+
+    if (truncated)
+    {
+        fprintf(stderr, "error: truncated input file.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if ((container->flags & CONTAINER_CRC) && (storedCrc != crc))
+    {
+        fprintf(stderr, "error: checksum doesn't match.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CheckBufferCrc
+*   Description: This function compares the CRC-32C at the end of a buffer
+*                holding a container with the CRC-32C of the data decoded
+*                from it.
+*   Parameters : src - pointer to the encoded data
+*                srcLen - number of bytes in src
+*                data - pointer to the decoded data
+*                len - number of bytes in data
+*   Effects    : None
+*   Returned   : 0 if the checksums match, otherwise -1 with errno set to
+*                EILSEQ.
+****************************************************************************/
+static int CheckBufferCrc(const byte_t *src, const size_t srcLen,
+    const byte_t *data, const size_t len)
+{
+    int i;
+    unsigned long crc;
+
+    crc = 0;
+
+    for (i = 0; i < CONTAINER_CRC_SIZE; i++)
+    {
+        crc = (crc << 8) | src[srcLen - CONTAINER_CRC_SIZE + i];
+    }
+
+    if (crc != Crc32c(0, data, len))
+    {
+        fprintf(stderr, "error: checksum doesn't match.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : BuildDecodeTable
+*   Description: This function builds a table that may be indexed by the
+*                next DECODE_LOOKUP_BITS bits of an encoded stream to find
+*                the symbol (and code length) of every code that is
+*                DECODE_LOOKUP_BITS bits or shorter.  Entries for the
+*                prefixes of longer codes have a code length of 0.
+*   Parameters : cl - pointer to list of canonical Huffman codes
+*                table - pointer to DECODE_TABLE_SIZE entry table to fill
+*   Effects    : table is filled with the decoded value and code length
+*                for every possible DECODE_LOOKUP_BITS bit prefix
+*   Returned   : None
+****************************************************************************/
+static void BuildDecodeTable(canonical_list_t *cl, decode_entry_t *table)
+{
+    int i;
+    unsigned long prefix, first, last;
+
+    for (i = 0; i < DECODE_TABLE_SIZE; i++)
+    {
+        table[i].value = 0;
+        table[i].codeLen = 0;
+    }
+
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        if ((0 == cl[i].codeLen) || (cl[i].codeLen > DECODE_LOOKUP_BITS))
+        {
+            continue;
+        }
+
+        if ((cl[i].code >> cl[i].codeLen) != 0)
+        {
+            /* the header has more codes than there is room for */
+            continue;
+        }
+
+        /* every index beginning with this code decodes to the symbol */
+        first = cl[i].code << (DECODE_LOOKUP_BITS - cl[i].codeLen);
+        last = first + (1UL << (DECODE_LOOKUP_BITS - cl[i].codeLen));
+
+        for (prefix = first; prefix < last; prefix++)
+        {
+            table[prefix].value = cl[i].value;
+            table[prefix].codeLen = cl[i].codeLen;
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : BuildDecoder
+*   Description: This function rebuilds the canonical code from a list of
+*                code lengths, and builds the tables used to decode it.
+*   Parameters : decoder - pointer to decoder whose list holds the value
+*                          and code length of every symbol, sorted by
+*                          value
+*   Effects    : The list is assigned codes and counting sorted by code
+*                length, and the rest of decoder is derived from it.
+*   Returned   : 0 for success, -1 if the code lengths have more codes than
+*                there is room for (the Kraft inequality doesn't hold).
+*                Lengths with room left over are accepted; the unused
+*                codes are found while decoding.
+****************************************************************************/
+static int BuildDecoder(canonical_decoder_t *decoder)
+{
+    int i, length, available;
+    canonical_list_t *cl;
+    int order[NUM_CHARS];               /* symbols by (length, value) */
+    canonical_list_t sorted[NUM_CHARS]; /* list sorted by code length */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    cl = decoder->list;
+
+    SortByCodeLength(cl, decoder->lenCount, order);
+
+    /***********************************************************************
+    * Count the unused codes of each length.  If there are ever fewer than
+    * the codes of the next length, codes would overlap.  More unused
+    * codes than symbols can never be used up, so the check stops there.
+    ***********************************************************************/
+    available = 1;
+
+    for (length = 1; (length < NUM_CHARS) && (available <= NUM_CHARS);
+        length++)
+    {
+        available = (2 * available) - decoder->lenCount[length];
+
+        if (available < 0)
+        {
+            STATS_STOP(STAT_TREE_NS, timer);
+            return -1;
+        }
+    }
+
+    /* assign the codes using same rule as encode */
+    AssignCanonicalCodes(cl);
+
+    /* sort the list by code length, indexing the first code of each */
+    decoder->lenIndex[0] = 0;
+
+    for (length = 1; length < NUM_CHARS; length++)
+    {
+        decoder->lenIndex[length] =
+            decoder->lenIndex[length - 1] + decoder->lenCount[length - 1];
+    }
+
+    for (i = 0; i < NUM_CHARS; i++)
+    {
+        sorted[i] = cl[order[i]];
+    }
+
+    memcpy(cl, sorted, sizeof(sorted));
+
+    /***********************************************************************
+    * The longest codes are assigned the smallest values, so a code of a
+    * given length is never smaller than the smallest code of that length,
+    * and the prefix of a longer code always is.  The smallest codes never
+    * exceed the number of symbols, so they fit in an unsigned long even
+    * when the codes themselves don't.
+    ***********************************************************************/
+    decoder->maxLength = cl[NUM_CHARS - 1].codeLen;
+
+    for (length = decoder->maxLength; length < NUM_CHARS; length++)
+    {
+        decoder->lenBase[length] = 0;
+    }
+
+    for (length = decoder->maxLength - 1; length >= 0; length--)
+    {
+        decoder->lenBase[length] =
+            (decoder->lenBase[length + 1] + decoder->lenCount[length + 1]) >>
+            1;
+    }
+
+    /* codes up to DECODE_LOOKUP_BITS long are decoded by table look up */
+    BuildDecodeTable(cl, decoder->table);
+
+    STATS_STOP(STAT_TREE_NS, timer);
+    STATS_ADD(STAT_TABLE_BUILDS, 1);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : FindSymbol
+*   Description: This function finds the symbol matching a code that is
+*                not smaller than the smallest code of its length.
+*   Parameters : decoder - pointer to decoder built by BuildDecoder
+*                code - the code to look up (right justified)
+*                length - the number of bits in code
+*   Effects    : None
+*   Returned   : Index of the symbol in decoder->list, or -1 if no symbol
+*                has the code.
+****************************************************************************/
+static int FindSymbol(const canonical_decoder_t *decoder,
+    const unsigned long code, const int length)
+{
+    unsigned long offset;
+
+    offset = code - decoder->lenBase[length];
+
+    if (offset >= (unsigned long)decoder->lenCount[length])
+    {
+        return -1;
+    }
+
+    /* codes of the same length are assigned in reverse symbol order */
+    return decoder->lenIndex[length] + decoder->lenCount[length] - 1 -
+        (int)offset;
+}
+
+/****************************************************************************
+*   Function   : DecodeSymbol
+*   Description: This function decodes the next symbol from a memory
+*                buffer.  Codes up to DECODE_LOOKUP_BITS long are found
+*                with a single table look up, longer ones are handed to
+*                DecodeLongSymbol.
+*   Parameters : decoder - pointer to decoder built by BuildDecoder
+*                reader - pointer to the buffer being read
+*   Effects    : The bits of the decoded symbol are removed from the
+*                buffer.
+*   Returned   : The decoded symbol, DECODE_END_OF_DATA if the buffer ends
+*                before a whole code, or DECODE_BAD_CODE if the bits don't
+*                match any code.
+****************************************************************************/
+static int DecodeSymbol(const canonical_decoder_t *decoder,
+    bit_reader_t *reader)
+{
+    const decode_entry_t *entry;
+    unsigned long code;
+    unsigned int bits;
+
+    bits = BufferPeekBits(reader, &code, DECODE_LOOKUP_BITS);
+    entry = &decoder->table[code];
+
+    if (0 == entry->codeLen)
+    {
+        return DecodeLongSymbol(decoder, reader, code, bits);
+    }
+
+    if (entry->codeLen > bits)
+    {
+        return DECODE_END_OF_DATA;
+    }
+
+    reader->accumCount -= entry->codeLen;
+    return entry->value;
+}
+
+/****************************************************************************
+*   Function   : DecodeLongSymbol
+*   Description: This function finishes decoding a symbol whose code is
+*                longer than DECODE_LOOKUP_BITS, by extending the bits one
+*                at a time until they form a code.
+*   Parameters : decoder - pointer to decoder built by BuildDecoder
+*                reader - pointer to the buffer being read
+*                code - the next DECODE_LOOKUP_BITS bits of the buffer
+*                       (not yet removed)
+*                bits - the number of bits in code that are really data
+*   Effects    : The bits of the decoded symbol are removed from the
+*                buffer.
+*   Returned   : The same values as DecodeSymbol.
+****************************************************************************/
+static int DecodeLongSymbol(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, unsigned long code, const unsigned int bits)
+{
+    int i, bit, length;
+
+    if (DECODE_LOOKUP_BITS > bits)
+    {
+        return DECODE_END_OF_DATA;
+    }
+
+    reader->accumCount -= DECODE_LOOKUP_BITS;
+    length = DECODE_LOOKUP_BITS;
+
+    while ((code < decoder->lenBase[length]) &&
+        (length < decoder->maxLength))
+    {
+        if ((bit = BufferGetBit(reader)) == EOF)
+        {
+            return DECODE_END_OF_DATA;
+        }
+
+        code = (code << 1) | bit;
+        length++;
+    }
+
+    if (code < decoder->lenBase[length])
+    {
+        return DECODE_END_OF_DATA;
+    }
+
+    if ((i = FindSymbol(decoder, code, length)) < 0)
+    {
+        return DECODE_BAD_CODE;
+    }
+
+    return decoder->list[i].value;
+}
+
+/****************************************************************************
+*   Function   : EncodeToBuffer
+*   Description: This function encodes a buffer of symbols followed by an
+*                EOF with a canonical code.  The caller must have made sure
+*                that the encoded symbols will fit.
+*   Parameters : writer - pointer to the buffer being written
+*                cl - pointer to list of canonical codes sorted by value
+*                in - pointer to the symbols to encode
+*                len - number of symbols in in
+*                maxLen - length of the longest code in cl
+*   Effects    : The encoded symbols and EOF are written to the buffer, and
+*                the last byte is padded with zeros.
+*   Returned   : None
+****************************************************************************/
+static void EncodeToBuffer(bit_writer_t *writer, const canonical_list_t *cl,
+    const byte_t *in, const size_t len, const int maxLen)
+{
+    BufferPutSymbols(writer, cl, in, len, maxLen);
+
+    /* now write EOF */
+    BufferPutCode(writer, cl[EOF_CHAR].code, cl[EOF_CHAR].codeLen);
+    BufferFlush(writer);
+}
+
+/****************************************************************************
+*   Function   : DecodeToBuffer
+*   Description: This function decodes symbols from a memory buffer until
+*                it decodes an EOF or runs out of data.
+*   Parameters : decoder - pointer to decoder built by BuildDecoder
+*                reader - pointer to the buffer being read
+*                out - pointer to the buffer receiving the decoded symbols
+*                outCap - size of out in bytes
+*                outLen - pointer to the number of decoded symbols
+*   Effects    : Symbols are decoded into out and the number of symbols
+*                is stored in outLen.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if out is too small).
+****************************************************************************/
+static int DecodeToBuffer(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, byte_t *out, const size_t outCap, size_t *outLen)
+{
+    int i, status;
+    size_t pos;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    status = 0;
+
+    for (pos = 0; ; pos++)
+    {
+        i = DecodeSymbol(decoder, reader);
+
+        if (DECODE_END_OF_DATA == i)
+        {
+            /* we ran out of data before finding EOF */
+            break;
+        }
+
+        if (DECODE_BAD_CODE == i)
+        {
+            /* no code matches the bits read */
+            fprintf(stderr, "error: invalid code in input buffer.\n");
+            errno = EILSEQ;
+            status = -1;
+            break;
+        }
+
+        if (i == EOF_CHAR)
+        {
+            break;
+        }
+
+        if (pos == outCap)
+        {
+            /* no room for the symbol */
+            errno = ERANGE;
+            status = -1;
+            break;
+        }
+
+        out[pos] = (byte_t)i;
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+    STATS_ADD(STAT_REFILLS, reader->refills);
+    *outLen = pos;
+    return status;
+}
+
+/****************************************************************************
+*   Function   : DecodeSymbols
+*   Description: This function decodes a known number of symbols from a
+*                memory buffer.  While there's an accumulator's worth of
+*                bytes left, the accumulator is refilled without checking
+*                for the end of the data, and LOOKUPS_PER_FILL symbols are
+*                decoded by table look up before the next check.  Codes
+*                that aren't in the table, and the symbols near the end of
+*                the data, are left to DecodeSymbol.
+*   Parameters : decoder - pointer to decoder built by BuildDecoder
+*                reader - pointer to the buffer being read
+*                out - pointer to the buffer receiving the decoded symbols
+*                count - number of symbols to decode
+*   Effects    : count symbols are decoded into out.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (EILSEQ if the buffer is truncated or
+*                holds a bad code).
+****************************************************************************/
+static int DecodeSymbols(const canonical_decoder_t *decoder,
+    bit_reader_t *reader, byte_t *out, const size_t count)
+{
+    const decode_entry_t *entry;
+    int k, symbol;
+    size_t pos;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    symbol = 0;
+    pos = 0;
+
+    while ((symbol >= 0) && (count - pos >= LOOKUPS_PER_FILL) &&
+        (reader->size - reader->pos >= sizeof(unsigned long)))
+    {
+        COUNT_REFILL(reader);
+
+        while (reader->accumCount <= (ULONG_BITS - 8))
+        {
+            reader->accum = (reader->accum << 8) | reader->data[reader->pos];
+            reader->pos++;
+            reader->accumCount += 8;
+        }
+
+        for (k = 0; (k < LOOKUPS_PER_FILL) && (symbol >= 0); k++)
+        {
+            entry = NULL;
+
+            if (reader->accumCount >= DECODE_LOOKUP_BITS)
+            {
+                entry = &decoder->table[(reader->accum >>
+                    (reader->accumCount - DECODE_LOOKUP_BITS)) &
+                    (DECODE_TABLE_SIZE - 1)];
+            }
+
+            if ((NULL != entry) && (0 != entry->codeLen))
+            {
+                reader->accumCount -= entry->codeLen;
+                symbol = entry->value;
+            }
+            else
+            {
+                /* long code, or a long code emptied the accumulator */
+                symbol = DecodeSymbol(decoder, reader);
+            }
+
+            if (EOF_CHAR == symbol)
+            {
+                symbol = DECODE_BAD_CODE;
+            }
+            else if (symbol >= 0)
+            {
+                out[pos++] = (byte_t)symbol;
+            }
+        }
+    }
+
+    /* decode the rest checking every code for the end of the data */
+    for (; (symbol >= 0) && (pos < count); pos++)
+    {
+        symbol = DecodeSymbol(decoder, reader);
+
+        if (EOF_CHAR == symbol)
+        {
+            symbol = DECODE_BAD_CODE;
+        }
+        else if (symbol >= 0)
+        {
+            out[pos] = (byte_t)symbol;
+        }
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+    STATS_ADD(STAT_REFILLS, reader->refills);
+
+    if (DECODE_END_OF_DATA == symbol)
+    {
+        fprintf(stderr, "error: truncated input buffer.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    if (symbol < 0)
+    {
+        /* no code matches the bits read */
+        fprintf(stderr, "error: invalid code in input buffer.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : MakeTable
+*   Description: This function allocates a trained table and builds its
+*                decoder.
+*   Parameters : id - number identifying the table
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : A table is allocated.
+*   Returned   : Pointer to the new table, or NULL for failure.  errno will
+*                be set in the event of a failure.
+****************************************************************************/
+static canonical_table_t *MakeTable(const unsigned long id,
+    const canonical_list_t *cl)
+{
+    int c;
+    canonical_table_t *table;
+
+    table = (canonical_table_t *)malloc(sizeof(canonical_table_t));
+
+    if (NULL == table)
+    {
+        perror("Allocating Code Table");
+        return NULL;
+    }
+
+    table->id = id;
+    table->maxLength = 0;
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        table->codes[c] = cl[c];
+        table->decoder.list[c] = cl[c];
+        table->maxLength = max(table->maxLength, cl[c].codeLen);
+    }
+
+    /* build the decoder now, so it can be used over and over */
+    if (0 != BuildDecoder(&table->decoder))
+    {
+        free(table);
+        fprintf(stderr, "error: malformed code table.\n");
+        errno = EILSEQ;
+        return NULL;
+    }
+
+    return table;
+}
+
+/****************************************************************************
+*   Function   : FindTable
+*   Description: This function uses a binary search to find where a table
+*                with a given id is, or would be, in a cache.
+*   Parameters : cache - pointer to the cache to search
+*                id - id of the table to find
+*   Effects    : None
+*   Returned   : Index of the first table in the cache whose id isn't less
+*                than id (numTables if there's no such table).
+****************************************************************************/
+static int FindTable(const canonical_cache_t *cache, const unsigned long id)
+{
+    int low, high, middle;
+
+    low = 0;
+    high = cache->numTables;
+
+    while (low < high)
+    {
+        middle = low + ((high - low) / 2);
+
+        if (cache->tables[middle]->id < id)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+/****************************************************************************
+*   Function   : SymbolsSize
+*   Description: This function computes the number of bytes needed to
+*                encode the symbols (other than EOF) with given counts
+*                using a canonical code, plus some extra bits.
+*   Parameters : counts - number of occurrences of each symbol
+*                cl - pointer to list of canonical codes sorted by value
+*                bits - number of extra bits to include
+*   Effects    : None
+*   Returned   : The size of the encoded symbols and extra bits in bytes,
+*                or the largest size_t if that size doesn't fit.
+****************************************************************************/
+static size_t SymbolsSize(const count_t *counts, const canonical_list_t *cl,
+    unsigned long bits)
+{
+    int c;
+    size_t bytes;
+
+    /* count whole bytes in groups of 8 symbols so nothing overflows */
+    bytes = 0;
+
+    for (c = 0; c < EOF_CHAR; c++)
+    {
+        if ((counts[c] / 8) > ((((size_t)-1) - bytes) / MAX_CODE_LEN))
+        {
+            return (size_t)-1;
+        }
+
+        bytes += (size_t)(counts[c] / 8) * cl[c].codeLen;
+        bits += (unsigned long)(counts[c] % 8) * cl[c].codeLen;
+    }
+
+    if ((bits + 7) / 8 > ((size_t)-1) - bytes)
+    {
+        return (size_t)-1;
+    }
+
+    return bytes + (bits + 7) / 8;
+}
+
+/****************************************************************************
+*   Function   : BufferPutCode
+*   Description: This function writes a right justified code to a memory
+*                buffer, MSB first.  The caller must have made sure that
+*                the buffer is large enough.
+*   Parameters : writer - pointer to the buffer being written
+*                code - the code to write (right justified)
+*                count - the number of bits in code (at most ULONG_BITS)
+*   Effects    : The code is appended to the buffer.  Bits that don't make
+*                a whole byte are kept in the accumulator.
+*   Returned   : None
+****************************************************************************/
+static void BufferPutCode(bit_writer_t *writer, const unsigned long code,
+    const unsigned int count)
+{
+    unsigned int bits, remaining;
+
+    remaining = count;
+
+    while (remaining > 0)
+    {
+        /* after writing whole bytes, accum holds at most 7 bits */
+        bits = ULONG_BITS - 7;
+
+        if (bits > remaining)
+        {
+            bits = remaining;
+        }
+
+        remaining -= bits;
+        writer->accum = (writer->accum << bits) |
+            ((code >> remaining) & ((1UL << bits) - 1));
+        writer->accumCount += bits;
+
+        while (writer->accumCount >= 8)
+        {
+            writer->accumCount -= 8;
+            writer->data[writer->pos++] =
+                (byte_t)(writer->accum >> writer->accumCount);
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : BufferPutSymbols
+*   Description: This function writes the codes for a buffer of symbols to
+*                a memory buffer.  While there are enough symbols left,
+*                CODES_PER_STORE codes are added to the accumulator without
+*                any checks, then the whole accumulator is stored, and only
+*                the whole bytes are kept.  The last symbols are written by
+*                BufferPutCode.  The caller must have made sure that the
+*                buffer is large enough for the codes.
+*   Parameters : writer - pointer to the buffer being written
+*                cl - pointer to list of canonical codes sorted by value
+*                in - pointer to the symbols to encode
+*                len - number of symbols in in
+*                maxLen - length of the longest code in cl.  Codes longer
+*                         than MAX_CODE_LEN are all written by
+*                         BufferPutCode.
+*   Effects    : The codes are appended to the buffer.  Bits that don't
+*                make a whole byte are kept in the accumulator.
+*   Returned   : None
+****************************************************************************/
+static void BufferPutSymbols(bit_writer_t *writer, const canonical_list_t *cl,
+    const byte_t *in, const size_t len, const int maxLen)
+{
+    size_t i, pos;
+    unsigned long accum, word;
+    unsigned int count;
+    int j;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    i = 0;
+
+    if ((CODES_PER_STORE > 0) && (maxLen <= MAX_CODE_LEN))
     {
-        return -1;
+        pos = writer->pos;
+        accum = writer->accum;
+        count = writer->accumCount;
+
+        while (i + CODES_PER_STORE + STORE_SLACK <= len)
+        {
+            for (j = 0; j < CODES_PER_STORE; j++)
+            {
+                accum = (accum << cl[in[i]].codeLen) | cl[in[i]].code;
+                count += cl[in[i]].codeLen;
+                i++;
+            }
+
+            /* store the bits MSB first, then keep the partial byte */
+            word = accum << (ULONG_BITS - count);
+
+            for (j = 0; j < ULONG_BYTES; j++)
+            {
+                writer->data[pos + j] =
+                    (byte_t)(word >> (ULONG_BITS - 8 * (j + 1)));
+            }
+
+            pos += count >> 3;
+            count &= 7;
+        }
+
+        writer->pos = pos;
+        writer->accum = accum;
+        writer->accumCount = count;
     }
 
-    /* use tree to generate a canonical code */
-    if (!BuildCanonicalCode(huffmanTree, canonicalList))
+    for (; i < len; i++)
     {
-        FreeHuffmanTree(huffmanTree);     /* free allocated memory */
-        return -1;
+        BufferPutCode(writer, cl[in[i]].code, cl[in[i]].codeLen);
     }
 
-    FreeHuffmanTree(huffmanTree);     /* free allocated memory */
+    STATS_STOP(STAT_CODING_NS, timer);
+}
 
-    /* write out canonical code */
-    /* print heading to make things look pretty (int is 10 char max) */
-    fprintf(outFile, "Char  CodeLen  Encoding\n");
-    fprintf(outFile, "----- -------- ----------------\n");
+/****************************************************************************
+*   Function   : BufferPutOrder1Symbols
+*   Description: This function writes the codes for a buffer of symbols to
+*                a memory buffer, using the code chosen by the symbol
+*                before each one.  It works the same way as
+*                BufferPutSymbols.  The caller must have made sure that
+*                the buffer is large enough for the codes.
+*   Parameters : writer - pointer to the buffer being written
+*                contexts - the code (sorted by value) used after each byte
+*                           value.  No code may be longer than
+*                           MAX_CODE_LEN.
+*                in - pointer to the symbols to encode
+*                len - number of symbols in in
+*   Effects    : The codes are appended to the buffer.  Bits that don't
+*                make a whole byte are kept in the accumulator.
+*   Returned   : None
+****************************************************************************/
+static void BufferPutOrder1Symbols(bit_writer_t *writer,
+    const canonical_list_t **contexts, const byte_t *in, const size_t len)
+{
+    size_t i, pos;
+    unsigned long accum, word;
+    unsigned int count;
+    int j;
+    byte_t prev;
+    const canonical_list_t *cl;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
 
-    for(i = 0; i < NUM_CHARS; i++)
+    STATS_START(timer);
+    i = 0;
+    prev = 0;
+
+    if (CODES_PER_STORE > 0)
     {
-        if(canonicalList[i].codeLen > 0)
+        pos = writer->pos;
+        accum = writer->accum;
+        count = writer->accumCount;
+
+        while (i + CODES_PER_STORE + STORE_SLACK <= len)
         {
-            if (canonicalList[i].value != EOF_CHAR)
-            {
-                fprintf(outFile,
-                        "0x%02X  %02d       ",
-                        canonicalList[i].value, canonicalList[i].codeLen);
-            }
-            else
+            for (j = 0; j < CODES_PER_STORE; j++)
             {
-                fprintf(outFile,
-                        "EOF   %02d       ", canonicalList[i].codeLen);
+                cl = contexts[prev];
+                accum = (accum << cl[in[i]].codeLen) | cl[in[i]].code;
+                count += cl[in[i]].codeLen;
+                prev = in[i];
+                i++;
             }
 
-            /* now write out the code bits */
-            for(length = 0; length < canonicalList[i].codeLen; length++)
+            /* store the bits MSB first, then keep the partial byte */
+            word = accum << (ULONG_BITS - count);
+
+            for (j = 0; j < ULONG_BYTES; j++)
             {
-                if (BitArrayTestBit(canonicalList[i].code, length))
-                {
-                    fputc('1', outFile);
-                }
-                else
-                {
-                    fputc('0', outFile);
-                }
+                writer->data[pos + j] =
+                    (byte_t)(word >> (ULONG_BITS - 8 * (j + 1)));
             }
 
-            fputc('\n', outFile);
+            pos += count >> 3;
+            count &= 7;
         }
+
+        writer->pos = pos;
+        writer->accum = accum;
+        writer->accumCount = count;
     }
 
-    return 0;
+    for (; i < len; i++)
+    {
+        cl = contexts[prev];
+        BufferPutCode(writer, cl[in[i]].code, cl[in[i]].codeLen);
+        prev = in[i];
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
 }
 
 /****************************************************************************
-*   Function   : CompareByCodeLen
-*   Description: Compare function to be used by qsort for sorting canonical
-*                list items by code length.  In the event of equal lengths,
-*                the symbol value will be used.
-*   Parameters : item1 - pointer canonical list item
-*                item2 - pointer canonical list item
-*   Effects    : None
-*   Returned   : 1 if item1 > item2
-*                -1 if item1 < item 2
-*                0 if something went wrong (means item1 == item2)
+*   Function   : BufferFlush
+*   Description: This function writes any bits left in the accumulator of
+*                a memory buffer, padding the last byte with zeros.
+*   Parameters : writer - pointer to the buffer being written
+*   Effects    : The accumulator is emptied into the buffer.
+*   Returned   : None
 ****************************************************************************/
-static int CompareByCodeLen(const void *item1, const void *item2)
+static void BufferFlush(bit_writer_t *writer)
 {
-    if (((canonical_list_t *)item1)->codeLen >
-        ((canonical_list_t *)item2)->codeLen)
-    {
-        /* item1 > item2 */
-        return 1;
-    }
-    else if (((canonical_list_t *)item1)->codeLen <
-        ((canonical_list_t *)item2)->codeLen)
+    if (writer->accumCount > 0)
     {
-        /* item1 < item2 */
-        return -1;
+        writer->data[writer->pos++] =
+            (byte_t)(writer->accum << (8 - writer->accumCount));
+        writer->accumCount = 0;
     }
-    else
+}
+
+/****************************************************************************
+*   Function   : BufferPeekBits
+*   Description: This function returns the next bits of a memory buffer
+*                without removing them.  Callers remove the bits by
+*                subtracting them from accumCount.
+*   Parameters : reader - pointer to the buffer being read
+*                bits - pointer to the bits read (right justified)
+*                count - the number of bits to read (at most
+*                        ULONG_BITS - 7)
+*   Effects    : The accumulator is refilled from the buffer
+*   Returned   : The number of bits actually available.  If it's less than
+*                count, the missing bits are zeros.
+****************************************************************************/
+static unsigned int BufferPeekBits(bit_reader_t *reader, unsigned long *bits,
+    const unsigned int count)
+{
+    if (reader->accumCount < count)
     {
-        /* both have equal code lengths break the tie using value */
-        if (((canonical_list_t *)item1)->value >
-            ((canonical_list_t *)item2)->value)
+        /* refill with as many whole bytes as will fit */
+        COUNT_REFILL(reader);
+
+        while ((reader->accumCount <= (ULONG_BITS - 8)) &&
+            (reader->pos < reader->size))
         {
-            return 1;
+            reader->accum = (reader->accum << 8) | reader->data[reader->pos];
+            reader->pos++;
+            reader->accumCount += 8;
         }
-        else
+
+        if (reader->accumCount < count)
         {
-            return -1;
+            /* pad the bits with zeros */
+            *bits = (reader->accum << (count - reader->accumCount)) &
+                ((1UL << count) - 1);
+            return reader->accumCount;
         }
     }
 
-    return 0;   /* we should never get here */
+    *bits = (reader->accum >> (reader->accumCount - count)) &
+        ((1UL << count) - 1);
+    return count;
 }
 
 /****************************************************************************
-*   Function   : CompareBySymbolValue
-*   Description: Compare function to be used by qsort for sorting canonical
-*                list items by symbol value.
-*   Parameters : item1 - pointer canonical list item
-*                item2 - pointer canonical list item
-*   Effects    : None
-*   Returned   : 1 if item1 > item2
-*                -1 if item1 < item 2
+*   Function   : BufferGetBit
+*   Description: This function reads the next bit of a memory buffer.
+*   Parameters : reader - pointer to the buffer being read
+*   Effects    : One bit is removed from the buffer.
+*   Returned   : The bit read, or EOF if there are no bits left.
 ****************************************************************************/
-static int CompareBySymbolValue(const void *item1, const void *item2)
+static int BufferGetBit(bit_reader_t *reader)
 {
-    if (((canonical_list_t *)item1)->value >
-        ((canonical_list_t *)item2)->value)
+    if (0 == reader->accumCount)
     {
-        /* item1 > item2 */
-        return 1;
+        if (reader->pos == reader->size)
+        {
+            return EOF;
+        }
+
+        COUNT_REFILL(reader);
+        reader->accum = reader->data[reader->pos];
+        reader->pos++;
+        reader->accumCount = 8;
     }
 
-    /* it must be the case that item1 < item2 */
-    return -1;
+    reader->accumCount--;
+    return (int)((reader->accum >> reader->accumCount) & 1);
 }
 
 /****************************************************************************
-*   Function   : BuildCanonicalCode
-*   Description: This function builds a canonical Huffman code from a
-*                Huffman tree.
-*   Parameters : ht - pointer to root of tree
-*                cl - pointer to canonical list
-*   Effects    : cl is filled with the canonical codes sorted by the value
-*                of the charcter to be encode.
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
+*   Function   : BufferGetBits
+*   Description: This function reads the next bits of a memory buffer.
+*   Parameters : reader - pointer to the buffer being read
+*                count - the number of bits to read (at most
+*                        ULONG_BITS - 7, and less than INT_MAX bits)
+*   Effects    : count bits are removed from the buffer.
+*   Returned   : The bits read (right justified), or EOF if there aren't
+*                count bits left.
 ****************************************************************************/
-static int BuildCanonicalCode(huffman_node_t *ht, canonical_list_t *cl)
+static int BufferGetBits(bit_reader_t *reader, const unsigned int count)
 {
-    int i;
-    byte_t depth = 0;
+    unsigned long bits;
 
-    /* initialize list */
-    for(i = 0; i < NUM_CHARS; i++)
+    if (BufferPeekBits(reader, &bits, count) < count)
     {
-        cl[i].value = i;
-        cl[i].codeLen = 0;
-        cl[i].code = NULL;
+        return EOF;
     }
 
-    /* fill list with code lengths (depth) from tree */
-    for(;;)
+    reader->accumCount -= count;
+    return (int)bits;
+}
+
+/****************************************************************************
+*   Function   : GroupContexts
+*   Description: This function splits the byte values that are followed by
+*                symbols into groups whose following symbols have similar
+*                counts.  The most frequent byte values start the groups.
+*                Each pass builds code lengths for the symbols following
+*                each group, and moves every byte value to the group whose
+*                code would take the fewest bits for the symbols following
+*                it.
+*   Parameters : work - pointer to order-1 working memory holding the
+*                       counts of the symbols following each byte
+*                numGroups - number of groups wanted
+*   Effects    : work->map holds the group of each byte value, and
+*                work->groupCounts holds the counts of the symbols
+*                following each group.  Byte values that aren't followed by
+*                anything are put in group 0.
+*   Returned   : The number of groups used.  It's less than numGroups if
+*                fewer byte values are followed by symbols.
+****************************************************************************/
+static int GroupContexts(order1_work_t *work, int numGroups)
+{
+    int c, g, i, pass, best, penalty;
+    double bits, bestBits;
+    unsigned long bestTotal;
+    unsigned long totals[256];          /* symbols following each byte */
+    byte_t used[256];                   /* 1 if the byte starts a group */
+    byte_t renumber[ORDER1_MAX_CODES];  /* group numbers without gaps */
+    byte_t lengths[ORDER1_MAX_CODES][NUM_CHARS];
+    int missing[ORDER1_MAX_CODES];      /* bits for a symbol without a code */
+
+    for (c = 0; c < 256; c++)
     {
-        /* follow this branch all the way left */
-        while (ht->left != NULL)
+        totals[c] = 0;
+        used[c] = 0;
+        work->map[c] = 0;
+
+        for (i = 0; i < work->numNext[c]; i++)
         {
-            ht = ht->left;
-            depth++;
+            totals[c] += work->counts[c][work->next[c][i]];
         }
+    }
+
+    /* the most frequent byte values start the groups */
+    for (g = 0; g < numGroups; g++)
+    {
+        best = -1;
+        bestTotal = 0;
 
-        if (ht->value != COMPOSITE_NODE)
+        for (c = 0; c < 256; c++)
         {
-            /* handle one symbol trees */
-            if (depth == 0)
+            if (!used[c] && (totals[c] > bestTotal))
             {
-                depth++;
+                best = c;
+                bestTotal = totals[c];
             }
+        }
+
+        if (best < 0)
+        {
+            /* fewer byte values than groups */
+            numGroups = g;
+            break;
+        }
+
+        used[best] = 1;
+        work->map[best] = (byte_t)g;
+    }
+
+    if (numGroups < 2)
+    {
+        CountGroups(work, 1);
+        return 1;
+    }
 
-            /* enter results in list */
-            cl[ht->value].codeLen = depth;
+    /* the first pass only has the bytes that started the groups */
+    for (c = 0; c < 256; c++)
+    {
+        if (!used[c])
+        {
+            totals[c] = 0;
         }
+    }
 
-        while (ht->parent != NULL)
+    for (pass = 0; pass < ORDER1_PASSES; pass++)
+    {
+        for (g = 0; g < numGroups; g++)
         {
-            if (ht != ht->parent->right)
+            for (c = 0; c < NUM_CHARS; c++)
             {
-                /* try the parent's right */
-                ht = ht->parent->right;
-                break;
+                work->groupCounts[g][c] = 0;
             }
-            else
+        }
+
+        for (c = 0; c < 256; c++)
+        {
+            if (0 != totals[c])
             {
-                /* parent's right tried, go up one level yet */
-                depth--;
-                ht = ht->parent;
+                for (i = 0; i < work->numNext[c]; i++)
+                {
+                    work->groupCounts[work->map[c]][work->next[c][i]] +=
+                        work->counts[c][work->next[c][i]];
+                }
             }
         }
 
-        if (ht->parent == NULL)
+        for (g = 0; g < numGroups; g++)
         {
-            /* we're at the top with nowhere to go */
-            break;
+            BuildCodeLengths(work->groupCounts[g], 0, lengths[g]);
+            missing[g] = 0;
+
+            for (c = 0; c < NUM_CHARS; c++)
+            {
+                if (lengths[g][c] > missing[g])
+                {
+                    missing[g] = lengths[g][c];
+                }
+            }
+
+            /* a symbol without a code costs more than the longest code */
+            missing[g] += 2;
+        }
+
+        /* move every byte to the group coding what follows it best */
+        for (c = 0; c < 256; c++)
+        {
+            if (0 == work->numNext[c])
+            {
+                continue;
+            }
+
+            best = 0;
+            bestBits = 0;
+
+            for (g = 0; g < numGroups; g++)
+            {
+                bits = 0;
+
+                for (i = 0; i < work->numNext[c]; i++)
+                {
+                    penalty = lengths[g][work->next[c][i]];
+                    bits += (double)work->counts[c][work->next[c][i]] *
+                        ((0 == penalty) ? missing[g] : penalty);
+                }
+
+                if ((0 == g) || (bits < bestBits))
+                {
+                    best = g;
+                    bestBits = bits;
+                }
+            }
+
+            work->map[c] = (byte_t)best;
+            totals[c] = 1;
+        }
+    }
+
+    /* renumber the groups so that the empty ones are dropped */
+    for (g = 0; g < numGroups; g++)
+    {
+        used[g] = 0;
+    }
+
+    for (c = 0; c < 256; c++)
+    {
+        if (0 != work->numNext[c])
+        {
+            used[work->map[c]] = 1;
         }
     }
 
-    /* sort by code length */
-    qsort(cl, NUM_CHARS, sizeof(canonical_list_t), CompareByCodeLen);
+    for (g = 0, i = 0; g < numGroups; g++)
+    {
+        renumber[g] = (byte_t)i;
+        i += used[g];
+    }
 
-    if (0 == AssignCanonicalCodes(cl))
+    for (c = 0; c < 256; c++)
     {
-        /* re-sort list in lexical order for use by encode algorithm */
-        qsort(cl, NUM_CHARS, sizeof(canonical_list_t), CompareBySymbolValue);
-        return 0;       /* success */
+        work->map[c] = renumber[work->map[c]];
     }
 
-    perror("Code assignment failed");
-    return -1;          /* assignment failed */
+    CountGroups(work, i);
+    return i;
 }
 
 /****************************************************************************
-*   Function   : AssignCanonicalCode
-*   Description: This function accepts a list of symbols sorted by their
-*                code lengths, and assigns a canonical Huffman code to each
-*                symbol.
-*   Parameters : cl - sorted list of symbols to have code values assigned
-*   Effects    : cl stores a list of canonical codes sorted by the length
-*                of the code used to encode the symbol.
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
+*   Function   : CountGroups
+*   Description: This function adds up the counts of the symbols following
+*                every byte value in each group.
+*   Parameters : work - pointer to order-1 working memory holding the
+*                       group of each byte value
+*                numGroups - number of groups
+*   Effects    : work->groupCounts holds the counts of the symbols
+*                following each group.
+*   Returned   : None
 ****************************************************************************/
-static int AssignCanonicalCodes(canonical_list_t *cl)
+static void CountGroups(order1_work_t *work, const int numGroups)
 {
-    int i;
-    byte_t length;
-    bit_array_t *code;
-
-    /* assign the new codes */
-    code = BitArrayCreate(EOF_CHAR);
-    BitArrayClearAll(code);
+    int c, g, i;
 
-    length = cl[(NUM_CHARS - 1)].codeLen;
-
-    for(i = (NUM_CHARS - 1); i >= 0; i--)
+    for (g = 0; g < numGroups; g++)
     {
-        /* bail if we hit a zero len code */
-        if (cl[i].codeLen == 0)
+        for (c = 0; c < NUM_CHARS; c++)
         {
-            break;
+            work->groupCounts[g][c] = 0;
         }
+    }
 
-        /* adjust code if this length is shorter than the previous */
-        if (cl[i].codeLen < length)
+    for (c = 0; c < 256; c++)
+    {
+        for (i = 0; i < work->numNext[c]; i++)
         {
-            BitArrayShiftRight(code, (length - cl[i].codeLen));
-            length = cl[i].codeLen;
+            work->groupCounts[work->map[c]][work->next[c][i]] +=
+                work->counts[c][work->next[c][i]];
         }
+    }
+}
+
+/****************************************************************************
+*   Function   : Order1Size
+*   Description: This function computes the most bytes that
+*                CanonicalEncodeOrder1 would write for a grouping of the
+*                byte values.
+*   Parameters : work - pointer to order-1 working memory holding the
+*                       counts of the symbols following each group
+*                numGroups - number of groups
+*   Effects    : work->codes holds a canonical code for each group.
+*   Returned   : The encoded size, or (size_t)-1 if it's too large to be
+*                represented by a size_t.  Each group's codes are rounded
+*                up to a whole byte, so it may be a few bytes too large.
+****************************************************************************/
+static size_t Order1Size(order1_work_t *work, const int numGroups)
+{
+    int g;
+    size_t size, codesLen;
+    byte_t lengths[NUM_CHARS];          /* code length of each symbol */
+    byte_t header[COMPACT_HEADER_BOUND];
+
+    size = (numGroups > 1) ? 1 + ORDER1_MAP_SIZE : 1;
+
+    for (g = 0; g < numGroups; g++)
+    {
+        /* don't use BuildCanonicalCode, it would count every try */
+        BuildCodeLengths(work->groupCounts[g], 0, lengths);
+        BuildCodeFromLengths(lengths, work->codes[g]);
+        size += PutCompactLengths(work->codes[g], header);
+        codesLen = SymbolsSize(work->groupCounts[g], work->codes[g], 0);
 
-        /* assign left justified code */
-        if ((cl[i].code = BitArrayDuplicate(code)) == NULL)
+        if (codesLen > ((size_t)-1) - size)
         {
-            perror("Duplicating code");
-            BitArrayDestroy(code);
-            return -1;
+            return (size_t)-1;
         }
 
-        BitArrayShiftLeft(cl[i].code, EOF_CHAR - length);
-
-        BitArrayIncrement(code);
+        size += codesLen;
     }
 
-    BitArrayDestroy(code);
-    return 0;
+    return size;
 }
 
 /****************************************************************************
-*   Function   : WriteHeader
-*   Description: This function writes the code size for each symbol and the
-*                total number of characters in the original file to the
-*                specified output file.  If the same algorithm that produced
-*                produced the original canonical code is used with these code
-*                lengths, an exact copy of the code will be produced.
-*   Parameters : cl - pointer to list of canonical Huffman codes
-*                bfp - pointer to open binary file to write to.
-*   Effects    : Symbol code lengths and symbol count are written to the
-*                output file.
-*   Returned   : None
+*   Function   : PutCompactLengths
+*   Description: This function writes the code length of every symbol as
+*                the compact header described with COMPACT_FIRST_LENGTH.
+*   Parameters : cl - pointer to list of canonical codes sorted by value.
+*                     No code may be longer than 63 bits.
+*                dst - pointer to a buffer of at least COMPACT_HEADER_BOUND
+*                      bytes
+*   Effects    : The compact header is written to dst.
+*   Returned   : The number of bytes written to dst.
 ****************************************************************************/
-static void WriteHeader(canonical_list_t *cl, bit_file_t *bfp)
+static size_t PutCompactLengths(const canonical_list_t *cl, byte_t *dst)
 {
-    int i;
+    int c, run, prev, diff;
+    bit_writer_t writer;
 
-    /* write out code size for each symbol */
-    for (i = 0; i < NUM_CHARS; i++)
+    writer.data = dst;
+    writer.pos = 0;
+    writer.accum = 0;
+    writer.accumCount = 0;
+    prev = COMPACT_FIRST_LENGTH;
+    c = 0;
+
+    while (c < NUM_CHARS)
     {
-        BitFilePutChar(cl[i].codeLen, bfp);
+        if (0 == cl[c].codeLen)
+        {
+            /* run of symbols that don't occur */
+            run = 1;
+
+            while ((c + run < NUM_CHARS) && (run < (1 << ZERO_RUN_BITS)) &&
+                (0 == cl[c + run].codeLen))
+            {
+                run++;
+            }
+
+            BufferPutCode(&writer, 0x02, 2);
+            BufferPutCode(&writer, run - 1, ZERO_RUN_BITS);
+            c += run;
+            continue;
+        }
+
+        diff = cl[c].codeLen - prev;
+
+        if (0 == diff)
+        {
+            BufferPutCode(&writer, 0x00, 1);
+        }
+        else if ((1 == diff) || (-1 == diff))
+        {
+            BufferPutCode(&writer, 0x06, 3);
+            BufferPutCode(&writer, (diff < 0), 1);
+        }
+        else if ((diff >= -3) && (diff <= 3))
+        {
+            BufferPutCode(&writer, 0x0E, 4);
+            BufferPutCode(&writer, (diff < 0), 1);
+            BufferPutCode(&writer, ((diff < 0) ? -diff : diff) - 2, 1);
+        }
+        else
+        {
+            BufferPutCode(&writer, 0x0F, 4);
+            BufferPutCode(&writer, cl[c].codeLen, LITERAL_LENGTH_BITS);
+        }
+
+        prev = cl[c].codeLen;
+        c++;
     }
+
+    BufferFlush(&writer);
+    return writer.pos;
 }
 
 /****************************************************************************
-*   Function   : ReadHeader
-*   Description: This function reads the header information stored by
-*                WriteHeader.  If the same algorithm that produced the
-*                original tree is used with these counts, an exact copy of
-*                the tree will be produced.
-*   Parameters : cl - pointer to list of canonical Huffman codes
-*                bfp - file to read from
-*   Effects    : Code lengths and symbols are read into the canonical list.
-*                Total number of symbols encoded is store in totalCount
-*   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.
+*   Function   : GetCompactLengths
+*   Description: This function reads a compact header written by
+*                PutCompactLengths.
+*   Parameters : reader - pointer to the buffer being read
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : The code length of every symbol in cl is set, and the
+*                header is removed from the buffer.  The padding bits are
+*                left in the accumulator.
+*   Returned   : 0 for success, -1 if the header is malformed.
 ****************************************************************************/
-static int ReadHeader(canonical_list_t *cl, bit_file_t *bfp)
+static int GetCompactLengths(bit_reader_t *reader, canonical_list_t *cl)
 {
-    int c;
-    int i;
+    int c, run, prev, length, bits;
 
-    /* read the code length */
-    for (i = 0; i < NUM_CHARS; i++)
+    prev = COMPACT_FIRST_LENGTH;
+    c = 0;
+
+    while (c < NUM_CHARS)
     {
-        c = BitFileGetChar(bfp);
+        if ((bits = BufferGetBit(reader)) == 0)
+        {
+            /* same length */
+            length = prev;
+        }
+        else if ((bits = BufferGetBit(reader)) == 0)
+        {
+            /* run of symbols that don't occur */
+            if ((run = BufferGetBits(reader, ZERO_RUN_BITS)) == EOF)
+            {
+                return -1;
+            }
 
-        if (c != EOF)
+            run++;
+
+            if (run > NUM_CHARS - c)
+            {
+                return -1;
+            }
+
+            for (; run > 0; run--, c++)
+            {
+                cl[c].codeLen = 0;
+            }
+
+            continue;
+        }
+        else if ((bits = BufferGetBit(reader)) == 0)
         {
-            cl[i].value = i;
-            cl[i].codeLen = (byte_t)c;
+            /* 1 longer or shorter */
+            if ((bits = BufferGetBit(reader)) == EOF)
+            {
+                return -1;
+            }
+
+            length = bits ? prev - 1 : prev + 1;
+        }
+        else if ((bits = BufferGetBit(reader)) == 0)
+        {
+            /* 2 or 3 longer or shorter */
+            if ((bits = BufferGetBits(reader, 2)) == EOF)
+            {
+                return -1;
+            }
+
+            length = 2 + (bits & 0x01);
+            length = (bits & 0x02) ? prev - length : prev + length;
         }
         else
         {
-            fprintf(stderr, "error: malformed file header.\n");
-            errno = EILSEQ;     /* Illegal byte sequence seems reasonable */
+            length = BufferGetBits(reader, LITERAL_LENGTH_BITS);
+        }
+
+        if ((EOF == bits) || (length < 1) || (length > UCHAR_MAX))
+        {
+            /* out of data, or not the length of a code */
             return -1;
         }
+
+        cl[c].codeLen = (byte_t)length;
+        prev = length;
+        c++;
     }
 
     return 0;
 }
+
+#ifdef HUFFMAN_STATS
+/****************************************************************************
+*   Function   : AddCodeStats
+*   Description: This function adds the symbols that a code was built for,
+*                and the number of bits the code takes for them, to the
+*                statistics.
+*   Parameters : counts - number of occurrences of each symbol
+*                cl - pointer to list of canonical codes sorted by value
+*   Effects    : The statistics for the code are added to the totals.
+*   Returned   : None
+****************************************************************************/
+static void AddCodeStats(const count_t *counts, const canonical_list_t *cl)
+{
+    int c;
+    double bits;
+
+    bits = 0;
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        bits += (double)counts[c] * cl[c].codeLen;
+    }
+
+    StatsAddCode(counts, bits);
+}
+#endif
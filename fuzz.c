@@ -0,0 +1,243 @@
+/***************************************************************************
+*                    Huffman Library Decoder Fuzz Target
+*
+*   File    : fuzz.c
+*   Purpose : libFuzzer target that feeds arbitrary data to the Huffman
+*             library's decoders, so that malformed, truncated and hostile
+*             input can be shown to fail cleanly.
+*   Author  : Michael Dipperstein
+*   Date    : October 15, 2026
+*
+****************************************************************************
+*
+* Huffman: An ANSI C Huffman Encoding/Decoding Routine
+* Copyright (C) 2026 by
+* Michael Dipperstein (mdipperstein@gmail.com)
+*
+* This file is part of the Huffman library.
+*
+* The Huffman library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The Huffman library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#define _POSIX_C_SOURCE 200809L     /* fmemopen */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "huffman.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define FUZZ_OUT_CAP        (1UL << 20) /* most bytes a decoder may write */
+#define TABLE_ID            1
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* the first byte of the input chooses one of these decoders */
+typedef enum
+{
+    FUZZ_MESSAGE,               /* HuffmanDecodeMessage */
+    FUZZ_BUFFER,                /* CanonicalDecodeBuffer */
+    FUZZ_CACHE,                 /* CanonicalDecodeWithCache */
+    FUZZ_CANONICAL_FILE,        /* CanonicalDecodeFileLimit */
+    FUZZ_TRADITIONAL_FILE,      /* HuffmanDecodeFile */
+    FUZZ_STREAM,                /* CanonicalDecodeStreamParallelLimit */
+    NUM_FUZZ_TARGETS
+} fuzz_target_t;
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static unsigned char out[FUZZ_OUT_CAP];     /* decoded data */
+static canonical_cache_t *cache = NULL;     /* holds a table with TABLE_ID */
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+static int DecodeFile(const uint8_t *data, size_t size,
+    const fuzz_target_t target);
+static canonical_cache_t *MakeCache(void);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : LLVMFuzzerTestOneInput
+*   Description: This function is called by libFuzzer with each input.  The
+*                first byte chooses a decoder, and the rest of the input is
+*                decoded with it.  Decoders may fail, but they must not
+*                read or write outside of their buffers, write more than
+*                FUZZ_OUT_CAP bytes, or leak.
+*   Parameters : data - pointer to the input
+*                size - number of bytes in data
+*   Effects    : The input is decoded and the result is thrown away.
+*   Returned   : 0 (libFuzzer reserves other values)
+****************************************************************************/
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    fuzz_target_t target;
+    huffman_decoder_t *decoder;
+    size_t outLen;
+
+    if (0 == size)
+    {
+        return 0;
+    }
+
+    target = (fuzz_target_t)(data[0] % NUM_FUZZ_TARGETS);
+    data++;
+    size--;
+
+    switch (target)
+    {
+        case FUZZ_MESSAGE:
+            /* decode twice, so the second decode may reuse the decoder */
+            if (NULL != (decoder = HuffmanCreateDecoder()))
+            {
+                HuffmanDecodeMessage(decoder, data, size, out, FUZZ_OUT_CAP,
+                    &outLen);
+                HuffmanDecodeMessage(decoder, data, size, out, FUZZ_OUT_CAP,
+                    &outLen);
+                HuffmanFreeDecoder(decoder);
+            }
+            break;
+
+        case FUZZ_BUFFER:
+            CanonicalDecodeBuffer(data, size, out, FUZZ_OUT_CAP, &outLen);
+            break;
+
+        case FUZZ_CACHE:
+            if ((NULL != cache) || (NULL != (cache = MakeCache())))
+            {
+                CanonicalDecodeWithCache(cache, data, size, out,
+                    FUZZ_OUT_CAP, &outLen);
+            }
+            break;
+
+        default:
+            DecodeFile(data, size, target);
+            break;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : DecodeFile
+*   Description: This function decodes an input with one of the decoders
+*                that read from a file.  The input is read from memory and
+*                the output is thrown away.
+*   Parameters : data - pointer to the encoded data
+*                size - number of bytes in data
+*                target - the decoder to use
+*   Effects    : The input is decoded to the null device.
+*   Returned   : The value returned by the decoder, or -1 if the files
+*                can't be opened.
+****************************************************************************/
+static int DecodeFile(const uint8_t *data, size_t size,
+    const fuzz_target_t target)
+{
+    FILE *inFile, *outFile;
+    int status;
+
+    /* fmemopen won't open an empty buffer */
+    if (0 == size)
+    {
+        return -1;
+    }
+
+    inFile = fmemopen((void *)data, size, "rb");
+
+    if (NULL == inFile)
+    {
+        return -1;
+    }
+
+    outFile = fopen("/dev/null", "wb");
+
+    if (NULL == outFile)
+    {
+        fclose(inFile);
+        return -1;
+    }
+
+    switch (target)
+    {
+        case FUZZ_CANONICAL_FILE:
+            status = CanonicalDecodeFileLimit(inFile, outFile, FUZZ_OUT_CAP);
+            break;
+
+        case FUZZ_TRADITIONAL_FILE:
+            status = HuffmanDecodeFile(inFile, outFile);
+            break;
+
+        case FUZZ_STREAM:
+            status = CanonicalDecodeStreamParallelLimit(inFile, outFile, 1,
+                FUZZ_OUT_CAP);
+            break;
+
+        default:
+            status = -1;
+            break;
+    }
+
+    fclose(inFile);
+    fclose(outFile);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : MakeCache
+*   Description: This function makes the cache used for decoding with a
+*                trained table.  The table is trained on a fixed sample,
+*                so every run uses the same one.
+*   Parameters : None
+*   Effects    : A cache holding a table with TABLE_ID is allocated.  It
+*                is kept for the life of the process.
+*   Returned   : Pointer to the cache, or NULL for failure.
+****************************************************************************/
+static canonical_cache_t *MakeCache(void)
+{
+    static const char sample[] =
+        "The quick brown fox jumps over the lazy dog.  0123456789";
+    canonical_table_t *table;
+    canonical_cache_t *newCache;
+
+    table = CanonicalTrainTable(sample, sizeof(sample) - 1, TABLE_ID);
+
+    if (NULL == table)
+    {
+        return NULL;
+    }
+
+    newCache = CanonicalCreateCache();
+
+    if ((NULL == newCache) || (0 != CanonicalCacheAdd(newCache, table)))
+    {
+        CanonicalFreeTable(table);
+        CanonicalFreeCache(newCache);
+        return NULL;
+    }
+
+    return newCache;
+}
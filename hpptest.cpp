@@ -0,0 +1,320 @@
+/***************************************************************************
+*                 Huffman Library C++ Canonical Codec Test
+*
+*   File    : hpptest.cpp
+*   Purpose : Check that huffman.hpp's CanonicalCodec and the C library's
+*             CanonicalEncodeBuffer and CanonicalDecodeBuffer write the
+*             same containers and decode each other's data.
+*   Author  : Michael Dipperstein
+*   Date    : October 15, 2026
+*
+****************************************************************************
+*
+* Huffman: An ANSI C Huffman Encoding/Decoding Routine
+* Copyright (C) 2026 by
+* Michael Dipperstein (mdipperstein@gmail.com)
+*
+* This file is part of the Huffman library.
+*
+* The Huffman library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The Huffman library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <string>
+#include <system_error>
+#include <vector>
+#include "huffman.hpp"
+
+extern "C"
+{
+#include "huffman.h"
+}
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+constexpr std::size_t FLAGS_OFFSET = 5;     /* container flags byte */
+constexpr std::uint8_t CODED = 0;           /* flags without STORED or RUN */
+constexpr std::uint8_t UNCODED_MASK =
+    huffman::detail::CONTAINER_STORED | huffman::detail::CONTAINER_RUN;
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+using Codec = huffman::CanonicalCodec<15, 11>;
+using Bytes = std::vector<std::byte>;
+
+/* an input and the container it's expected to be written in */
+struct TestCase
+{
+    std::string name;
+    Bytes data;
+    std::uint8_t container;     /* CODED, CONTAINER_STORED or CONTAINER_RUN */
+};
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static int failures = 0;
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+static std::vector<TestCase> MakeTests();
+static void RunTest(Codec &codec, const TestCase &test);
+static void CheckCorruptCrc(Codec &codec, const TestCase &test,
+    const Bytes &encoded);
+static void Check(const bool ok, const TestCase &test, const char *what);
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : main
+*   Description: This is the main function for this program.  It codes each
+*                test input with both libraries and reports any
+*                differences.
+*   Parameters : None
+*   Effects    : A line is printed for every failed check.
+*   Returned   : EXIT_SUCCESS if every check passes, otherwise EXIT_FAILURE.
+****************************************************************************/
+int main()
+{
+    Codec codec;
+    std::size_t count = 0;
+
+    /* one codec for every test, so tables are rebuilt and reused */
+    for (const TestCase &test : MakeTests())
+    {
+        RunTest(codec, test);
+        count++;
+    }
+
+    if (0 != failures)
+    {
+        std::printf("%d checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    std::printf("%zu inputs passed\n", count);
+    return EXIT_SUCCESS;
+}
+
+/****************************************************************************
+*   Function   : MakeTests
+*   Description: This function makes the test inputs.  There is at least
+*                one input for each kind of container, and repeated inputs
+*                so that codes are reused.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : The test inputs.
+****************************************************************************/
+static std::vector<TestCase> MakeTests()
+{
+    static const char text[] =
+        "It was the best of times, it was the worst of times, it was the "
+        "age of wisdom, it was the age of foolishness, it was the epoch of "
+        "belief, it was the epoch of incredulity, it was the season of "
+        "Light, it was the season of Darkness.";
+    std::vector<TestCase> tests;
+    Bytes data;
+    unsigned long seed = 1;
+
+    tests.push_back({"empty", {}, huffman::detail::CONTAINER_STORED});
+
+    data.clear();
+    for (const char c : std::string("tiny message"))
+    {
+        data.push_back(static_cast<std::byte>(c));
+    }
+    tests.push_back({"tiny", data, huffman::detail::CONTAINER_STORED});
+
+    tests.push_back({"one byte run", Bytes(1, std::byte{'x'}),
+        huffman::detail::CONTAINER_RUN});
+    tests.push_back({"long run", Bytes(100000, std::byte{0}),
+        huffman::detail::CONTAINER_RUN});
+
+    data.clear();
+    for (unsigned i = 0; i < 40; i++)
+    {
+        for (const char *c = text; '\0' != *c; c++)
+        {
+            data.push_back(static_cast<std::byte>(*c));
+        }
+    }
+    tests.push_back({"text", data, CODED});
+    tests.push_back({"text again", data, CODED});
+
+    /* pseudo-random bytes that coding can't make smaller */
+    data.clear();
+    for (unsigned i = 0; i < 65536; i++)
+    {
+        seed = (seed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+        data.push_back(static_cast<std::byte>(seed >> 16));
+    }
+    tests.push_back({"random", data, huffman::detail::CONTAINER_STORED});
+
+    /* counts that double, so an unlimited code would be too long */
+    data.clear();
+    for (unsigned i = 0; i < 20; i++)
+    {
+        data.insert(data.end(), std::size_t{1} << i,
+            static_cast<std::byte>(i));
+    }
+    tests.push_back({"deep code", data, CODED});
+
+    return tests;
+}
+
+/****************************************************************************
+*   Function   : RunTest
+*   Description: This function encodes an input with each library and each
+*                CanonicalCodec overload, makes sure the encoded data is the
+*                same, and decodes it with the other library.
+*   Parameters : codec - the C++ codec to use
+*                test - the input to test
+*   Effects    : Failed checks are reported and counted.
+*   Returned   : None
+****************************************************************************/
+static void RunTest(Codec &codec, const TestCase &test)
+{
+    const std::size_t len = test.data.size();
+    Bytes cEncoded(CanonicalEncodeBound(len));
+    Bytes hppEncoded(Codec::EncodeBound(len));
+    Bytes iterEncoded, decoded, iterDecoded;
+    std::size_t cLen, hppLen, decodedLen;
+
+    try
+    {
+        /* encode with C, with a span, and with an output iterator */
+        if (0 != CanonicalEncodeBuffer(test.data.data(), len,
+            cEncoded.data(), cEncoded.size(), &cLen))
+        {
+            Check(false, test, "CanonicalEncodeBuffer failed");
+            return;
+        }
+
+        cEncoded.resize(cLen);
+        hppLen = codec.Encode(test.data, std::span(hppEncoded));
+        hppEncoded.resize(hppLen);
+        codec.Encode(test.data, std::back_inserter(iterEncoded));
+
+        Check(hppEncoded == cEncoded, test, "span encode differs from C");
+        Check(iterEncoded == cEncoded, test,
+            "iterator encode differs from C");
+        Check((cLen > FLAGS_OFFSET) && (test.container ==
+            (std::to_integer<std::uint8_t>(cEncoded[FLAGS_OFFSET]) &
+            UNCODED_MASK)), test, "unexpected container");
+
+        /* C++ encoded -> C decoded */
+        decoded.assign(len, std::byte{0});
+        Check((0 == CanonicalDecodeBuffer(hppEncoded.data(), hppLen,
+            decoded.data(), len, &decodedLen)) && (decodedLen == len) &&
+            (decoded == test.data), test, "C decode of C++ data failed");
+
+        /* C encoded -> C++ decoded, with a span and an output iterator */
+        decoded.assign(Codec::DecodedSize(cEncoded), std::byte{0});
+        decodedLen = codec.Decode(cEncoded, std::span(decoded));
+        Check((decodedLen == len) && (decoded == test.data), test,
+            "span decode of C data failed");
+
+        codec.Decode(cEncoded, std::back_inserter(iterDecoded));
+        Check(iterDecoded == test.data, test,
+            "iterator decode of C data failed");
+
+        CheckCorruptCrc(codec, test, cEncoded);
+    }
+    catch (const std::system_error &e)
+    {
+        Check(false, test, e.what());
+    }
+}
+
+/****************************************************************************
+*   Function   : CheckCorruptCrc
+*   Description: This function changes the checksum of encoded data and
+*                makes sure that both libraries reject it.
+*   Parameters : codec - the C++ codec to use
+*                test - the input that was encoded
+*                encoded - the encoded input
+*   Effects    : Failed checks are reported and counted.
+*   Returned   : None
+****************************************************************************/
+static void CheckCorruptCrc(Codec &codec, const TestCase &test,
+    const Bytes &encoded)
+{
+    Bytes corrupt(encoded);
+    Bytes decoded(test.data.size());
+    Bytes iterDecoded;
+    std::size_t decodedLen;
+    bool thrown;
+
+    corrupt.back() ^= std::byte{0x01};      /* the CRC is last */
+
+    Check(0 != CanonicalDecodeBuffer(corrupt.data(), corrupt.size(),
+        decoded.data(), decoded.size(), &decodedLen), test,
+        "C decode accepted a bad CRC");
+
+    thrown = false;
+
+    try
+    {
+        codec.Decode(corrupt, std::span(decoded));
+    }
+    catch (const std::system_error &e)
+    {
+        thrown = (e.code() == std::errc::illegal_byte_sequence);
+    }
+
+    Check(thrown, test, "span decode accepted a bad CRC");
+    thrown = false;
+
+    try
+    {
+        codec.Decode(corrupt, std::back_inserter(iterDecoded));
+    }
+    catch (const std::system_error &e)
+    {
+        thrown = (e.code() == std::errc::illegal_byte_sequence);
+    }
+
+    Check(thrown, test, "iterator decode accepted a bad CRC");
+}
+
+/****************************************************************************
+*   Function   : Check
+*   Description: This function reports a check that failed.
+*   Parameters : ok - true if the check passed
+*                test - the input being tested
+*                what - description of the failure
+*   Effects    : A failure is printed and counted if ok is false.
+*   Returned   : None
+****************************************************************************/
+static void Check(const bool ok, const TestCase &test, const char *what)
+{
+    if (!ok)
+    {
+        std::printf("%s: %s\n", test.name.c_str(), what);
+        failures++;
+    }
+}
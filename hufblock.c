@@ -0,0 +1,2295 @@
+/***************************************************************************
+*             Canonical Huffman Encoding and Decoding of Blocks
+*
+*   File    : hufblock.c
+*   Purpose : Use canonical huffman coding to compress/decompress streams
+*             as a sequence of independently coded blocks, so that the
+*             input only needs to be read once.
+*   Author  : Michael Dipperstein
+*   Date    : October 14, 2026
+*
+****************************************************************************
+*
+* Huffman: An ANSI C Canonical Huffman Encoding/Decoding Routine
+* Copyright (C) 2026 by
+* Michael Dipperstein (mdipperstein@gmail.com)
+*
+* This file is part of the Huffman library.
+*
+* The Huffman library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The Huffman library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#ifndef HUFFMAN_NO_MMAP
+#define _POSIX_C_SOURCE 200112L     /* mmap, ftruncate and posix_madvise */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifndef HUFFMAN_NO_THREADS
+#include <pthread.h>
+#endif
+#ifndef HUFFMAN_NO_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "huflocal.h"
+#include "huffman.h"
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/***************************************************************************
+* An encoded stream is a sequence of blocks, each starting with a block
+* type byte.  Other block types follow the type with the decoded and
+* encoded sizes of the block (4 bytes each, MSB first) and the encoded
+* block.  The stream ends with a BLOCK_END type byte.  Encoders write
+* whichever of BLOCK_COMPACT, BLOCK_STORED and BLOCK_RUN is smallest (or of
+* those and BLOCK_ORDER1, if asked to), but decoders accept all of the
+* types.
+***************************************************************************/
+#define BLOCK_END           0       /* no more blocks */
+#define BLOCK_CANONICAL     1       /* block coded by CanonicalEncodeBuffer */
+#define BLOCK_INTERLEAVED   2   /* block coded by CanonicalEncodeInterleaved */
+#define BLOCK_COMPACT       3   /* BLOCK_INTERLEAVED with a compact header */
+#define BLOCK_STORED        4       /* block is stored without coding */
+#define BLOCK_RUN           5       /* block is 1 byte repeated rawLen times */
+#define BLOCK_ORDER1        6       /* block coded by CanonicalEncodeOrder1 */
+
+/* largest number of input bytes coded in a single block */
+#define BLOCK_SIZE          (1UL << 20)
+
+/* bytes in a block header (only the type byte for BLOCK_END) */
+#define BLOCK_HEADER_SIZE   9
+
+/***************************************************************************
+* A seekable stream has an index after its BLOCK_END.  The index has an
+* entry for every block and the BLOCK_END, holding the decoded offset of
+* the block and the encoded offset of its header (8 bytes each, MSB first).
+* Encoded offsets are from the first block header.  The index is followed
+* by the number of entries (4 bytes, MSB first) and indexMagic, so it can
+* be found from the end of the file.  Decoders that stop at BLOCK_END never
+* see the index.
+***************************************************************************/
+#define INDEX_ENTRY_SIZE    16
+#define INDEX_FOOTER_SIZE   8
+#define INDEX_GROWTH        64      /* entries added when the index fills */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* a block to be encoded or decoded */
+typedef struct block_job_t
+{
+    int type;               /* type of block */
+    byte_t *raw;            /* decoded data */
+    size_t rawLen;          /* number of bytes in raw */
+    byte_t *coded;          /* encoded data */
+    size_t codedLen;        /* number of bytes in coded */
+    int status;             /* 0 if the block was coded, otherwise -1 */
+    int error;              /* errno if the block couldn't be coded */
+} block_job_t;
+
+/***************************************************************************
+* Blocks are coded in batches, and the threads that code them.  With worker
+* threads there are two batches, so the caller's thread can read the next
+* batch and write the last one while a batch is coded.
+***************************************************************************/
+typedef struct block_pool_t
+{
+    block_job_t *jobs;      /* one job per block in each batch */
+    int numSlots;           /* number of jobs allocated */
+    int batchSize;          /* largest number of blocks in a batch */
+    block_job_t *batch;     /* jobs in the batch being coded */
+    int numJobs;            /* number of blocks in that batch */
+    int encode;             /* 1 -> encode blocks, 0 -> decode blocks */
+    int order1;             /* 1 -> also try BLOCK_ORDER1 when encoding */
+#ifndef HUFFMAN_NO_THREADS
+    pthread_t *threads;     /* worker threads */
+    int numThreads;         /* number of worker threads */
+    int numQueued;          /* number of jobs handed to the workers */
+    int nextJob;            /* next queued job to be started */
+    int pending;            /* number of jobs not finished */
+    int quit;               /* set to tell the workers to exit */
+    pthread_mutex_t lock;   /* protects everything above */
+    pthread_cond_t start;   /* signals that a batch is ready */
+    pthread_cond_t done;    /* signals that a batch is finished */
+#endif
+} block_pool_t;
+
+/* where a block starts in the decoded and encoded data */
+typedef struct index_entry_t
+{
+    unsigned long rawOffset;        /* offset of the decoded block */
+    unsigned long codedOffset;      /* offset of the block header */
+} index_entry_t;
+
+/* index of a seekable stream, built as it's encoded */
+typedef struct block_index_t
+{
+    index_entry_t *entries;         /* one entry per block and BLOCK_END */
+    unsigned long numEntries;       /* number of entries used */
+    unsigned long capacity;         /* number of entries allocated */
+    unsigned long rawOffset;        /* offset of the next decoded block */
+    unsigned long codedOffset;      /* offset of the next block header */
+} block_index_t;
+
+/***************************************************************************
+*                                 MACROS
+***************************************************************************/
+/* count coded blocks only when statistics are being collected */
+#ifdef HUFFMAN_STATS
+#define COUNT_BLOCK(job, encode)    CountBlock((job), (encode))
+#else
+#define COUNT_BLOCK(job, encode)    ((void)0)
+#endif
+
+/***************************************************************************
+*                            GLOBAL VARIABLES
+***************************************************************************/
+static const byte_t indexMagic[4] = {'H', 'U', 'F', 'X'};
+
+/***************************************************************************
+*                               PROTOTYPES
+***************************************************************************/
+/* coding batches of blocks */
+static int EncodeBlocks(FILE *inFile, FILE *outFile, const int numThreads,
+    const int order1, block_index_t *index);
+static int CreatePool(block_pool_t *pool, int numThreads, const int encode);
+static void DestroyPool(block_pool_t *pool);
+static void StartBatch(block_pool_t *pool, block_job_t *batch,
+    const int numJobs);
+static void FinishBatch(block_pool_t *pool);
+static int ReadRawBlocks(FILE *fp, block_job_t *jobs, const int maxJobs,
+    int *endOfFile);
+static int ReadCodedBlocks(FILE *fp, block_job_t *jobs, const int maxJobs,
+    const unsigned long maxSize, unsigned long *decoded, int *endOfFile);
+static int WriteCodedBlocks(FILE *fp, const block_job_t *jobs,
+    const int numJobs, block_index_t *index);
+static int WriteRawBlocks(FILE *fp, const block_job_t *jobs,
+    const int numJobs);
+static void CodeBlock(const block_pool_t *pool, block_job_t *job);
+static void EncodeBlock(block_job_t *job, const int order1);
+static void DecodeBlock(block_job_t *job);
+#ifdef HUFFMAN_STATS
+static void CountBlock(const block_job_t *job, const int encode);
+#endif
+#ifndef HUFFMAN_NO_THREADS
+static void *WorkerThread(void *arg);
+#endif
+
+/* block headers */
+static int WriteBlockHeader(FILE *fp, const int type,
+    const unsigned long rawLen, const unsigned long codedLen);
+static int ReadBlockHeader(FILE *fp, int *type, unsigned long *rawLen,
+    unsigned long *codedLen);
+static size_t PutBlockHeader(byte_t *header, const int type,
+    const unsigned long rawLen, const unsigned long codedLen);
+static int GetBlockHeader(const byte_t *header, const size_t len, int *type,
+    unsigned long *rawLen, unsigned long *codedLen);
+
+/* seek index */
+static int AddIndexEntry(block_index_t *index, const unsigned long rawLen,
+    const unsigned long codedLen);
+static int WriteIndex(FILE *fp, const block_index_t *index);
+static int ReadIndexEntry(FILE *fp, const long indexPos,
+    const unsigned long n, index_entry_t *entry);
+static void PutOffset(byte_t *dst, unsigned long value, const int size);
+static int GetOffset(const byte_t *src, const int size,
+    unsigned long *value);
+
+/* memory mapped files */
+#ifndef HUFFMAN_NO_MMAP
+static int MapInputFile(const char *name, byte_t **data, size_t *len);
+static int MapOutputFile(const char *name, const size_t len, byte_t **data,
+    int *fd);
+static int UnmapOutputFile(byte_t *data, const size_t mappedLen,
+    const size_t len, int fd);
+#else
+static int OpenNamedFiles(const char *inName, const char *outName,
+    FILE **inFile, FILE **outFile);
+static int CloseNamedFiles(FILE *inFile, FILE *outFile, int status);
+#endif
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/****************************************************************************
+*   Function   : CanonicalEncodeStream
+*   Description: This routine reads a file one block at a time, and writes
+*                out each block encoded with a canonical code optimized for
+*                that block.
+*   Parameters : inFile - Open file pointer for file to encode (it doesn't
+*                         need to be rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalEncodeStream(FILE *inFile, FILE *outFile)
+{
+    return CanonicalEncodeStreamParallel(inFile, outFile, 1);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeStream
+*   Description: This routine reads a file encoded by CanonicalEncodeStream
+*                one block at a time, and writes out the decoded blocks.
+*   Parameters : inFile - Open file pointer for file to decode
+*                outFile - Open file pointer for file receiving decoded data
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalDecodeStream(FILE *inFile, FILE *outFile)
+{
+    return CanonicalDecodeStreamParallel(inFile, outFile, 1);
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeStreamParallel
+*   Description: This routine does the same thing as CanonicalEncodeStream,
+*                but encodes up to numThreads blocks at once, while the
+*                next blocks are read and the last ones are written.  The
+*                output is identical no matter how many threads are used.
+*   Parameters : inFile - Open file pointer for file to encode (it doesn't
+*                         need to be rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*                numThreads - number of threads to encode with.  Values
+*                             less than 2 encode in the caller's thread.
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalEncodeStreamParallel(FILE *inFile, FILE *outFile,
+    int numThreads)
+{
+    return EncodeBlocks(inFile, outFile, numThreads, 0, NULL);
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeStreamOrder1
+*   Description: This routine does the same thing as
+*                CanonicalEncodeStreamParallel, but it also tries coding
+*                each block with codes chosen by the byte before each
+*                symbol (BLOCK_ORDER1), and keeps whichever is smaller.
+*                Text and other data where a byte says a lot about the
+*                byte after it compress better, but encoding is slower.
+*                Decoding is done by CanonicalDecodeStream and
+*                CanonicalDecodeStreamParallel.
+*   Parameters : inFile - Open file pointer for file to encode (it doesn't
+*                         need to be rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*                numThreads - number of threads to encode with.  Values
+*                             less than 2 encode in the caller's thread.
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalEncodeStreamOrder1(FILE *inFile, FILE *outFile, int numThreads)
+{
+    return EncodeBlocks(inFile, outFile, numThreads, 1, NULL);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeStreamParallel
+*   Description: This routine does the same thing as CanonicalDecodeStream,
+*                but decodes up to numThreads blocks at once, while the
+*                next blocks are read and the last ones are written.  The
+*                size in each block header is used to find the next block
+*                without decoding the current one.
+*   Parameters : inFile - Open file pointer for file to decode
+*                outFile - Open file pointer for file receiving decoded data
+*                numThreads - number of threads to decode with.  Values
+*                             less than 2 decode in the caller's thread.
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalDecodeStreamParallel(FILE *inFile, FILE *outFile,
+    int numThreads)
+{
+    return CanonicalDecodeStreamParallelLimit(inFile, outFile, numThreads,
+        ULONG_MAX);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeStreamParallelLimit
+*   Description: This routine decodes a file like
+*                CanonicalDecodeStreamParallel, but fails instead of
+*                writing more than a given number of bytes.  The decoded
+*                sizes in the block headers are added up as the blocks are
+*                read, so a block that would go over the limit is rejected
+*                before it's decoded, but blocks before it may already have
+*                been written.
+*   Parameters : inFile - Open file pointer for file to decode
+*                outFile - Open file pointer for file receiving decoded data
+*                numThreads - number of threads to decode with.  Values
+*                             less than 2 decode in the caller's thread.
+*                maxSize - most bytes that may be decoded
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if the file decodes to more
+*                than maxSize bytes).  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalDecodeStreamParallelLimit(FILE *inFile, FILE *outFile,
+    int numThreads, unsigned long maxSize)
+{
+    block_pool_t pool;
+    block_job_t *current, *next, *swap;
+    unsigned long decoded;
+    int numCurrent, numNext, status, endOfFile, readError;
+
+    /* validate input and output files */
+    if ((NULL == inFile) || (NULL == outFile))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != CreatePool(&pool, numThreads, 0))
+    {
+        return -1;
+    }
+
+    /* with two batches, next is read while current is decoded */
+    current = pool.jobs;
+    next = pool.jobs + (pool.numSlots - pool.batchSize);
+    status = 0;
+    endOfFile = 0;
+    readError = 0;
+    decoded = 0;
+
+    numCurrent = ReadCodedBlocks(inFile, current, pool.batchSize, maxSize,
+        &decoded, &endOfFile);
+
+    if (numCurrent < 0)
+    {
+        readError = errno;
+        numCurrent = 0;
+    }
+
+    StartBatch(&pool, current, numCurrent);
+
+    while (numCurrent > 0)
+    {
+        numNext = 0;
+
+        if ((next != current) && !endOfFile)
+        {
+            numNext = ReadCodedBlocks(inFile, next, pool.batchSize,
+                maxSize, &decoded, &endOfFile);
+
+            if (numNext < 0)
+            {
+                readError = errno;
+                numNext = 0;
+                endOfFile = 1;
+            }
+        }
+
+        FinishBatch(&pool);
+
+        if (next != current)
+        {
+            /* decode the next batch while this one is written */
+            StartBatch(&pool, next, numNext);
+        }
+
+        if (0 != WriteRawBlocks(outFile, current, numCurrent))
+        {
+            status = -1;
+            break;
+        }
+
+        if ((next == current) && !endOfFile)
+        {
+            numNext = ReadCodedBlocks(inFile, current, pool.batchSize,
+                maxSize, &decoded, &endOfFile);
+
+            if (numNext < 0)
+            {
+                readError = errno;
+                numNext = 0;
+            }
+
+            StartBatch(&pool, current, numNext);
+        }
+
+        swap = current;
+        current = next;
+        next = swap;
+        numCurrent = numNext;
+    }
+
+    /* a batch may still be running if a write failed */
+    FinishBatch(&pool);
+    DestroyPool(&pool);
+
+    if ((0 == status) && (0 != readError))
+    {
+        errno = readError;
+        status = -1;
+    }
+
+    return status;
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeSeekable
+*   Description: This routine does the same thing as
+*                CanonicalEncodeStreamParallel, but follows the encoded
+*                blocks with an index of where each block starts, so that
+*                CanonicalDecodeRange can decode part of the data without
+*                decoding the blocks before it.  The result may still be
+*                decoded by CanonicalDecodeStream.
+*   Parameters : inFile - Open file pointer for file to encode (it doesn't
+*                         need to be rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*                numThreads - number of threads to encode with.  Values
+*                             less than 2 encode in the caller's thread.
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int CanonicalEncodeSeekable(FILE *inFile, FILE *outFile, int numThreads)
+{
+    block_index_t index;
+    int status;
+
+    index.entries = NULL;
+    index.numEntries = 0;
+    index.capacity = 0;
+    index.rawOffset = 0;
+    index.codedOffset = 0;
+
+    status = EncodeBlocks(inFile, outFile, numThreads, 0, &index);
+
+    if (0 == status)
+    {
+        status = WriteIndex(outFile, &index);
+    }
+
+    free(index.entries);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeRange
+*   Description: This routine decodes part of a file encoded by
+*                CanonicalEncodeSeekable.  The index at the end of the file
+*                is searched for the block holding the first byte of the
+*                range, and only the blocks holding the range are read and
+*                decoded.
+*   Parameters : inFile - Open file pointer for file to decode (it must be
+*                         seekable)
+*                offset - offset of the first decoded byte wanted
+*                length - number of decoded bytes wanted
+*                dst - pointer to the length byte buffer receiving the
+*                      decoded bytes
+*   Effects    : The decoded bytes from offset to offset + length are
+*                written to dst.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (EILSEQ if inFile doesn't end with an
+*                index, ERANGE if the range goes past the end of the data).
+*                Either way, inFile will be left open.
+****************************************************************************/
+int CanonicalDecodeRange(FILE *inFile, unsigned long offset, size_t length,
+    void *dst)
+{
+    byte_t footer[INDEX_FOOTER_SIZE];
+    byte_t *out, *buffer;
+    long indexPos, streamPos;
+    unsigned long numEntries, first, last, middle;
+    unsigned long rawLen, codedLen, skip, endOffset;
+    int type, status;
+    index_entry_t entry, next;
+    block_job_t job;
+
+    /* validate parameters */
+    if ((NULL == inFile) || ((NULL == dst) && (0 != length)))
+    {
+        errno = (NULL == inFile) ? ENOENT : EINVAL;
+        return -1;
+    }
+
+    out = (byte_t *)dst;
+
+    /* the footer tells how many entries are in the index before it */
+    if ((0 != fseek(inFile, -INDEX_FOOTER_SIZE, SEEK_END)) ||
+        ((indexPos = ftell(inFile)) < 0) ||
+        (fread(footer, 1, INDEX_FOOTER_SIZE, inFile) != INDEX_FOOTER_SIZE) ||
+        (0 != memcmp(footer + 4, indexMagic, sizeof(indexMagic))))
+    {
+        fprintf(stderr, "error: missing block index.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    GetOffset(footer, 4, &numEntries);
+
+    if ((0 == numEntries) ||
+        (numEntries > (unsigned long)indexPos / INDEX_ENTRY_SIZE))
+    {
+        fprintf(stderr, "error: malformed block index.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    indexPos -= (long)(numEntries * INDEX_ENTRY_SIZE);
+
+    /* the last entry is for BLOCK_END, which is just before the index */
+    if (0 != ReadIndexEntry(inFile, indexPos, numEntries - 1, &entry))
+    {
+        return -1;
+    }
+
+    endOffset = entry.codedOffset;
+    streamPos = indexPos - 1 - (long)endOffset;
+
+    if ((offset > entry.rawOffset) || (length > entry.rawOffset - offset))
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    if (0 == length)
+    {
+        return 0;
+    }
+
+    /* find the last block starting at or before offset */
+    first = 0;
+    last = numEntries - 1;
+
+    while (last - first > 1)
+    {
+        middle = first + (last - first) / 2;
+
+        if (0 != ReadIndexEntry(inFile, indexPos, middle, &entry))
+        {
+            return -1;
+        }
+
+        if (entry.rawOffset <= offset)
+        {
+            first = middle;
+        }
+        else
+        {
+            last = middle;
+        }
+    }
+
+    buffer = (byte_t *)malloc(BLOCK_SIZE);
+    job.coded = (byte_t *)malloc(CanonicalInterleavedBound(BLOCK_SIZE));
+
+    if ((NULL == buffer) || (NULL == job.coded))
+    {
+        perror("Allocating Block Buffers");
+        free(buffer);
+        free(job.coded);
+        return -1;
+    }
+
+    if (0 != ReadIndexEntry(inFile, indexPos, first, &entry))
+    {
+        free(buffer);
+        free(job.coded);
+        return -1;
+    }
+
+    status = 0;
+    skip = offset - entry.rawOffset;
+
+    if (entry.rawOffset > offset)
+    {
+        fprintf(stderr, "error: malformed block index.\n");
+        errno = EILSEQ;
+        status = -1;
+    }
+
+    while ((length > 0) && (0 == status))
+    {
+        if ((first + 1 >= numEntries) || (entry.codedOffset > endOffset))
+        {
+            fprintf(stderr, "error: malformed block index.\n");
+            errno = EILSEQ;
+            status = -1;
+            break;
+        }
+
+        /* the next entry gives the sizes that the block header must have */
+        if ((0 != ReadIndexEntry(inFile, indexPos, first + 1, &next)) ||
+            (0 != fseek(inFile, streamPos + (long)entry.codedOffset,
+            SEEK_SET)) ||
+            (0 != ReadBlockHeader(inFile, &type, &rawLen, &codedLen)))
+        {
+            status = -1;
+            break;
+        }
+
+        if ((BLOCK_END == type) || (next.codedOffset > endOffset) ||
+            (next.rawOffset < entry.rawOffset) ||
+            (next.rawOffset - entry.rawOffset != rawLen) ||
+            (skip >= rawLen) ||
+            (next.codedOffset < entry.codedOffset) ||
+            (next.codedOffset - entry.codedOffset !=
+            BLOCK_HEADER_SIZE + codedLen))
+        {
+            fprintf(stderr, "error: malformed block index.\n");
+            errno = EILSEQ;
+            status = -1;
+            break;
+        }
+
+        job.type = type;
+        job.rawLen = rawLen;
+        job.codedLen = codedLen;
+
+        /* blocks that are wanted whole are decoded straight into dst */
+        job.raw = ((0 == skip) && (length >= rawLen)) ? out : buffer;
+
+        if (fread((BLOCK_STORED == type) ? job.raw : job.coded, 1,
+            job.codedLen, inFile) != job.codedLen)
+        {
+            fprintf(stderr, "error: truncated block.\n");
+            errno = EILSEQ;
+            status = -1;
+            break;
+        }
+
+        DecodeBlock(&job);
+
+        if (0 != job.status)
+        {
+            status = -1;
+            break;
+        }
+
+        COUNT_BLOCK(&job, 0);
+        rawLen -= skip;
+
+        if (rawLen > length)
+        {
+            rawLen = length;
+        }
+
+        if (job.raw == buffer)
+        {
+            memcpy(out, buffer + skip, rawLen);
+        }
+
+        out += rawLen;
+        length -= rawLen;
+        skip = 0;
+        entry = next;
+        first++;
+    }
+
+    free(buffer);
+    free(job.coded);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : CanonicalEncodeMapped
+*   Description: This routine does the same thing as CanonicalEncodeStream,
+*                but memory maps the input and output files.  Each block
+*                is encoded straight from the input mapping into the
+*                output mapping, which is sized for the worst case and
+*                trimmed when encoding is done.
+*   Parameters : inName - name of the file to encode
+*                outName - name of the file receiving encoded data.  It's
+*                          created or truncated.
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+int CanonicalEncodeMapped(const char *inName, const char *outName)
+{
+#ifndef HUFFMAN_NO_MMAP
+    byte_t *in, *out;
+    size_t inLen, outCap, numBlocks, pos, offset;
+    int fd, status;
+    block_job_t job;
+
+    /* validate input and output file names */
+    if ((NULL == inName) || (NULL == outName))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != MapInputFile(inName, &in, &inLen))
+    {
+        return -1;
+    }
+
+    /* no block is encoded to more bytes than it holds */
+    numBlocks = inLen / BLOCK_SIZE + ((inLen % BLOCK_SIZE) ? 1 : 0);
+
+    if (numBlocks > (((size_t)-1) - inLen - 1) / BLOCK_HEADER_SIZE)
+    {
+        if (NULL != in)
+        {
+            munmap(in, inLen);
+        }
+
+        errno = ERANGE;
+        return -1;
+    }
+
+    outCap = inLen + (numBlocks * BLOCK_HEADER_SIZE) + 1;
+
+    if (0 != MapOutputFile(outName, outCap, &out, &fd))
+    {
+        if (NULL != in)
+        {
+            munmap(in, inLen);
+        }
+
+        return -1;
+    }
+
+    status = 0;
+    pos = 0;
+
+    for (offset = 0; offset < inLen; offset += job.rawLen)
+    {
+        job.raw = in + offset;
+        job.rawLen = inLen - offset;
+
+        if (job.rawLen > BLOCK_SIZE)
+        {
+            job.rawLen = BLOCK_SIZE;
+        }
+
+        /* leave room for the block header */
+        job.coded = out + pos + BLOCK_HEADER_SIZE;
+        EncodeBlock(&job, 0);
+
+        if (0 != job.status)
+        {
+            status = -1;
+            break;
+        }
+
+        COUNT_BLOCK(&job, 1);
+
+        if (BLOCK_STORED == job.type)
+        {
+            memcpy(job.coded, job.raw, job.rawLen);
+        }
+
+        pos += PutBlockHeader(out + pos, job.type, job.rawLen, job.codedLen);
+        pos += job.codedLen;
+    }
+
+    if (0 == status)
+    {
+        pos += PutBlockHeader(out + pos, BLOCK_END, 0, 0);
+    }
+
+    if (NULL != in)
+    {
+        munmap(in, inLen);
+    }
+
+    if (0 != UnmapOutputFile(out, outCap, pos, fd))
+    {
+        status = -1;
+    }
+
+    return status;
+#else
+    FILE *inFile, *outFile;
+
+    if (0 != OpenNamedFiles(inName, outName, &inFile, &outFile))
+    {
+        return -1;
+    }
+
+    return CloseNamedFiles(inFile, outFile,
+        CanonicalEncodeStream(inFile, outFile));
+#endif
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeMapped
+*   Description: This routine does the same thing as CanonicalDecodeStream,
+*                but memory maps the input and output files.  The block
+*                headers are read first to find the size of the output
+*                mapping, then each block is decoded straight from the
+*                input mapping into the output mapping.
+*   Parameters : inName - name of the file to decode
+*                outName - name of the file receiving decoded data.  It's
+*                          created or truncated.
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+int CanonicalDecodeMapped(const char *inName, const char *outName)
+{
+    return CanonicalDecodeMappedLimit(inName, outName, ULONG_MAX);
+}
+
+/****************************************************************************
+*   Function   : CanonicalDecodeMappedLimit
+*   Description: This routine decodes a file like CanonicalDecodeMapped,
+*                but fails instead of writing more than a given number of
+*                bytes.  The decoded sizes in the block headers are added
+*                up before the output is sized, so nothing is written if
+*                the total is too large.
+*   Parameters : inName - name of the file to decode
+*                outName - name of the file receiving decoded data.  It's
+*                          created or truncated.
+*                maxSize - most bytes that may be decoded
+*   Effects    : Huffman encoded file is decoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ERANGE if the file decodes to more
+*                than maxSize bytes).
+****************************************************************************/
+int CanonicalDecodeMappedLimit(const char *inName, const char *outName,
+    unsigned long maxSize)
+{
+#ifndef HUFFMAN_NO_MMAP
+    byte_t *in, *out;
+    size_t inLen, outLen, pos, offset;
+    unsigned long rawLen, codedLen;
+    int fd, type, status;
+    block_job_t job;
+
+    /* validate input and output file names */
+    if ((NULL == inName) || (NULL == outName))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != MapInputFile(inName, &in, &inLen))
+    {
+        return -1;
+    }
+
+    if (NULL == in)
+    {
+        fprintf(stderr, "error: malformed block header.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* add up the decoded size of every block */
+    status = 0;
+    pos = 0;
+    outLen = 0;
+    type = BLOCK_CANONICAL;
+
+    while (BLOCK_END != type)
+    {
+        if ((status = GetBlockHeader(in + pos, inLen - pos, &type, &rawLen,
+            &codedLen)) < 0)
+        {
+            break;
+        }
+
+        pos += status;
+        status = 0;
+
+        if (codedLen > inLen - pos)
+        {
+            fprintf(stderr, "error: truncated block.\n");
+            errno = EILSEQ;
+            status = -1;
+            break;
+        }
+
+        if ((rawLen > ((size_t)-1) - outLen) || (rawLen > maxSize - outLen))
+        {
+            fprintf(stderr, "error: decoded data is larger than %lu bytes.\n",
+                maxSize);
+            errno = ERANGE;
+            status = -1;
+            break;
+        }
+
+        pos += codedLen;
+        outLen += rawLen;
+    }
+
+    if ((0 != status) || (0 != MapOutputFile(outName, outLen, &out, &fd)))
+    {
+        munmap(in, inLen);
+        return -1;
+    }
+
+    /* the headers have all been checked, so just decode the blocks */
+    pos = 0;
+    offset = 0;
+    type = BLOCK_CANONICAL;
+
+    while (BLOCK_END != type)
+    {
+        pos += GetBlockHeader(in + pos, inLen - pos, &type, &rawLen,
+            &codedLen);
+
+        if (BLOCK_END == type)
+        {
+            break;
+        }
+
+        job.type = type;
+        job.raw = out + offset;
+        job.rawLen = rawLen;
+        job.coded = in + pos;
+        job.codedLen = codedLen;
+
+        if (BLOCK_STORED == type)
+        {
+            memcpy(job.raw, job.coded, job.rawLen);
+        }
+
+        DecodeBlock(&job);
+
+        if (0 != job.status)
+        {
+            status = -1;
+            break;
+        }
+
+        COUNT_BLOCK(&job, 0);
+        pos += codedLen;
+        offset += rawLen;
+    }
+
+    munmap(in, inLen);
+
+    if (0 != UnmapOutputFile(out, outLen, outLen, fd))
+    {
+        status = -1;
+    }
+
+    return status;
+#else
+    FILE *inFile, *outFile;
+
+    if (0 != OpenNamedFiles(inName, outName, &inFile, &outFile))
+    {
+        return -1;
+    }
+
+    return CloseNamedFiles(inFile, outFile,
+        CanonicalDecodeStreamParallelLimit(inFile, outFile, 1, maxSize));
+#endif
+}
+
+/****************************************************************************
+*   Function   : EncodeBlocks
+*   Description: This function reads a file one block at a time, and
+*                writes out each block encoded with a canonical code
+*                optimized for that block.  Up to numThreads blocks are
+*                encoded at once.
+*   Parameters : inFile - Open file pointer for file to encode
+*                outFile - Open file pointer for file receiving encoded data
+*                numThreads - number of threads to encode with
+*                order1 - 1 if BLOCK_ORDER1 should also be tried
+*                index - pointer to the index that an entry is added to for
+*                        each block written (NULL for no index)
+*   Effects    : File is Huffman encoded and index is filled in.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int EncodeBlocks(FILE *inFile, FILE *outFile, const int numThreads,
+    const int order1, block_index_t *index)
+{
+    block_pool_t pool;
+    block_job_t *current, *next, *swap;
+    int numCurrent, numNext, status, endOfFile;
+
+    /* validate input and output files */
+    if ((NULL == inFile) || (NULL == outFile))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (0 != CreatePool(&pool, numThreads, 1))
+    {
+        return -1;
+    }
+
+    pool.order1 = order1;
+
+    /* with two batches, next is read while current is encoded */
+    current = pool.jobs;
+    next = pool.jobs + (pool.numSlots - pool.batchSize);
+    status = 0;
+    endOfFile = 0;
+
+    numCurrent = ReadRawBlocks(inFile, current, pool.batchSize, &endOfFile);
+    StartBatch(&pool, current, numCurrent);
+
+    while (numCurrent > 0)
+    {
+        numNext = 0;
+
+        if ((next != current) && !endOfFile)
+        {
+            numNext = ReadRawBlocks(inFile, next, pool.batchSize,
+                &endOfFile);
+        }
+
+        FinishBatch(&pool);
+
+        if (next != current)
+        {
+            /* encode the next batch while this one is written */
+            StartBatch(&pool, next, numNext);
+        }
+
+        if (0 != WriteCodedBlocks(outFile, current, numCurrent, index))
+        {
+            status = -1;
+            break;
+        }
+
+        if ((next == current) && !endOfFile)
+        {
+            numNext = ReadRawBlocks(inFile, current, pool.batchSize,
+                &endOfFile);
+            StartBatch(&pool, current, numNext);
+        }
+
+        swap = current;
+        current = next;
+        next = swap;
+        numCurrent = numNext;
+    }
+
+    /* a batch may still be running if a write failed */
+    FinishBatch(&pool);
+
+    if ((0 == status) && ferror(inFile))
+    {
+        status = -1;
+    }
+
+    if ((0 == status) && (NULL != index) &&
+        (0 != AddIndexEntry(index, 0, 0)))
+    {
+        status = -1;
+    }
+
+    if ((0 == status) && (0 != WriteBlockHeader(outFile, BLOCK_END, 0, 0)))
+    {
+        status = -1;
+    }
+
+    DestroyPool(&pool);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : CreatePool
+*   Description: This function allocates the buffers for batches of
+*                blocks and starts the threads that will code them.  A
+*                batch has a block for each thread.  If there will be
+*                worker threads, buffers are allocated for two batches.
+*   Parameters : pool - pointer to the pool being created
+*                numThreads - number of threads to code blocks with
+*                encode - 1 if the blocks will be encoded, 0 if they'll be
+*                         decoded
+*   Effects    : Memory is allocated and threads are started.  If
+*                HUFFMAN_NO_THREADS is defined, or numThreads is less than
+*                2, blocks will be coded one at a time by StartBatch.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int CreatePool(block_pool_t *pool, int numThreads, const int encode)
+{
+    int i, numJobs;
+    size_t codedCap;
+
+#ifdef HUFFMAN_NO_THREADS
+    numThreads = 1;
+#endif
+
+    if (numThreads < 1)
+    {
+        numThreads = 1;
+    }
+
+    pool->numSlots = 0;
+    pool->batchSize = numThreads;
+    pool->batch = NULL;
+    pool->numJobs = 0;
+    pool->encode = encode;
+    pool->order1 = 0;
+#ifndef HUFFMAN_NO_THREADS
+    pool->numThreads = 0;
+    pool->threads = NULL;
+    pool->numQueued = 0;
+    pool->nextJob = 0;
+    pool->pending = 0;
+    pool->quit = 0;
+#endif
+    numJobs = (numThreads < 2) ? numThreads : 2 * numThreads;
+    pool->jobs = (block_job_t *)malloc(numJobs * sizeof(block_job_t));
+
+    if (NULL == pool->jobs)
+    {
+        perror("Allocating Block Buffers");
+        return -1;
+    }
+
+    codedCap = CanonicalInterleavedBound(BLOCK_SIZE);
+
+    for (i = 0; i < numJobs; i++)
+    {
+        pool->jobs[i].raw = (byte_t *)malloc(BLOCK_SIZE);
+        pool->jobs[i].coded = (byte_t *)malloc(codedCap);
+        pool->numSlots++;
+
+        if ((NULL == pool->jobs[i].raw) || (NULL == pool->jobs[i].coded))
+        {
+            perror("Allocating Block Buffers");
+            DestroyPool(pool);
+            return -1;
+        }
+    }
+
+#ifndef HUFFMAN_NO_THREADS
+    if (numThreads < 2)
+    {
+        /* the caller's thread does all the work */
+        return 0;
+    }
+
+    pool->threads = (pthread_t *)malloc(numThreads * sizeof(pthread_t));
+
+    if (NULL == pool->threads)
+    {
+        perror("Allocating Threads");
+        DestroyPool(pool);
+        return -1;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    for (i = 0; i < numThreads; i++)
+    {
+        if (0 != pthread_create(&pool->threads[i], NULL, WorkerThread, pool))
+        {
+            break;
+        }
+
+        pool->numThreads++;
+    }
+
+    if (0 == pool->numThreads)
+    {
+        /* couldn't start any threads; do the work ourselves */
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->start);
+        pthread_cond_destroy(&pool->done);
+        free(pool->threads);
+        pool->threads = NULL;
+    }
+#endif
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : DestroyPool
+*   Description: This function stops the threads started by CreatePool and
+*                frees the memory it allocated.
+*   Parameters : pool - pointer to the pool being destroyed
+*   Effects    : Threads are stopped and memory is freed.
+*   Returned   : None
+****************************************************************************/
+static void DestroyPool(block_pool_t *pool)
+{
+    int i;
+
+#ifndef HUFFMAN_NO_THREADS
+    if (pool->numThreads > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->quit = 1;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+
+        for (i = 0; i < pool->numThreads; i++)
+        {
+            pthread_join(pool->threads[i], NULL);
+        }
+
+        pthread_mutex_destroy(&pool->lock);
+        pthread_cond_destroy(&pool->start);
+        pthread_cond_destroy(&pool->done);
+        pool->numThreads = 0;
+    }
+
+    free(pool->threads);
+    pool->threads = NULL;
+#endif
+
+    for (i = 0; i < pool->numSlots; i++)
+    {
+        free(pool->jobs[i].raw);
+        free(pool->jobs[i].coded);
+    }
+
+    free(pool->jobs);
+    pool->jobs = NULL;
+}
+
+/****************************************************************************
+*   Function   : StartBatch
+*   Description: This function starts coding a batch of blocks.  Without
+*                worker threads, the batch is coded before this function
+*                returns.
+*   Parameters : pool - pointer to the pool that will code the batch
+*                batch - pointer to the jobs in the batch
+*                numJobs - number of jobs in the batch
+*   Effects    : The batch is handed to the worker threads, or coded.
+*                FinishBatch must be called before another batch is
+*                started.
+*   Returned   : None
+****************************************************************************/
+static void StartBatch(block_pool_t *pool, block_job_t *batch,
+    const int numJobs)
+{
+    int i;
+
+    pool->batch = batch;
+    pool->numJobs = numJobs;
+
+#ifndef HUFFMAN_NO_THREADS
+    if (pool->numThreads > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+        pool->numQueued = numJobs;
+        pool->nextJob = 0;
+        pool->pending = numJobs;
+        pthread_cond_broadcast(&pool->start);
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+#endif
+
+    for (i = 0; i < numJobs; i++)
+    {
+        CodeBlock(pool, &batch[i]);
+    }
+}
+
+/****************************************************************************
+*   Function   : FinishBatch
+*   Description: This function waits for the batch started by StartBatch
+*                to be coded.
+*   Parameters : pool - pointer to the pool coding the batch
+*   Effects    : Every job in the batch is coded and has its status set.
+*   Returned   : None
+****************************************************************************/
+static void FinishBatch(block_pool_t *pool)
+{
+#ifndef HUFFMAN_NO_THREADS
+    if (pool->numThreads > 0)
+    {
+        pthread_mutex_lock(&pool->lock);
+
+        while (pool->pending > 0)
+        {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+    }
+#else
+    (void)pool;
+#endif
+}
+
+/****************************************************************************
+*   Function   : ReadRawBlocks
+*   Description: This function reads a batch of blocks to be encoded.
+*   Parameters : fp - pointer to the open file being encoded
+*                jobs - pointer to the jobs receiving the blocks
+*                maxJobs - largest number of blocks to read
+*                endOfFile - pointer to a flag set once the end of the
+*                            file (or an error) is reached
+*   Effects    : Up to maxJobs blocks are read into jobs.  Every block but
+*                the last one in the file is BLOCK_SIZE bytes.
+*   Returned   : The number of blocks read.
+****************************************************************************/
+static int ReadRawBlocks(FILE *fp, block_job_t *jobs, const int maxJobs,
+    int *endOfFile)
+{
+    int numJobs;
+
+    for (numJobs = 0; numJobs < maxJobs; numJobs++)
+    {
+        jobs[numJobs].rawLen = fread(jobs[numJobs].raw, 1, BLOCK_SIZE, fp);
+
+        if (jobs[numJobs].rawLen != BLOCK_SIZE)
+        {
+            /* end of file (or an error) */
+            *endOfFile = 1;
+
+            if (jobs[numJobs].rawLen != 0)
+            {
+                numJobs++;
+            }
+
+            break;
+        }
+    }
+
+    return numJobs;
+}
+
+/****************************************************************************
+*   Function   : ReadCodedBlocks
+*   Description: This function reads a batch of encoded blocks, stopping
+*                at BLOCK_END.
+*   Parameters : fp - pointer to the open file being decoded
+*                jobs - pointer to the jobs receiving the blocks
+*                maxJobs - largest number of blocks to read
+*                maxSize - most bytes that all of the blocks may decode to
+*                decoded - pointer to the number of bytes that the blocks
+*                          read so far decode to
+*                endOfFile - pointer to a flag set once BLOCK_END is read
+*   Effects    : Up to maxJobs blocks are read into jobs, and their decoded
+*                sizes are added to decoded.  The data of a BLOCK_STORED
+*                block is read straight into its decoded data.
+*   Returned   : The number of blocks read, or -1 if a block couldn't be
+*                read or would decode past maxSize.  errno will be set in
+*                the event of a failure.
+****************************************************************************/
+static int ReadCodedBlocks(FILE *fp, block_job_t *jobs, const int maxJobs,
+    const unsigned long maxSize, unsigned long *decoded, int *endOfFile)
+{
+    block_job_t *job;
+    unsigned long rawLen, codedLen;
+    int numJobs, type;
+
+    for (numJobs = 0; numJobs < maxJobs; numJobs++)
+    {
+        if (0 != ReadBlockHeader(fp, &type, &rawLen, &codedLen))
+        {
+            return -1;
+        }
+
+        if (BLOCK_END == type)
+        {
+            *endOfFile = 1;
+            break;
+        }
+
+        if (rawLen > maxSize - *decoded)
+        {
+            fprintf(stderr, "error: decoded data is larger than %lu bytes.\n",
+                maxSize);
+            errno = ERANGE;
+            return -1;
+        }
+
+        *decoded += rawLen;
+        job = &jobs[numJobs];
+        job->type = type;
+        job->rawLen = rawLen;
+        job->codedLen = codedLen;
+
+        /* stored blocks are read straight into the decoded data */
+        if (fread((BLOCK_STORED == type) ? job->raw : job->coded,
+            1, job->codedLen, fp) != job->codedLen)
+        {
+            fprintf(stderr, "error: truncated block.\n");
+            errno = EILSEQ;
+            return -1;
+        }
+    }
+
+    return numJobs;
+}
+
+/****************************************************************************
+*   Function   : WriteCodedBlocks
+*   Description: This function writes out a batch of encoded blocks in the
+*                order they were read.
+*   Parameters : fp - pointer to the open file receiving the blocks
+*                jobs - pointer to the encoded jobs
+*                numJobs - number of jobs to write
+*                index - pointer to the index that an entry is added to for
+*                        each block written (NULL for no index)
+*   Effects    : The blocks are written to fp and added to index.
+*   Returned   : 0 for success, -1 for failure (including a block that
+*                couldn't be encoded).  errno will be set in the event of a
+*                failure.
+****************************************************************************/
+static int WriteCodedBlocks(FILE *fp, const block_job_t *jobs,
+    const int numJobs, block_index_t *index)
+{
+    const block_job_t *job;
+    int i;
+
+    for (i = 0; i < numJobs; i++)
+    {
+        job = &jobs[i];
+
+        if (0 != job->status)
+        {
+            errno = job->error;
+            return -1;
+        }
+
+        if (((NULL != index) &&
+            (0 != AddIndexEntry(index, job->rawLen, job->codedLen))) ||
+            (0 != WriteBlockHeader(fp, job->type,
+            job->rawLen, job->codedLen)) ||
+            (fwrite((BLOCK_STORED == job->type) ? job->raw : job->coded,
+            1, job->codedLen, fp) != job->codedLen))
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : WriteRawBlocks
+*   Description: This function writes out a batch of decoded blocks in the
+*                order they were read.
+*   Parameters : fp - pointer to the open file receiving the blocks
+*                jobs - pointer to the decoded jobs
+*                numJobs - number of jobs to write
+*   Effects    : The decoded blocks are written to fp.
+*   Returned   : 0 for success, -1 for failure (including a block that
+*                couldn't be decoded).  errno will be set in the event of a
+*                failure.
+****************************************************************************/
+static int WriteRawBlocks(FILE *fp, const block_job_t *jobs,
+    const int numJobs)
+{
+    int i;
+
+    for (i = 0; i < numJobs; i++)
+    {
+        if (0 != jobs[i].status)
+        {
+            errno = jobs[i].error;
+            return -1;
+        }
+
+        if (fwrite(jobs[i].raw, 1, jobs[i].rawLen, fp) != jobs[i].rawLen)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/****************************************************************************
+*   Function   : CodeBlock
+*   Description: This function encodes or decodes a single block.
+*   Parameters : pool - pointer to the pool holding the block
+*                job - pointer to the block to be coded
+*   Effects    : The block is coded and its status and error are set.
+*   Returned   : None
+****************************************************************************/
+static void CodeBlock(const block_pool_t *pool, block_job_t *job)
+{
+    if (pool->encode)
+    {
+        EncodeBlock(job, pool->order1);
+    }
+    else
+    {
+        DecodeBlock(job);
+    }
+
+    job->error = errno;
+    COUNT_BLOCK(job, pool->encode);
+}
+
+/****************************************************************************
+*   Function   : EncodeBlock
+*   Description: This function encodes a block as whichever block type is
+*                smallest.  A block of 1 repeated byte is a BLOCK_RUN.
+*                Otherwise the block is Huffman coded, unless the size
+*                computed from its symbol counts and code lengths isn't
+*                smaller than the block, in which case it's stored.  If
+*                order1 is set, the block is also coded as a BLOCK_ORDER1,
+*                which is kept if it's smaller than the other types.
+*   Parameters : job - pointer to the block to be encoded
+*                order1 - 1 if BLOCK_ORDER1 should also be tried
+*   Effects    : The block is encoded and its type, encoded size and status
+*                are set.  The encoded data for a BLOCK_STORED block is
+*                job->raw, so nothing is copied.
+*   Returned   : None
+****************************************************************************/
+static void EncodeBlock(block_job_t *job, const int order1)
+{
+    size_t order1Len;
+
+    job->status = 0;
+
+    if (IsRun(job->raw, job->rawLen))
+    {
+        job->type = BLOCK_RUN;
+        job->coded[0] = job->raw[0];
+        job->codedLen = 1;
+        return;
+    }
+
+    /***********************************************************************
+    * CanonicalEncodeInterleaved fails with ERANGE before it codes anything
+    * if the result won't fit, so blocks that will be stored aren't coded.
+    ***********************************************************************/
+    job->type = BLOCK_COMPACT;
+    job->status = CanonicalEncodeInterleaved(job->raw, job->rawLen,
+        job->coded, job->rawLen - 1, &job->codedLen, 1);
+
+    if ((0 != job->status) && (ERANGE == errno))
+    {
+        job->type = BLOCK_STORED;
+        job->codedLen = job->rawLen;
+        job->status = 0;
+    }
+
+    if (order1 && (0 == job->status))
+    {
+        /* this also fails with ERANGE unless it beats the choice above */
+        if (0 == CanonicalEncodeOrder1(job->raw, job->rawLen, job->coded,
+            job->codedLen - 1, &order1Len))
+        {
+            job->type = BLOCK_ORDER1;
+            job->codedLen = order1Len;
+        }
+        else if (ERANGE != errno)
+        {
+            job->status = -1;
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : DecodeBlock
+*   Description: This function decodes a single block of any type.
+*   Parameters : job - pointer to the block to be decoded.  The data of a
+*                      BLOCK_STORED block must already be in job->raw.
+*   Effects    : The block is decoded into job->raw and its status is set.
+*   Returned   : None
+****************************************************************************/
+static void DecodeBlock(block_job_t *job)
+{
+    size_t decodedLen;
+
+    job->status = 0;
+
+    if (BLOCK_STORED == job->type)
+    {
+        /* nothing to decode */
+    }
+    else if (BLOCK_RUN == job->type)
+    {
+        memset(job->raw, job->coded[0], job->rawLen);
+    }
+    else if (BLOCK_ORDER1 == job->type)
+    {
+        job->status = CanonicalDecodeOrder1(job->coded, job->codedLen,
+            job->raw, job->rawLen);
+    }
+    else if (BLOCK_CANONICAL != job->type)
+    {
+        job->status = CanonicalDecodeInterleaved(job->coded, job->codedLen,
+            job->raw, job->rawLen, (BLOCK_COMPACT == job->type));
+    }
+    else
+    {
+        job->status = CanonicalDecodeBuffer(job->coded, job->codedLen,
+            job->raw, job->rawLen, &decodedLen);
+
+        if ((0 == job->status) && (decodedLen != job->rawLen))
+        {
+            fprintf(stderr, "error: block decoded to the wrong size.\n");
+            errno = EILSEQ;
+            job->status = -1;
+        }
+    }
+}
+
+#ifdef HUFFMAN_STATS
+/****************************************************************************
+*   Function   : CountBlock
+*   Description: This function adds a coded block and its bytes to the
+*                statistics.
+*   Parameters : job - pointer to the block that was coded
+*                encode - 1 if the block was encoded, 0 if it was decoded
+*   Effects    : The statistics for the block are added, if it was coded
+*                successfully.
+*   Returned   : None
+****************************************************************************/
+static void CountBlock(const block_job_t *job, const int encode)
+{
+    if (0 != job->status)
+    {
+        return;
+    }
+
+    STATS_ADD(STAT_BLOCKS, 1);
+
+    /* CanonicalDecodeBuffer counts the bytes of BLOCK_CANONICAL itself */
+    if (BLOCK_CANONICAL != job->type)
+    {
+        STATS_ADD(encode ? STAT_BYTES_IN : STAT_BYTES_OUT, job->rawLen);
+        STATS_ADD(encode ? STAT_BYTES_OUT : STAT_BYTES_IN,
+            BLOCK_HEADER_SIZE + job->codedLen);
+    }
+}
+#endif
+
+#ifndef HUFFMAN_NO_THREADS
+/****************************************************************************
+*   Function   : WorkerThread
+*   Description: This function is run by each thread started by CreatePool.
+*                It codes blocks from the current batch until the pool is
+*                destroyed.
+*   Parameters : arg - pointer to the pool the thread belongs to
+*   Effects    : Blocks are coded as batches are run.
+*   Returned   : NULL
+****************************************************************************/
+static void *WorkerThread(void *arg)
+{
+    block_pool_t *pool;
+    block_job_t *job;
+
+    pool = (block_pool_t *)arg;
+    pthread_mutex_lock(&pool->lock);
+
+    for (;;)
+    {
+        /* wait for a job */
+        while ((!pool->quit) && (pool->nextJob >= pool->numQueued))
+        {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+
+        if (pool->quit)
+        {
+            break;
+        }
+
+        job = &pool->batch[pool->nextJob];
+        pool->nextJob++;
+
+        /* code the block without holding the lock */
+        pthread_mutex_unlock(&pool->lock);
+        CodeBlock(pool, job);
+        pthread_mutex_lock(&pool->lock);
+
+        pool->pending--;
+
+        if (0 == pool->pending)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+#endif
+
+/****************************************************************************
+*   Function   : WriteBlockHeader
+*   Description: This function writes the header that precedes each block
+*                of an encoded stream.
+*   Parameters : fp - pointer to open file to write to
+*                type - type of block
+*                rawLen - number of bytes the block decodes to
+*                codedLen - number of encoded bytes following the header
+*   Effects    : The block header is written to fp.  Only the type is
+*                written for BLOCK_END.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int WriteBlockHeader(FILE *fp, const int type,
+    const unsigned long rawLen, const unsigned long codedLen)
+{
+    size_t len;
+    byte_t header[BLOCK_HEADER_SIZE];
+
+    len = PutBlockHeader(header, type, rawLen, codedLen);
+
+    if (fwrite(header, 1, len, fp) != len)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ReadBlockHeader
+*   Description: This function reads the header written by
+*                WriteBlockHeader.
+*   Parameters : fp - pointer to open file to read from
+*                type - pointer to the type of block read
+*                rawLen - pointer to the number of bytes the block decodes
+*                         to
+*                codedLen - pointer to the number of encoded bytes
+*                           following the header
+*   Effects    : The block header is read from fp.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ReadBlockHeader(FILE *fp, int *type, unsigned long *rawLen,
+    unsigned long *codedLen)
+{
+    int c;
+    size_t len;
+    byte_t header[BLOCK_HEADER_SIZE];
+
+    len = 0;
+
+    if (EOF != (c = getc(fp)))
+    {
+        header[0] = (byte_t)c;
+        len = 1;
+
+        if (BLOCK_END != c)
+        {
+            len += fread(header + 1, 1, BLOCK_HEADER_SIZE - 1, fp);
+        }
+    }
+
+    if (GetBlockHeader(header, len, type, rawLen, codedLen) < 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : PutBlockHeader
+*   Description: This function builds a block header in memory.  The sizes
+*                are written as 32 bits, MSB first.
+*   Parameters : header - pointer to BLOCK_HEADER_SIZE bytes receiving the
+*                         header
+*                type - type of block
+*                rawLen - number of bytes the block decodes to
+*                codedLen - number of encoded bytes following the header
+*   Effects    : The block header is written to header.  Only the type is
+*                written for BLOCK_END.
+*   Returned   : The number of bytes in the header.
+****************************************************************************/
+static size_t PutBlockHeader(byte_t *header, const int type,
+    const unsigned long rawLen, const unsigned long codedLen)
+{
+    int i;
+
+    header[0] = (byte_t)type;
+
+    if (BLOCK_END == type)
+    {
+        return 1;
+    }
+
+    for (i = 0; i < 4; i++)
+    {
+        header[1 + i] = (byte_t)((rawLen >> (24 - 8 * i)) & 0xFF);
+        header[5 + i] = (byte_t)((codedLen >> (24 - 8 * i)) & 0xFF);
+    }
+
+    return BLOCK_HEADER_SIZE;
+}
+
+/****************************************************************************
+*   Function   : GetBlockHeader
+*   Description: This function reads a block header built by
+*                PutBlockHeader, and makes sure that the sizes are ones
+*                that an encoder could have written.
+*   Parameters : header - pointer to the header
+*                len - number of bytes available in header
+*                type - pointer to the type of block read
+*                rawLen - pointer to the number of bytes the block decodes
+*                         to
+*                codedLen - pointer to the number of encoded bytes
+*                           following the header
+*   Effects    : The block header is read from header.
+*   Returned   : The number of bytes in the header, or -1 for failure.
+*                errno will be set in the event of a failure.
+****************************************************************************/
+static int GetBlockHeader(const byte_t *header, const size_t len, int *type,
+    unsigned long *rawLen, unsigned long *codedLen)
+{
+    int i;
+
+    *type = (len > 0) ? header[0] : -1;
+    *rawLen = 0;
+    *codedLen = 0;
+
+    if (BLOCK_END == *type)
+    {
+        return 1;
+    }
+
+    if ((*type >= BLOCK_CANONICAL) && (*type <= BLOCK_ORDER1) &&
+        (len >= BLOCK_HEADER_SIZE))
+    {
+        for (i = 0; i < 4; i++)
+        {
+            *rawLen = (*rawLen << 8) | header[1 + i];
+            *codedLen = (*codedLen << 8) | header[5 + i];
+        }
+
+        if ((*rawLen > 0) && (*rawLen <= BLOCK_SIZE) &&
+            (*codedLen <= CanonicalInterleavedBound(BLOCK_SIZE)) &&
+            ((BLOCK_STORED != *type) || (*codedLen == *rawLen)) &&
+            ((BLOCK_RUN != *type) || (1 == *codedLen)))
+        {
+            return BLOCK_HEADER_SIZE;
+        }
+    }
+
+    fprintf(stderr, "error: malformed block header.\n");
+    errno = EILSEQ;     /* Illegal byte sequence seems reasonable */
+    return -1;
+}
+
+/****************************************************************************
+*   Function   : AddIndexEntry
+*   Description: This function adds an entry for the next block written to
+*                a seekable stream to its index.
+*   Parameters : index - pointer to the index being built
+*                rawLen - number of bytes the block decodes to (0 for
+*                         BLOCK_END)
+*                codedLen - number of encoded bytes following the block
+*                           header (0 for BLOCK_END)
+*   Effects    : An entry is added to the index, which grows if it's full.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int AddIndexEntry(block_index_t *index, const unsigned long rawLen,
+    const unsigned long codedLen)
+{
+    index_entry_t *entries;
+
+    if (index->numEntries == index->capacity)
+    {
+        /* the entry count is written as 4 bytes */
+        if (index->capacity > (0xFFFFFFFFUL - INDEX_GROWTH))
+        {
+            errno = ERANGE;
+            return -1;
+        }
+
+        entries = (index_entry_t *)realloc(index->entries,
+            (index->capacity + INDEX_GROWTH) * sizeof(index_entry_t));
+
+        if (NULL == entries)
+        {
+            perror("Allocating Block Index");
+            return -1;
+        }
+
+        index->entries = entries;
+        index->capacity += INDEX_GROWTH;
+    }
+
+    if ((rawLen > ULONG_MAX - index->rawOffset) ||
+        (BLOCK_HEADER_SIZE + codedLen > ULONG_MAX - index->codedOffset))
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    index->entries[index->numEntries].rawOffset = index->rawOffset;
+    index->entries[index->numEntries].codedOffset = index->codedOffset;
+    index->numEntries++;
+    index->rawOffset += rawLen;
+    index->codedOffset += BLOCK_HEADER_SIZE + codedLen;
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : WriteIndex
+*   Description: This function writes the index of a seekable stream and
+*                the footer that follows it.
+*   Parameters : fp - pointer to open file to write to
+*                index - pointer to the index
+*   Effects    : The index and footer are written to fp.
+*   Returned   : 0 for success, -1 for failure.
+****************************************************************************/
+static int WriteIndex(FILE *fp, const block_index_t *index)
+{
+    unsigned long i;
+    byte_t entry[INDEX_ENTRY_SIZE];
+
+    for (i = 0; i < index->numEntries; i++)
+    {
+        PutOffset(entry, index->entries[i].rawOffset, 8);
+        PutOffset(entry + 8, index->entries[i].codedOffset, 8);
+
+        if (fwrite(entry, 1, INDEX_ENTRY_SIZE, fp) != INDEX_ENTRY_SIZE)
+        {
+            return -1;
+        }
+    }
+
+    PutOffset(entry, index->numEntries, 4);
+    memcpy(entry + 4, indexMagic, sizeof(indexMagic));
+
+    if (fwrite(entry, 1, INDEX_FOOTER_SIZE, fp) != INDEX_FOOTER_SIZE)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : ReadIndexEntry
+*   Description: This function reads one entry from the index of a
+*                seekable stream.
+*   Parameters : fp - pointer to open file to read from
+*                indexPos - position of the index in fp
+*                n - number of the entry to read
+*                entry - pointer to the entry read
+*   Effects    : fp is moved to the entry and the entry is read.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int ReadIndexEntry(FILE *fp, const long indexPos,
+    const unsigned long n, index_entry_t *entry)
+{
+    byte_t data[INDEX_ENTRY_SIZE];
+
+    if ((0 != fseek(fp, indexPos + (long)(n * INDEX_ENTRY_SIZE), SEEK_SET)) ||
+        (fread(data, 1, INDEX_ENTRY_SIZE, fp) != INDEX_ENTRY_SIZE))
+    {
+        fprintf(stderr, "error: truncated block index.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    /* encoded blocks are all before the index */
+    if ((0 != GetOffset(data, 8, &entry->rawOffset)) ||
+        (0 != GetOffset(data + 8, 8, &entry->codedOffset)) ||
+        (entry->codedOffset >= (unsigned long)indexPos))
+    {
+        fprintf(stderr, "error: malformed block index.\n");
+        errno = EILSEQ;
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : PutOffset
+*   Description: This function writes a value as a given number of bytes,
+*                MSB first.
+*   Parameters : dst - pointer to the size bytes receiving the value
+*                value - the value to write
+*                size - number of bytes to write the value as
+*   Effects    : The value is written to dst.  Bytes beyond the size of an
+*                unsigned long are 0.
+*   Returned   : None
+****************************************************************************/
+static void PutOffset(byte_t *dst, unsigned long value, const int size)
+{
+    int i;
+
+    /* shift a byte at a time, since size may be more than a long holds */
+    for (i = size - 1; i >= 0; i--)
+    {
+        dst[i] = (byte_t)(value & 0xFF);
+        value >>= 8;
+    }
+}
+
+/****************************************************************************
+*   Function   : GetOffset
+*   Description: This function reads a value written by PutOffset.
+*   Parameters : src - pointer to the size bytes holding the value
+*                size - number of bytes the value was written as
+*                value - pointer to the value read
+*   Effects    : The value is read from src.
+*   Returned   : 0 for success, -1 if the value doesn't fit in an unsigned
+*                long.
+****************************************************************************/
+static int GetOffset(const byte_t *src, const int size,
+    unsigned long *value)
+{
+    int i;
+
+    *value = 0;
+
+    for (i = 0; i < size; i++)
+    {
+        if (*value > (ULONG_MAX >> 8))
+        {
+            return -1;
+        }
+
+        *value = (*value << 8) | src[i];
+    }
+
+    return 0;
+}
+
+#ifndef HUFFMAN_NO_MMAP
+/****************************************************************************
+*   Function   : MapInputFile
+*   Description: This function maps a file to be read into memory.
+*   Parameters : name - name of the file to map
+*                data - pointer to the mapped file.  It's NULL for empty
+*                       files, which can't be mapped.
+*                len - pointer to the number of bytes in the file
+*   Effects    : The file is mapped for reading.  The caller must unmap
+*                it with munmap.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int MapInputFile(const char *name, byte_t **data, size_t *len)
+{
+    int fd;
+    struct stat st;
+    void *map;
+
+    *data = NULL;
+    *len = 0;
+
+    if ((fd = open(name, O_RDONLY)) < 0)
+    {
+        perror("Opening Input File");
+        return -1;
+    }
+
+    if (0 != fstat(fd, &st))
+    {
+        perror("Opening Input File");
+        close(fd);
+        return -1;
+    }
+
+    if ((st.st_size < 0) || ((off_t)(size_t)st.st_size != st.st_size))
+    {
+        close(fd);
+        errno = ERANGE;
+        return -1;
+    }
+
+    *len = (size_t)st.st_size;
+
+    if (*len > 0)
+    {
+        map = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (MAP_FAILED == map)
+        {
+            perror("Mapping Input File");
+            close(fd);
+            return -1;
+        }
+
+        /* it's read front to back */
+        posix_madvise(map, *len, POSIX_MADV_SEQUENTIAL);
+        *data = (byte_t *)map;
+    }
+
+    close(fd);          /* the mapping stays valid */
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : MapOutputFile
+*   Description: This function creates a file of a given size and maps it
+*                into memory to be written.
+*   Parameters : name - name of the file to create
+*                len - number of bytes to size the file to
+*                data - pointer to the mapped file.  It's NULL if len is 0.
+*                fd - pointer to the open file descriptor of the file
+*   Effects    : The file is created (or truncated) and mapped.  The
+*                caller must unmap it with UnmapOutputFile.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int MapOutputFile(const char *name, const size_t len, byte_t **data,
+    int *fd)
+{
+    void *map;
+
+    *data = NULL;
+
+    if ((off_t)len < 0)
+    {
+        errno = ERANGE;
+        return -1;
+    }
+
+    if ((*fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0666)) < 0)
+    {
+        perror("Opening Output File");
+        return -1;
+    }
+
+    if (0 != ftruncate(*fd, (off_t)len))
+    {
+        perror("Sizing Output File");
+        close(*fd);
+        return -1;
+    }
+
+    if (len > 0)
+    {
+        map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+
+        if (MAP_FAILED == map)
+        {
+            perror("Mapping Output File");
+            close(*fd);
+            return -1;
+        }
+
+        *data = (byte_t *)map;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : UnmapOutputFile
+*   Description: This function unmaps a file mapped by MapOutputFile, and
+*                trims it to the number of bytes actually written.
+*   Parameters : data - pointer to the mapped file (may be NULL)
+*                mappedLen - number of bytes mapped
+*                len - number of bytes to keep
+*                fd - the open file descriptor of the file
+*   Effects    : The file is unmapped, trimmed and closed.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int UnmapOutputFile(byte_t *data, const size_t mappedLen,
+    const size_t len, int fd)
+{
+    int status;
+
+    status = 0;
+
+    if ((NULL != data) && (0 != munmap(data, mappedLen)))
+    {
+        status = -1;
+    }
+
+    if ((len != mappedLen) && (0 != ftruncate(fd, (off_t)len)))
+    {
+        status = -1;
+    }
+
+    if (0 != close(fd))
+    {
+        status = -1;
+    }
+
+    return status;
+}
+#else
+/****************************************************************************
+*   Function   : OpenNamedFiles
+*   Description: This function opens a pair of files to be coded with a
+*                function that takes open files.  It's used in place of
+*                memory mapping when HUFFMAN_NO_MMAP is defined.
+*   Parameters : inName - name of the file to read
+*                outName - name of the file to write
+*                inFile - pointer to the opened input file
+*                outFile - pointer to the opened output file
+*   Effects    : The files are opened.  Neither is left open on failure.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
+****************************************************************************/
+static int OpenNamedFiles(const char *inName, const char *outName,
+    FILE **inFile, FILE **outFile)
+{
+    if ((NULL == inName) || (NULL == outName))
+    {
+        errno = ENOENT;
+        return -1;
+    }
+
+    if (NULL == (*inFile = fopen(inName, "rb")))
+    {
+        perror("Opening Input File");
+        return -1;
+    }
+
+    if (NULL == (*outFile = fopen(outName, "wb")))
+    {
+        perror("Opening Output File");
+        fclose(*inFile);
+        return -1;
+    }
+
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CloseNamedFiles
+*   Description: This function closes a pair of files opened by
+*                OpenNamedFiles once they've been coded.
+*   Parameters : inFile - the input file
+*                outFile - the output file
+*                status - value returned by the function that coded them
+*   Effects    : The files are closed.
+*   Returned   : status, or -1 if the output file couldn't be closed.
+*                errno will be set in the event of a failure.
+****************************************************************************/
+static int CloseNamedFiles(FILE *inFile, FILE *outFile, int status)
+{
+    fclose(inFile);
+
+    if ((0 != fclose(outFile)) && (0 == status))
+    {
+        status = -1;
+    }
+
+    return status;
+}
+#endif
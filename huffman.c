@@ -35,11 +35,51 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#ifndef HUFFMAN_NO_THREADS
+#include <pthread.h>
+#endif
 #include "huflocal.h"
 #include "huffman.h"
 #include "bitarray/bitarray.h"
 #include "bitfile/bitfile.h"
 
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/***************************************************************************
+* The decoder walks the tree DECODE_STEP_BITS bits at a time.  Every
+* composite node is a state, and each state has a table entry for every
+* possible group of bits, giving the state the bits lead to and the
+* symbols found along the way.
+***************************************************************************/
+#define DECODE_STEP_BITS    4
+#define DECODE_STEPS        (1 << DECODE_STEP_BITS)
+#define NUM_STATES          (NUM_CHARS - 1)     /* most composite nodes */
+
+#define DECODE_BUFFER_SIZE  4096    /* decoded bytes written at once */
+
+/***************************************************************************
+* Files are encoded a chunk at a time.  Each pass reads a batch of chunks,
+* one for each thread, then counts or encodes every chunk of the batch on
+* its own thread.  The encoded chunks are written out in order, each
+* starting at the bit where the last one ended.
+***************************************************************************/
+#define CHUNK_SIZE          (1UL << 20)
+
+/* longest code kept in an unsigned long, so it can be written at once */
+#define FAST_CODE_LEN       ((sizeof(unsigned long) - 1) * CHAR_BIT)
+
+/***************************************************************************
+* A header that starts with the symbol COMPACT_HEADER and a count of 0
+* (which the original header never contains) is a compact header.  It is
+* followed by the number of symbols less 1, then the symbols (as a list of
+* values, or a bitmap if that is shorter), then the count of each symbol
+* in order of value.  Counts are written 7 bits at a time, least
+* significant first, with the high bit set in every byte but the last.
+***************************************************************************/
+#define COMPACT_HEADER      0xFF
+#define SYMBOL_BITMAP_SIZE  ((UCHAR_MAX + 1) / CHAR_BIT)
+
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
@@ -49,9 +89,38 @@ typedef struct code_list_t
     bit_array_t *code;  /* code used for symbol (left justified) */
 } code_list_t;
 
-/***************************************************************************
-*                                CONSTANTS
-***************************************************************************/
+/* a code, ready to be written to a chunk */
+typedef struct chunk_code_t
+{
+    unsigned long bits;         /* code (right justified) if it's short */
+    unsigned int codeLen;       /* number of bits in code */
+    const byte_t *code;         /* code (left justified) if it's long */
+} chunk_code_t;
+
+/* a chunk of a file being encoded, and its counts or encoded bits */
+typedef struct chunk_job_t
+{
+    byte_t *raw;                /* chunk of the input file */
+    size_t rawLen;              /* number of bytes in raw */
+    count_t counts[NUM_CHARS];  /* symbols in raw (counting pass) */
+    const chunk_code_t *codes;  /* codes for raw (NULL when counting) */
+    byte_t *coded;              /* raw encoded with codes */
+    unsigned long codedBits;    /* number of bits in coded */
+    int status;                 /* 0 if the chunk was coded, otherwise -1 */
+    int error;                  /* errno if the chunk couldn't be coded */
+#ifndef HUFFMAN_NO_THREADS
+    pthread_t thread;           /* thread coding the chunk */
+    int started;                /* 1 if thread was started */
+#endif
+} chunk_job_t;
+
+/* result of walking the tree from a state with DECODE_STEP_BITS bits */
+typedef struct decode_step_t
+{
+    short next;                         /* state reached after the bits */
+    short numSymbols;                   /* number of symbols found */
+    short symbol[DECODE_STEP_BITS];     /* symbols found, in order */
+} decode_step_t;
 
 /***************************************************************************
 *                                 MACROS
@@ -65,11 +134,29 @@ typedef struct code_list_t
 *                               PROTOTYPES
 ***************************************************************************/
 /* creates look up table from tree */
-static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList);
+static int MakeCodeList(const huffman_tree_t *tree, code_list_t *codeList);
+
+/* encoding with either kind of header */
+static int EncodeFile(FILE *inFile, FILE *outFile, const int compact,
+    int numThreads);
+
+/* coding a file a chunk at a time */
+static int ReadChunks(FILE *fp, chunk_job_t *jobs, const int numJobs);
+static void RunChunks(chunk_job_t *jobs, const int numJobs);
+static void CodeChunk(chunk_job_t *job);
+static void EncodeChunk(chunk_job_t *job);
+#ifndef HUFFMAN_NO_THREADS
+static void *ChunkThread(void *arg);
+#endif
 
 /* reading/writing tree to file */
-static void WriteHeader(huffman_node_t *ht, bit_file_t *bfp);
-static int ReadHeader(huffman_node_t **ht, bit_file_t *bfp);
+static void WriteHeader(const huffman_tree_t *tree, bit_file_t *bfp);
+static void WriteCompactHeader(const huffman_tree_t *tree, bit_file_t *bfp);
+static int ReadHeader(huffman_tree_t *tree, bit_file_t *bfp);
+static int ReadCompactHeader(huffman_tree_t *tree, bit_file_t *bfp);
+
+/* decoding a group of bits at a time */
+static void BuildDecodeSteps(const huffman_tree_t *tree, decode_step_t *steps);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -89,10 +176,87 @@ static int ReadHeader(huffman_node_t **ht, bit_file_t *bfp);
 ****************************************************************************/
 int HuffmanEncodeFile(FILE *inFile, FILE *outFile)
 {
-    huffman_node_t *huffmanTree;        /* root of huffman tree */
+    return EncodeFile(inFile, outFile, 0, 1);
+}
+
+/****************************************************************************
+*   Function   : HuffmanEncodeFileCompact
+*   Description: This routine does the same thing as HuffmanEncodeFile,
+*                but writes a compact header.  The header only takes a few
+*                bytes more than the number of symbols in the file, which
+*                matters for small files.  HuffmanDecodeFile decodes files
+*                with either header.
+*   Parameters : inFile - Open file pointer for file to encode (must be
+*                         rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int HuffmanEncodeFileCompact(FILE *inFile, FILE *outFile)
+{
+    return EncodeFile(inFile, outFile, 1, 1);
+}
+
+/****************************************************************************
+*   Function   : HuffmanEncodeFileParallel
+*   Description: This routine does the same thing as HuffmanEncodeFile (or
+*                HuffmanEncodeFileCompact), but counts and encodes
+*                numThreads chunks of the file at once.  The output is
+*                identical no matter how many threads are used.
+*   Parameters : inFile - Open file pointer for file to encode (must be
+*                         rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*                compact - 1 to write a compact header, 0 to write the
+*                          original header
+*                numThreads - number of threads to encode with.  Values
+*                             less than 2 encode in the caller's thread.
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+int HuffmanEncodeFileParallel(FILE *inFile, FILE *outFile, int compact,
+    int numThreads)
+{
+    return EncodeFile(inFile, outFile, compact, numThreads);
+}
+
+/****************************************************************************
+*   Function   : EncodeFile
+*   Description: This routine genrates a huffman tree optimized for a file
+*                and writes out an encoded version of that file.  The file
+*                is read a batch of chunks at a time, and the chunks of a
+*                batch are counted, then encoded, by up to numThreads
+*                threads.
+*   Parameters : inFile - Open file pointer for file to encode (must be
+*                         rewindable).
+*                outFile - Open file pointer for file receiving encoded data
+*                compact - 1 to write a compact header, 0 to write the
+*                          original header
+*                numThreads - largest number of chunks coded at once
+*   Effects    : File is Huffman encoded
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.  Either way, inFile and outFile will
+*                be left open.
+****************************************************************************/
+static int EncodeFile(FILE *inFile, FILE *outFile, const int compact,
+    int numThreads)
+{
+    huffman_tree_t huffmanTree;         /* huffman tree */
     code_list_t codeList[NUM_CHARS];    /* table for quick encode */
+    chunk_code_t codes[NUM_CHARS];      /* codes written to chunks */
+    count_t counts[NUM_CHARS];          /* symbols in the file */
+    chunk_job_t *jobs;
     bit_file_t *bOutFile;
-    int c;
+    int c, i, numJobs, status;
+    unsigned int bit, maxLen;
+    size_t codedCap;
+#ifdef HUFFMAN_STATS
+    double timer, bits;
+    long outPos;
+#endif
 
     /* validate input and output files */
     if ((NULL == inFile) || (NULL == outFile))
@@ -101,57 +265,230 @@ int HuffmanEncodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
-    bOutFile = MakeBitFile(outFile, BF_WRITE);
+#ifdef HUFFMAN_NO_THREADS
+    numThreads = 1;
+#endif
 
-    if (NULL == bOutFile)
+    if (numThreads < 1)
     {
-        perror("Making Output File a BitFile");
-        return -1;
+        numThreads = 1;
     }
 
-    /* build tree */
-    if ((huffmanTree = GenerateTreeFromFile(inFile)) == NULL)
+    STATS_TELL(outPos, outFile);
+
+    jobs = (chunk_job_t *)malloc(numThreads * sizeof(chunk_job_t));
+
+    if (NULL == jobs)
     {
-        outFile = BitFileToFILE(bOutFile);
+        perror("Allocating Chunks");
         return -1;
     }
 
-    /* build a list of codes for each symbol */
+    status = 0;
+
+    for (i = 0; i < numThreads; i++)
+    {
+        jobs[i].raw = (byte_t *)malloc(CHUNK_SIZE);
+        jobs[i].coded = NULL;
+        jobs[i].codes = NULL;
+
+        if (NULL == jobs[i].raw)
+        {
+            perror("Allocating Chunks");
+            status = -1;
+        }
+    }
+
+    bOutFile = NULL;
 
-    /* initialize code list */
     for (c = 0; c < NUM_CHARS; c++)
     {
+        counts[c] = 0;
         codeList[c].code = NULL;
         codeList[c].codeLen = 0;
     }
 
-    if (0 != MakeCodeList(huffmanTree, codeList))
+    /* count the symbols in each batch, and add up the counts */
+    while ((0 == status) &&
+        ((numJobs = ReadChunks(inFile, jobs, numThreads)) > 0))
     {
-        outFile = BitFileToFILE(bOutFile);
-        return -1;
+        RunChunks(jobs, numJobs);
+
+        for (i = 0; (i < numJobs) && (0 == status); i++)
+        {
+            if (0 != jobs[i].status)
+            {
+                errno = jobs[i].error;
+                status = -1;
+                break;
+            }
+
+            for (c = 0; c < EOF_CHAR; c++)
+            {
+                if (counts[c] > COUNT_T_MAX - jobs[i].counts[c])
+                {
+                    fprintf(stderr,
+                        "Input contains too many 0x%02X to count.\n", c);
+                    errno = ERANGE;
+                    status = -1;
+                    break;
+                }
+
+                counts[c] += jobs[i].counts[c];
+            }
+        }
+    }
+
+    if ((0 == status) && ferror(inFile))
+    {
+        status = -1;
+    }
+
+    /* build tree and a list of codes for each symbol */
+    if (0 == status)
+    {
+        STATS_START(timer);
+        GenerateTreeFromCounts(counts, 1, &huffmanTree);
+        status = MakeCodeList(&huffmanTree, codeList);
+        STATS_STOP(STAT_TREE_NS, timer);
+        STATS_ADD(STAT_TABLE_BUILDS, 1);
+    }
+
+#ifdef HUFFMAN_STATS
+    if (0 == status)
+    {
+        for (c = 0, bits = 0; c < NUM_CHARS; c++)
+        {
+            counts[c] = huffmanTree.nodes[c].count;
+            bits += (double)counts[c] * codeList[c].codeLen;
+        }
+
+        StatsAddCode(counts, bits);
+    }
+#endif
+
+    /* make the codes ready to be written to chunks */
+    maxLen = 0;
+
+    for (c = 0; (c < NUM_CHARS) && (0 == status); c++)
+    {
+        codes[c].bits = 0;
+        codes[c].codeLen = codeList[c].codeLen;
+        codes[c].code = (byte_t *)BitArrayGetBits(codeList[c].code);
+
+        if (codes[c].codeLen <= FAST_CODE_LEN)
+        {
+            for (bit = 0; bit < codes[c].codeLen; bit++)
+            {
+                codes[c].bits = (codes[c].bits << 1) |
+                    BitArrayTestBit(codeList[c].code, bit);
+            }
+        }
+
+        if (codes[c].codeLen > maxLen)
+        {
+            maxLen = codes[c].codeLen;
+        }
+    }
+
+    /* a chunk's codes can't take more than maxLen bits per symbol */
+    codedCap = (CHUNK_SIZE / CHAR_BIT) * maxLen + 1;
+
+    for (i = 0; (i < numThreads) && (0 == status); i++)
+    {
+        jobs[i].codes = codes;
+        jobs[i].coded = (byte_t *)malloc(codedCap);
+
+        if (NULL == jobs[i].coded)
+        {
+            perror("Allocating Chunks");
+            status = -1;
+        }
+    }
+
+    if (0 == status)
+    {
+        bOutFile = MakeBitFile(outFile, BF_WRITE);
+
+        if (NULL == bOutFile)
+        {
+            perror("Making Output File a BitFile");
+            status = -1;
+        }
+        else if (EOF == BitFileSetBuffer(bOutFile, BF_BUFFER_SIZE))
+        {
+            perror("Buffering Output File");
+            status = -1;
+        }
     }
 
     /* write out encoded file */
+    if (0 == status)
+    {
+        /* write header for rebuilding of tree */
+        STATS_START(timer);
+
+        if (compact)
+        {
+            WriteCompactHeader(&huffmanTree, bOutFile);
+        }
+        else
+        {
+            WriteHeader(&huffmanTree, bOutFile);
+        }
 
-    /* write header for rebuilding of tree */
-    WriteHeader(huffmanTree, bOutFile);
+        STATS_STOP(STAT_HEADER_NS, timer);
 
-    /* read characters from file and write them to encoded file */
-    rewind(inFile);         /* start another pass on the input file */
+        /* encode each batch, and write the chunks one after another */
+        rewind(inFile);         /* start another pass on the input file */
+    }
 
-    while((c = fgetc(inFile)) != EOF)
+    while ((0 == status) &&
+        ((numJobs = ReadChunks(inFile, jobs, numThreads)) > 0))
     {
-        BitFilePutBits(bOutFile,
-            BitArrayGetBits(codeList[c].code),
-            codeList[c].codeLen);
+        RunChunks(jobs, numJobs);
+
+        for (i = 0; (i < numJobs) && (0 == status); i++)
+        {
+            if (0 != jobs[i].status)
+            {
+                errno = jobs[i].error;
+                status = -1;
+            }
+            else if (EOF == BitFilePutBits(bOutFile, jobs[i].coded,
+                jobs[i].codedBits))
+            {
+                status = -1;
+            }
+        }
     }
 
-    /* now write EOF */
-    BitFilePutBits(bOutFile,
-        BitArrayGetBits(codeList[EOF_CHAR].code),
-        codeList[EOF_CHAR].codeLen);
+    if ((0 == status) && ferror(inFile))
+    {
+        status = -1;
+    }
 
-    /* free the code list */
+    if (0 == status)
+    {
+        /* now write EOF */
+        if (EOF == BitFilePutBits(bOutFile,
+            BitArrayGetBits(codeList[EOF_CHAR].code),
+            codeList[EOF_CHAR].codeLen))
+        {
+            status = -1;
+        }
+
+        STATS_ADD_FILE(STAT_BYTES_IN, 0, inFile);
+    }
+
+    /* BitFileToFILE can't report a failed write, so flush the buffer first */
+    if ((0 == status) && (EOF == BitFileFlushOutput(bOutFile, 0)) &&
+        ferror(outFile))
+    {
+        status = -1;    /* EOF alone may only mean there was nothing left */
+    }
+
+    /* free the code list and chunks */
     for (c = 0; c < NUM_CHARS; c++)
     {
         if (codeList[c].code != NULL)
@@ -160,13 +497,214 @@ int HuffmanEncodeFile(FILE *inFile, FILE *outFile)
         }
     }
 
+    for (i = 0; i < numThreads; i++)
+    {
+        free(jobs[i].raw);
+        free(jobs[i].coded);
+    }
+
+    free(jobs);
+
     /* clean up */
-    outFile = BitFileToFILE(bOutFile);          /* make file normal again */
-    FreeHuffmanTree(huffmanTree);               /* free allocated memory */
+    if (NULL != bOutFile)
+    {
+        outFile = BitFileToFILE(bOutFile);      /* make file normal again */
+    }
 
-    return 0;
+    STATS_ADD_FILE(STAT_BYTES_OUT, outPos, outFile);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : ReadChunks
+*   Description: This function reads a batch of chunks of a file.
+*   Parameters : fp - pointer to the open file being read
+*                jobs - pointer to the jobs receiving the chunks
+*                numJobs - largest number of chunks to read
+*   Effects    : Up to numJobs chunks are read into jobs.  Every chunk but
+*                the last one in the file is CHUNK_SIZE bytes.
+*   Returned   : The number of chunks read.
+****************************************************************************/
+static int ReadChunks(FILE *fp, chunk_job_t *jobs, const int numJobs)
+{
+    int i;
+
+    for (i = 0; i < numJobs; i++)
+    {
+        jobs[i].rawLen = fread(jobs[i].raw, 1, CHUNK_SIZE, fp);
+
+        if (jobs[i].rawLen != CHUNK_SIZE)
+        {
+            /* end of file (or an error) */
+            return (0 == jobs[i].rawLen) ? i : i + 1;
+        }
+    }
+
+    return numJobs;
+}
+
+/****************************************************************************
+*   Function   : RunChunks
+*   Description: This function codes a batch of chunks, starting a thread
+*                for every chunk but the first, which is coded by the
+*                caller's thread.
+*   Parameters : jobs - pointer to the jobs in the batch
+*                numJobs - number of jobs in the batch
+*   Effects    : Every chunk in the batch is coded and has its status set.
+*                Chunks whose thread couldn't be started are coded by the
+*                caller's thread.
+*   Returned   : None
+****************************************************************************/
+static void RunChunks(chunk_job_t *jobs, const int numJobs)
+{
+    int i;
+
+#ifndef HUFFMAN_NO_THREADS
+    for (i = 1; i < numJobs; i++)
+    {
+        jobs[i].started =
+            (0 == pthread_create(&jobs[i].thread, NULL, ChunkThread,
+            &jobs[i]));
+    }
+
+    CodeChunk(&jobs[0]);
+
+    for (i = 1; i < numJobs; i++)
+    {
+        if (jobs[i].started)
+        {
+            pthread_join(jobs[i].thread, NULL);
+        }
+        else
+        {
+            CodeChunk(&jobs[i]);
+        }
+    }
+#else
+    for (i = 0; i < numJobs; i++)
+    {
+        CodeChunk(&jobs[i]);
+    }
+#endif
 }
 
+/****************************************************************************
+*   Function   : CodeChunk
+*   Description: This function counts the symbols in a chunk, or encodes
+*                it if the job has codes.
+*   Parameters : job - pointer to the chunk to be coded
+*   Effects    : The chunk is counted or encoded and its status and error
+*                are set.
+*   Returned   : None
+****************************************************************************/
+static void CodeChunk(chunk_job_t *job)
+{
+    job->status = 0;
+    job->error = 0;
+
+    if (NULL == job->codes)
+    {
+        job->status = CountSymbols(job->raw, job->rawLen, job->counts);
+        job->error = errno;
+    }
+    else
+    {
+        EncodeChunk(job);
+    }
+}
+
+/****************************************************************************
+*   Function   : EncodeChunk
+*   Description: This function encodes a chunk into memory.  Codes of up
+*                to FAST_CODE_LEN bits are added to an accumulator at once,
+*                and longer codes are added from their bit arrays a byte
+*                at a time.  Whole bytes are stored as soon as they're
+*                complete.
+*   Parameters : job - pointer to the chunk to be encoded.  job->coded must
+*                      have room for the codes of every symbol in the chunk.
+*   Effects    : The chunk is encoded MSB first into job->coded, and the
+*                number of bits is stored in job->codedBits.  Bits after
+*                the last code are 0.
+*   Returned   : None
+****************************************************************************/
+static void EncodeChunk(chunk_job_t *job)
+{
+    size_t i, pos;
+    unsigned long accum;
+    unsigned int count, bit, len;
+    const chunk_code_t *code;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+    pos = 0;
+    accum = 0;
+    count = 0;
+
+    for (i = 0; i < job->rawLen; i++)
+    {
+        code = &job->codes[job->raw[i]];
+
+        if (code->codeLen <= FAST_CODE_LEN)
+        {
+            /* count is less than CHAR_BIT, so the code fits */
+            accum = (accum << code->codeLen) | code->bits;
+            count += code->codeLen;
+        }
+        else
+        {
+            /* add long codes CHAR_BIT bits at a time */
+            for (bit = 0; bit < code->codeLen; bit += len)
+            {
+                len = code->codeLen - bit;
+                len = (len < CHAR_BIT) ? len : CHAR_BIT;
+                accum = (accum << len) |
+                    (code->code[bit / CHAR_BIT] >> (CHAR_BIT - len));
+                count += len;
+
+                while (count >= CHAR_BIT)
+                {
+                    count -= CHAR_BIT;
+                    job->coded[pos++] = (byte_t)(accum >> count);
+                }
+            }
+        }
+
+        while (count >= CHAR_BIT)
+        {
+            count -= CHAR_BIT;
+            job->coded[pos++] = (byte_t)(accum >> count);
+        }
+    }
+
+    job->codedBits = (unsigned long)pos * CHAR_BIT + count;
+
+    if (count > 0)
+    {
+        /* left justify the last bits */
+        job->coded[pos] = (byte_t)(accum << (CHAR_BIT - count));
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+}
+
+#ifndef HUFFMAN_NO_THREADS
+/****************************************************************************
+*   Function   : ChunkThread
+*   Description: This function is run by each thread started by RunChunks.
+*   Parameters : arg - pointer to the chunk to be coded
+*   Effects    : The chunk is coded.
+*   Returned   : NULL
+****************************************************************************/
+static void *ChunkThread(void *arg)
+{
+    CodeChunk((chunk_job_t *)arg);
+    return NULL;
+}
+#endif
+
+
 /****************************************************************************
 *   Function   : HuffmanDecodeFile
 *   Description: This routine reads a Huffman coded file and writes out a
@@ -175,16 +713,24 @@ int HuffmanEncodeFile(FILE *inFile, FILE *outFile)
 *                outFile - Open file pointer for file receiving decoded data
 *   Effects    : Huffman encoded file is decoded
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
-*                event of a failure.  Either way, inFile and outFile will
-*                be left open.
+*                event of a failure (EILSEQ if the file is malformed or
+*                truncated).  Either way, inFile and outFile will be left
+*                open.
 ****************************************************************************/
 int HuffmanDecodeFile(FILE *inFile, FILE *outFile)
 {
-    huffman_node_t *huffmanArray[NUM_CHARS];    /* array of all leaves */
-    huffman_node_t *huffmanTree;
-    huffman_node_t *currentNode;
-    int i, c;
+    huffman_tree_t huffmanTree;         /* huffman tree */
+    decode_step_t *steps;               /* DECODE_STEPS for each state */
+    const decode_step_t *step;
+    int root, state;
+    int c, i, shift, done, status;
+    size_t numDecoded;
+    byte_t decoded[DECODE_BUFFER_SIZE];     /* symbols not yet written */
     bit_file_t *bInFile;
+#ifdef HUFFMAN_STATS
+    double timer;
+    long inPos, outPos;
+#endif
 
     /* validate input and output files */
     if ((NULL == inFile) || (NULL == outFile))
@@ -193,6 +739,9 @@ int HuffmanDecodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
+    STATS_TELL(inPos, inFile);
+    STATS_TELL(outPos, outFile);
+
     bInFile = MakeBitFile(inFile, BF_READ);
 
     if (NULL == bInFile)
@@ -201,76 +750,119 @@ int HuffmanDecodeFile(FILE *inFile, FILE *outFile)
         return -1;
     }
 
-    /* allocate array of leaves for all possible characters */
-    for (i = 0; i < NUM_CHARS; i++)
+    if (EOF == BitFileSetBuffer(bInFile, BF_BUFFER_SIZE))
     {
-        if ((huffmanArray[i] = AllocHuffmanNode(i)) == NULL)
-        {
-            /* allocation failed clear existing allocations */
-            for (i--; i >= 0; i--)
-            {
-                free(huffmanArray[i]);
-            }
-
-            inFile = BitFileToFILE(bInFile);
-            return -1;
-        }
+        perror("Buffering Input File");
+        inFile = BitFileToFILE(bInFile);
+        return -1;
     }
 
     /* populate leaves with frequency information from file header */
-    if (0 != ReadHeader(huffmanArray, bInFile))
-    {
-        for (i = 0; i < NUM_CHARS; i++)
-        {
-            free(huffmanArray[i]);
-        }
+    InitHuffmanTree(&huffmanTree);
+    STATS_START(timer);
 
+    if (0 != ReadHeader(&huffmanTree, bInFile))
+    {
         inFile = BitFileToFILE(bInFile);
         return -1;
     }
 
-    /* put array of leaves into a huffman tree */
-    if ((huffmanTree = BuildHuffmanTree(huffmanArray, NUM_CHARS)) == NULL)
+    STATS_STOP(STAT_HEADER_NS, timer);
+
+    /* put leaves into a huffman tree */
+    STATS_START(timer);
+    root = BuildHuffmanTree(&huffmanTree);
+
+    /* now we should have a tree that matches the tree used on the encode */
+    if (huffmanTree.nodes[root].value != COMPOSITE_NODE)
     {
-        FreeHuffmanTree(huffmanTree);
+        /* EOF is the only symbol, and its code has no bits */
         inFile = BitFileToFILE(bInFile);
-        return -1;
+        return 0;
     }
 
-    /* now we should have a tree that matches the tree used on the encode */
-    currentNode = huffmanTree;
+    /* flatten the tree into a table of DECODE_STEP_BITS bit steps */
+    steps = (decode_step_t *)malloc(NUM_STATES * DECODE_STEPS *
+        sizeof(decode_step_t));
 
-    while ((c = BitFileGetBit(bInFile)) != EOF)
+    if (NULL == steps)
     {
-        /* traverse the tree finding matches for our characters */
-        if (c != 0)
-        {
-            currentNode = currentNode->right;
-        }
-        else
+        perror("Allocating Decode Table");
+        inFile = BitFileToFILE(bInFile);
+        return -1;
+    }
+
+    BuildDecodeSteps(&huffmanTree, steps);
+    STATS_STOP(STAT_TREE_NS, timer);
+    STATS_ADD(STAT_TABLE_BUILDS, 1);
+    state = root - NUM_CHARS;
+    done = 0;
+    status = 0;
+    numDecoded = 0;
+    STATS_START(timer);
+
+    /* the header is a whole number of bytes, so the codes start on one */
+    while ((!done) && ((c = BitFileGetChar(bInFile)) != EOF))
+    {
+        for (shift = 8 - DECODE_STEP_BITS; (shift >= 0) && (!done);
+            shift -= DECODE_STEP_BITS)
         {
-            currentNode = currentNode->left;
+            step = &steps[(state * DECODE_STEPS) +
+                ((c >> shift) & (DECODE_STEPS - 1))];
+
+            for (i = 0; i < step->numSymbols; i++)
+            {
+                if (EOF_CHAR == step->symbol[i])
+                {
+                    /* we've just read the EOF */
+                    done = 1;
+                    break;
+                }
+
+                decoded[numDecoded] = (byte_t)step->symbol[i];
+                numDecoded++;
+            }
+
+            state = step->next;
         }
 
-        if (currentNode->value != COMPOSITE_NODE)
+        if (numDecoded > DECODE_BUFFER_SIZE - CHAR_BIT)
         {
-            /* we've found a character */
-            if (currentNode->value == EOF_CHAR)
+            /* write out characters before a byte's worth can overflow */
+            if (fwrite(decoded, 1, numDecoded, outFile) != numDecoded)
             {
-                /* we've just read the EOF */
+                status = -1;
                 break;
             }
 
-            fputc(currentNode->value, outFile); /* write out character */
-            currentNode = huffmanTree;          /* back to top of tree */
+            numDecoded = 0;
         }
     }
 
+    if ((0 == status) &&
+        (fwrite(decoded, 1, numDecoded, outFile) != numDecoded))
+    {
+        status = -1;
+    }
+
+    STATS_STOP(STAT_CODING_NS, timer);
+
     /* clean up */
+    free(steps);
     inFile = BitFileToFILE(bInFile);            /* make file normal again */
-    FreeHuffmanTree(huffmanTree);     /* free allocated memory */
 
-    return 0;
+    STATS_ADD_FILE(STAT_BYTES_IN, inPos, inFile);
+    STATS_ADD_FILE(STAT_BYTES_OUT, outPos, outFile);
+
+    if ((0 == status) && !done)
+    {
+        /* the data ran out before the EOF symbol */
+        fprintf(stderr, "error: truncated input file.\n");
+        errno = EILSEQ;
+        status = -1;
+    }
+
+    return status;
 }
 
 /****************************************************************************
@@ -287,8 +879,9 @@ int HuffmanDecodeFile(FILE *inFile, FILE *outFile)
 ****************************************************************************/
 int HuffmanShowTree(FILE *inFile, FILE *outFile)
 {
-    huffman_node_t *huffmanTree;        /* root of huffman tree */
-    huffman_node_t *htp;                /* pointer into tree */
+    huffman_tree_t huffmanTree;         /* huffman tree */
+    huffman_node_t *nodes;
+    int htp;                            /* index of node in tree */
     char code[NUM_CHARS - 1];           /* 1s and 0s in character's code */
     int depth = 0;                      /* depth of tree */
 
@@ -300,7 +893,7 @@ int HuffmanShowTree(FILE *inFile, FILE *outFile)
     }
 
     /* build tree */
-    if ((huffmanTree = GenerateTreeFromFile(inFile)) == NULL)
+    if (0 != GenerateTreeFromFile(inFile, &huffmanTree))
     {
         return -1;
     }
@@ -310,18 +903,19 @@ int HuffmanShowTree(FILE *inFile, FILE *outFile)
     fprintf(outFile, "Char  Count      Encoding\n");
     fprintf(outFile, "----- ---------- ----------------\n");
 
-    htp = huffmanTree;
+    nodes = huffmanTree.nodes;
+    htp = huffmanTree.root;
     for(;;)
     {
         /* follow this branch all the way left */
-        while (htp->left != NULL)
+        while (nodes[htp].left != NONE)
         {
             code[depth] = '0';
-            htp = htp->left;
+            htp = nodes[htp].left;
             depth++;
         }
 
-        if (htp->value != COMPOSITE_NODE)
+        if (nodes[htp].value != COMPOSITE_NODE)
         {
             /* handle the case of a single symbol code */
             if (depth == 0)
@@ -333,45 +927,42 @@ int HuffmanShowTree(FILE *inFile, FILE *outFile)
             /* we hit a character node, print its code */
             code[depth] = '\0';
 
-            if (htp->value != EOF_CHAR)
+            if (nodes[htp].value != EOF_CHAR)
             {
                 fprintf(outFile, "0x%02X  %10d %s\n",
-                    htp->value, htp->count, code);
+                    nodes[htp].value, nodes[htp].count, code);
             }
             else
             {
-                fprintf(outFile, "EOF   %10d %s\n", htp->count, code);
+                fprintf(outFile, "EOF   %10d %s\n", nodes[htp].count, code);
             }
         }
 
-        while (htp->parent != NULL)
+        while (nodes[htp].parent != NONE)
         {
-            if (htp != htp->parent->right)
+            if (htp != nodes[nodes[htp].parent].right)
             {
                 /* try the parent's right */
                 code[depth - 1] = '1';
-                htp = htp->parent->right;
+                htp = nodes[nodes[htp].parent].right;
                 break;
             }
             else
             {
                 /* parent's right tried, go up one level yet */
                 depth--;
-                htp = htp->parent;
+                htp = nodes[htp].parent;
                 code[depth] = '\0';
             }
         }
 
-        if (htp->parent == NULL)
+        if (nodes[htp].parent == NONE)
         {
             /* we're at the top with nowhere to go */
             break;
         }
     }
 
-    /* clean up */
-    FreeHuffmanTree(huffmanTree);     /* free allocated memory */
-
     return 0;
 }
 
@@ -382,14 +973,16 @@ int HuffmanShowTree(FILE *inFile, FILE *outFile)
 *                the encoding process.  Instead of traversing a tree in
 *                search of the code for any symbol, the code maybe found
 *                by accessing codeList[symbol].code.
-*   Parameters : ht - pointer to root of huffman tree
+*   Parameters : tree - pointer to huffman tree
 *                codeList - code list to populate.
 *   Effects    : Code values are filled in for symbols in a code list.
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
 *                event of a failure.
 ****************************************************************************/
-static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
+static int MakeCodeList(const huffman_tree_t *tree, code_list_t *codeList)
 {
+    const huffman_node_t *nodes;
+    int ht;                     /* index of node in tree */
     bit_array_t *code;
     byte_t depth = 0;
 
@@ -400,23 +993,25 @@ static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
     }
 
     BitArrayClearAll(code);
+    nodes = tree->nodes;
+    ht = tree->root;
 
     for(;;)
     {
         /* follow this branch all the way left */
-        while (ht->left != NULL)
+        while (nodes[ht].left != NONE)
         {
             BitArrayShiftLeft(code, 1);
-            ht = ht->left;
+            ht = nodes[ht].left;
             depth++;
         }
 
-        if (ht->value != COMPOSITE_NODE)
+        if (nodes[ht].value != COMPOSITE_NODE)
         {
             /* enter results in list */
-            codeList[ht->value].codeLen = depth;
-            codeList[ht->value].code = BitArrayDuplicate(code);
-            if (codeList[ht->value].code == NULL)
+            codeList[nodes[ht].value].codeLen = depth;
+            codeList[nodes[ht].value].code = BitArrayDuplicate(code);
+            if (codeList[nodes[ht].value].code == NULL)
             {
                 perror("Unable to allocate bit array");
                 BitArrayDestroy(code);
@@ -424,16 +1019,17 @@ static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
             }
 
             /* now left justify code */
-            BitArrayShiftLeft(codeList[ht->value].code, EOF_CHAR - depth);
+            BitArrayShiftLeft(codeList[nodes[ht].value].code,
+                EOF_CHAR - depth);
         }
 
-        while (ht->parent != NULL)
+        while (nodes[ht].parent != NONE)
         {
-            if (ht != ht->parent->right)
+            if (ht != nodes[nodes[ht].parent].right)
             {
                 /* try the parent's right */
                 BitArraySetBit(code, (EOF_CHAR - 1));
-                ht = ht->parent->right;
+                ht = nodes[nodes[ht].parent].right;
                 break;
             }
             else
@@ -441,11 +1037,11 @@ static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
                 /* parent's right tried, go up one level yet */
                 depth--;
                 BitArrayShiftRight(code, 1);
-                ht = ht->parent;
+                ht = nodes[ht].parent;
             }
         }
 
-        if (ht->parent == NULL)
+        if (nodes[ht].parent == NONE)
         {
             /* we're at the top with nowhere to go */
             break;
@@ -456,6 +1052,70 @@ static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
     return 0;
 }
 
+/****************************************************************************
+*   Function   : BuildDecodeSteps
+*   Description: This function flattens a huffman tree into a table that
+*                is indexed by state and the next DECODE_STEP_BITS bits of
+*                encoded data.  Each composite node is a state; the state
+*                of the composite node stored at nodes[n] is n - NUM_CHARS.
+*   Parameters : tree - pointer to a huffman tree whose root is a composite
+*                       node
+*                steps - pointer to DECODE_STEPS entries for each state
+*   Effects    : Each entry is set to the symbols found by walking the tree
+*                from its state with its bits (returning to the root after
+*                each symbol), and the state the walk ends in.  Bits after
+*                an EOF are ignored.
+*   Returned   : None
+****************************************************************************/
+static void BuildDecodeSteps(const huffman_tree_t *tree, decode_step_t *steps)
+{
+    const huffman_node_t *nodes;
+    decode_step_t *step;
+    int node, current, bits, bit;
+
+    nodes = tree->nodes;
+
+    /* composite nodes are stored after the leaves */
+    for (node = NUM_CHARS; node < tree->numNodes; node++)
+    {
+        for (bits = 0; bits < DECODE_STEPS; bits++)
+        {
+            step = &steps[((node - NUM_CHARS) * DECODE_STEPS) + bits];
+            step->numSymbols = 0;
+            current = node;
+
+            for (bit = DECODE_STEP_BITS - 1; bit >= 0; bit--)
+            {
+                if ((bits >> bit) & 1)
+                {
+                    current = nodes[current].right;
+                }
+                else
+                {
+                    current = nodes[current].left;
+                }
+
+                if (nodes[current].value != COMPOSITE_NODE)
+                {
+                    /* found a symbol, the next one starts at the root */
+                    step->symbol[step->numSymbols] = nodes[current].value;
+                    step->numSymbols++;
+
+                    if (EOF_CHAR == nodes[current].value)
+                    {
+                        current = tree->root;
+                        break;
+                    }
+
+                    current = tree->root;
+                }
+            }
+
+            step->next = current - NUM_CHARS;
+        }
+    }
+}
+
 /****************************************************************************
 *   Function   : WriteHeader
 *   Description: This function writes the each symbol contained in a tree
@@ -463,46 +1123,52 @@ static int MakeCodeList(huffman_node_t *ht, code_list_t *codeList)
 *                to the specified output file.  If the same algorithm that
 *                produced the original tree is used with these counts, an
 *                exact copy of the tree will be produced.
-*   Parameters : ht - pointer to root of huffman tree
+*   Parameters : tree - pointer to huffman tree
 *                bfp - pointer to open binary file to write to.
 *   Effects    : Symbol values and symbol counts are written to a file.
 *   Returned   : None
 ****************************************************************************/
-static void WriteHeader(huffman_node_t *ht, bit_file_t *bfp)
+static void WriteHeader(const huffman_tree_t *tree, bit_file_t *bfp)
 {
+    const huffman_node_t *nodes;
+    int ht;                     /* index of node in tree */
     unsigned int i;
 
+    nodes = tree->nodes;
+    ht = tree->root;
+
     for(;;)
     {
         /* follow this branch all the way left */
-        while (ht->left != NULL)
+        while (nodes[ht].left != NONE)
         {
-            ht = ht->left;
+            ht = nodes[ht].left;
         }
 
-        if ((ht->value != COMPOSITE_NODE) &&
-            (ht->value != EOF_CHAR))
+        if ((nodes[ht].value != COMPOSITE_NODE) &&
+            (nodes[ht].value != EOF_CHAR))
         {
             /* write symbol and count to header */
-            BitFilePutChar(ht->value, bfp);
-            BitFilePutBits(bfp, (void *)&(ht->count), 8 * sizeof(count_t));
+            BitFilePutChar(nodes[ht].value, bfp);
+            BitFilePutBits(bfp, (void *)&(nodes[ht].count),
+                8 * sizeof(count_t));
         }
 
-        while (ht->parent != NULL)
+        while (nodes[ht].parent != NONE)
         {
-            if (ht != ht->parent->right)
+            if (ht != nodes[nodes[ht].parent].right)
             {
-                ht = ht->parent->right;
+                ht = nodes[nodes[ht].parent].right;
                 break;
             }
             else
             {
                 /* parent's right tried, go up one level yet */
-                ht = ht->parent;
+                ht = nodes[ht].parent;
             }
         }
 
-        if (ht->parent == NULL)
+        if (nodes[ht].parent == NONE)
         {
             /* we're at the top with nowhere to go */
             break;
@@ -517,27 +1183,124 @@ static void WriteHeader(huffman_node_t *ht, bit_file_t *bfp)
     }
 }
 
+/****************************************************************************
+*   Function   : WriteCompactHeader
+*   Description: This function writes the symbols contained in a tree and
+*                their number of occurrences in the original file using
+*                the compact header described with COMPACT_HEADER.
+*   Parameters : tree - pointer to huffman tree
+*                bfp - pointer to open binary file to write to.
+*   Effects    : Symbol values and symbol counts are written to a file.
+*   Returned   : None
+****************************************************************************/
+static void WriteCompactHeader(const huffman_tree_t *tree, bit_file_t *bfp)
+{
+    const huffman_node_t *nodes;
+    int c, i, numSymbols;
+    count_t count;
+    byte_t bitmap[SYMBOL_BITMAP_SIZE];
+
+    nodes = tree->nodes;
+    numSymbols = 0;
+
+    for (c = 0; c < SYMBOL_BITMAP_SIZE; c++)
+    {
+        bitmap[c] = 0;
+    }
+
+    for (c = 0; c < EOF_CHAR; c++)
+    {
+        if (nodes[c].count > 0)
+        {
+            bitmap[c / CHAR_BIT] |= (1 << (c % CHAR_BIT));
+            numSymbols++;
+        }
+    }
+
+    if (0 == numSymbols)
+    {
+        /* the original header is just an end of table marker */
+        WriteHeader(tree, bfp);
+        return;
+    }
+
+    /* symbol COMPACT_HEADER with a count of 0 marks a compact header */
+    BitFilePutChar(COMPACT_HEADER, bfp);
+
+    for (i = 0; i < (int)sizeof(count_t); i++)
+    {
+        BitFilePutChar(0, bfp);
+    }
+
+    BitFilePutChar(numSymbols - 1, bfp);
+
+    /* write symbol values */
+    if (numSymbols < SYMBOL_BITMAP_SIZE)
+    {
+        for (c = 0; c < EOF_CHAR; c++)
+        {
+            if (nodes[c].count > 0)
+            {
+                BitFilePutChar(c, bfp);
+            }
+        }
+    }
+    else
+    {
+        for (c = 0; c < SYMBOL_BITMAP_SIZE; c++)
+        {
+            BitFilePutChar(bitmap[c], bfp);
+        }
+    }
+
+    /* write counts 7 bits at a time */
+    for (c = 0; c < EOF_CHAR; c++)
+    {
+        count = nodes[c].count;
+
+        if (0 == count)
+        {
+            continue;
+        }
+
+        while (count > 0x7F)
+        {
+            BitFilePutChar((int)(count & 0x7F) | 0x80, bfp);
+            count >>= 7;
+        }
+
+        BitFilePutChar((int)count, bfp);
+    }
+}
+
 /****************************************************************************
 *   Function   : ReadHeader
 *   Description: This function reads the header information stored by
 *                WriteHeader.  If the same algorithm that produced the
 *                original tree is used with these counts, an exact copy of
 *                the tree will be produced.
-*   Parameters : ht - pointer to array of pointers to tree leaves
+*                Encoders never write a symbol twice or with a count of 0,
+*                so headers that do are rejected.
+*   Parameters : tree - pointer to tree whose leaves receive the counts
 *                inFile - file to read from
-*   Effects    : Frequency information is read into the node of ht
+*   Effects    : Frequency information is read into the leaves of tree
 *   Returned   : 0 for success, -1 for failure.  errno will be set in the
 *                event of a failure.
 ****************************************************************************/
-static int ReadHeader(huffman_node_t **ht, bit_file_t *bfp)
+static int ReadHeader(huffman_tree_t *tree, bit_file_t *bfp)
 {
     count_t count;
-    int c;
+    int c, first;
     int status = -1;        /* in case of premature EOF */
 
+    first = 1;
+
     while ((c = BitFileGetChar(bfp)) != EOF)
     {
-        BitFileGetBits(bfp, (void *)(&count), 8 * sizeof(count_t));
+        if (EOF == BitFileGetBits(bfp, (void *)(&count), 8 * sizeof(count_t)))
+        {
+            break;      /* the count was cut short */
+        }
 
         if ((count == 0) && (c == 0))
         {
@@ -546,20 +1309,127 @@ static int ReadHeader(huffman_node_t **ht, bit_file_t *bfp)
             break;
         }
 
-        ht[c]->count = count;
-        ht[c]->ignore = 0;
+        if ((count == 0) && (c == COMPACT_HEADER) && first)
+        {
+            /* the rest of the header is compact */
+            status = ReadCompactHeader(tree, bfp);
+            break;
+        }
+
+        if ((count == 0) || (!tree->nodes[c].ignore))
+        {
+            break;      /* malformed */
+        }
+
+        tree->nodes[c].count = count;
+        tree->nodes[c].ignore = 0;
+        first = 0;
     }
 
     /* add assumed EOF */
-    ht[EOF_CHAR]->count = 1;
-    ht[EOF_CHAR]->ignore = 0;
+    tree->nodes[EOF_CHAR].count = 1;
+    tree->nodes[EOF_CHAR].ignore = 0;
 
     if (0 != status)
     {
-        /* we hit EOF before we read a full header */
+        /* we hit EOF before we read a full header, or it's malformed */
         fprintf(stderr, "error: malformed file header.\n");
         errno = EILSEQ;     /* Illegal byte sequence seems reasonable */
     }
 
     return status;
 }
+
+/****************************************************************************
+*   Function   : ReadCompactHeader
+*   Description: This function reads the part of a compact header written
+*                by WriteCompactHeader that follows the COMPACT_HEADER
+*                marker.
+*   Parameters : tree - pointer to tree whose leaves receive the counts
+*                bfp - file to read from
+*   Effects    : Frequency information is read into the leaves of tree
+*   Returned   : 0 for success, -1 if the header is malformed.
+****************************************************************************/
+static int ReadCompactHeader(huffman_tree_t *tree, bit_file_t *bfp)
+{
+    int c, i, numSymbols, shift, bits;
+    count_t count;
+    byte_t bitmap[SYMBOL_BITMAP_SIZE];
+
+    if ((numSymbols = BitFileGetChar(bfp)) == EOF)
+    {
+        return -1;
+    }
+
+    numSymbols++;
+
+    /* read symbol values */
+    for (c = 0; c < SYMBOL_BITMAP_SIZE; c++)
+    {
+        bitmap[c] = 0;
+    }
+
+    if (numSymbols < SYMBOL_BITMAP_SIZE)
+    {
+        for (i = 0; i < numSymbols; i++)
+        {
+            if ((c = BitFileGetChar(bfp)) == EOF)
+            {
+                return -1;
+            }
+
+            bitmap[c / CHAR_BIT] |= (1 << (c % CHAR_BIT));
+        }
+    }
+    else
+    {
+        for (c = 0; c < SYMBOL_BITMAP_SIZE; c++)
+        {
+            if ((bits = BitFileGetChar(bfp)) == EOF)
+            {
+                return -1;
+            }
+
+            bitmap[c] = (byte_t)bits;
+        }
+    }
+
+    /* read counts 7 bits at a time */
+    for (c = 0; c < EOF_CHAR; c++)
+    {
+        if (0 == (bitmap[c / CHAR_BIT] & (1 << (c % CHAR_BIT))))
+        {
+            continue;
+        }
+
+        count = 0;
+        shift = 0;
+
+        do
+        {
+            if ((bits = BitFileGetChar(bfp)) == EOF)
+            {
+                return -1;
+            }
+
+            if ((shift > 28) || ((28 == shift) && ((bits & 0x7F) > 0x0F)))
+            {
+                /* more bits than a 32 bit count_t holds */
+                return -1;
+            }
+
+            count |= (count_t)(bits & 0x7F) << shift;
+            shift += 7;
+        } while (bits & 0x80);
+
+        if (0 == count)
+        {
+            return -1;
+        }
+
+        tree->nodes[c].count = count;
+        tree->nodes[c].ignore = 0;
+    }
+
+    return 0;
+}
@@ -33,9 +33,50 @@
 #ifndef _HUFFMAN_H_
 #define _HUFFMAN_H_
 
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <stdio.h>
+
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+#define CANONICAL_TABLE_BOUND   326     /* most bytes in a saved table */
+
+/***************************************************************************
+*                            TYPE DEFINITIONS
+***************************************************************************/
+/* canonical code trained on sample data (contents are private) */
+typedef struct canonical_table_t canonical_table_t;
+
+/* trained tables that may be used for decoding (contents are private) */
+typedef struct canonical_cache_t canonical_cache_t;
+
+/* working state kept between messages (contents are private) */
+typedef struct huffman_encoder_t huffman_encoder_t;
+typedef struct huffman_decoder_t huffman_decoder_t;
+
+/***************************************************************************
+* Totals for every call since the last HuffmanResetStats, collected when the
+* library is built with HUFFMAN_STATS.  Times are summed over all threads.
+* The code lengths and entropy are for the symbols each code was built
+* from, so their ratio shows how close the codes come to the entropy.
+***************************************************************************/
+typedef struct huffman_stats_t
+{
+    double bytesIn;             /* bytes read by the coders */
+    double bytesOut;            /* bytes written by the coders */
+    unsigned long blocks;       /* blocks coded by the block coders */
+    unsigned long tableBuilds;  /* codes and decoders built */
+    unsigned long refills;      /* bit reader refills (memory decoders) */
+    double histogramNs;         /* nanoseconds counting symbols */
+    double treeNs;              /* nanoseconds building codes and decoders */
+    double headerNs;            /* nanoseconds writing and reading headers */
+    double codingNs;            /* nanoseconds in the coding loops */
+    double symbols;             /* symbols the codes were built from */
+    double codedBits;           /* bits the codes take for those symbols */
+    double entropyBits;         /* bits the entropy of the symbols allows */
+} huffman_stats_t;
 
 /***************************************************************************
 *                               PROTOTYPES
@@ -44,11 +85,77 @@
 /* traditional codes */
 int HuffmanShowTree(FILE *inFile, FILE *outFile);       /* dump codes */
 int HuffmanEncodeFile(FILE *inFile, FILE *outFile);     /* encode file */
+int HuffmanEncodeFileCompact(FILE *inFile, FILE *outFile);  /* small header */
+int HuffmanEncodeFileParallel(FILE *inFile, FILE *outFile, int compact,
+    int numThreads);
 int HuffmanDecodeFile(FILE *inFile, FILE *outFile);     /* decode file */
 
 /* canonical code */
 int CanonicalShowTree(FILE *inFile, FILE *outFile);     /* dump codes */
 int CanonicalEncodeFile(FILE *inFile, FILE *outFile);   /* encode file */
 int CanonicalDecodeFile(FILE *inFile, FILE *outFile);   /* decode file */
+int CanonicalDecodeFileLimit(FILE *inFile, FILE *outFile,
+    unsigned long maxSize);
+
+/* canonical code in memory */
+size_t CanonicalEncodeBound(size_t size);       /* largest encoded size */
+int CanonicalEncodeBuffer(const void *src, size_t srcLen, void *dst,
+    size_t dstCap, size_t *outLen);
+int CanonicalDecodeBuffer(const void *src, size_t srcLen, void *dst,
+    size_t dstCap, size_t *outLen);
+int CanonicalDecodedSize(const void *src, size_t srcLen, size_t *size);
+
+/* canonical code in memory, reusing codes from one message to the next */
+huffman_encoder_t *HuffmanCreateEncoder(void);
+void HuffmanFreeEncoder(huffman_encoder_t *encoder);
+int HuffmanEncodeMessage(huffman_encoder_t *encoder, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen);
+
+huffman_decoder_t *HuffmanCreateDecoder(void);
+void HuffmanFreeDecoder(huffman_decoder_t *decoder);
+int HuffmanDecodeMessage(huffman_decoder_t *decoder, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen);
+
+/* canonical code trained on sample data, in place of a header */
+canonical_table_t *CanonicalTrainTable(const void *sample, size_t sampleLen,
+    unsigned long id);
+canonical_table_t *CanonicalLoadTable(const void *src, size_t srcLen);
+int CanonicalSaveTable(const canonical_table_t *table, void *dst,
+    size_t dstCap, size_t *outLen);
+void CanonicalFreeTable(canonical_table_t *table);
+int CanonicalEncodeWithTable(const canonical_table_t *table, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen);
+
+canonical_cache_t *CanonicalCreateCache(void);
+int CanonicalCacheAdd(canonical_cache_t *cache, canonical_table_t *table);
+void CanonicalFreeCache(canonical_cache_t *cache);
+int CanonicalDecodeWithCache(const canonical_cache_t *cache, const void *src,
+    size_t srcLen, void *dst, size_t dstCap, size_t *outLen);
+
+/* canonical code in blocks (input is only read once) */
+int CanonicalEncodeStream(FILE *inFile, FILE *outFile);     /* encode file */
+int CanonicalDecodeStream(FILE *inFile, FILE *outFile);     /* decode file */
+int CanonicalEncodeStreamParallel(FILE *inFile, FILE *outFile,
+    int numThreads);
+int CanonicalDecodeStreamParallel(FILE *inFile, FILE *outFile,
+    int numThreads);
+int CanonicalDecodeStreamParallelLimit(FILE *inFile, FILE *outFile,
+    int numThreads, unsigned long maxSize);
+int CanonicalEncodeStreamOrder1(FILE *inFile, FILE *outFile, int numThreads);
+
+/* canonical code in blocks, with an index for decoding part of the data */
+int CanonicalEncodeSeekable(FILE *inFile, FILE *outFile, int numThreads);
+int CanonicalDecodeRange(FILE *inFile, unsigned long offset, size_t length,
+    void *dst);
+
+/* canonical code in blocks, coded between memory mapped files */
+int CanonicalEncodeMapped(const char *inName, const char *outName);
+int CanonicalDecodeMapped(const char *inName, const char *outName);
+int CanonicalDecodeMappedLimit(const char *inName, const char *outName,
+    unsigned long maxSize);
+
+/* statistics (HuffmanGetStats fails with ENOSYS without HUFFMAN_STATS) */
+int HuffmanGetStats(huffman_stats_t *stats);
+void HuffmanResetStats(void);
 
 #endif /* _HUFFMAN_H_ */
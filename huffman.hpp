@@ -0,0 +1,1504 @@
+/***************************************************************************
+*                    Huffman Library C++ Front End Header
+*
+*   File    : huffman.hpp
+*   Purpose : Provide a header only C++20 canonical Huffman codec that
+*             reads and writes the same container format as
+*             CanonicalEncodeBuffer and CanonicalEncodeFile.  The longest
+*             code and the size of the decode look up table are template
+*             parameters, so the coding loops are specialized for them at
+*             compile time.
+*   Author  : Michael Dipperstein
+*   Date    : October 14, 2026
+*
+****************************************************************************
+*
+* Huffman: An ANSI C Huffman Encoding/Decoding Routine
+* Copyright (C) 2004, 2007, 2014 by
+* Michael Dipperstein (mdipperstein@gmail.com)
+*
+* This file is part of the Huffman library.
+*
+* The Huffman library is free software; you can redistribute it and/or
+* modify it under the terms of the GNU Lesser General Public License as
+* published by the Free Software Foundation; either version 3 of the
+* License, or (at your option) any later version.
+*
+* The Huffman library is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser
+* General Public License for more details.
+*
+* You should have received a copy of the GNU Lesser General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*
+***************************************************************************/
+
+#ifndef _HUFFMAN_HPP_
+#define _HUFFMAN_HPP_
+
+/***************************************************************************
+*                             INCLUDED FILES
+***************************************************************************/
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <system_error>
+
+namespace huffman
+{
+
+namespace detail
+{
+
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+/***************************************************************************
+* These describe the container written by canonical.c, and must match the
+* values there.  Containers start with:
+*   magic (4 bytes)             - 0x89 'H' 'U' 'F'
+*   version (1 byte)            - CONTAINER_VERSION
+*   flags (1 byte)              - CONTAINER_CRC if there's a checksum,
+*                                 CONTAINER_STORED or CONTAINER_RUN if the
+*                                 data isn't coded
+*   decoded size (8 bytes)      - number of symbols encoded, MSB first
+*   lengths size (2 bytes)      - bytes of compact code lengths, MSB first
+* The compact code lengths and the encoded symbols follow, then a CRC-32C of
+* the decoded data (4 bytes, MSB first).  Data that isn't coded has no code
+* lengths.  The decoded bytes follow a CONTAINER_STORED header, and the one
+* byte that they all are follows a CONTAINER_RUN header.
+***************************************************************************/
+inline constexpr int NUM_CHARS = 257;           /* 256 bytes and EOF */
+inline constexpr int EOF_CHAR = NUM_CHARS - 1;
+inline constexpr std::uint8_t CONTAINER_VERSION = 1;
+inline constexpr std::uint8_t CONTAINER_CRC = 0x01;
+inline constexpr std::uint8_t CONTAINER_STORED = 0x02;
+inline constexpr std::uint8_t CONTAINER_RUN = 0x04;
+inline constexpr std::size_t CONTAINER_HEADER_SIZE = 16;
+inline constexpr std::size_t CONTAINER_CRC_SIZE = 4;
+
+/* shorter data is stored, because its code lengths outweigh any savings */
+inline constexpr std::size_t TINY_CONTAINER_SIZE = 32;
+inline constexpr std::uint8_t containerMagic[4] = {0x89, 'H', 'U', 'F'};
+
+/* compact code lengths (see PutCompactLengths in canonical.c) */
+inline constexpr int COMPACT_FIRST_LENGTH = 8;
+inline constexpr int ZERO_RUN_BITS = 5;
+inline constexpr int LITERAL_LENGTH_BITS = 6;
+inline constexpr std::size_t COMPACT_HEADER_BOUND = (NUM_CHARS * 10 + 7) / 8;
+
+inline constexpr std::size_t CONTAINER_BOUND =
+    CONTAINER_HEADER_SIZE + COMPACT_HEADER_BOUND + CONTAINER_CRC_SIZE;
+
+/* width of the bit accumulators used by the coding loops */
+inline constexpr unsigned ACCUM_BITS = 64;
+
+/***************************************************************************
+*                                FUNCTIONS
+***************************************************************************/
+
+/* throw the error that the C library would have put in errno */
+[[noreturn]] inline void Fail(const std::errc error, const char *what)
+{
+    throw std::system_error(std::make_error_code(error), what);
+}
+
+/* CRC-32C (Castagnoli) tables for slicing-by-4, built at compile time */
+constexpr std::array<std::array<std::uint32_t, 256>, 4> MakeCrcTable()
+{
+    std::array<std::array<std::uint32_t, 256>, 4> table{};
+
+    for (std::uint32_t i = 0; i < 256; i++)
+    {
+        std::uint32_t crc = i;
+
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78UL : (crc >> 1);
+        }
+
+        table[0][i] = crc;
+    }
+
+    for (std::uint32_t i = 0; i < 256; i++)
+    {
+        for (int slice = 1; slice < 4; slice++)
+        {
+            table[slice][i] = (table[slice - 1][i] >> 8) ^
+                table[0][table[slice - 1][i] & 0xFF];
+        }
+    }
+
+    return table;
+}
+
+inline constexpr auto crcTable = MakeCrcTable();
+
+/****************************************************************************
+*   Function   : Crc32c
+*   Description: This function adds a buffer to a running CRC-32C.  It
+*                computes the same CRC as Crc32c in huflocal.c.
+*   Parameters : crc - the CRC of all the data before buffer (0 for no
+*                      data)
+*                buffer - pointer to the data to add
+*                size - number of bytes in buffer
+*   Effects    : None
+*   Returned   : The CRC of the data before buffer followed by buffer.
+****************************************************************************/
+inline std::uint32_t Crc32c(std::uint32_t crc, const std::uint8_t *buffer,
+    std::size_t size) noexcept
+{
+    crc = ~crc;
+
+    while (size >= 4)
+    {
+        crc ^= std::uint32_t{buffer[0]} | (std::uint32_t{buffer[1]} << 8) |
+            (std::uint32_t{buffer[2]} << 16) |
+            (std::uint32_t{buffer[3]} << 24);
+        crc = crcTable[3][crc & 0xFF] ^ crcTable[2][(crc >> 8) & 0xFF] ^
+            crcTable[1][(crc >> 16) & 0xFF] ^ crcTable[0][crc >> 24];
+        buffer += 4;
+        size -= 4;
+    }
+
+    while (size > 0)
+    {
+        crc = crcTable[0][(crc ^ *buffer) & 0xFF] ^ (crc >> 8);
+        buffer++;
+        size--;
+    }
+
+    return ~crc;
+}
+
+/****************************************************************************
+*   Function   : BuildCodeLengths
+*   Description: This function computes the depth of each symbol in a
+*                Huffman tree for a set of counts.  Ties are broken the same
+*                way BuildHuffmanTree in huflocal.c breaks them (count, then
+*                level, then slot), so both libraries build the same code.
+*   Parameters : counts - number of occurrences of each byte
+*                lengths - array of NUM_CHARS code lengths to fill
+*   Effects    : lengths[c] is set to the depth of c in the tree, or 0 if c
+*                doesn't occur.  A lone symbol gets a 1 bit code, and EOF
+*                never gets one.
+*   Returned   : None
+****************************************************************************/
+inline void BuildCodeLengths(const std::uint64_t *counts,
+    std::uint8_t *lengths) noexcept
+{
+    std::uint64_t count[2 * NUM_CHARS];     /* count of each node */
+    int level[2 * NUM_CHARS];               /* height of each node */
+    int parent[2 * NUM_CHARS];              /* parent of each node */
+    int depth[2 * NUM_CHARS];               /* depth of each node */
+    int slotNode[NUM_CHARS];                /* node currently in each slot */
+    int heap[NUM_CHARS];                    /* slots still to combine */
+    int heapSize = 0;
+    int numNodes = NUM_CHARS;
+
+    /* a slot is combined first if its node is smaller, lower, or earlier */
+    auto less = [&](const int slot1, const int slot2)
+    {
+        const int node1 = slotNode[slot1];
+        const int node2 = slotNode[slot2];
+
+        if (count[node1] != count[node2])
+        {
+            return count[node1] < count[node2];
+        }
+
+        if (level[node1] != level[node2])
+        {
+            return level[node1] < level[node2];
+        }
+
+        return slot1 < slot2;
+    };
+
+    auto insert = [&](const int slot)
+    {
+        int i = heapSize++;
+
+        while (i > 0)
+        {
+            const int up = (i - 1) / 2;
+
+            if (!less(slot, heap[up]))
+            {
+                break;
+            }
+
+            heap[i] = heap[up];
+            i = up;
+        }
+
+        heap[i] = slot;
+    };
+
+    auto removeMin = [&]()
+    {
+        const int min = heap[0];
+        const int last = heap[--heapSize];
+        int i = 0;
+
+        for (;;)
+        {
+            int child = 2 * i + 1;
+
+            if (child >= heapSize)
+            {
+                break;
+            }
+
+            if ((child + 1 < heapSize) && less(heap[child + 1], heap[child]))
+            {
+                child++;
+            }
+
+            if (!less(heap[child], last))
+            {
+                break;
+            }
+
+            heap[i] = heap[child];
+            i = child;
+        }
+
+        heap[i] = last;
+        return min;
+    };
+
+    for (int i = 0; i < NUM_CHARS; i++)
+    {
+        count[i] = (i < EOF_CHAR) ? counts[i] : 0;
+        level[i] = 0;
+        parent[i] = -1;
+        slotNode[i] = i;
+
+        if (0 != count[i])
+        {
+            insert(i);
+        }
+    }
+
+    /* combine the two smallest nodes until only one is left */
+    while (heapSize > 1)
+    {
+        const int min1 = removeMin();
+        const int min2 = removeMin();
+        const int node = numNodes++;
+
+        count[node] = count[slotNode[min1]] + count[slotNode[min2]];
+        level[node] =
+            std::max(level[slotNode[min1]], level[slotNode[min2]]) + 1;
+        parent[node] = -1;
+        parent[slotNode[min1]] = node;
+        parent[slotNode[min2]] = node;
+
+        /* the composite takes the slot of its first child */
+        slotNode[min1] = node;
+        insert(min1);
+    }
+
+    /* parents are stored after their children, so work down from root */
+    for (int node = numNodes - 1; node >= 0; node--)
+    {
+        depth[node] = (parent[node] < 0) ? 0 : depth[parent[node]] + 1;
+    }
+
+    for (int c = 0; c < NUM_CHARS; c++)
+    {
+        if (0 == count[c])
+        {
+            lengths[c] = 0;
+        }
+        else
+        {
+            /* handle one symbol trees */
+            lengths[c] = static_cast<std::uint8_t>(std::max(depth[c], 1));
+        }
+    }
+}
+
+/****************************************************************************
+*   Function   : LimitCodeLengths
+*   Description: This function shortens codes so that none is longer than
+*                maxLen bits, using the same method as LimitCodeLengths in
+*                canonical.c.  Codes that are too long are cut down to
+*                maxLen bits, then codes are moved to longer lengths until
+*                the lengths satisfy the Kraft inequality again.  Symbols
+*                keep their order by (length, value).
+*   Parameters : lengths - code length of each symbol (0 if it has none)
+*                maxLen - longest code allowed (at most 32)
+*   Effects    : The code lengths are replaced with lengths of at most
+*                maxLen.
+*   Returned   : None
+****************************************************************************/
+inline void LimitCodeLengths(std::uint8_t *lengths, const unsigned maxLen)
+    noexcept
+{
+    int order[NUM_CHARS];                   /* symbols by (length, value) */
+    int next[256];                          /* next order of each length */
+    std::uint64_t lenCount[256] = {};       /* codes of each length */
+    std::uint64_t excess;
+    unsigned length;
+
+    if (*std::max_element(lengths, lengths + NUM_CHARS) <= maxLen)
+    {
+        return;
+    }
+
+    /* counting sort the symbols by length */
+    for (int i = 0; i < NUM_CHARS; i++)
+    {
+        lenCount[lengths[i]]++;
+    }
+
+    next[0] = 0;
+
+    for (length = 1; length < 256; length++)
+    {
+        next[length] = next[length - 1] +
+            static_cast<int>(lenCount[length - 1]);
+    }
+
+    for (int i = 0; i < NUM_CHARS; i++)
+    {
+        order[next[lengths[i]]++] = i;
+    }
+
+    /* every code that's too long becomes a maxLen bit code */
+    for (length = maxLen + 1; length < 256; length++)
+    {
+        lenCount[maxLen] += lenCount[length];
+    }
+
+    /* how far the Kraft sum exceeds 1, in units of 2^-maxLen */
+    excess = 0;
+
+    for (length = 1; length <= maxLen; length++)
+    {
+        excess += lenCount[length] << (maxLen - length);
+    }
+
+    excess -= std::uint64_t{1} << maxLen;
+
+    while (excess > 0)
+    {
+        /* remove one code from the longest length ... */
+        lenCount[maxLen]--;
+
+        /* ... and make room for it by splitting the longest shorter code */
+        for (length = maxLen - 1; length > 0; length--)
+        {
+            if (0 != lenCount[length])
+            {
+                lenCount[length]--;
+                lenCount[length + 1] += 2;
+                break;
+            }
+        }
+
+        excess--;
+    }
+
+    /* hand the new lengths out in the order of the old lengths */
+    length = 1;
+
+    for (int i = static_cast<int>(lenCount[0]); i < NUM_CHARS; i++)
+    {
+        while (0 == lenCount[length])
+        {
+            length++;
+        }
+
+        lengths[order[i]] = static_cast<std::uint8_t>(length);
+        lenCount[length]--;
+    }
+}
+
+/* MSB first bit writer for compact code lengths */
+struct HeaderWriter
+{
+    std::uint8_t *data;
+    std::size_t pos = 0;
+    std::uint32_t accum = 0;
+    unsigned count = 0;
+
+    void Put(const std::uint32_t code, const unsigned bits) noexcept
+    {
+        accum = (accum << bits) | code;
+        count += bits;
+
+        while (count >= 8)
+        {
+            count -= 8;
+            data[pos++] = static_cast<std::uint8_t>(accum >> count);
+        }
+    }
+
+    void Flush() noexcept
+    {
+        if (count > 0)
+        {
+            data[pos++] = static_cast<std::uint8_t>(accum << (8 - count));
+            count = 0;
+        }
+    }
+};
+
+/****************************************************************************
+*   Function   : PutCompactLengths
+*   Description: This function writes the code length of every symbol as
+*                the compact header described in canonical.c.
+*   Parameters : lengths - code length of each symbol (at most 63)
+*                dst - pointer to at least COMPACT_HEADER_BOUND bytes
+*   Effects    : The compact header is written to dst.
+*   Returned   : The number of bytes written to dst.
+****************************************************************************/
+inline std::size_t PutCompactLengths(const std::uint8_t *lengths,
+    std::uint8_t *dst) noexcept
+{
+    HeaderWriter writer{dst};
+    int prev = COMPACT_FIRST_LENGTH;
+    int c = 0;
+
+    while (c < NUM_CHARS)
+    {
+        if (0 == lengths[c])
+        {
+            /* run of symbols that don't occur */
+            int run = 1;
+
+            while ((c + run < NUM_CHARS) && (run < (1 << ZERO_RUN_BITS)) &&
+                (0 == lengths[c + run]))
+            {
+                run++;
+            }
+
+            writer.Put(0x02, 2);
+            writer.Put(run - 1, ZERO_RUN_BITS);
+            c += run;
+            continue;
+        }
+
+        const int diff = lengths[c] - prev;
+
+        if (0 == diff)
+        {
+            writer.Put(0x00, 1);
+        }
+        else if ((1 == diff) || (-1 == diff))
+        {
+            writer.Put(0x06, 3);
+            writer.Put(diff < 0, 1);
+        }
+        else if ((diff >= -3) && (diff <= 3))
+        {
+            writer.Put(0x0E, 4);
+            writer.Put(diff < 0, 1);
+            writer.Put(((diff < 0) ? -diff : diff) - 2, 1);
+        }
+        else
+        {
+            writer.Put(0x0F, 4);
+            writer.Put(lengths[c], LITERAL_LENGTH_BITS);
+        }
+
+        prev = lengths[c];
+        c++;
+    }
+
+    writer.Flush();
+    return writer.pos;
+}
+
+/****************************************************************************
+*   Function   : GetCompactLengths
+*   Description: This function reads a compact header written by
+*                PutCompactLengths.
+*   Parameters : src - pointer to the compact header
+*                len - number of bytes in src
+*                lengths - array of NUM_CHARS code lengths to fill
+*   Effects    : The code length of every symbol is read into lengths.
+*   Returned   : true for success, false if the header is malformed.
+****************************************************************************/
+inline bool GetCompactLengths(const std::uint8_t *src, const std::size_t len,
+    std::uint8_t *lengths) noexcept
+{
+    std::size_t bitPos = 0;
+    int prev = COMPACT_FIRST_LENGTH;
+    int c = 0;
+
+    /* returns the next count bits, or -1 if there aren't that many left */
+    auto get = [&](const unsigned count)
+    {
+        int bits = 0;
+
+        if (bitPos + count > 8 * len)
+        {
+            return -1;
+        }
+
+        for (unsigned i = 0; i < count; i++, bitPos++)
+        {
+            bits = (bits << 1) | ((src[bitPos / 8] >> (7 - bitPos % 8)) & 1);
+        }
+
+        return bits;
+    };
+
+    while (c < NUM_CHARS)
+    {
+        int bits, length;
+
+        if ((bits = get(1)) == 0)
+        {
+            /* same length */
+            length = prev;
+        }
+        else if ((bits < 0) || ((bits = get(1)) == 0))
+        {
+            /* run of symbols that don't occur */
+            int run;
+
+            if ((bits < 0) || ((run = get(ZERO_RUN_BITS)) < 0) ||
+                (run + 1 > NUM_CHARS - c))
+            {
+                return false;
+            }
+
+            for (run++; run > 0; run--, c++)
+            {
+                lengths[c] = 0;
+            }
+
+            continue;
+        }
+        else if ((bits < 0) || ((bits = get(1)) == 0))
+        {
+            /* 1 longer or shorter */
+            if ((bits < 0) || ((bits = get(1)) < 0))
+            {
+                return false;
+            }
+
+            length = bits ? prev - 1 : prev + 1;
+        }
+        else if ((bits < 0) || ((bits = get(1)) == 0))
+        {
+            /* 2 or 3 longer or shorter */
+            if ((bits < 0) || ((bits = get(2)) < 0))
+            {
+                return false;
+            }
+
+            length = 2 + (bits & 0x01);
+            length = (bits & 0x02) ? prev - length : prev + length;
+        }
+        else
+        {
+            length = (bits < 0) ? -1 : get(LITERAL_LENGTH_BITS);
+        }
+
+        if ((length < 1) || (length > 255))
+        {
+            /* out of data, or not the length of a code */
+            return false;
+        }
+
+        lengths[c] = static_cast<std::uint8_t>(length);
+        prev = length;
+        c++;
+    }
+
+    return true;
+}
+
+/* the fixed part of a container header */
+struct Container
+{
+    std::uint8_t flags;
+    std::size_t size;                   /* bytes of decoded data */
+    std::size_t lengthsLen;             /* bytes of compact code lengths */
+};
+
+/****************************************************************************
+*   Function   : GetContainer
+*   Description: This function reads the container header at the start of
+*                a buffer, and makes sure the buffer is big enough to hold
+*                everything the header describes.
+*   Parameters : src - the encoded data
+*   Effects    : None
+*   Returned   : The container information.  std::system_error is thrown
+*                if src doesn't start with a valid container header (which
+*                is the case for data encoded by older versions of the C
+*                library).
+****************************************************************************/
+inline Container GetContainer(const std::span<const std::byte> src)
+{
+    constexpr std::uint8_t uncodedFlags = CONTAINER_STORED | CONTAINER_RUN;
+    const auto *in = reinterpret_cast<const std::uint8_t *>(src.data());
+    Container container;
+    std::uint64_t size = 0;
+
+    if ((src.size() < CONTAINER_HEADER_SIZE) ||
+        (0 != std::memcmp(in, containerMagic, sizeof(containerMagic))) ||
+        (CONTAINER_VERSION != in[4]) ||
+        (in[5] & ~(CONTAINER_CRC | uncodedFlags)) ||
+        (uncodedFlags == (in[5] & uncodedFlags)))
+    {
+        Fail(std::errc::illegal_byte_sequence, "malformed huffman header");
+    }
+
+    container.flags = in[5];
+    container.lengthsLen = (std::size_t{in[14]} << 8) | in[15];
+
+    for (int i = 6; i < 14; i++)
+    {
+        size = (size << 8) | in[i];
+    }
+
+    /* data with code lengths is coded, data without them is stored or a run */
+    if (((0 == container.lengthsLen) != (0 != (container.flags &
+        uncodedFlags))) || (container.lengthsLen > COMPACT_HEADER_BOUND))
+    {
+        Fail(std::errc::illegal_byte_sequence, "malformed huffman header");
+    }
+
+    if (size > SIZE_MAX)
+    {
+        Fail(std::errc::result_out_of_range, "huffman data is too large");
+    }
+
+    container.size = static_cast<std::size_t>(size);
+
+    const std::size_t len = container.lengthsLen +
+        ((container.flags & CONTAINER_CRC) ? CONTAINER_CRC_SIZE : 0);
+
+    if ((len > src.size() - CONTAINER_HEADER_SIZE) ||
+        ((container.flags & CONTAINER_STORED) &&
+        (container.size > src.size() - CONTAINER_HEADER_SIZE - len)) ||
+        ((container.flags & CONTAINER_RUN) &&
+        (src.size() - CONTAINER_HEADER_SIZE - len < 1)))
+    {
+        Fail(std::errc::illegal_byte_sequence, "truncated huffman data");
+    }
+
+    return container;
+}
+
+} /* namespace detail */
+
+/***************************************************************************
+* CanonicalCodec encodes and decodes memory buffers in the container format
+* of CanonicalEncodeBuffer, so data may be encoded by either library and
+* decoded by the other.  The encoder never writes codes longer than
+* MaxCodeLen bits, and the decoder rejects (with std::errc::not_supported)
+* data using longer codes.  The C library writes codes of at most
+* MAX_CODE_LEN (15 by default) bits.  Codes of up to LookupBits bits are
+* decoded with a single table look up.
+*
+* A codec owns its code and decoder tables, which are allocated when it's
+* constructed.  It may be moved, but not copied.  Like the contexts from
+* HuffmanCreateEncoder and HuffmanCreateDecoder, the code and decode table
+* are only rebuilt when a message's code lengths differ from the last
+* message's, and no memory is allocated while coding.  A codec may only be
+* used by one thread at a time.
+*
+* Errors are thrown as std::system_error with the errno value the C library
+* reports (std::errc::result_out_of_range if dst is too small,
+* std::errc::illegal_byte_sequence if src is malformed or its checksum
+* doesn't match).
+***************************************************************************/
+template <unsigned MaxCodeLen = 15, unsigned LookupBits = 11>
+class CanonicalCodec
+{
+    static_assert((MaxCodeLen >= 9) && (MaxCodeLen <= 32),
+        "MaxCodeLen must be between 9 and 32");
+    static_assert((LookupBits >= 1) && (LookupBits <= 16) &&
+        (LookupBits <= MaxCodeLen), "LookupBits must be between 1 and 16, "
+        "and no more than MaxCodeLen");
+
+public:
+    static constexpr unsigned maxCodeLen = MaxCodeLen;
+    static constexpr unsigned lookupBits = LookupBits;
+    static constexpr std::size_t tableSize = std::size_t{1} << LookupBits;
+
+    /* codes added to the encode accumulator between stores */
+    static constexpr unsigned codesPerStore =
+        (detail::ACCUM_BITS - 7) / MaxCodeLen;
+
+    /* symbols that always fit in a refilled decode accumulator */
+    static constexpr unsigned symbolsPerFill =
+        (detail::ACCUM_BITS - 7) / MaxCodeLen;
+
+    CanonicalCodec() :
+        encoder(std::make_unique<EncodeTable>()),
+        decoder(std::make_unique<DecodeTable>())
+    {
+    }
+
+    CanonicalCodec(CanonicalCodec &&) noexcept = default;
+    CanonicalCodec &operator=(CanonicalCodec &&) noexcept = default;
+    CanonicalCodec(const CanonicalCodec &) = delete;
+    CanonicalCodec &operator=(const CanonicalCodec &) = delete;
+
+    /************************************************************************
+    *   Function   : EncodeBound
+    *   Description: This function returns the largest number of bytes that
+    *                Encode can produce for an input of a given size.
+    *   Parameters : size - number of bytes to be encoded
+    *   Effects    : None
+    *   Returned   : The worst case encoded size, or 0 if it's too large to
+    *                be represented by a std::size_t.
+    ************************************************************************/
+    static constexpr std::size_t EncodeBound(const std::size_t size) noexcept
+    {
+        if ((size / 8) >
+            ((SIZE_MAX - detail::CONTAINER_BOUND - MaxCodeLen) / MaxCodeLen))
+        {
+            return 0;
+        }
+
+        return detail::CONTAINER_BOUND + (size / 8) * MaxCodeLen +
+            ((size % 8) * MaxCodeLen + 7) / 8;
+    }
+
+    /************************************************************************
+    *   Function   : DecodedSize
+    *   Description: This function returns the number of bytes that encoded
+    *                data decodes to, so a buffer may be allocated before
+    *                decoding.
+    *   Parameters : src - the encoded data
+    *   Effects    : None
+    *   Returned   : The number of decoded bytes.
+    ************************************************************************/
+    static std::size_t DecodedSize(const std::span<const std::byte> src)
+    {
+        return detail::GetContainer(src).size;
+    }
+
+    /************************************************************************
+    *   Function   : Encode
+    *   Description: This function encodes a buffer into a preallocated
+    *                buffer.  EncodeBound(src.size()) bytes are always
+    *                enough.
+    *   Parameters : src - the data to encode
+    *                dst - the buffer receiving the encoded data
+    *   Effects    : src is encoded into dst.
+    *   Returned   : The number of bytes written to dst.  Nothing is
+    *                written if dst is too small.
+    ************************************************************************/
+    std::size_t Encode(const std::span<const std::byte> src,
+        const std::span<std::byte> dst)
+    {
+        const auto *in = reinterpret_cast<const std::uint8_t *>(src.data());
+        auto *out = reinterpret_cast<std::uint8_t *>(dst.data());
+        const std::size_t len = src.size();
+        std::uint64_t codesLen;
+
+        if (const std::uint8_t flags = ChooseContainer(in, len, codesLen))
+        {
+            /* the data is stored or a run */
+            const std::size_t dataLen =
+                (detail::CONTAINER_STORED == flags) ? len : 1;
+
+            if ((dataLen > dst.size()) || (detail::CONTAINER_HEADER_SIZE +
+                detail::CONTAINER_CRC_SIZE > dst.size() - dataLen))
+            {
+                detail::Fail(std::errc::result_out_of_range,
+                    "huffman output buffer is too small");
+            }
+
+            PutUncodedHeader(out, len, flags);
+            std::copy(in, in + dataLen, out + detail::CONTAINER_HEADER_SIZE);
+            PutCrc(out + detail::CONTAINER_HEADER_SIZE + dataLen,
+                detail::Crc32c(0, in, len));
+            return detail::CONTAINER_HEADER_SIZE + dataLen +
+                detail::CONTAINER_CRC_SIZE;
+        }
+
+        const std::size_t headerLen = encoder->headerLen;
+
+        /* make sure everything fits, so the coding loop doesn't check */
+        if ((codesLen > dst.size()) || (headerLen +
+            detail::CONTAINER_CRC_SIZE > dst.size() - codesLen))
+        {
+            detail::Fail(std::errc::result_out_of_range,
+                "huffman output buffer is too small");
+        }
+
+        std::memcpy(out, encoder->header, headerLen);
+        PutSize(out, len);
+
+        const std::uint8_t *codeLen = encoder->len;
+        const std::uint32_t *code = encoder->code;
+        std::uint8_t *pos = out + headerLen;
+        std::uint64_t accum = 0;
+        unsigned count = 0;
+        std::size_t i = 0;
+
+        /***********************************************************
+        * Add codesPerStore codes, then store the whole accumulator
+        * and keep the partial byte.  Stores may write past the last
+        * whole byte, so they're only done while at least 8 bytes of
+        * codes (64 symbols) will still be written after them.
+        ***********************************************************/
+        while (i + codesPerStore + 64 <= len)
+        {
+            for (unsigned j = 0; j < codesPerStore; j++, i++)
+            {
+                accum = (accum << codeLen[in[i]]) | code[in[i]];
+                count += codeLen[in[i]];
+            }
+
+            const std::uint64_t word = accum << (detail::ACCUM_BITS - count);
+
+            for (unsigned j = 0; j < 8; j++)
+            {
+                pos[j] = static_cast<std::uint8_t>(word >> (56 - 8 * j));
+            }
+
+            pos += count >> 3;
+            count &= 7;
+        }
+
+        for (; i < len; i++)
+        {
+            accum = (accum << codeLen[in[i]]) | code[in[i]];
+            count += codeLen[in[i]];
+
+            while (count >= 8)
+            {
+                count -= 8;
+                *pos++ = static_cast<std::uint8_t>(accum >> count);
+            }
+        }
+
+        if (count > 0)
+        {
+            *pos++ = static_cast<std::uint8_t>(accum << (8 - count));
+        }
+
+        PutCrc(pos, detail::Crc32c(0, in, len));
+        return static_cast<std::size_t>(pos - out) +
+            detail::CONTAINER_CRC_SIZE;
+    }
+
+    /************************************************************************
+    *   Function   : Encode
+    *   Description: This function encodes a buffer to an output iterator.
+    *   Parameters : src - the data to encode
+    *                out - where the encoded bytes are written
+    *   Effects    : src is encoded to out.
+    *   Returned   : The iterator after the last byte written.
+    ************************************************************************/
+    template <std::output_iterator<std::byte> Out>
+    Out Encode(const std::span<const std::byte> src, Out out)
+    {
+        const auto *in = reinterpret_cast<const std::uint8_t *>(src.data());
+        const std::size_t len = src.size();
+        std::uint8_t size[detail::CONTAINER_HEADER_SIZE];
+        std::uint8_t crc[detail::CONTAINER_CRC_SIZE];
+        std::uint64_t accum = 0, codesLen;
+        unsigned count = 0;
+
+        PutCrc(crc, detail::Crc32c(0, in, len));
+
+        if (const std::uint8_t flags = ChooseContainer(in, len, codesLen))
+        {
+            /* the data is stored or a run */
+            PutUncodedHeader(size, len, flags);
+            out = Copy(size, detail::CONTAINER_HEADER_SIZE, out);
+            out = Copy(in, (detail::CONTAINER_STORED == flags) ? len : 1, out);
+            return Copy(crc, detail::CONTAINER_CRC_SIZE, out);
+        }
+
+        PutSize(size, len);
+        out = Copy(encoder->header, 6, out);
+        out = Copy(size + 6, 8, out);
+        out = Copy(encoder->header + 14, encoder->headerLen - 14, out);
+
+        for (std::size_t i = 0; i < len; i++)
+        {
+            accum = (accum << encoder->len[in[i]]) | encoder->code[in[i]];
+            count += encoder->len[in[i]];
+
+            while (count >= 8)
+            {
+                count -= 8;
+                *out++ = static_cast<std::byte>(accum >> count);
+            }
+        }
+
+        if (count > 0)
+        {
+            *out++ = static_cast<std::byte>(accum << (8 - count));
+        }
+
+        return Copy(crc, detail::CONTAINER_CRC_SIZE, out);
+    }
+
+    /************************************************************************
+    *   Function   : Decode
+    *   Description: This function decodes a buffer into a preallocated
+    *                buffer.  DecodedSize(src) bytes are enough.
+    *   Parameters : src - the encoded data
+    *                dst - the buffer receiving the decoded data
+    *   Effects    : src is decoded into dst.
+    *   Returned   : The number of bytes written to dst.  Nothing is
+    *                written if dst is too small.
+    ************************************************************************/
+    std::size_t Decode(const std::span<const std::byte> src,
+        const std::span<std::byte> dst)
+    {
+        const detail::Container container = BuildDecoder(src);
+        auto *out = reinterpret_cast<std::uint8_t *>(dst.data());
+        std::uint8_t *pos = out;
+
+        if (container.size > dst.size())
+        {
+            detail::Fail(std::errc::result_out_of_range,
+                "huffman output buffer is too small");
+        }
+
+        DecodeSymbols(src, container, [&pos](const std::uint8_t symbol)
+            {
+                *pos++ = symbol;
+            });
+
+        if (container.flags & detail::CONTAINER_CRC)
+        {
+            CheckCrc(src, detail::Crc32c(0, out, container.size));
+        }
+
+        return container.size;
+    }
+
+    /************************************************************************
+    *   Function   : Decode
+    *   Description: This function decodes a buffer to an output iterator.
+    *                The checksum is checked after all of the data has been
+    *                written.
+    *   Parameters : src - the encoded data
+    *                out - where the decoded bytes are written
+    *   Effects    : src is decoded to out.
+    *   Returned   : The iterator after the last byte written.
+    ************************************************************************/
+    template <std::output_iterator<std::byte> Out>
+    Out Decode(const std::span<const std::byte> src, Out out)
+    {
+        const detail::Container container = BuildDecoder(src);
+        std::uint8_t chunk[4096];           /* decoded bytes not yet written */
+        std::size_t chunkLen = 0;
+        std::uint32_t crc = 0;
+
+        DecodeSymbols(src, container, [&](const std::uint8_t symbol)
+            {
+                chunk[chunkLen++] = symbol;
+
+                if (sizeof(chunk) == chunkLen)
+                {
+                    crc = detail::Crc32c(crc, chunk, chunkLen);
+                    out = Copy(chunk, chunkLen, out);
+                    chunkLen = 0;
+                }
+            });
+
+        crc = detail::Crc32c(crc, chunk, chunkLen);
+        out = Copy(chunk, chunkLen, out);
+
+        if (container.flags & detail::CONTAINER_CRC)
+        {
+            CheckCrc(src, crc);
+        }
+
+        return out;
+    }
+
+private:
+    /* the code built for the last message encoded */
+    struct EncodeTable
+    {
+        bool valid = false;
+        std::uint64_t counts[256];          /* symbols in the message */
+        std::uint8_t lengths[detail::NUM_CHARS];    /* lengths before limit */
+        std::uint32_t code[256];            /* code of each byte */
+        std::uint8_t len[256];              /* bits in each code */
+        std::uint8_t header[detail::CONTAINER_HEADER_SIZE +
+            detail::COMPACT_HEADER_BOUND];
+        std::size_t headerLen;
+    };
+
+    /* a table look up: the decoded symbol, and the bits its code takes */
+    struct DecodeEntry
+    {
+        std::uint16_t symbol;
+        std::uint8_t length;                /* 0 if the code is longer */
+    };
+
+    /* the decoder built for the last message decoded */
+    struct DecodeTable
+    {
+        bool valid = false;
+        std::uint8_t compact[detail::COMPACT_HEADER_BOUND];
+        std::size_t compactLen;
+        DecodeEntry table[tableSize];
+        std::uint32_t first[MaxCodeLen + 1];    /* smallest code of a length */
+        std::uint32_t count[MaxCodeLen + 1];    /* codes of each length */
+        std::uint16_t index[MaxCodeLen + 1];    /* length's first symbol */
+        std::uint16_t symbols[detail::NUM_CHARS];   /* by (length, -value) */
+    };
+
+    std::unique_ptr<EncodeTable> encoder;
+    std::unique_ptr<DecodeTable> decoder;
+
+    template <typename Out>
+    static Out Copy(const std::uint8_t *data, const std::size_t len, Out out)
+    {
+        for (std::size_t i = 0; i < len; i++)
+        {
+            *out++ = static_cast<std::byte>(data[i]);
+        }
+
+        return out;
+    }
+
+    static void PutSize(std::uint8_t *header, std::uint64_t size) noexcept
+    {
+        /* size is 8 bytes no matter how big a std::size_t is */
+        for (int i = 13; i >= 6; i--)
+        {
+            header[i] = static_cast<std::uint8_t>(size & 0xFF);
+            size >>= 8;
+        }
+    }
+
+    static void PutUncodedHeader(std::uint8_t *header,
+        const std::uint64_t size, const std::uint8_t flags) noexcept
+    {
+        std::memcpy(header, detail::containerMagic, 4);
+        header[4] = detail::CONTAINER_VERSION;
+        header[5] = detail::CONTAINER_CRC | flags;
+        PutSize(header, size);
+        header[14] = 0;
+        header[15] = 0;
+    }
+
+    static void PutCrc(std::uint8_t *dst, const std::uint32_t crc) noexcept
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            dst[i] = static_cast<std::uint8_t>(crc >> (24 - 8 * i));
+        }
+    }
+
+    static void CheckCrc(const std::span<const std::byte> src,
+        const std::uint32_t crc)
+    {
+        const auto *in = reinterpret_cast<const std::uint8_t *>(src.data()) +
+            src.size() - detail::CONTAINER_CRC_SIZE;
+        std::uint32_t expected = 0;
+
+        for (std::size_t i = 0; i < detail::CONTAINER_CRC_SIZE; i++)
+        {
+            expected = (expected << 8) | in[i];
+        }
+
+        if (crc != expected)
+        {
+            detail::Fail(std::errc::illegal_byte_sequence,
+                "huffman checksum doesn't match");
+        }
+    }
+
+    /************************************************************************
+    *   Function   : ChooseContainer
+    *   Description: This function chooses a container the same way as
+    *                HuffmanEncodeMessage in canonical.c.  Runs and messages
+    *                shorter than TINY_CONTAINER_SIZE aren't worth building
+    *                a code for, and messages that coding doesn't make
+    *                smaller are stored.
+    *   Parameters : in - pointer to the message
+    *                len - number of bytes in the message
+    *                codesLen - set to the number of bytes the codes for the
+    *                           message take, if it's coded
+    *   Effects    : The encode table holds the code for the message if one
+    *                was built.
+    *   Returned   : CONTAINER_STORED or CONTAINER_RUN if the message isn't
+    *                coded, otherwise 0.
+    ************************************************************************/
+    std::uint8_t ChooseContainer(const std::uint8_t *in, const std::size_t len,
+        std::uint64_t &codesLen)
+    {
+        if ((len > 0) && std::all_of(in + 1, in + len,
+            [in](const std::uint8_t symbol) { return symbol == in[0]; }))
+        {
+            return detail::CONTAINER_RUN;
+        }
+
+        if (len < detail::TINY_CONTAINER_SIZE)
+        {
+            return detail::CONTAINER_STORED;
+        }
+
+        codesLen = (BuildEncoder(in, len) + 7) / 8;
+
+        if ((codesLen >= len) || (encoder->headerLen -
+            detail::CONTAINER_HEADER_SIZE >= len - codesLen))
+        {
+            return detail::CONTAINER_STORED;
+        }
+
+        return 0;
+    }
+
+    /************************************************************************
+    *   Function   : BuildEncoder
+    *   Description: This function counts the symbols in a message and
+    *                builds a canonical code for them.  If the code lengths
+    *                are the same as the last message's, its code and
+    *                header are used again.
+    *   Parameters : in - pointer to the message
+    *                len - number of bytes in the message
+    *   Effects    : The encode table holds the code and container header
+    *                (without the size) for the message.
+    *   Returned   : The number of bits the codes for the message take.
+    ************************************************************************/
+    std::uint64_t BuildEncoder(const std::uint8_t *in, const std::size_t len)
+    {
+        EncodeTable &enc = *encoder;
+        std::uint8_t lengths[detail::NUM_CHARS];
+        std::uint64_t bits = 0;
+
+        std::fill(enc.counts, enc.counts + 256, 0);
+
+        for (std::size_t i = 0; i < len; i++)
+        {
+            enc.counts[in[i]]++;
+        }
+
+        detail::BuildCodeLengths(enc.counts, lengths);
+
+        /* the same lengths always make the same code and header */
+        if (!enc.valid || (0 != std::memcmp(lengths, enc.lengths,
+            detail::NUM_CHARS)))
+        {
+            std::memcpy(enc.lengths, lengths, detail::NUM_CHARS);
+            detail::LimitCodeLengths(lengths, MaxCodeLen);
+            AssignCodes(lengths);
+
+            std::memcpy(enc.header, detail::containerMagic, 4);
+            enc.header[4] = detail::CONTAINER_VERSION;
+            enc.header[5] = detail::CONTAINER_CRC;
+            PutSize(enc.header, 0);
+
+            const std::size_t compactLen = detail::PutCompactLengths(lengths,
+                enc.header + detail::CONTAINER_HEADER_SIZE);
+            enc.header[14] = static_cast<std::uint8_t>(compactLen >> 8);
+            enc.header[15] = static_cast<std::uint8_t>(compactLen & 0xFF);
+            enc.headerLen = detail::CONTAINER_HEADER_SIZE + compactLen;
+            enc.valid = true;
+        }
+
+        for (int c = 0; c < 256; c++)
+        {
+            bits += enc.counts[c] * enc.len[c];
+        }
+
+        return bits;
+    }
+
+    /************************************************************************
+    *   Function   : AssignCodes
+    *   Description: This function assigns canonical codes the same way as
+    *                AssignCanonicalCodes in canonical.c.  The longest codes
+    *                get the smallest values, and within a length, symbols
+    *                with higher values get smaller codes.
+    *   Parameters : lengths - code length of each symbol (at most
+    *                          MaxCodeLen)
+    *   Effects    : The code of every byte is put in the encode table.
+    *   Returned   : None
+    ************************************************************************/
+    void AssignCodes(const std::uint8_t *lengths) noexcept
+    {
+        std::uint32_t count[MaxCodeLen + 2] = {};
+        std::uint32_t next[MaxCodeLen + 1];
+        std::uint64_t code = 0;
+
+        for (int c = 0; c < 256; c++)
+        {
+            count[lengths[c]]++;
+        }
+
+        for (unsigned length = MaxCodeLen; length > 0; length--)
+        {
+            next[length] = static_cast<std::uint32_t>(code);
+            code = (code + count[length]) >> 1;
+        }
+
+        for (int c = 255; c >= 0; c--)
+        {
+            encoder->len[c] = lengths[c];
+            encoder->code[c] = (0 == lengths[c]) ? 0 : next[lengths[c]]++;
+        }
+    }
+
+    /************************************************************************
+    *   Function   : BuildDecoder
+    *   Description: This function reads the container header of encoded
+    *                data, and builds the decode tables for its code
+    *                lengths, unless they're the same as the last message's.
+    *   Parameters : src - the encoded data
+    *   Effects    : The decode table holds the code used by src.
+    *   Returned   : The container information.
+    ************************************************************************/
+    detail::Container BuildDecoder(const std::span<const std::byte> src)
+    {
+        const detail::Container container = detail::GetContainer(src);
+        const auto *compact = reinterpret_cast<const std::uint8_t *>(
+            src.data()) + detail::CONTAINER_HEADER_SIZE;
+        DecodeTable &dec = *decoder;
+        std::uint8_t lengths[detail::NUM_CHARS];
+        std::uint64_t kraft = 0;
+
+        /* keep the decoder if there's no code or it's the same code again */
+        if ((0 == container.lengthsLen) ||
+            (dec.valid && (container.lengthsLen == dec.compactLen) &&
+            (0 == std::memcmp(compact, dec.compact, dec.compactLen))))
+        {
+            return container;
+        }
+
+        dec.valid = false;
+
+        if (!detail::GetCompactLengths(compact, container.lengthsLen,
+            lengths))
+        {
+            detail::Fail(std::errc::illegal_byte_sequence,
+                "malformed huffman header");
+        }
+
+        std::fill(dec.count, dec.count + MaxCodeLen + 1, 0);
+
+        for (int c = 0; c < detail::NUM_CHARS; c++)
+        {
+            if (lengths[c] > MaxCodeLen)
+            {
+                detail::Fail(std::errc::not_supported,
+                    "huffman code is longer than MaxCodeLen");
+            }
+
+            dec.count[lengths[c]]++;
+        }
+
+        /* the lengths can't have more codes than there is room for */
+        for (unsigned length = 1; length <= MaxCodeLen; length++)
+        {
+            kraft += std::uint64_t{dec.count[length]} << (MaxCodeLen - length);
+        }
+
+        if (kraft > (std::uint64_t{1} << MaxCodeLen))
+        {
+            detail::Fail(std::errc::illegal_byte_sequence,
+                "malformed huffman header");
+        }
+
+        /* symbols ordered by length, then by descending value */
+        std::uint64_t code = 0;
+        std::uint16_t index = 0;
+
+        for (unsigned length = MaxCodeLen; length > 0; length--)
+        {
+            dec.first[length] = static_cast<std::uint32_t>(code);
+            code = (code + dec.count[length]) >> 1;
+        }
+
+        std::uint16_t next[MaxCodeLen + 1];
+
+        for (unsigned length = 1; length <= MaxCodeLen; length++)
+        {
+            dec.index[length] = index;
+            next[length] = index;
+            index += static_cast<std::uint16_t>(dec.count[length]);
+        }
+
+        for (int c = detail::NUM_CHARS - 1; c >= 0; c--)
+        {
+            if (0 != lengths[c])
+            {
+                dec.symbols[next[lengths[c]]++] =
+                    static_cast<std::uint16_t>(c);
+            }
+        }
+
+        /* every index beginning with a short code decodes to its symbol */
+        std::fill(dec.table, dec.table + tableSize, DecodeEntry{0, 0});
+
+        for (unsigned length = 1; length <= LookupBits; length++)
+        {
+            for (std::uint32_t k = 0; k < dec.count[length]; k++)
+            {
+                const std::size_t start = std::size_t{dec.first[length] + k}
+                    << (LookupBits - length);
+                const std::size_t end =
+                    start + (std::size_t{1} << (LookupBits - length));
+                const DecodeEntry entry{dec.symbols[dec.index[length] + k],
+                    static_cast<std::uint8_t>(length)};
+
+                std::fill(dec.table + start, dec.table + end, entry);
+            }
+        }
+
+        std::memcpy(dec.compact, compact, container.lengthsLen);
+        dec.compactLen = container.lengthsLen;
+        dec.valid = true;
+        return container;
+    }
+
+    /************************************************************************
+    *   Function   : DecodeSymbol
+    *   Description: This function decodes the symbol at the start of a
+    *                window of MaxCodeLen bits.
+    *   Parameters : window - the next MaxCodeLen bits (right justified)
+    *                length - set to the number of bits in the symbol's code
+    *   Effects    : None
+    *   Returned   : The symbol, or a value above 255 if the bits aren't the
+    *                code of a byte.
+    ************************************************************************/
+    unsigned DecodeSymbol(const std::uint64_t window, unsigned &length) const
+        noexcept
+    {
+        const DecodeTable &dec = *decoder;
+        const DecodeEntry entry =
+            dec.table[window >> (MaxCodeLen - LookupBits)];
+
+        if (0 != entry.length)
+        {
+            length = entry.length;
+            return entry.symbol;
+        }
+
+        /* a long code is never smaller than the first code of its length */
+        for (length = LookupBits + 1; length <= MaxCodeLen; length++)
+        {
+            const std::uint64_t offset =
+                (window >> (MaxCodeLen - length)) - dec.first[length];
+
+            if (offset < dec.count[length])
+            {
+                return dec.symbols[dec.index[length] + offset];
+            }
+        }
+
+        return detail::NUM_CHARS; /* the bits don't match any code */
+    }
+
+    /************************************************************************
+    *   Function   : DecodeSymbols
+    *   Description: This function decodes the symbols of a container.
+    *                While there are enough bytes left, the accumulator is
+    *                refilled once for every symbolsPerFill symbols, and
+    *                the symbols are decoded without any checks.  The bytes
+    *                of stored and run containers are passed on as they
+    *                are.
+    *   Parameters : src - the encoded data
+    *                container - the container information for src
+    *                emit - called with each decoded symbol
+    *   Effects    : container.size symbols are passed to emit.
+    *   Returned   : None
+    ************************************************************************/
+    template <typename Emit>
+    void DecodeSymbols(const std::span<const std::byte> src,
+        const detail::Container &container, Emit &&emit) const
+    {
+        constexpr std::uint64_t windowMask =
+            (std::uint64_t{1} << MaxCodeLen) - 1;
+        const auto *in = reinterpret_cast<const std::uint8_t *>(src.data());
+        const std::uint8_t *pos = in + detail::CONTAINER_HEADER_SIZE +
+            container.lengthsLen;
+        const std::uint8_t *end = in + src.size() -
+            ((container.flags & detail::CONTAINER_CRC) ?
+            detail::CONTAINER_CRC_SIZE : 0);
+        std::uint64_t accum = 0;
+        unsigned count = 0, length;
+        std::size_t remaining = container.size;
+
+        /* data without a code is the bytes themselves, or 1 repeated */
+        if (container.flags &
+            (detail::CONTAINER_STORED | detail::CONTAINER_RUN))
+        {
+            const std::size_t step =
+                (container.flags & detail::CONTAINER_STORED) ? 1 : 0;
+
+            for (; remaining > 0; remaining--, pos += step)
+            {
+                emit(*pos);
+            }
+
+            return;
+        }
+
+        auto refill = [&]()
+        {
+            while ((count <= detail::ACCUM_BITS - 8) && (pos < end))
+            {
+                accum = (accum << 8) | *pos++;
+                count += 8;
+            }
+        };
+
+        while ((remaining >= symbolsPerFill) && (end - pos >= 8))
+        {
+            refill();
+
+            for (unsigned j = 0; j < symbolsPerFill; j++)
+            {
+                const unsigned symbol = DecodeSymbol(
+                    (accum >> (count - MaxCodeLen)) & windowMask, length);
+
+                if (symbol > 255)
+                {
+                    detail::Fail(std::errc::illegal_byte_sequence,
+                        "bad huffman code");
+                }
+
+                count -= length;
+                emit(static_cast<std::uint8_t>(symbol));
+            }
+
+            remaining -= symbolsPerFill;
+        }
+
+        /* the last symbols may need bits past the end of the data */
+        for (; remaining > 0; remaining--)
+        {
+            refill();
+
+            const std::uint64_t window = (count >= MaxCodeLen) ?
+                (accum >> (count - MaxCodeLen)) & windowMask :
+                (accum << (MaxCodeLen - count)) & windowMask;
+            const unsigned symbol = DecodeSymbol(window, length);
+
+            if ((symbol > 255) || (length > count))
+            {
+                detail::Fail(std::errc::illegal_byte_sequence,
+                    "bad or truncated huffman code");
+            }
+
+            count -= length;
+            emit(static_cast<std::uint8_t>(symbol));
+        }
+    }
+};
+
+} /* namespace huffman */
+
+#endif /* _HUFFMAN_HPP_ */
@@ -33,18 +33,50 @@
 /***************************************************************************
 *                             INCLUDED FILES
 ***************************************************************************/
+#if defined(HUFFMAN_STATS) && !defined(_WIN32)
+#define _POSIX_C_SOURCE 200112L     /* clock_gettime */
+#include <unistd.h>
+#endif
+
 #include <stdio.h>
-#include <stdlib.h>
+#include <errno.h>
+#ifdef HUFFMAN_STATS
+#include <math.h>
+#include <time.h>
+#ifndef HUFFMAN_NO_THREADS
+#include <pthread.h>
+#endif
+#endif
 #include "huflocal.h"
 #include "huffman.h"
 
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
+/***************************************************************************
+* Min-heap of the array slots holding the nodes still to be combined.
+* Slots are ordered by count, then level, then slot number, which is the
+* order that a linear search of the slots would find them in.
+***************************************************************************/
+typedef struct node_heap_t
+{
+    int slot[NUM_CHARS];        /* heap of slot numbers */
+    count_t count[NUM_CHARS];   /* count of the node in each slot */
+    int level[NUM_CHARS];       /* level of the node in each slot */
+    int size;                   /* number of slots in the heap */
+} node_heap_t;
 
 /***************************************************************************
 *                                CONSTANTS
 ***************************************************************************/
+/* number of interleaved histograms used to count symbols */
+#define NUM_HISTOGRAMS      4
+
+/* largest number of bytes counted before histograms are summed */
+#define HISTOGRAM_CHUNK     (1UL << 24)
+
+/* number of bytes read from a file at a time while counting */
+#define COUNT_BUFFER_SIZE   16384
 
 /***************************************************************************
 *                                 MACROS
@@ -53,10 +85,301 @@
 /***************************************************************************
 *                            GLOBAL VARIABLES
 ***************************************************************************/
+#ifdef HUFFMAN_STATS
+/* running totals of each stat_t */
+static double totals[NUM_STATS];
+
+#ifndef HUFFMAN_NO_THREADS
+static pthread_mutex_t statsLock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+#endif
+
+/***************************************************************************
+* CRC-32C (Castagnoli polynomial 0x1EDC6F41, reflected).  crcTable[0] holds
+* the CRC of each byte, and crcTable[n] holds the CRC of each byte followed
+* by n zero bytes, so 4 bytes may be added at a time.
+***************************************************************************/
+static const unsigned long crcTable[4][UCHAR_MAX + 1] =
+{
+    {
+        0x00000000UL, 0xF26B8303UL, 0xE13B70F7UL, 0x1350F3F4UL,
+        0xC79A971FUL, 0x35F1141CUL, 0x26A1E7E8UL, 0xD4CA64EBUL,
+        0x8AD958CFUL, 0x78B2DBCCUL, 0x6BE22838UL, 0x9989AB3BUL,
+        0x4D43CFD0UL, 0xBF284CD3UL, 0xAC78BF27UL, 0x5E133C24UL,
+        0x105EC76FUL, 0xE235446CUL, 0xF165B798UL, 0x030E349BUL,
+        0xD7C45070UL, 0x25AFD373UL, 0x36FF2087UL, 0xC494A384UL,
+        0x9A879FA0UL, 0x68EC1CA3UL, 0x7BBCEF57UL, 0x89D76C54UL,
+        0x5D1D08BFUL, 0xAF768BBCUL, 0xBC267848UL, 0x4E4DFB4BUL,
+        0x20BD8EDEUL, 0xD2D60DDDUL, 0xC186FE29UL, 0x33ED7D2AUL,
+        0xE72719C1UL, 0x154C9AC2UL, 0x061C6936UL, 0xF477EA35UL,
+        0xAA64D611UL, 0x580F5512UL, 0x4B5FA6E6UL, 0xB93425E5UL,
+        0x6DFE410EUL, 0x9F95C20DUL, 0x8CC531F9UL, 0x7EAEB2FAUL,
+        0x30E349B1UL, 0xC288CAB2UL, 0xD1D83946UL, 0x23B3BA45UL,
+        0xF779DEAEUL, 0x05125DADUL, 0x1642AE59UL, 0xE4292D5AUL,
+        0xBA3A117EUL, 0x4851927DUL, 0x5B016189UL, 0xA96AE28AUL,
+        0x7DA08661UL, 0x8FCB0562UL, 0x9C9BF696UL, 0x6EF07595UL,
+        0x417B1DBCUL, 0xB3109EBFUL, 0xA0406D4BUL, 0x522BEE48UL,
+        0x86E18AA3UL, 0x748A09A0UL, 0x67DAFA54UL, 0x95B17957UL,
+        0xCBA24573UL, 0x39C9C670UL, 0x2A993584UL, 0xD8F2B687UL,
+        0x0C38D26CUL, 0xFE53516FUL, 0xED03A29BUL, 0x1F682198UL,
+        0x5125DAD3UL, 0xA34E59D0UL, 0xB01EAA24UL, 0x42752927UL,
+        0x96BF4DCCUL, 0x64D4CECFUL, 0x77843D3BUL, 0x85EFBE38UL,
+        0xDBFC821CUL, 0x2997011FUL, 0x3AC7F2EBUL, 0xC8AC71E8UL,
+        0x1C661503UL, 0xEE0D9600UL, 0xFD5D65F4UL, 0x0F36E6F7UL,
+        0x61C69362UL, 0x93AD1061UL, 0x80FDE395UL, 0x72966096UL,
+        0xA65C047DUL, 0x5437877EUL, 0x4767748AUL, 0xB50CF789UL,
+        0xEB1FCBADUL, 0x197448AEUL, 0x0A24BB5AUL, 0xF84F3859UL,
+        0x2C855CB2UL, 0xDEEEDFB1UL, 0xCDBE2C45UL, 0x3FD5AF46UL,
+        0x7198540DUL, 0x83F3D70EUL, 0x90A324FAUL, 0x62C8A7F9UL,
+        0xB602C312UL, 0x44694011UL, 0x5739B3E5UL, 0xA55230E6UL,
+        0xFB410CC2UL, 0x092A8FC1UL, 0x1A7A7C35UL, 0xE811FF36UL,
+        0x3CDB9BDDUL, 0xCEB018DEUL, 0xDDE0EB2AUL, 0x2F8B6829UL,
+        0x82F63B78UL, 0x709DB87BUL, 0x63CD4B8FUL, 0x91A6C88CUL,
+        0x456CAC67UL, 0xB7072F64UL, 0xA457DC90UL, 0x563C5F93UL,
+        0x082F63B7UL, 0xFA44E0B4UL, 0xE9141340UL, 0x1B7F9043UL,
+        0xCFB5F4A8UL, 0x3DDE77ABUL, 0x2E8E845FUL, 0xDCE5075CUL,
+        0x92A8FC17UL, 0x60C37F14UL, 0x73938CE0UL, 0x81F80FE3UL,
+        0x55326B08UL, 0xA759E80BUL, 0xB4091BFFUL, 0x466298FCUL,
+        0x1871A4D8UL, 0xEA1A27DBUL, 0xF94AD42FUL, 0x0B21572CUL,
+        0xDFEB33C7UL, 0x2D80B0C4UL, 0x3ED04330UL, 0xCCBBC033UL,
+        0xA24BB5A6UL, 0x502036A5UL, 0x4370C551UL, 0xB11B4652UL,
+        0x65D122B9UL, 0x97BAA1BAUL, 0x84EA524EUL, 0x7681D14DUL,
+        0x2892ED69UL, 0xDAF96E6AUL, 0xC9A99D9EUL, 0x3BC21E9DUL,
+        0xEF087A76UL, 0x1D63F975UL, 0x0E330A81UL, 0xFC588982UL,
+        0xB21572C9UL, 0x407EF1CAUL, 0x532E023EUL, 0xA145813DUL,
+        0x758FE5D6UL, 0x87E466D5UL, 0x94B49521UL, 0x66DF1622UL,
+        0x38CC2A06UL, 0xCAA7A905UL, 0xD9F75AF1UL, 0x2B9CD9F2UL,
+        0xFF56BD19UL, 0x0D3D3E1AUL, 0x1E6DCDEEUL, 0xEC064EEDUL,
+        0xC38D26C4UL, 0x31E6A5C7UL, 0x22B65633UL, 0xD0DDD530UL,
+        0x0417B1DBUL, 0xF67C32D8UL, 0xE52CC12CUL, 0x1747422FUL,
+        0x49547E0BUL, 0xBB3FFD08UL, 0xA86F0EFCUL, 0x5A048DFFUL,
+        0x8ECEE914UL, 0x7CA56A17UL, 0x6FF599E3UL, 0x9D9E1AE0UL,
+        0xD3D3E1ABUL, 0x21B862A8UL, 0x32E8915CUL, 0xC083125FUL,
+        0x144976B4UL, 0xE622F5B7UL, 0xF5720643UL, 0x07198540UL,
+        0x590AB964UL, 0xAB613A67UL, 0xB831C993UL, 0x4A5A4A90UL,
+        0x9E902E7BUL, 0x6CFBAD78UL, 0x7FAB5E8CUL, 0x8DC0DD8FUL,
+        0xE330A81AUL, 0x115B2B19UL, 0x020BD8EDUL, 0xF0605BEEUL,
+        0x24AA3F05UL, 0xD6C1BC06UL, 0xC5914FF2UL, 0x37FACCF1UL,
+        0x69E9F0D5UL, 0x9B8273D6UL, 0x88D28022UL, 0x7AB90321UL,
+        0xAE7367CAUL, 0x5C18E4C9UL, 0x4F48173DUL, 0xBD23943EUL,
+        0xF36E6F75UL, 0x0105EC76UL, 0x12551F82UL, 0xE03E9C81UL,
+        0x34F4F86AUL, 0xC69F7B69UL, 0xD5CF889DUL, 0x27A40B9EUL,
+        0x79B737BAUL, 0x8BDCB4B9UL, 0x988C474DUL, 0x6AE7C44EUL,
+        0xBE2DA0A5UL, 0x4C4623A6UL, 0x5F16D052UL, 0xAD7D5351UL
+    },
+    {
+        0x00000000UL, 0x13A29877UL, 0x274530EEUL, 0x34E7A899UL,
+        0x4E8A61DCUL, 0x5D28F9ABUL, 0x69CF5132UL, 0x7A6DC945UL,
+        0x9D14C3B8UL, 0x8EB65BCFUL, 0xBA51F356UL, 0xA9F36B21UL,
+        0xD39EA264UL, 0xC03C3A13UL, 0xF4DB928AUL, 0xE7790AFDUL,
+        0x3FC5F181UL, 0x2C6769F6UL, 0x1880C16FUL, 0x0B225918UL,
+        0x714F905DUL, 0x62ED082AUL, 0x560AA0B3UL, 0x45A838C4UL,
+        0xA2D13239UL, 0xB173AA4EUL, 0x859402D7UL, 0x96369AA0UL,
+        0xEC5B53E5UL, 0xFFF9CB92UL, 0xCB1E630BUL, 0xD8BCFB7CUL,
+        0x7F8BE302UL, 0x6C297B75UL, 0x58CED3ECUL, 0x4B6C4B9BUL,
+        0x310182DEUL, 0x22A31AA9UL, 0x1644B230UL, 0x05E62A47UL,
+        0xE29F20BAUL, 0xF13DB8CDUL, 0xC5DA1054UL, 0xD6788823UL,
+        0xAC154166UL, 0xBFB7D911UL, 0x8B507188UL, 0x98F2E9FFUL,
+        0x404E1283UL, 0x53EC8AF4UL, 0x670B226DUL, 0x74A9BA1AUL,
+        0x0EC4735FUL, 0x1D66EB28UL, 0x298143B1UL, 0x3A23DBC6UL,
+        0xDD5AD13BUL, 0xCEF8494CUL, 0xFA1FE1D5UL, 0xE9BD79A2UL,
+        0x93D0B0E7UL, 0x80722890UL, 0xB4958009UL, 0xA737187EUL,
+        0xFF17C604UL, 0xECB55E73UL, 0xD852F6EAUL, 0xCBF06E9DUL,
+        0xB19DA7D8UL, 0xA23F3FAFUL, 0x96D89736UL, 0x857A0F41UL,
+        0x620305BCUL, 0x71A19DCBUL, 0x45463552UL, 0x56E4AD25UL,
+        0x2C896460UL, 0x3F2BFC17UL, 0x0BCC548EUL, 0x186ECCF9UL,
+        0xC0D23785UL, 0xD370AFF2UL, 0xE797076BUL, 0xF4359F1CUL,
+        0x8E585659UL, 0x9DFACE2EUL, 0xA91D66B7UL, 0xBABFFEC0UL,
+        0x5DC6F43DUL, 0x4E646C4AUL, 0x7A83C4D3UL, 0x69215CA4UL,
+        0x134C95E1UL, 0x00EE0D96UL, 0x3409A50FUL, 0x27AB3D78UL,
+        0x809C2506UL, 0x933EBD71UL, 0xA7D915E8UL, 0xB47B8D9FUL,
+        0xCE1644DAUL, 0xDDB4DCADUL, 0xE9537434UL, 0xFAF1EC43UL,
+        0x1D88E6BEUL, 0x0E2A7EC9UL, 0x3ACDD650UL, 0x296F4E27UL,
+        0x53028762UL, 0x40A01F15UL, 0x7447B78CUL, 0x67E52FFBUL,
+        0xBF59D487UL, 0xACFB4CF0UL, 0x981CE469UL, 0x8BBE7C1EUL,
+        0xF1D3B55BUL, 0xE2712D2CUL, 0xD69685B5UL, 0xC5341DC2UL,
+        0x224D173FUL, 0x31EF8F48UL, 0x050827D1UL, 0x16AABFA6UL,
+        0x6CC776E3UL, 0x7F65EE94UL, 0x4B82460DUL, 0x5820DE7AUL,
+        0xFBC3FAF9UL, 0xE861628EUL, 0xDC86CA17UL, 0xCF245260UL,
+        0xB5499B25UL, 0xA6EB0352UL, 0x920CABCBUL, 0x81AE33BCUL,
+        0x66D73941UL, 0x7575A136UL, 0x419209AFUL, 0x523091D8UL,
+        0x285D589DUL, 0x3BFFC0EAUL, 0x0F186873UL, 0x1CBAF004UL,
+        0xC4060B78UL, 0xD7A4930FUL, 0xE3433B96UL, 0xF0E1A3E1UL,
+        0x8A8C6AA4UL, 0x992EF2D3UL, 0xADC95A4AUL, 0xBE6BC23DUL,
+        0x5912C8C0UL, 0x4AB050B7UL, 0x7E57F82EUL, 0x6DF56059UL,
+        0x1798A91CUL, 0x043A316BUL, 0x30DD99F2UL, 0x237F0185UL,
+        0x844819FBUL, 0x97EA818CUL, 0xA30D2915UL, 0xB0AFB162UL,
+        0xCAC27827UL, 0xD960E050UL, 0xED8748C9UL, 0xFE25D0BEUL,
+        0x195CDA43UL, 0x0AFE4234UL, 0x3E19EAADUL, 0x2DBB72DAUL,
+        0x57D6BB9FUL, 0x447423E8UL, 0x70938B71UL, 0x63311306UL,
+        0xBB8DE87AUL, 0xA82F700DUL, 0x9CC8D894UL, 0x8F6A40E3UL,
+        0xF50789A6UL, 0xE6A511D1UL, 0xD242B948UL, 0xC1E0213FUL,
+        0x26992BC2UL, 0x353BB3B5UL, 0x01DC1B2CUL, 0x127E835BUL,
+        0x68134A1EUL, 0x7BB1D269UL, 0x4F567AF0UL, 0x5CF4E287UL,
+        0x04D43CFDUL, 0x1776A48AUL, 0x23910C13UL, 0x30339464UL,
+        0x4A5E5D21UL, 0x59FCC556UL, 0x6D1B6DCFUL, 0x7EB9F5B8UL,
+        0x99C0FF45UL, 0x8A626732UL, 0xBE85CFABUL, 0xAD2757DCUL,
+        0xD74A9E99UL, 0xC4E806EEUL, 0xF00FAE77UL, 0xE3AD3600UL,
+        0x3B11CD7CUL, 0x28B3550BUL, 0x1C54FD92UL, 0x0FF665E5UL,
+        0x759BACA0UL, 0x663934D7UL, 0x52DE9C4EUL, 0x417C0439UL,
+        0xA6050EC4UL, 0xB5A796B3UL, 0x81403E2AUL, 0x92E2A65DUL,
+        0xE88F6F18UL, 0xFB2DF76FUL, 0xCFCA5FF6UL, 0xDC68C781UL,
+        0x7B5FDFFFUL, 0x68FD4788UL, 0x5C1AEF11UL, 0x4FB87766UL,
+        0x35D5BE23UL, 0x26772654UL, 0x12908ECDUL, 0x013216BAUL,
+        0xE64B1C47UL, 0xF5E98430UL, 0xC10E2CA9UL, 0xD2ACB4DEUL,
+        0xA8C17D9BUL, 0xBB63E5ECUL, 0x8F844D75UL, 0x9C26D502UL,
+        0x449A2E7EUL, 0x5738B609UL, 0x63DF1E90UL, 0x707D86E7UL,
+        0x0A104FA2UL, 0x19B2D7D5UL, 0x2D557F4CUL, 0x3EF7E73BUL,
+        0xD98EEDC6UL, 0xCA2C75B1UL, 0xFECBDD28UL, 0xED69455FUL,
+        0x97048C1AUL, 0x84A6146DUL, 0xB041BCF4UL, 0xA3E32483UL
+    },
+    {
+        0x00000000UL, 0xA541927EUL, 0x4F6F520DUL, 0xEA2EC073UL,
+        0x9EDEA41AUL, 0x3B9F3664UL, 0xD1B1F617UL, 0x74F06469UL,
+        0x38513EC5UL, 0x9D10ACBBUL, 0x773E6CC8UL, 0xD27FFEB6UL,
+        0xA68F9ADFUL, 0x03CE08A1UL, 0xE9E0C8D2UL, 0x4CA15AACUL,
+        0x70A27D8AUL, 0xD5E3EFF4UL, 0x3FCD2F87UL, 0x9A8CBDF9UL,
+        0xEE7CD990UL, 0x4B3D4BEEUL, 0xA1138B9DUL, 0x045219E3UL,
+        0x48F3434FUL, 0xEDB2D131UL, 0x079C1142UL, 0xA2DD833CUL,
+        0xD62DE755UL, 0x736C752BUL, 0x9942B558UL, 0x3C032726UL,
+        0xE144FB14UL, 0x4405696AUL, 0xAE2BA919UL, 0x0B6A3B67UL,
+        0x7F9A5F0EUL, 0xDADBCD70UL, 0x30F50D03UL, 0x95B49F7DUL,
+        0xD915C5D1UL, 0x7C5457AFUL, 0x967A97DCUL, 0x333B05A2UL,
+        0x47CB61CBUL, 0xE28AF3B5UL, 0x08A433C6UL, 0xADE5A1B8UL,
+        0x91E6869EUL, 0x34A714E0UL, 0xDE89D493UL, 0x7BC846EDUL,
+        0x0F382284UL, 0xAA79B0FAUL, 0x40577089UL, 0xE516E2F7UL,
+        0xA9B7B85BUL, 0x0CF62A25UL, 0xE6D8EA56UL, 0x43997828UL,
+        0x37691C41UL, 0x92288E3FUL, 0x78064E4CUL, 0xDD47DC32UL,
+        0xC76580D9UL, 0x622412A7UL, 0x880AD2D4UL, 0x2D4B40AAUL,
+        0x59BB24C3UL, 0xFCFAB6BDUL, 0x16D476CEUL, 0xB395E4B0UL,
+        0xFF34BE1CUL, 0x5A752C62UL, 0xB05BEC11UL, 0x151A7E6FUL,
+        0x61EA1A06UL, 0xC4AB8878UL, 0x2E85480BUL, 0x8BC4DA75UL,
+        0xB7C7FD53UL, 0x12866F2DUL, 0xF8A8AF5EUL, 0x5DE93D20UL,
+        0x29195949UL, 0x8C58CB37UL, 0x66760B44UL, 0xC337993AUL,
+        0x8F96C396UL, 0x2AD751E8UL, 0xC0F9919BUL, 0x65B803E5UL,
+        0x1148678CUL, 0xB409F5F2UL, 0x5E273581UL, 0xFB66A7FFUL,
+        0x26217BCDUL, 0x8360E9B3UL, 0x694E29C0UL, 0xCC0FBBBEUL,
+        0xB8FFDFD7UL, 0x1DBE4DA9UL, 0xF7908DDAUL, 0x52D11FA4UL,
+        0x1E704508UL, 0xBB31D776UL, 0x511F1705UL, 0xF45E857BUL,
+        0x80AEE112UL, 0x25EF736CUL, 0xCFC1B31FUL, 0x6A802161UL,
+        0x56830647UL, 0xF3C29439UL, 0x19EC544AUL, 0xBCADC634UL,
+        0xC85DA25DUL, 0x6D1C3023UL, 0x8732F050UL, 0x2273622EUL,
+        0x6ED23882UL, 0xCB93AAFCUL, 0x21BD6A8FUL, 0x84FCF8F1UL,
+        0xF00C9C98UL, 0x554D0EE6UL, 0xBF63CE95UL, 0x1A225CEBUL,
+        0x8B277743UL, 0x2E66E53DUL, 0xC448254EUL, 0x6109B730UL,
+        0x15F9D359UL, 0xB0B84127UL, 0x5A968154UL, 0xFFD7132AUL,
+        0xB3764986UL, 0x1637DBF8UL, 0xFC191B8BUL, 0x595889F5UL,
+        0x2DA8ED9CUL, 0x88E97FE2UL, 0x62C7BF91UL, 0xC7862DEFUL,
+        0xFB850AC9UL, 0x5EC498B7UL, 0xB4EA58C4UL, 0x11ABCABAUL,
+        0x655BAED3UL, 0xC01A3CADUL, 0x2A34FCDEUL, 0x8F756EA0UL,
+        0xC3D4340CUL, 0x6695A672UL, 0x8CBB6601UL, 0x29FAF47FUL,
+        0x5D0A9016UL, 0xF84B0268UL, 0x1265C21BUL, 0xB7245065UL,
+        0x6A638C57UL, 0xCF221E29UL, 0x250CDE5AUL, 0x804D4C24UL,
+        0xF4BD284DUL, 0x51FCBA33UL, 0xBBD27A40UL, 0x1E93E83EUL,
+        0x5232B292UL, 0xF77320ECUL, 0x1D5DE09FUL, 0xB81C72E1UL,
+        0xCCEC1688UL, 0x69AD84F6UL, 0x83834485UL, 0x26C2D6FBUL,
+        0x1AC1F1DDUL, 0xBF8063A3UL, 0x55AEA3D0UL, 0xF0EF31AEUL,
+        0x841F55C7UL, 0x215EC7B9UL, 0xCB7007CAUL, 0x6E3195B4UL,
+        0x2290CF18UL, 0x87D15D66UL, 0x6DFF9D15UL, 0xC8BE0F6BUL,
+        0xBC4E6B02UL, 0x190FF97CUL, 0xF321390FUL, 0x5660AB71UL,
+        0x4C42F79AUL, 0xE90365E4UL, 0x032DA597UL, 0xA66C37E9UL,
+        0xD29C5380UL, 0x77DDC1FEUL, 0x9DF3018DUL, 0x38B293F3UL,
+        0x7413C95FUL, 0xD1525B21UL, 0x3B7C9B52UL, 0x9E3D092CUL,
+        0xEACD6D45UL, 0x4F8CFF3BUL, 0xA5A23F48UL, 0x00E3AD36UL,
+        0x3CE08A10UL, 0x99A1186EUL, 0x738FD81DUL, 0xD6CE4A63UL,
+        0xA23E2E0AUL, 0x077FBC74UL, 0xED517C07UL, 0x4810EE79UL,
+        0x04B1B4D5UL, 0xA1F026ABUL, 0x4BDEE6D8UL, 0xEE9F74A6UL,
+        0x9A6F10CFUL, 0x3F2E82B1UL, 0xD50042C2UL, 0x7041D0BCUL,
+        0xAD060C8EUL, 0x08479EF0UL, 0xE2695E83UL, 0x4728CCFDUL,
+        0x33D8A894UL, 0x96993AEAUL, 0x7CB7FA99UL, 0xD9F668E7UL,
+        0x9557324BUL, 0x3016A035UL, 0xDA386046UL, 0x7F79F238UL,
+        0x0B899651UL, 0xAEC8042FUL, 0x44E6C45CUL, 0xE1A75622UL,
+        0xDDA47104UL, 0x78E5E37AUL, 0x92CB2309UL, 0x378AB177UL,
+        0x437AD51EUL, 0xE63B4760UL, 0x0C158713UL, 0xA954156DUL,
+        0xE5F54FC1UL, 0x40B4DDBFUL, 0xAA9A1DCCUL, 0x0FDB8FB2UL,
+        0x7B2BEBDBUL, 0xDE6A79A5UL, 0x3444B9D6UL, 0x91052BA8UL
+    },
+    {
+        0x00000000UL, 0xDD45AAB8UL, 0xBF672381UL, 0x62228939UL,
+        0x7B2231F3UL, 0xA6679B4BUL, 0xC4451272UL, 0x1900B8CAUL,
+        0xF64463E6UL, 0x2B01C95EUL, 0x49234067UL, 0x9466EADFUL,
+        0x8D665215UL, 0x5023F8ADUL, 0x32017194UL, 0xEF44DB2CUL,
+        0xE964B13DUL, 0x34211B85UL, 0x560392BCUL, 0x8B463804UL,
+        0x924680CEUL, 0x4F032A76UL, 0x2D21A34FUL, 0xF06409F7UL,
+        0x1F20D2DBUL, 0xC2657863UL, 0xA047F15AUL, 0x7D025BE2UL,
+        0x6402E328UL, 0xB9474990UL, 0xDB65C0A9UL, 0x06206A11UL,
+        0xD725148BUL, 0x0A60BE33UL, 0x6842370AUL, 0xB5079DB2UL,
+        0xAC072578UL, 0x71428FC0UL, 0x136006F9UL, 0xCE25AC41UL,
+        0x2161776DUL, 0xFC24DDD5UL, 0x9E0654ECUL, 0x4343FE54UL,
+        0x5A43469EUL, 0x8706EC26UL, 0xE524651FUL, 0x3861CFA7UL,
+        0x3E41A5B6UL, 0xE3040F0EUL, 0x81268637UL, 0x5C632C8FUL,
+        0x45639445UL, 0x98263EFDUL, 0xFA04B7C4UL, 0x27411D7CUL,
+        0xC805C650UL, 0x15406CE8UL, 0x7762E5D1UL, 0xAA274F69UL,
+        0xB327F7A3UL, 0x6E625D1BUL, 0x0C40D422UL, 0xD1057E9AUL,
+        0xABA65FE7UL, 0x76E3F55FUL, 0x14C17C66UL, 0xC984D6DEUL,
+        0xD0846E14UL, 0x0DC1C4ACUL, 0x6FE34D95UL, 0xB2A6E72DUL,
+        0x5DE23C01UL, 0x80A796B9UL, 0xE2851F80UL, 0x3FC0B538UL,
+        0x26C00DF2UL, 0xFB85A74AUL, 0x99A72E73UL, 0x44E284CBUL,
+        0x42C2EEDAUL, 0x9F874462UL, 0xFDA5CD5BUL, 0x20E067E3UL,
+        0x39E0DF29UL, 0xE4A57591UL, 0x8687FCA8UL, 0x5BC25610UL,
+        0xB4868D3CUL, 0x69C32784UL, 0x0BE1AEBDUL, 0xD6A40405UL,
+        0xCFA4BCCFUL, 0x12E11677UL, 0x70C39F4EUL, 0xAD8635F6UL,
+        0x7C834B6CUL, 0xA1C6E1D4UL, 0xC3E468EDUL, 0x1EA1C255UL,
+        0x07A17A9FUL, 0xDAE4D027UL, 0xB8C6591EUL, 0x6583F3A6UL,
+        0x8AC7288AUL, 0x57828232UL, 0x35A00B0BUL, 0xE8E5A1B3UL,
+        0xF1E51979UL, 0x2CA0B3C1UL, 0x4E823AF8UL, 0x93C79040UL,
+        0x95E7FA51UL, 0x48A250E9UL, 0x2A80D9D0UL, 0xF7C57368UL,
+        0xEEC5CBA2UL, 0x3380611AUL, 0x51A2E823UL, 0x8CE7429BUL,
+        0x63A399B7UL, 0xBEE6330FUL, 0xDCC4BA36UL, 0x0181108EUL,
+        0x1881A844UL, 0xC5C402FCUL, 0xA7E68BC5UL, 0x7AA3217DUL,
+        0x52A0C93FUL, 0x8FE56387UL, 0xEDC7EABEUL, 0x30824006UL,
+        0x2982F8CCUL, 0xF4C75274UL, 0x96E5DB4DUL, 0x4BA071F5UL,
+        0xA4E4AAD9UL, 0x79A10061UL, 0x1B838958UL, 0xC6C623E0UL,
+        0xDFC69B2AUL, 0x02833192UL, 0x60A1B8ABUL, 0xBDE41213UL,
+        0xBBC47802UL, 0x6681D2BAUL, 0x04A35B83UL, 0xD9E6F13BUL,
+        0xC0E649F1UL, 0x1DA3E349UL, 0x7F816A70UL, 0xA2C4C0C8UL,
+        0x4D801BE4UL, 0x90C5B15CUL, 0xF2E73865UL, 0x2FA292DDUL,
+        0x36A22A17UL, 0xEBE780AFUL, 0x89C50996UL, 0x5480A32EUL,
+        0x8585DDB4UL, 0x58C0770CUL, 0x3AE2FE35UL, 0xE7A7548DUL,
+        0xFEA7EC47UL, 0x23E246FFUL, 0x41C0CFC6UL, 0x9C85657EUL,
+        0x73C1BE52UL, 0xAE8414EAUL, 0xCCA69DD3UL, 0x11E3376BUL,
+        0x08E38FA1UL, 0xD5A62519UL, 0xB784AC20UL, 0x6AC10698UL,
+        0x6CE16C89UL, 0xB1A4C631UL, 0xD3864F08UL, 0x0EC3E5B0UL,
+        0x17C35D7AUL, 0xCA86F7C2UL, 0xA8A47EFBUL, 0x75E1D443UL,
+        0x9AA50F6FUL, 0x47E0A5D7UL, 0x25C22CEEUL, 0xF8878656UL,
+        0xE1873E9CUL, 0x3CC29424UL, 0x5EE01D1DUL, 0x83A5B7A5UL,
+        0xF90696D8UL, 0x24433C60UL, 0x4661B559UL, 0x9B241FE1UL,
+        0x8224A72BUL, 0x5F610D93UL, 0x3D4384AAUL, 0xE0062E12UL,
+        0x0F42F53EUL, 0xD2075F86UL, 0xB025D6BFUL, 0x6D607C07UL,
+        0x7460C4CDUL, 0xA9256E75UL, 0xCB07E74CUL, 0x16424DF4UL,
+        0x106227E5UL, 0xCD278D5DUL, 0xAF050464UL, 0x7240AEDCUL,
+        0x6B401616UL, 0xB605BCAEUL, 0xD4273597UL, 0x09629F2FUL,
+        0xE6264403UL, 0x3B63EEBBUL, 0x59416782UL, 0x8404CD3AUL,
+        0x9D0475F0UL, 0x4041DF48UL, 0x22635671UL, 0xFF26FCC9UL,
+        0x2E238253UL, 0xF36628EBUL, 0x9144A1D2UL, 0x4C010B6AUL,
+        0x5501B3A0UL, 0x88441918UL, 0xEA669021UL, 0x37233A99UL,
+        0xD867E1B5UL, 0x05224B0DUL, 0x6700C234UL, 0xBA45688CUL,
+        0xA345D046UL, 0x7E007AFEUL, 0x1C22F3C7UL, 0xC167597FUL,
+        0xC747336EUL, 0x1A0299D6UL, 0x782010EFUL, 0xA565BA57UL,
+        0xBC65029DUL, 0x6120A825UL, 0x0302211CUL, 0xDE478BA4UL,
+        0x31035088UL, 0xEC46FA30UL, 0x8E647309UL, 0x5321D9B1UL,
+        0x4A21617BUL, 0x9764CBC3UL, 0xF54642FAUL, 0x2803E842UL
+    }
+};
 
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
+/* count symbols */
+static int AddSymbolCounts(const byte_t *buffer, size_t size,
+    count_t *counts);
+
+/* min-heap of nodes to be combined */
+static void HeapInsert(node_heap_t *heap, const int slot,
+    const count_t count, const int level);
+static int HeapRemoveMin(node_heap_t *heap);
+static int HeapLess(const node_heap_t *heap, const int slot1,
+    const int slot2);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -67,251 +390,841 @@
 *   Description: This routine creates a huffman tree optimized for encoding
 *                the file passed as a parameter.
 *   Parameters : inFile - Name of file to create tree for
+*                tree - pointer to the arena to build the tree in
 *   Effects    : Huffman tree is built for file.
-*   Returned   : Pointer to resulting tree.  NULL on failure.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure.
 ****************************************************************************/
-huffman_node_t *GenerateTreeFromFile(FILE *inFile)
+int GenerateTreeFromFile(FILE *inFile, huffman_tree_t *tree)
 {
-    huffman_node_t *huffmanArray[NUM_CHARS];    /* array of all leaves */
-    huffman_node_t *huffmanTree;                /* root of huffman tree */
-    int c;
+    count_t counts[NUM_CHARS];      /* number of occurrences of each char */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    if (0 != CountFileSymbols(inFile, counts))
+    {
+        return -1;
+    }
+
+    STATS_START(timer);
+    GenerateTreeFromCounts(counts, 1, tree);
+    STATS_STOP(STAT_TREE_NS, timer);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : CountFileSymbols
+*   Description: This routine counts the number of occurrences of each
+*                character in a file.
+*   Parameters : inFile - file to be counted
+*                counts - array of NUM_CHARS counts to fill
+*   Effects    : The rest of inFile is read.  counts[c] is set to the number
+*                of occurrences of c.  counts[EOF_CHAR] is set to 0.
+*   Returned   : 0 for success, -1 if a character occurs too many times to
+*                be counted.  errno will be set in the event of a failure.
+****************************************************************************/
+int CountFileSymbols(FILE *inFile, count_t *counts)
+{
+    int c, status;
+    size_t size;
+    byte_t buffer[COUNT_BUFFER_SIZE];   /* data being counted */
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
 
-    /* allocate array of leaves for all possible characters */
     for (c = 0; c < NUM_CHARS; c++)
     {
-        if ((huffmanArray[c] = AllocHuffmanNode(c)) == NULL)
+        counts[c] = 0;
+    }
+
+    /* count occurrence of each character a buffer at a time */
+    status = 0;
+
+    while ((size = fread(buffer, 1, COUNT_BUFFER_SIZE, inFile)) != 0)
+    {
+        if (0 != AddSymbolCounts(buffer, size, counts))
         {
-            /* allocation failed clear existing allocations */
-            for (c--; c >= 0; c--)
-            {
-                free(huffmanArray[c]);
-            }
-            return NULL;
+            status = -1;
+            break;
         }
     }
 
-    /* assume that there will be exactly 1 EOF */
-    huffmanArray[EOF_CHAR]->count = 1;
-    huffmanArray[EOF_CHAR]->ignore = 0;
+    STATS_STOP(STAT_HISTOGRAM_NS, timer);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : CountSymbols
+*   Description: This routine counts the number of occurrences of each
+*                character in a buffer.
+*   Parameters : buffer - pointer to the data to be counted
+*                size - number of bytes in buffer
+*                counts - array of NUM_CHARS counts to fill
+*   Effects    : counts[c] is set to the number of occurrences of c in
+*                buffer.  counts[EOF_CHAR] is set to 0.
+*   Returned   : 0 for success, -1 if a character occurs too many times to
+*                be counted.  errno will be set in the event of a failure.
+****************************************************************************/
+int CountSymbols(const byte_t *buffer, size_t size, count_t *counts)
+{
+    int c, status;
+#ifdef HUFFMAN_STATS
+    double timer;
+#endif
+
+    STATS_START(timer);
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        counts[c] = 0;
+    }
+
+    status = AddSymbolCounts(buffer, size, counts);
+    STATS_STOP(STAT_HISTOGRAM_NS, timer);
+    return status;
+}
+
+/****************************************************************************
+*   Function   : AddSymbolCounts
+*   Description: This routine adds the number of occurrences of each
+*                character in a buffer to a set of counts.
+*                Consecutive bytes are counted in NUM_HISTOGRAMS separate
+*                tables, which are summed at the end, so that a run of the
+*                same byte doesn't make each increment wait on the one
+*                before it.
+*   Parameters : buffer - pointer to the data to be counted
+*                size - number of bytes in buffer
+*                counts - array of counts to add to
+*   Effects    : The occurrences of each character c in buffer are added to
+*                counts[c].
+*   Returned   : 0 for success, -1 if a character occurs too many times to
+*                be counted.  errno will be set in the event of a failure.
+****************************************************************************/
+static int AddSymbolCounts(const byte_t *buffer, size_t size,
+    count_t *counts)
+{
+    size_t i, chunk;
+    int c;
+    count_t total;
+    count_t histogram[NUM_HISTOGRAMS][UCHAR_MAX + 1];
 
-    /* count occurrence of each character */
-    while ((c = fgetc(inFile)) != EOF)
+    while (size > 0)
     {
-        if (huffmanArray[c]->count < COUNT_T_MAX)
+        /* limit the chunk size so the histograms can't overflow */
+        chunk = (size < HISTOGRAM_CHUNK) ? size : HISTOGRAM_CHUNK;
+
+        for (c = 0; c <= UCHAR_MAX; c++)
         {
-            /* increment count for character and include in tree */
-            huffmanArray[c]->count++;
-            huffmanArray[c]->ignore = 0;
+            histogram[0][c] = 0;
+            histogram[1][c] = 0;
+            histogram[2][c] = 0;
+            histogram[3][c] = 0;
         }
-        else
+
+        for (i = 0; i + NUM_HISTOGRAMS <= chunk; i += NUM_HISTOGRAMS)
         {
-            fprintf(stderr,
-                "Input file contains too many 0x%02X to count.\n", c);
-            return NULL;
+            histogram[0][buffer[i]]++;
+            histogram[1][buffer[i + 1]]++;
+            histogram[2][buffer[i + 2]]++;
+            histogram[3][buffer[i + 3]]++;
         }
+
+        for (; i < chunk; i++)
+        {
+            histogram[0][buffer[i]]++;
+        }
+
+        /* add the histograms to the counts */
+        for (c = 0; c <= UCHAR_MAX; c++)
+        {
+            total = histogram[0][c] + histogram[1][c] + histogram[2][c] +
+                histogram[3][c];
+
+            if (counts[c] > COUNT_T_MAX - total)
+            {
+                fprintf(stderr,
+                    "Input contains too many 0x%02X to count.\n", c);
+                errno = ERANGE;
+                return -1;
+            }
+
+            counts[c] += total;
+        }
+
+        buffer += chunk;
+        size -= chunk;
     }
 
-    /* put array of leaves into a huffman tree */
-    huffmanTree = BuildHuffmanTree(huffmanArray, NUM_CHARS);
+    return 0;
+}
+
+/****************************************************************************
+*   Function   : IsRun
+*   Description: This function determines if a buffer is a single byte
+*                value repeated.
+*   Parameters : data - pointer to the data to check
+*                len - number of bytes in data
+*   Effects    : None
+*   Returned   : 1 if len is greater than 0 and every byte in data is the
+*                same, otherwise 0.
+****************************************************************************/
+int IsRun(const byte_t *data, const size_t len)
+{
+    size_t i;
+
+    if (0 == len)
+    {
+        return 0;
+    }
 
-    /* deallocate any unused leaves */
-    for (c = 0; c < EOF; c++)
+    for (i = 1; i < len; i++)
     {
-        if (1 == huffmanArray[c]->ignore)
+        if (data[i] != data[0])
         {
-            free(huffmanArray[c]);
+            return 0;
         }
     }
 
-    return huffmanTree;
+    return 1;
 }
 
 /****************************************************************************
-*   Function   : AllocHuffmanNode
-*   Description: This routine allocates and initializes memory for a node
-*                (tree entry for a single character) in a Huffman tree.
-*   Parameters : value - character value represented by this node
-*   Effects    : Memory for a huffman_node_t is allocated from the heap
-*   Returned   : Pointer to allocated node.  NULL on failure to allocate.
+*   Function   : GenerateTreeFromCounts
+*   Description: This routine creates a huffman tree from the number of
+*                occurrences of each character.
+*   Parameters : counts - number of occurrences of each character
+*                eof - 1 if exactly one EOF is assumed, regardless of the
+*                      value of counts[EOF_CHAR].  0 if there's no EOF.
+*                tree - pointer to the arena to build the tree in
+*   Effects    : Huffman tree is built for counts.
+*   Returned   : None
 ****************************************************************************/
-huffman_node_t *AllocHuffmanNode(int value)
+void GenerateTreeFromCounts(const count_t *counts, const int eof,
+    huffman_tree_t *tree)
 {
-    huffman_node_t *ht;
+    int c;
 
-    ht = (huffman_node_t *)(malloc(sizeof(huffman_node_t)));
+    InitHuffmanTree(tree);
 
-    if (ht != NULL)
+    for (c = 0; c < EOF_CHAR; c++)
     {
-        ht->value = value;
-        ht->ignore = 1;         /* will be 0 if one is found */
+        if (counts[c] != 0)
+        {
+            /* include character in tree */
+            tree->nodes[c].count = counts[c];
+            tree->nodes[c].ignore = 0;
+        }
+    }
 
-        /* at this point, the node is not part of a tree */
-        ht->count = 0;
-        ht->level = 0;
-        ht->left = NULL;
-        ht->right = NULL;
-        ht->parent = NULL;
+    if (eof)
+    {
+        /* assume that there will be exactly 1 EOF */
+        tree->nodes[EOF_CHAR].count = 1;
+        tree->nodes[EOF_CHAR].ignore = 0;
     }
-    else
+
+    /* put leaves into a huffman tree */
+    BuildHuffmanTree(tree);
+}
+
+/****************************************************************************
+*   Function   : InitHuffmanTree
+*   Description: This routine initializes a tree arena to hold a leaf for
+*                every character and nothing else.
+*   Parameters : tree - pointer to the arena to initialize
+*   Effects    : Every leaf is given a count of 0 and marked as ignored.
+*                Any previous tree in the arena is discarded.
+*   Returned   : None
+****************************************************************************/
+void InitHuffmanTree(huffman_tree_t *tree)
+{
+    int c;
+
+    for (c = 0; c < NUM_CHARS; c++)
     {
-        perror("Allocate Node");
+        tree->nodes[c].value = c;
+        tree->nodes[c].ignore = 1;      /* will be 0 if one is found */
+
+        /* at this point, the node is not part of a tree */
+        tree->nodes[c].count = 0;
+        tree->nodes[c].level = 0;
+        tree->nodes[c].left = NONE;
+        tree->nodes[c].right = NONE;
+        tree->nodes[c].parent = NONE;
     }
 
-    return ht;
+    tree->numNodes = NUM_CHARS;
+    tree->root = NONE;
 }
 
 /****************************************************************************
-*   Function   : AllocHuffmanCompositeNode
-*   Description: This routine allocates and initializes memory for a
-*                composite node (tree entry for multiple characters) in a
-*                Huffman tree.  The number of occurrences for a composite is
-*                the sum of occurrences of its children.
-*   Parameters : left - left child in tree
-*                right - right child in tree
-*   Effects    : Memory for a huffman_node_t is allocated from the heap
-*   Returned   : Pointer to allocated node
+*   Function   : BuildHuffmanTree
+*   Description: This function builds a huffman tree from the leaves of a
+*                tree arena.  The two active (ignore == 0) nodes with the
+*                smallest count are combined until only one is left.  In
+*                order to keep the tree shallow, if two nodes have the same
+*                count, the node with the lower level is selected first.
+*   Parameters : tree - pointer to an arena initialized by InitHuffmanTree
+*   Effects    : Composite nodes are added to the arena to join the active
+*                leaves into a huffman tree.
+*   Returned   : Index of the root of the Huffman Tree (also stored in
+*                tree->root), NONE if there are no active leaves.
 ****************************************************************************/
-static huffman_node_t *AllocHuffmanCompositeNode(huffman_node_t *left,
-    huffman_node_t *right)
+int BuildHuffmanTree(huffman_tree_t *tree)
 {
-    huffman_node_t *ht;
+    int i, node;
+    int min1, min2;                 /* two slots with the lowest count */
+    int slotNode[NUM_CHARS];        /* node currently in each slot */
+    node_heap_t heap;               /* slots of nodes still to combine */
+    huffman_node_t *nodes;
 
-    ht = (huffman_node_t *)(malloc(sizeof(huffman_node_t)));
+    /***********************************************************************
+    * Each leaf starts out in the slot of its own index.  A composite takes
+    * the slot of the first of the nodes it combines, so that ties between
+    * nodes are broken in the same order no matter when they were made.
+    ***********************************************************************/
+    nodes = tree->nodes;
+    tree->numNodes = NUM_CHARS;
+    heap.size = 0;
 
-    if (ht != NULL)
+    for (i = 0; i < NUM_CHARS; i++)
     {
-        ht->value = COMPOSITE_NODE;     /* represents multiple chars */
-        ht->ignore = 0;
-        ht->count = left->count + right->count;     /* sum of children */
-        ht->level = max(left->level, right->level) + 1;
+        slotNode[i] = i;
+        nodes[i].parent = NONE;
 
-        /* attach children */
-        ht->left = left;
-        ht->left->parent = ht;
-        ht->right = right;
-        ht->right->parent = ht;
-        ht->parent = NULL;
+        if (!nodes[i].ignore)
+        {
+            HeapInsert(&heap, i, nodes[i].count, nodes[i].level);
+        }
     }
-    else
+
+    /* keep looking until no more nodes can be found */
+    for (;;)
     {
-        perror("Allocate Composite");
-        return NULL;
+        /* find node with lowest count */
+        if ((min1 = HeapRemoveMin(&heap)) == NONE)
+        {
+            /* there weren't any nodes */
+            tree->root = NONE;
+            return NONE;
+        }
+
+        nodes[slotNode[min1]].ignore = 1;   /* remove from consideration */
+
+        /* find node with second lowest count */
+        if ((min2 = HeapRemoveMin(&heap)) == NONE)
+        {
+            /* no more nodes to combine */
+            break;
+        }
+
+        nodes[slotNode[min2]].ignore = 1;   /* remove from consideration */
+
+        /* combine nodes into a composite (count is sum of children) */
+        node = tree->numNodes;
+        tree->numNodes++;
+
+        nodes[node].value = COMPOSITE_NODE;
+        nodes[node].ignore = 0;
+        nodes[node].count =
+            nodes[slotNode[min1]].count + nodes[slotNode[min2]].count;
+        nodes[node].level =
+            max(nodes[slotNode[min1]].level, nodes[slotNode[min2]].level) + 1;
+
+        /* attach children */
+        nodes[node].left = slotNode[min1];
+        nodes[node].right = slotNode[min2];
+        nodes[node].parent = NONE;
+        nodes[slotNode[min1]].parent = node;
+        nodes[slotNode[min2]].parent = node;
+
+        slotNode[min1] = node;
+        HeapInsert(&heap, min1, nodes[node].count, nodes[node].level);
     }
 
-    return ht;
+    tree->root = slotNode[min1];
+    return tree->root;
 }
 
 /****************************************************************************
-*   Function   : FreeHuffmanTree
-*   Description: This is a recursive routine for freeing the memory
-*                allocated for a node and all of its descendants.
-*   Parameters : ht - structure to delete along with its children.
-*   Effects    : Memory for a huffman_node_t and its children is returned to
-*                the heap.
+*   Function   : BuildCodeLengths
+*   Description: This function computes the length of the code that the
+*                tree built by GenerateTreeFromCounts would give each
+*                character, without building the tree.
+*   Parameters : counts - number of occurrences of each character
+*                eof - 1 if exactly one EOF is assumed, regardless of the
+*                      value of counts[EOF_CHAR].  0 if there's no EOF.
+*                lengths - array of NUM_CHARS code lengths to fill
+*   Effects    : lengths[c] is set to the depth of c in the tree (at most
+*                UCHAR_MAX), or 0 if c doesn't occur.  A lone character gets
+*                a 1 bit code.
 *   Returned   : None
 ****************************************************************************/
-void FreeHuffmanTree(huffman_node_t *ht)
+void BuildCodeLengths(const count_t *counts, const int eof, byte_t *lengths)
 {
-    if (ht->left != NULL)
+    int c, node, nextNode;
+    int min1, min2;                     /* slots with the lowest counts */
+    node_heap_t heap;                   /* slots still to be combined */
+    int slotNode[NUM_CHARS];            /* node currently in each slot */
+    int parent[2 * NUM_CHARS];          /* parent of each node */
+    int depth[2 * NUM_CHARS];           /* depth of each node */
+
+    /***********************************************************************
+    * Nodes 0 through NUM_CHARS - 1 are the leaves, composites are numbered
+    * after them.  Like BuildHuffmanTree, a composite takes the slot of the
+    * first of the nodes it combines, so nodes are combined in the same
+    * order.
+    ***********************************************************************/
+    heap.size = 0;
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        parent[c] = NONE;
+        slotNode[c] = c;
+
+        if (EOF_CHAR == c)
+        {
+            if (eof)
+            {
+                /* assume that there will be exactly 1 EOF */
+                HeapInsert(&heap, c, 1, 0);
+            }
+        }
+        else if (counts[c] != 0)
+        {
+            HeapInsert(&heap, c, counts[c], 0);
+        }
+    }
+
+    nextNode = NUM_CHARS;
+
+    for (;;)
     {
-        FreeHuffmanTree(ht->left);
+        if ((min1 = HeapRemoveMin(&heap)) == NONE)
+        {
+            /* there weren't any characters */
+            break;
+        }
+
+        if ((min2 = HeapRemoveMin(&heap)) == NONE)
+        {
+            /* min1 holds the root */
+            break;
+        }
+
+        /* combine nodes into a composite */
+        node = nextNode;
+        nextNode++;
+        parent[node] = NONE;
+        parent[slotNode[min1]] = node;
+        parent[slotNode[min2]] = node;
+        slotNode[min1] = node;
+        HeapInsert(&heap, min1, heap.count[min1] + heap.count[min2],
+            max(heap.level[min1], heap.level[min2]) + 1);
     }
 
-    if (ht->right != NULL)
+    /* parents are numbered after their children, so work down from root */
+    for (node = nextNode - 1; node >= 0; node--)
     {
-        FreeHuffmanTree(ht->right);
+        if (NONE == parent[node])
+        {
+            depth[node] = 0;
+        }
+        else
+        {
+            depth[node] = depth[parent[node]] + 1;
+        }
     }
 
-    free(ht);
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        if ((0 == counts[c]) && ((c != EOF_CHAR) || !eof))
+        {
+            lengths[c] = 0;
+        }
+        else if (0 == depth[c])
+        {
+            /* handle one symbol trees */
+            lengths[c] = 1;
+        }
+        else
+        {
+            lengths[c] = (depth[c] < UCHAR_MAX) ? depth[c] : UCHAR_MAX;
+        }
+    }
 }
 
 /****************************************************************************
-*   Function   : FindMinimumCount
-*   Description: This function searches an array of HUFFMAN_STRCUT to find
-*                the active (ignore == 0) element with the smallest
-*                frequency count.  In order to keep the tree shallow, if two
-*                nodes have the same count, the node with the lower level
-*                selected.
-*   Parameters : ht - pointer to array of structures to be searched
-*                elements - number of elements in the array
-*   Effects    : None
-*   Returned   : Index of the active element with the smallest count.
-*                NONE is returned if no minimum is found.
+*   Function   : HeapInsert
+*   Description: This function adds a slot to a heap of slots to be
+*                combined.
+*   Parameters : heap - pointer to heap
+*                slot - slot to be added (not already in the heap)
+*                count - count of the node in the slot
+*                level - level of the node in the slot
+*   Effects    : The slot is added to the heap.
+*   Returned   : None
 ****************************************************************************/
-static int FindMinimumCount(huffman_node_t **ht, int elements)
+static void HeapInsert(node_heap_t *heap, const int slot,
+    const count_t count, const int level)
 {
-    int i;                      /* array index */
-    int currentIndex;           /* index with lowest count seen so far */
-    unsigned int currentCount;  /* lowest count seen so far */
-    int currentLevel;           /* level of lowest count seen so far */
-
-    currentIndex = NONE;
-    currentCount = UINT_MAX;
-    currentLevel = INT_MAX;
-
-    /* sequentially search array */
-    for (i = 0; i < elements; i++)
-    {
-        /* check for lowest count (or equally as low, but not as deep) */
-        if ((ht[i] != NULL) && (!ht[i]->ignore) &&
-            (ht[i]->count < currentCount ||
-                (ht[i]->count == currentCount && ht[i]->level < currentLevel)))
+    int i, parent;
+
+    heap->count[slot] = count;
+    heap->level[slot] = level;
+
+    /* move the slot up until it isn't less than its parent */
+    i = heap->size;
+    heap->size++;
+
+    while (i > 0)
+    {
+        parent = (i - 1) / 2;
+
+        if (!HeapLess(heap, slot, heap->slot[parent]))
         {
-            currentIndex = i;
-            currentCount = ht[i]->count;
-            currentLevel = ht[i]->level;
+            break;
         }
+
+        heap->slot[i] = heap->slot[parent];
+        i = parent;
     }
 
-    return currentIndex;
+    heap->slot[i] = slot;
 }
 
 /****************************************************************************
-*   Function   : BuildHuffmanTree
-*   Description: This function builds a huffman tree from an array of
-*                HUFFMAN_STRCUT.
-*   Parameters : ht - pointer to array of structures to be searched
-*                elements - number of elements in the array
-*   Effects    : Array of huffman_node_t is built into a huffman tree.
-*   Returned   : Pointer to the root of a Huffman Tree
+*   Function   : HeapRemoveMin
+*   Description: This function removes the slot holding the node with the
+*                smallest count from a heap.  Ties are broken by the lower
+*                level, then the lower slot.
+*   Parameters : heap - pointer to heap
+*   Effects    : The slot is removed from the heap.
+*   Returned   : The slot removed, or NONE if the heap is empty.
 ****************************************************************************/
-huffman_node_t *BuildHuffmanTree(huffman_node_t **ht, int elements)
+static int HeapRemoveMin(node_heap_t *heap)
 {
-    int min1, min2;     /* two nodes with the lowest count */
+    int i, child, min, last;
+
+    if (0 == heap->size)
+    {
+        return NONE;
+    }
+
+    min = heap->slot[0];
+    heap->size--;
+    last = heap->slot[heap->size];
+
+    /* move the last slot down from the top until it's in order */
+    i = 0;
 
-    /* keep looking until no more nodes can be found */
     for (;;)
     {
-        /* find node with lowest count */
-        min1 = FindMinimumCount(ht, elements);
+        child = 2 * i + 1;
 
-        if (min1 == NONE)
+        if (child >= heap->size)
         {
-            /* no more nodes to combine */
             break;
         }
 
-        ht[min1]->ignore = 1;       /* remove from consideration */
-
-        /* find node with second lowest count */
-        min2 = FindMinimumCount(ht, elements);
+        if ((child + 1 < heap->size) &&
+            HeapLess(heap, heap->slot[child + 1], heap->slot[child]))
+        {
+            child++;
+        }
 
-        if (min2 == NONE)
+        if (!HeapLess(heap, heap->slot[child], last))
         {
-            /* no more nodes to combine */
             break;
         }
 
-        ht[min2]->ignore = 1;       /* remove from consideration */
+        heap->slot[i] = heap->slot[child];
+        i = child;
+    }
+
+    heap->slot[i] = last;
+    return min;
+}
+
+/****************************************************************************
+*   Function   : HeapLess
+*   Description: This function determines if the node in one slot should be
+*                combined before the node in another slot.
+*   Parameters : heap - pointer to heap holding the slots
+*                slot1 - first slot to compare
+*                slot2 - second slot to compare
+*   Effects    : None
+*   Returned   : Non-zero if the slot1 node has a lower count, or the same
+*                count and a lower level, or the same count and level and
+*                slot1 < slot2.  Otherwise 0.
+****************************************************************************/
+static int HeapLess(const node_heap_t *heap, const int slot1,
+    const int slot2)
+{
+    if (heap->count[slot1] != heap->count[slot2])
+    {
+        return (heap->count[slot1] < heap->count[slot2]);
+    }
+
+    if (heap->level[slot1] != heap->level[slot2])
+    {
+        return (heap->level[slot1] < heap->level[slot2]);
+    }
+
+    return (slot1 < slot2);
+}
+
+/****************************************************************************
+*   Function   : Crc32c
+*   Description: This routine adds a buffer to a running CRC-32C.
+*   Parameters : crc - the CRC of all the data before buffer (0 for no
+*                      data)
+*                buffer - pointer to the data to add
+*                size - number of bytes in buffer
+*   Effects    : None
+*   Returned   : The CRC of the data before buffer followed by buffer.
+****************************************************************************/
+unsigned long Crc32c(unsigned long crc, const byte_t *buffer, size_t size)
+{
+    crc = ~crc & 0xFFFFFFFFUL;
+
+    /* fold 4 bytes at a time into the CRC (slicing-by-4) */
+    while (size >= 4)
+    {
+        crc ^= (unsigned long)buffer[0] |
+            ((unsigned long)buffer[1] << 8) |
+            ((unsigned long)buffer[2] << 16) |
+            ((unsigned long)buffer[3] << 24);
+        crc = crcTable[3][crc & 0xFF] ^
+            crcTable[2][(crc >> 8) & 0xFF] ^
+            crcTable[1][(crc >> 16) & 0xFF] ^
+            crcTable[0][(crc >> 24) & 0xFF];
+        buffer += 4;
+        size -= 4;
+    }
+
+    while (size > 0)
+    {
+        crc = crcTable[0][(crc ^ *buffer) & 0xFF] ^ (crc >> 8);
+        buffer++;
+        size--;
+    }
+
+    return ~crc & 0xFFFFFFFFUL;
+}
+
+/****************************************************************************
+*   Function   : HuffmanGetStats
+*   Description: This routine returns the statistics collected since the
+*                library was loaded, or since the last call to
+*                HuffmanResetStats.
+*   Parameters : stats - pointer to the structure receiving the statistics
+*   Effects    : stats is filled in.
+*   Returned   : 0 for success, -1 for failure.  errno will be set in the
+*                event of a failure (ENOSYS if the library was built
+*                without HUFFMAN_STATS).
+****************************************************************************/
+int HuffmanGetStats(huffman_stats_t *stats)
+{
+    if (NULL == stats)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+#ifdef HUFFMAN_STATS
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_lock(&statsLock);
+#endif
+
+    stats->bytesIn = totals[STAT_BYTES_IN];
+    stats->bytesOut = totals[STAT_BYTES_OUT];
+    stats->blocks = (unsigned long)totals[STAT_BLOCKS];
+    stats->tableBuilds = (unsigned long)totals[STAT_TABLE_BUILDS];
+    stats->refills = (unsigned long)totals[STAT_REFILLS];
+    stats->histogramNs = totals[STAT_HISTOGRAM_NS];
+    stats->treeNs = totals[STAT_TREE_NS];
+    stats->headerNs = totals[STAT_HEADER_NS];
+    stats->codingNs = totals[STAT_CODING_NS];
+    stats->symbols = totals[STAT_SYMBOLS];
+    stats->codedBits = totals[STAT_CODED_BITS];
+    stats->entropyBits = totals[STAT_ENTROPY_BITS];
+
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_unlock(&statsLock);
+#endif
+    return 0;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/****************************************************************************
+*   Function   : HuffmanResetStats
+*   Description: This routine sets all of the statistics collected by the
+*                library back to 0.
+*   Parameters : None
+*   Effects    : The statistics are cleared.  Nothing happens if the
+*                library was built without HUFFMAN_STATS.
+*   Returned   : None
+****************************************************************************/
+void HuffmanResetStats(void)
+{
+#ifdef HUFFMAN_STATS
+    int i;
+
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_lock(&statsLock);
+#endif
+
+    for (i = 0; i < NUM_STATS; i++)
+    {
+        totals[i] = 0;
+    }
+
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_unlock(&statsLock);
+#endif
+#endif
+}
+
+#ifdef HUFFMAN_STATS
+/****************************************************************************
+*   Function   : StatsNow
+*   Description: This routine returns the current time for timing the
+*                stages of coding.  A monotonic wall clock is used where
+*                POSIX timers are available.
+*   Parameters : None
+*   Effects    : None
+*   Returned   : The current time in nanoseconds.
+****************************************************************************/
+double StatsNow(void)
+{
+#if defined(_POSIX_TIMERS) && (_POSIX_TIMERS > 0)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+#else
+    return (double)clock() * (1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+/****************************************************************************
+*   Function   : StatsAdd
+*   Description: This routine adds a value to one of the statistics.  It's
+*                called once per buffer or block, never once per symbol.
+*   Parameters : stat - the statistic to add to
+*                value - amount to add
+*   Effects    : value is added to the total for stat.
+*   Returned   : None
+****************************************************************************/
+void StatsAdd(const stat_t stat, const double value)
+{
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_lock(&statsLock);
+#endif
+
+    totals[stat] += value;
+
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_unlock(&statsLock);
+#endif
+}
 
-        /* combine nodes into a tree */
-        if ((ht[min1] = AllocHuffmanCompositeNode(ht[min1], ht[min2])) == NULL)
+/****************************************************************************
+*   Function   : StatsAddCode
+*   Description: This routine adds the symbols that a code was built from,
+*                the bits the code takes to encode them, and the number of
+*                bits their entropy calls for, to the statistics.
+*   Parameters : counts - number of occurrences of each symbol
+*                codedBits - sum of the count times the code length of
+*                            each symbol
+*   Effects    : The statistics for the code are added to the totals.
+*   Returned   : None
+****************************************************************************/
+void StatsAddCode(const count_t *counts, const double codedBits)
+{
+    int c;
+    double total, entropy;
+
+    total = 0;
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        total += counts[c];
+    }
+
+    /* entropy is the sum of -log2(p) for every symbol */
+    entropy = 0;
+
+    for (c = 0; c < NUM_CHARS; c++)
+    {
+        if (0 != counts[c])
         {
-            return NULL;
+            entropy -= counts[c] * (log(counts[c] / total) / log(2.0));
         }
-
-        ht[min2] = NULL;
     }
 
-    return ht[min1];
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_lock(&statsLock);
+#endif
+
+    totals[STAT_SYMBOLS] += total;
+    totals[STAT_CODED_BITS] += codedBits;
+    totals[STAT_ENTROPY_BITS] += entropy;
+
+#ifndef HUFFMAN_NO_THREADS
+    pthread_mutex_unlock(&statsLock);
+#endif
+}
+
+/****************************************************************************
+*   Function   : StatsTell
+*   Description: This routine returns the position of a file, so the bytes
+*                coded to or from it may be counted.  Unlike ftell, errno
+*                is left alone if the file isn't seekable.
+*   Parameters : fp - pointer to the file
+*   Effects    : None
+*   Returned   : The position of fp, or -1 if it can't be determined.
+****************************************************************************/
+long StatsTell(FILE *fp)
+{
+    int error;
+    long pos;
+
+    error = errno;
+    pos = ftell(fp);
+    errno = error;
+    return pos;
+}
+
+/****************************************************************************
+*   Function   : StatsAddFile
+*   Description: This routine adds the number of bytes that a file has
+*                moved since a position returned by StatsTell to the
+*                statistics.  Nothing is added for files that aren't
+*                seekable.
+*   Parameters : stat - the statistic to add to (STAT_BYTES_IN or
+*                       STAT_BYTES_OUT)
+*                start - earlier position of fp
+*                fp - pointer to the file
+*   Effects    : The bytes read or written are added to the total for stat.
+*   Returned   : None
+****************************************************************************/
+void StatsAddFile(const stat_t stat, const long start, FILE *fp)
+{
+    long pos;
+
+    pos = StatsTell(fp);
+
+    if ((start >= 0) && (pos >= start))
+    {
+        StatsAdd(stat, (double)(pos - start));
+    }
 }
+#endif  /* HUFFMAN_STATS */
@@ -37,6 +37,17 @@
 ***************************************************************************/
 #include <limits.h>
 
+/***************************************************************************
+*                                CONSTANTS
+***************************************************************************/
+#define NONE    -1
+
+#define COUNT_T_MAX     UINT_MAX    /* based on count_t being unsigned int */
+
+#define COMPOSITE_NODE      -1      /* node represents multiple characters */
+#define NUM_CHARS   (UCHAR_MAX + 2) /* Add an extra char for EOF */
+#define EOF_CHAR    (NUM_CHARS - 1) /* index used for EOF */
+
 /***************************************************************************
 *                            TYPE DEFINITIONS
 ***************************************************************************/
@@ -62,37 +73,113 @@ typedef struct huffman_node_t
     int level;          /* depth in tree (root is 0) */
 
     /***********************************************************************
-    *  pointer to children and parent.
+    *  index of children and parent in the tree's nodes (NONE if there is
+    *  no such node).
     *  NOTE: parent is only useful if non-recursive methods are used to
     *        search the huffman tree.
     ***********************************************************************/
-    struct huffman_node_t *left, *right, *parent;
+    int left, right, parent;
 } huffman_node_t;
 
 /***************************************************************************
-*                                CONSTANTS
+* All of the nodes of a tree live in a single caller supplied arena.  The
+* leaf for character c is always nodes[c], and composite nodes follow the
+* leaves.  A tree may be rebuilt in the same arena any number of times.
 ***************************************************************************/
-#define NONE    -1
-
-#define COUNT_T_MAX     UINT_MAX    /* based on count_t being unsigned int */
+typedef struct huffman_tree_t
+{
+    huffman_node_t nodes[2 * NUM_CHARS];    /* leaves, then composites */
+    int numNodes;                           /* number of nodes in use */
+    int root;                               /* index of root (or NONE) */
+} huffman_tree_t;
 
-#define COMPOSITE_NODE      -1      /* node represents multiple characters */
-#define NUM_CHARS   (UCHAR_MAX + 2) /* Add an extra char for EOF */
-#define EOF_CHAR    (NUM_CHARS - 1) /* index used for EOF */
+#ifdef HUFFMAN_STATS
+/* statistics collected while coding (see huffman_stats_t) */
+typedef enum
+{
+    STAT_BYTES_IN,          /* bytes read by the coders */
+    STAT_BYTES_OUT,         /* bytes written by the coders */
+    STAT_BLOCKS,            /* blocks coded by the block coders */
+    STAT_TABLE_BUILDS,      /* codes and decoders built */
+    STAT_REFILLS,           /* refills of memory bit reader accumulators */
+    STAT_HISTOGRAM_NS,      /* nanoseconds spent counting symbols */
+    STAT_TREE_NS,           /* nanoseconds spent building codes/decoders */
+    STAT_HEADER_NS,         /* nanoseconds spent on code length headers */
+    STAT_CODING_NS,         /* nanoseconds spent in coding loops */
+    STAT_SYMBOLS,           /* symbols that codes were built for */
+    STAT_CODED_BITS,        /* bits the codes use for those symbols */
+    STAT_ENTROPY_BITS,      /* bits the symbols' entropy calls for */
+    NUM_STATS
+} stat_t;
+#endif
 
 /***************************************************************************
 *                                 MACROS
 ***************************************************************************/
 #define max(a, b) ((a)>(b)?(a):(b))
 
+/***************************************************************************
+* Statistics are only collected when HUFFMAN_STATS is defined; otherwise
+* these macros do nothing.  The timer used by STATS_START and STATS_STOP
+* is a double, and the file position used by STATS_TELL and STATS_ADD_FILE
+* is a long.  Both must be declared inside #ifdef HUFFMAN_STATS.
+***************************************************************************/
+#ifdef HUFFMAN_STATS
+#define STATS_START(timer)      ((timer) = StatsNow())
+#define STATS_STOP(stat, timer) StatsAdd((stat), StatsNow() - (timer))
+#define STATS_ADD(stat, n)      StatsAdd((stat), (double)(n))
+#define STATS_TELL(pos, fp)     ((pos) = StatsTell(fp))
+#define STATS_ADD_FILE(stat, pos, fp)   StatsAddFile((stat), (pos), (fp))
+#else
+#define STATS_START(timer)      ((void)0)
+#define STATS_STOP(stat, timer) ((void)0)
+#define STATS_ADD(stat, n)      ((void)0)
+#define STATS_TELL(pos, fp)     ((void)0)
+#define STATS_ADD_FILE(stat, pos, fp)   ((void)0)
+#endif
+
 /***************************************************************************
 *                               PROTOTYPES
 ***************************************************************************/
 
-/* create/destroy tree */
-huffman_node_t *GenerateTreeFromFile(FILE *inFile);
-huffman_node_t *BuildHuffmanTree(huffman_node_t **ht, int elements);
-huffman_node_t *AllocHuffmanNode(int value);
-void FreeHuffmanTree(huffman_node_t *ht);
+/* create tree */
+int GenerateTreeFromFile(FILE *inFile, huffman_tree_t *tree);
+void GenerateTreeFromCounts(const count_t *counts, const int eof,
+    huffman_tree_t *tree);
+void InitHuffmanTree(huffman_tree_t *tree);
+int BuildHuffmanTree(huffman_tree_t *tree);
+
+/* code lengths only */
+void BuildCodeLengths(const count_t *counts, const int eof, byte_t *lengths);
+
+/* count symbols */
+int CountFileSymbols(FILE *inFile, count_t *counts);
+int CountSymbols(const byte_t *buffer, size_t size, count_t *counts);
+int IsRun(const byte_t *data, const size_t len);
+
+/* checksums */
+unsigned long Crc32c(unsigned long crc, const byte_t *buffer, size_t size);
+
+#ifdef HUFFMAN_STATS
+/* statistics */
+double StatsNow(void);
+void StatsAdd(const stat_t stat, const double value);
+void StatsAddCode(const count_t *counts, const double codedBits);
+long StatsTell(FILE *fp);
+void StatsAddFile(const stat_t stat, const long start, FILE *fp);
+#endif
+
+/* canonical coding of interleaved streams (canonical.c) */
+size_t CanonicalInterleavedBound(size_t size);
+int CanonicalEncodeInterleaved(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstCap, size_t *outLen, const int compact);
+int CanonicalDecodeInterleaved(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstLen, const int compact);
+
+/* canonical coding with codes chosen by the previous symbol (canonical.c) */
+int CanonicalEncodeOrder1(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstCap, size_t *outLen);
+int CanonicalDecodeOrder1(const byte_t *src, size_t srcLen, byte_t *dst,
+    size_t dstLen);
 
 #endif  /* define _HUFFMAN_LOCAL_H */
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include "huffman.h"
 #include "optlist/optlist.h"
 
@@ -55,6 +56,7 @@ typedef enum
 *                               PROTOTYPES
 ***************************************************************************/
 static void ShowUsage(FILE *stream, char *progPath);
+static void ShowStats(FILE *stream);
 
 /***************************************************************************
 *                                FUNCTIONS
@@ -73,19 +75,38 @@ static void ShowUsage(FILE *stream, char *progPath);
 ****************************************************************************/
 int main (int argc, char *argv[])
 {
-    int status, canonical;
+    int status, canonical, compact, stream, mapped, seekable, ranged, order1;
+    int numThreads, tradThreads, verbose, error;
+    unsigned long offset, maxSize;
+    size_t length;
+    void *range;
     option_t *optList, *thisOpt;
     FILE *inFile, *outFile;
+    char *inName, *outName, *end;
     mode_t mode;
 
     /* initialize variables */
     inFile = NULL;
     outFile = NULL;
+    inName = NULL;
+    outName = NULL;
     mode = SHOW_TREE;
     canonical = 0;
+    compact = 0;
+    stream = 0;
+    mapped = 0;
+    seekable = 0;
+    ranged = 0;
+    order1 = 0;
+    offset = 0;
+    length = 0;
+    maxSize = ULONG_MAX;
+    numThreads = 1;
+    tradThreads = 0;
+    verbose = 0;
 
     /* parse command line */
-    optList = GetOptList(argc, argv, "Ccdtni:o:h?");
+    optList = GetOptList(argc, argv, "Ccdtkspmxr:j:T:l:nvi:o:h?");
     thisOpt = optList;
 
     while (thisOpt != NULL)
@@ -108,6 +129,130 @@ int main (int argc, char *argv[])
                 mode = SHOW_TREE;
                 break;
 
+            case 'k':       /* traditional code with a compact header */
+                compact = 1;
+                break;
+
+            case 's':       /* canonical code in blocks */
+                stream = 1;
+                break;
+
+            case 'p':       /* blocks coded using the previous byte */
+                order1 = 1;
+                stream = 1;
+                break;
+
+            case 'm':       /* blocks coded between memory mapped files */
+                mapped = 1;
+                break;
+
+            case 'x':       /* blocks with a seek index */
+                seekable = 1;
+                stream = 1;
+                break;
+
+            case 'r':       /* range of decoded bytes */
+                offset = strtoul(thisOpt->argument, &end, 0);
+
+                if (',' == *end)
+                {
+                    length = (size_t)strtoul(end + 1, &end, 0);
+                }
+
+                if ((end == thisOpt->argument) || ('\0' != *end))
+                {
+                    fprintf(stderr, "Invalid range.\n");
+
+                    if (inFile != NULL)
+                    {
+                        fclose(inFile);
+                    }
+
+                    if (outFile != NULL)
+                    {
+                        fclose(outFile);
+                    }
+
+                    FreeOptList(optList);
+                    return EINVAL;
+                }
+
+                ranged = 1;
+                mode = DECOMPRESS;
+                break;
+
+            case 'j':       /* number of threads coding blocks */
+                numThreads = atoi(thisOpt->argument);
+
+                if (numThreads < 1)
+                {
+                    fprintf(stderr, "Invalid number of threads.\n");
+
+                    if (inFile != NULL)
+                    {
+                        fclose(inFile);
+                    }
+
+                    if (outFile != NULL)
+                    {
+                        fclose(outFile);
+                    }
+
+                    FreeOptList(optList);
+                    return EINVAL;
+                }
+
+                stream = 1;
+                break;
+
+            case 'T':       /* threads encoding a traditional code */
+                tradThreads = atoi(thisOpt->argument);
+
+                if (tradThreads < 1)
+                {
+                    fprintf(stderr, "Invalid number of threads.\n");
+
+                    if (inFile != NULL)
+                    {
+                        fclose(inFile);
+                    }
+
+                    if (outFile != NULL)
+                    {
+                        fclose(outFile);
+                    }
+
+                    FreeOptList(optList);
+                    return EINVAL;
+                }
+                break;
+
+            case 'l':       /* most bytes a canonical code may decode */
+                maxSize = strtoul(thisOpt->argument, &end, 0);
+
+                if ((end == thisOpt->argument) || ('\0' != *end))
+                {
+                    fprintf(stderr, "Invalid decode limit.\n");
+
+                    if (inFile != NULL)
+                    {
+                        fclose(inFile);
+                    }
+
+                    if (outFile != NULL)
+                    {
+                        fclose(outFile);
+                    }
+
+                    FreeOptList(optList);
+                    return EINVAL;
+                }
+                break;
+
+            case 'v':       /* show statistics */
+                verbose = 1;
+                break;
+
             case 'i':       /* input file name */
                 if (inFile != NULL)
                 {
@@ -134,6 +279,8 @@ int main (int argc, char *argv[])
                     FreeOptList(optList);
                     return errno;
                 }
+
+                inName = thisOpt->argument;
                 break;
 
             case 'o':       /* output file name */
@@ -162,6 +309,8 @@ int main (int argc, char *argv[])
                     FreeOptList(optList);
                     return errno;
                 }
+
+                outName = thisOpt->argument;
                 break;
 
             case 'h':
@@ -177,6 +326,20 @@ int main (int argc, char *argv[])
     }
 
     /* validate command line */
+    if (stream && (mode != SHOW_TREE))
+    {
+        /* streams may be piped */
+        if (inFile == NULL)
+        {
+            inFile = stdin;
+        }
+
+        if (outFile == NULL)
+        {
+            outFile = stdout;
+        }
+    }
+
     if ((inFile == NULL) || (outFile == NULL))
     {
         fprintf(stderr, "Input and output files must be provided\n\n");
@@ -185,6 +348,8 @@ int main (int argc, char *argv[])
     }
 
     /* execute selected function */
+    HuffmanResetStats();
+
     switch (mode)
     {
         case SHOW_TREE:
@@ -199,10 +364,38 @@ int main (int argc, char *argv[])
             break;
 
         case COMPRESS:
-            if (canonical)
+            if (mapped)
+            {
+                status = CanonicalEncodeMapped(inName, outName);
+            }
+            else if (seekable)
+            {
+                status = CanonicalEncodeSeekable(inFile, outFile,
+                    numThreads);
+            }
+            else if (order1)
+            {
+                status = CanonicalEncodeStreamOrder1(inFile, outFile,
+                    numThreads);
+            }
+            else if (stream)
+            {
+                status = CanonicalEncodeStreamParallel(inFile, outFile,
+                    numThreads);
+            }
+            else if (canonical)
             {
                 status = CanonicalEncodeFile(inFile, outFile);
             }
+            else if (tradThreads > 0)
+            {
+                status = HuffmanEncodeFileParallel(inFile, outFile, compact,
+                    tradThreads);
+            }
+            else if (compact)
+            {
+                status = HuffmanEncodeFileCompact(inFile, outFile);
+            }
             else
             {
                 status = HuffmanEncodeFile(inFile, outFile);
@@ -210,9 +403,47 @@ int main (int argc, char *argv[])
             break;
 
         case DECOMPRESS:
-            if (canonical)
+            if (ranged)
+            {
+                status = -1;
+                range = NULL;
+
+                if (length > maxSize)
+                {
+                    fprintf(stderr, "Range is longer than the decode limit.\n");
+                    errno = ERANGE;
+                }
+                else if (NULL == (range = malloc((0 == length) ? 1 : length)))
+                {
+                    perror("Allocating Range");
+                }
+                else if (0 == CanonicalDecodeRange(inFile, offset, length,
+                    range))
+                {
+                    status = (fwrite(range, 1, length, outFile) == length) ?
+                        0 : -1;
+                }
+
+                free(range);
+            }
+            else if (mapped)
+            {
+                status = CanonicalDecodeMappedLimit(inName, outName, maxSize);
+            }
+            else if (stream)
+            {
+                status = CanonicalDecodeStreamParallelLimit(inFile, outFile,
+                    numThreads, maxSize);
+            }
+            else if (canonical)
+            {
+                status = CanonicalDecodeFileLimit(inFile, outFile, maxSize);
+            }
+            else if (ULONG_MAX != maxSize)
             {
-                status = CanonicalDecodeFile(inFile, outFile);
+                fprintf(stderr, "-l can't limit a traditional code.\n");
+                errno = EINVAL;
+                status = -1;
             }
             else
             {
@@ -225,6 +456,13 @@ int main (int argc, char *argv[])
             break;
     }
 
+    if (verbose)
+    {
+        error = errno;
+        ShowStats(stderr);
+        errno = error;
+    }
+
     /* clean up*/
     fclose(inFile);
     fclose(outFile);
@@ -259,7 +497,71 @@ static void ShowUsage(FILE *stream, char *progPath)
     fprintf(stream, "  -d : Decode input file to output file.\n");
     fprintf(stream,
         "  -t : Generate code tree for input file to output file.\n");
+    fprintf(stream,
+        "  -k : Encode a traditional code with a compact header.\n");
+    fprintf(stream,
+        "  -T<threads> : Encode a traditional code with this many threads."
+        "\n");
+    fprintf(stream,
+        "  -s : Encode/Decode a canonical code in blocks (input may be "
+        "a pipe).\n");
+    fprintf(stream,
+        "  -j<threads> : Code blocks with this many threads (implies -s)."
+        "\n");
+    fprintf(stream,
+        "  -p : Encode blocks (see -s) with codes chosen by the previous "
+        "byte.\n");
+    fprintf(stream,
+        "  -m : Encode/Decode blocks (see -s) with memory mapped files.\n");
+    fprintf(stream,
+        "  -x : Encode blocks (see -s) with an index for -r.\n");
+    fprintf(stream,
+        "  -r<offset>,<length> : Decode only this range of a file encoded "
+        "with -x.\n");
+    fprintf(stream,
+        "  -l<bytes> : Fail rather than decode more than this many bytes "
+        "(canonical codes only).\n");
     fprintf(stream, "  -i<filename> : Name of input file.\n");
     fprintf(stream, "  -o<filename> : Name of output file.\n");
+    fprintf(stream,
+        "  -v : Print statistics (library must be built with STATS=1).\n");
+    fprintf(stream,
+        "  With -s, input and output default to stdin and stdout.\n");
     fprintf(stream, "  -h|?  : Print out command line options.\n\n");
 }
+
+/****************************************************************************
+*   Function   : ShowStats
+*   Description: This function writes out the statistics collected by the
+*                Huffman library while coding.
+*   Parameters : stream - output stream receiving the statistics
+*   Effects    : The statistics are written to stream.
+*   Returned   : None
+****************************************************************************/
+static void ShowStats(FILE *stream)
+{
+    huffman_stats_t stats;
+
+    if (0 != HuffmanGetStats(&stats))
+    {
+        fprintf(stream, "No statistics (build the library with STATS=1).\n");
+        return;
+    }
+
+    fprintf(stream, "bytes in     : %.0f\n", stats.bytesIn);
+    fprintf(stream, "bytes out    : %.0f\n", stats.bytesOut);
+    fprintf(stream, "blocks       : %lu\n", stats.blocks);
+    fprintf(stream, "table builds : %lu\n", stats.tableBuilds);
+    fprintf(stream, "refills      : %lu\n", stats.refills);
+    fprintf(stream, "histogram    : %.3f ms\n", stats.histogramNs / 1e6);
+    fprintf(stream, "tree build   : %.3f ms\n", stats.treeNs / 1e6);
+    fprintf(stream, "header       : %.3f ms\n", stats.headerNs / 1e6);
+    fprintf(stream, "coding       : %.3f ms\n", stats.codingNs / 1e6);
+
+    if (stats.symbols > 0)
+    {
+        fprintf(stream, "code length  : %.4f bits/symbol (entropy %.4f)\n",
+            stats.codedBits / stats.symbols,
+            stats.entropyBits / stats.symbols);
+    }
+}
@@ -24,11 +24,39 @@ do
         diff $X bar
         filesize=$(stat -c '%s' foo)
         printf "traditional size:\t%d\n" $filesize
+        ./sample -k -c -i $X -o foo
+        ./sample -d -i foo -o bar
+        diff $X bar
+        filesize=$(stat -c '%s' foo)
+        printf "compact size:\t\t%d\n" $filesize
         ./sample -C -c -i $X -o foo
         ./sample -C -d -i foo -o bar
         diff $X bar
         filesize=$(stat -c '%s' foo)
-        printf "canonical size:\t\t%d\n\n" $filesize
+        printf "canonical size:\t\t%d\n" $filesize
+        ./sample -s -c < $X > foo
+        ./sample -s -d < foo > bar
+        diff $X bar
+        filesize=$(stat -c '%s' foo)
+        printf "stream size:\t\t%d\n" $filesize
+        ./sample -p -c < $X > foo
+        ./sample -s -d < foo > bar
+        diff $X bar
+        filesize=$(stat -c '%s' foo)
+        printf "order-1 size:\t\t%d\n" $filesize
+        ./sample -m -c -i $X -o foo
+        ./sample -m -d -i foo -o bar
+        diff $X bar
+        filesize=$(stat -c '%s' foo)
+        printf "mapped size:\t\t%d\n" $filesize
+        ./sample -x -c -i $X -o foo
+        ./sample -s -d -i foo -o bar
+        diff $X bar
+        third=$(($(stat -c '%s' $X) / 3))
+        ./sample -r $third,$third -i foo -o bar
+        tail -c +$((third + 1)) $X | head -c $third | diff - bar
+        filesize=$(stat -c '%s' foo)
+        printf "seekable size:\t\t%d\n\n" $filesize
         rm foo
         rm bar
     fi